@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Compares a Google Benchmark JSON result against a baseline.
+
+    CompareBaseline.py baseline.json result.json [--tolerance 0.25]
+
+Benchmarks are matched by name, aggregates (mean/median/stddev) are used when the runs were repeated,
+median first. Exits with 1 when a benchmark is slower than its baseline by more than the tolerance,
+benchmarks missing on either side are reported but do not fail.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, encoding="utf-8") as file:
+        benchmarks = json.load(file)["benchmarks"]
+
+    # Per run name, the median aggregate when there is one, else the first iteration run.
+    times = {}
+    for benchmark in benchmarks:
+        name = benchmark.get("run_name", benchmark["name"])
+        kind = benchmark.get("aggregate_name")
+        if kind not in (None, "median", "mean"):
+            continue
+        rank = {"median": 0, "mean": 1, None: 2}[kind]
+        # Manual and real time benchmarks report the timed part in real_time, the others are compared on cpu_time.
+        key = "real_time" if name.endswith(("/manual_time", "/real_time")) else "cpu_time"
+        if name not in times or rank < times[name][0]:
+            times[name] = (rank, benchmark[key], benchmark["time_unit"])
+    return {name: (time, unit) for name, (_, time, unit) in times.items()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("result")
+    parser.add_argument("--tolerance", type=float, default=0.25, help="allowed slowdown, 0.25 for 25%%")
+    arguments = parser.parse_args()
+
+    baseline = load(arguments.baseline)
+    result = load(arguments.result)
+    regressions = 0
+    for name in sorted(baseline.keys() | result.keys()):
+        if name not in result:
+            print(f"{name:<48} missing from the result")
+            continue
+        if name not in baseline:
+            print(f"{name:<48} new, {result[name][0]:.1f} {result[name][1]}")
+            continue
+        (before, unit), (after, result_unit) = baseline[name], result[name]
+        if unit != result_unit:
+            print(f"{name:<48} time unit changed from {unit} to {result_unit}")
+            regressions += 1
+            continue
+        change = after / before - 1 if before else 0.0
+        regressed = change > arguments.tolerance
+        regressions += regressed
+        print(f"{name:<48} {before:12.1f} {after:12.1f} {unit} {change:+8.1%}{'  REGRESSION' if regressed else ''}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,721 @@
+#include <benchmark/benchmark.h>
+
+#include <FetchTiming.h>
+#include <HostCollectionScheduler.h>
+#include <IOperatingSystemInfoFetcher.h>
+#include <InMemoryHostTransport.h>
+#include <InMemoryReg.h>
+#include <InMemoryWmi.h>
+#include <LanguageTags.h>
+#include <OperatingSystemInfoBitmapIndex.h>
+#include <OperatingSystemInfoDiff.h>
+#include <OperatingSystemInfoProvider.h>
+#include <OperatingSystemInfoStream.h>
+#include <OperatingSystemVersion.h>
+#include <RegistryBatch.h>
+#include <SharedOperatingSystemInfo.h>
+#include <ThreadPool.h>
+#include <Utf16Transcoder.h>
+#include <WindowsBuildCatalog.h>
+#include <WmiCimv2.h>
+#ifdef __linux__
+#include <OperatingSystemInfoSocket.h>
+#endif
+
+#include "OperatingSystemInfoSources.h"
+#include "Utf16.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Hot paths of the provider and the Windows fetcher, run against InMemoryWmi and InMemoryReg so they build anywhere.
+//
+// "Cold" benchmarks time the first call on freshly built state (new provider, new WMI provider, newly opened key),
+// the setup itself is not timed. "Warm" benchmarks time the steady state of repeated calls.
+// Run with --benchmark_format=json, Benchmark/CompareBaseline.py checks the result against Benchmark/baseline.json.
+namespace
+{
+using Field = OperatingSystemInfoField;
+
+constexpr const char* CurrentVersionPath = "SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion";
+
+// Windows 10 Pro 22H2, Japanese UI.
+constexpr const char* OperatingSystemMof = R"(
+instance of Win32_OperatingSystem
+{
+    Caption = "Microsoft Windows 10 Pro";
+    OSArchitecture = "64-bit";
+    MUILanguages = {"ja-JP"};
+    Locale = "0411";
+    Version = "10.0.19045";
+    OSLanguage = 1041;
+    ServicePackMajorVersion = 0;
+    ServicePackMinorVersion = 0;
+};
+)";
+
+struct Machine
+{
+    Machine()
+    {
+        Wmi.Parse(OperatingSystemMof);
+        Registry.SetStringValue(CurrentVersionPath, "ProductName", L"Windows 10 Pro");
+        Registry.SetStringValue(CurrentVersionPath, "EditionID", L"Professional");
+        Registry.SetStringValue(CurrentVersionPath, "BuildBranch", L"vb_release");
+        Registry.SetStringValue(CurrentVersionPath, "ReleaseId", L"2009");
+        Registry.SetStringValue(CurrentVersionPath, "DisplayVersion", L"22H2");
+        Registry.SetIntValue(CurrentVersionPath, "CurrentMajorVersionNumber", 10);
+        Registry.SetIntValue(CurrentVersionPath, "CurrentMinorVersionNumber", 0);
+        Registry.SetStringValue(CurrentVersionPath, "CurrentVersion", L"6.3");
+        Registry.SetStringValue(CurrentVersionPath, "CurrentBuildNumber", L"19045");
+        Registry.SetStringValue(CurrentVersionPath, "CurrentBuild", L"19045");
+        Registry.SetIntValue(CurrentVersionPath, "UBR", 3803);
+        Registry.SetStringValue(CurrentVersionPath, "InstallationType", L"Client");
+        Registry.SetInt64Value(CurrentVersionPath, "InstallTime", 133000000000000000ull);
+        Registry.SetBinaryValue(CurrentVersionPath, "DigitalProductId", std::vector<std::byte>(164));
+        Registry.SetStringValue(CurrentVersionPath, "RegisteredOwner", L"\u5c71\u7530\u592a\u90ce");
+        Registry.SetStringValue(CurrentVersionPath, "SystemRoot", L"C:\\Windows");
+    }
+
+    InMemoryWmiRepository Wmi;
+    InMemoryRegistry Registry;
+};
+
+const Machine& GetMachine()
+{
+    static const Machine machine;
+    return machine;
+}
+
+// Runs the same steps as OperatingSystemInfoFetcher, over the in-memory backends.
+class InMemoryFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit InMemoryFetcher(const Machine& machine) : m_Machine(machine)
+    {
+    }
+
+    OperatingSystemInfo GetInformation() override
+    {
+        return GetInformation(OperatingSystemInfoFieldMask::All());
+    }
+
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields) override
+    {
+        auto needed = detail::GetNeededFields(fields);
+
+        OperatingSystemInfo result;
+        if (needed.Intersects(detail::s_WmiFields))
+        {
+            InMemoryWmi provider(m_Machine.Wmi);
+            detail::ReadOperatingSystemObject(provider, needed, fields, result);
+        }
+        if (needed.Intersects(detail::s_RegistryFields))
+        {
+            InMemoryReg reg;
+            reg.Open(m_Machine.Registry, CurrentVersionPath);
+            detail::ReadCurrentVersionValues(reg, result);
+        }
+        detail::CompleteInformation(fields, result);
+        return result;
+    }
+
+private:
+    const Machine& m_Machine;
+};
+
+OperatingSystemInfo GetSampleInformation()
+{
+    return InMemoryFetcher(GetMachine()).GetInformation();
+}
+
+template <class TFunction> double TimeSeconds(TFunction&& function)
+{
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Provider, including FillDefaultValues for the fields the fake machine does not have (CSDVersion, CSDBuildNumber).
+
+void Provider_Uncached(benchmark::State& state)
+{
+    OperatingSystemInfoProvider provider(std::make_unique<InMemoryFetcher>(GetMachine()));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(provider.GetInformation());
+    }
+}
+BENCHMARK(Provider_Uncached);
+
+void Provider_Cached_Cold(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        OperatingSystemInfoProvider provider(std::make_unique<InMemoryFetcher>(GetMachine()), std::chrono::hours(1));
+        state.SetIterationTime(TimeSeconds([&provider] { benchmark::DoNotOptimize(provider.GetInformation()); }));
+    }
+}
+BENCHMARK(Provider_Cached_Cold)->UseManualTime();
+
+void Provider_Cached_Warm(benchmark::State& state)
+{
+    OperatingSystemInfoProvider provider(std::make_unique<InMemoryFetcher>(GetMachine()), std::chrono::hours(1));
+    provider.GetInformation();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(provider.GetInformation());
+    }
+}
+BENCHMARK(Provider_Cached_Warm);
+
+void Provider_Cached_Warm_TwoFields(benchmark::State& state)
+{
+    OperatingSystemInfoProvider provider(std::make_unique<InMemoryFetcher>(GetMachine()), std::chrono::hours(1));
+    provider.GetInformation();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(provider.GetInformation({Field::Caption, Field::UBR}));
+    }
+}
+BENCHMARK(Provider_Cached_Warm_TwoFields);
+
+// Registry read of [HKLM\SOFTWARE\Microsoft\Windows NT\CurrentVersion], batched and one value at a time.
+
+void Registry_Batch_Cold(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        InMemoryReg reg;
+        OperatingSystemInfo info;
+        state.SetIterationTime(TimeSeconds([&] {
+            reg.Open(GetMachine().Registry, CurrentVersionPath);
+            detail::ReadCurrentVersionValues(reg, info);
+        }));
+        benchmark::DoNotOptimize(info);
+    }
+}
+BENCHMARK(Registry_Batch_Cold)->UseManualTime();
+
+void Registry_Batch_Warm(benchmark::State& state)
+{
+    InMemoryReg reg;
+    reg.Open(GetMachine().Registry, CurrentVersionPath);
+    for (auto _ : state)
+    {
+        OperatingSystemInfo info;
+        detail::ReadCurrentVersionValues(reg, info);
+        benchmark::DoNotOptimize(info);
+    }
+}
+BENCHMARK(Registry_Batch_Warm);
+
+void Registry_PerField_Warm(benchmark::State& state)
+{
+    InMemoryReg reg;
+    reg.Open(GetMachine().Registry, CurrentVersionPath);
+    for (auto _ : state)
+    {
+        OperatingSystemInfo info;
+        ReadValues(reg, Bind<RegistryValueType::String>("EditionID", info.EditionID));
+        ReadValues(reg, Bind<RegistryValueType::String>("BuildBranch", info.BuildBranch));
+        ReadValues(reg, Bind<RegistryValueType::String>("ReleaseId", info.ReleaseId));
+        ReadValues(reg, Bind<RegistryValueType::Dword>("CurrentMajorVersionNumber", info.CurrentMajorVersionNumber));
+        ReadValues(reg, Bind<RegistryValueType::Dword>("CurrentMinorVersionNumber", info.CurrentMinorVersionNumber));
+        ReadValues(reg, Bind<RegistryValueType::String>("CurrentVersion", info.CurrentVersion));
+        ReadValues(reg, Bind<RegistryValueType::String>("CurrentBuildNumber", info.CurrentBuildNumber));
+        ReadValues(reg, Bind<RegistryValueType::Dword>("UBR", info.UBR));
+        ReadValues(reg, Bind<RegistryValueType::String>("CSDVersion", info.CSDVersion));
+        ReadValues(reg, Bind<RegistryValueType::String>("CSDBuildNumber", info.CSDBuildNumber));
+        benchmark::DoNotOptimize(info);
+    }
+}
+BENCHMARK(Registry_PerField_Warm);
+
+// WMI Win32_OperatingSystem extraction, query parsing included.
+
+void Wmi_OSInfo_Cold(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        InMemoryWmi provider(GetMachine().Wmi);
+        state.SetIterationTime(TimeSeconds([&provider] { benchmark::DoNotOptimize(WmiCimv2(provider).GetOSInfo()); }));
+    }
+}
+BENCHMARK(Wmi_OSInfo_Cold)->UseManualTime();
+
+void Wmi_OSInfo_Warm(benchmark::State& state)
+{
+    InMemoryWmi provider(GetMachine().Wmi);
+    WmiCimv2 wmi(provider);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(wmi.GetOSInfo());
+    }
+}
+BENCHMARK(Wmi_OSInfo_Warm);
+
+// detail::ToUtf8String over WMI-sized strings, argument is the length in characters.
+
+void ToUtf8String_Ascii(benchmark::State& state)
+{
+    std::wstring text(static_cast<size_t>(state.range(0)), L'W');
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(detail::ToUtf8String(text));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<int64_t>(sizeof(wchar_t)));
+}
+BENCHMARK(ToUtf8String_Ascii)->Arg(8)->Arg(32)->Arg(256);
+
+void ToUtf8String_Japanese(benchmark::State& state)
+{
+    std::wstring text;
+    while (text.size() < static_cast<size_t>(state.range(0)))
+    {
+        text += L"Windows \u65e5\u672c\u8a9e ";
+    }
+    text.resize(static_cast<size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(detail::ToUtf8String(text));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<int64_t>(sizeof(wchar_t)));
+}
+BENCHMARK(ToUtf8String_Japanese)->Arg(8)->Arg(32)->Arg(256);
+
+// UTF-16 transcoder at each SIMD level, wchar_t is UTF-32 here so ToUtf8String does not go through it.
+// Arguments are the SIMD level and the length in code units.
+
+std::u16string MakeUtf16Text(const char16_t* pattern, size_t length)
+{
+    std::u16string text;
+    while (text.size() < length)
+    {
+        text += pattern;
+    }
+    text.resize(length);
+    return text;
+}
+
+void Utf16ToUtf8(benchmark::State& state, const char16_t* pattern)
+{
+    auto level = static_cast<SimdLevel>(state.range(0));
+    auto text = MakeUtf16Text(pattern, static_cast<size_t>(state.range(1)));
+    std::string output(GetUtf8BufferSize(text.size()), '\0');
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ConvertUtf16ToUtf8(text.data(), text.size(), &output[0], level));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(1) * 2);
+}
+
+void Utf16ToUtf8Arguments(benchmark::internal::Benchmark* benchmark)
+{
+    for (auto level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2})
+    {
+        if (level <= GetSupportedSimdLevel())
+        {
+            benchmark->Args({static_cast<int64_t>(level), 32})->Args({static_cast<int64_t>(level), 4096});
+        }
+    }
+}
+BENCHMARK_CAPTURE(Utf16ToUtf8, Ascii, u"Microsoft Windows 10 Pro ")->Apply(Utf16ToUtf8Arguments);
+BENCHMARK_CAPTURE(Utf16ToUtf8, Japanese, u"Windows \u65e5\u672c\u8a9e ")->Apply(Utf16ToUtf8Arguments);
+
+// The string fields of a snapshot converted in one call.
+void Utf16ToUtf8_Bulk(benchmark::State& state)
+{
+    std::vector<std::u16string> values;
+    for (auto value : {u"Microsoft Windows 10 Pro", u"64-bit", u"ja-JP", u"0411", u"10.0.19045", u"Professional",
+                       u"vb_release", u"2009", u"6.3", u"19045", u"\u5c71\u7530\u592a\u90ce"})
+    {
+        values.emplace_back(value);
+    }
+    std::vector<Utf16String> strings;
+    size_t count = 0;
+    for (const auto& value : values)
+    {
+        strings.push_back({value.data(), value.size()});
+        count += value.size();
+    }
+    std::string output(GetUtf8BufferSize(count), '\0');
+    std::vector<size_t> ends(strings.size());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ConvertUtf16ToUtf8(strings.data(), strings.size(), &output[0], ends.data()));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(strings.size()));
+}
+BENCHMARK(Utf16ToUtf8_Bulk);
+
+// Build catalog lookups.
+
+void FindWindowsRelease_Build(benchmark::State& state)
+{
+    const uint32_t builds[] = {10240, 17763, 19045, 22000, 22631, 26100, 12345};
+    for (auto _ : state)
+    {
+        for (auto build : builds)
+        {
+            benchmark::DoNotOptimize(FindWindowsRelease(build));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(std::size(builds)));
+}
+BENCHMARK(FindWindowsRelease_Build);
+
+void FindWindowsRelease_Branch(benchmark::State& state)
+{
+    const std::string_view branches[] = {"th1", "rs5_release", "vb_release", "co_release", "ni_release", "ge_release", "xx_release"};
+    for (auto _ : state)
+    {
+        for (auto branch : branches)
+        {
+            benchmark::DoNotOptimize(FindWindowsReleaseByBranch(branch));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(std::size(branches)));
+}
+BENCHMARK(FindWindowsRelease_Branch);
+
+void FindWindowsRelease_Information(benchmark::State& state)
+{
+    auto info = GetSampleInformation();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(detail::FindRelease(info));
+    }
+}
+BENCHMARK(FindWindowsRelease_Information);
+
+// operator<< of a fully populated OperatingSystemInfo.
+
+void Stream_Information(benchmark::State& state)
+{
+    auto info = GetSampleInformation();
+    std::ostringstream out;
+    for (auto _ : state)
+    {
+        out.str(std::string());
+        out << info;
+        benchmark::DoNotOptimize(out.tellp());
+    }
+}
+BENCHMARK(Stream_Information);
+
+// Collection of 256 hosts through the in-memory transport, 1 to 2 ms per attempt and 5% of failed attempts,
+// with the concurrency as argument. Reported in hosts per second of wall time.
+void HostCollection(benchmark::State& state)
+{
+    const auto& machine = GetMachine();
+    InMemoryHostTransportOptions transportOptions;
+    transportOptions.MinLatency = std::chrono::milliseconds(1);
+    transportOptions.MaxLatency = std::chrono::milliseconds(2);
+    transportOptions.FailureRate = 0.05;
+    InMemoryHostTransport transport(machine.Wmi, machine.Registry, transportOptions);
+
+    auto concurrency = static_cast<size_t>(state.range(0));
+    ThreadPool pool(concurrency);
+    HostCollectionOptions options;
+    options.MaxConcurrency = concurrency;
+    options.InitialBackoff = std::chrono::milliseconds(1);
+    HostCollectionScheduler scheduler(pool, transport, options);
+
+    std::vector<std::string> hosts;
+    for (int i = 0; i < 256; ++i)
+    {
+        hosts.push_back("host" + std::to_string(i));
+    }
+    for (auto _ : state)
+    {
+        auto statistics = scheduler.Collect(hosts, [](const HostCollectionResult& result) {
+            benchmark::DoNotOptimize(result.Status);
+        });
+        benchmark::DoNotOptimize(statistics.Succeeded);
+    }
+    state.counters["hosts/s"] =
+        benchmark::Counter(static_cast<double>(hosts.size() * state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(HostCollection)->Arg(16)->Arg(64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Diff of two fully populated snapshots differing by their UBR.
+
+void Diff_Pair(benchmark::State& state)
+{
+    auto previous = GetSampleInformation();
+    auto current = previous;
+    current.UBR = "4046";
+    OperatingSystemInfoChangeSet changes;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(DiffOperatingSystemInfo(previous, current, changes));
+    }
+}
+BENCHMARK(Diff_Pair);
+
+// Batch diff of 65536 pairs on a pool of 4 threads, one pair in 16 has a new UBR.
+// Reported in pairs per second of wall time.
+void Diff_Batch(benchmark::State& state, bool compact)
+{
+    constexpr size_t PairCount = 65536;
+    auto previousInfo = GetSampleInformation();
+    auto currentInfo = previousInfo;
+    currentInfo.UBR = "4046";
+    std::vector<OperatingSystemInfo> previous(PairCount, previousInfo);
+    std::vector<OperatingSystemInfo> current(PairCount, previousInfo);
+    for (size_t i = 0; i < PairCount; i += 16)
+    {
+        current[i] = currentInfo;
+    }
+    OperatingSystemInfoStringPool strings;
+    std::vector<CompactOperatingSystemInfo> previousCompact(PairCount, CompactOperatingSystemInfo::Pack(previousInfo, strings));
+    std::vector<CompactOperatingSystemInfo> currentCompact(previousCompact);
+    for (size_t i = 0; i < PairCount; i += 16)
+    {
+        currentCompact[i] = CompactOperatingSystemInfo::Pack(currentInfo, strings);
+    }
+
+    ThreadPool pool(4);
+    OperatingSystemInfoBatchDiff diff(pool);
+    std::vector<OperatingSystemInfoFieldMask> changed;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(compact ? diff.Diff(previousCompact, currentCompact, changed)
+                                         : diff.Diff(previous, current, changed));
+    }
+    state.counters["pairs/s"] =
+        benchmark::Counter(static_cast<double>(PairCount * state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(Diff_Batch, Full, false)->UseRealTime();
+BENCHMARK_CAPTURE(Diff_Batch, Compact, true)->UseRealTime();
+
+// Cost of one FetchTimingSpan, two clock reads and the histogram update. Nothing when the timing is compiled out.
+
+void FetchTimingSpan_Overhead(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        FetchTimingSpan span(FetchStage::RegistryRead);
+    }
+}
+BENCHMARK(FetchTimingSpan_Overhead);
+
+// Read of a fully populated snapshot out of the shared-memory segment, as a record view over the reader's buffer
+// or converted to an OperatingSystemInfo.
+void SharedSnapshot_Read(benchmark::State& state, bool view)
+{
+    auto name = "Benchmark." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    SharedOperatingSystemInfoPublisher publisher(name);
+    SharedOperatingSystemInfoReader reader(name);
+    if (!publisher.Open() || !publisher.Publish(GetSampleInformation()) || !reader.Open())
+    {
+        state.SkipWithError("Cannot create the shared-memory segment");
+        return;
+    }
+    OperatingSystemInfoRecordView record;
+    OperatingSystemInfo info;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(view ? reader.Read(record, std::chrono::hours(1)) : reader.Read(info, std::chrono::hours(1)));
+    }
+}
+BENCHMARK_CAPTURE(SharedSnapshot_Read, View, true);
+BENCHMARK_CAPTURE(SharedSnapshot_Read, Info, false);
+
+// LCID to tag and back, over a few locales so the lookups do not all hit the same cache line.
+void LanguageTag_Lookup(benchmark::State& state, bool toLcid)
+{
+    constexpr uint32_t Lcids[] = {0x0409, 0x0411, 0x0407, 0x0804, 0x7C04, 0x0C0A, 0x0416, 0x0419};
+    std::string_view tags[std::size(Lcids)];
+    for (size_t i = 0; i < std::size(Lcids); ++i)
+    {
+        tags[i] = GetLanguageTag(Lcids[i]);
+    }
+    size_t i = 0;
+    uint32_t lcid = 0;
+    for (auto _ : state)
+    {
+        if (toLcid)
+        {
+            benchmark::DoNotOptimize(FindLcid(tags[i], lcid));
+        }
+        else
+        {
+            benchmark::DoNotOptimize(GetLanguageTag(Lcids[i]));
+        }
+        i = (i + 1) % std::size(Lcids);
+    }
+}
+BENCHMARK_CAPTURE(LanguageTag_Lookup, ToTag, false);
+BENCHMARK_CAPTURE(LanguageTag_Lookup, ToLcid, true);
+
+// One million Version strings of Windows 10 and 11 builds, with varying UBRs.
+std::vector<std::string> MakeVersionColumn()
+{
+    constexpr const char* Builds[] = {"10.0.17763.", "10.0.19044.", "10.0.19045.", "10.0.22621.", "10.0.22631."};
+    std::vector<std::string> column;
+    column.reserve(1 << 20);
+    for (uint32_t i = 0; i < (1 << 20); ++i)
+    {
+        column.push_back(Builds[i % std::size(Builds)] + std::to_string(i * 2654435761u % 5000));
+    }
+    return column;
+}
+
+// Reported in strings per second.
+void OperatingSystemVersion_Parse(benchmark::State& state, SimdLevel level)
+{
+    auto column = MakeVersionColumn();
+    std::vector<std::string_view> texts(column.begin(), column.end());
+    std::vector<OperatingSystemVersion> versions(texts.size());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ParseOperatingSystemVersions(texts.data(), texts.size(), versions.data(), level));
+    }
+    state.counters["strings/s"] =
+        benchmark::Counter(static_cast<double>(texts.size() * state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(OperatingSystemVersion_Parse, Scalar, SimdLevel::Scalar)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(OperatingSystemVersion_Parse, Avx2, SimdLevel::Avx2)->Unit(benchmark::kMillisecond);
+
+// Index of one million snapshots, then the query for the hosts older than 10.0.19045.3000.
+void OperatingSystemVersionIndex_Build(benchmark::State& state)
+{
+    auto column = MakeVersionColumn();
+    std::vector<std::string_view> texts(column.begin(), column.end());
+    std::vector<OperatingSystemVersion> versions(texts.size());
+    ParseOperatingSystemVersions(texts.data(), texts.size(), versions.data());
+    OperatingSystemVersionIndex index;
+    for (auto _ : state)
+    {
+        index.Build(versions.data(), versions.size());
+    }
+}
+BENCHMARK(OperatingSystemVersionIndex_Build)->Unit(benchmark::kMillisecond);
+
+void OperatingSystemVersionIndex_Below(benchmark::State& state)
+{
+    auto column = MakeVersionColumn();
+    std::vector<std::string_view> texts(column.begin(), column.end());
+    std::vector<OperatingSystemVersion> versions(texts.size());
+    ParseOperatingSystemVersions(texts.data(), texts.size(), versions.data());
+    OperatingSystemVersionIndex index;
+    index.Build(versions.data(), versions.size());
+    const auto threshold = OperatingSystemVersion::Make(10, 0, 19045, 3000);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(index.Below(threshold).Size());
+    }
+}
+BENCHMARK(OperatingSystemVersionIndex_Below);
+
+constexpr uint32_t BitmapIndexHosts = 1 << 20;
+
+OperatingSystemInfo MakeFleetSnapshot(uint32_t host)
+{
+    constexpr const char* Editions[] = {"Enterprise", "Professional", "Core", "Education"};
+    constexpr const char* Codenames[] = {"RS5", "19H1", "20H1", "21H2", "22H2", "23H2"};
+    const auto hash = host * 2654435761u;
+    OperatingSystemInfo info;
+    info.EditionID = Editions[(hash >> 8) % std::size(Editions)];
+    info.Codename = Codenames[(hash >> 12) % std::size(Codenames)];
+    info.OSArchitecture = (hash >> 20) % 8 == 0 ? "32-bit" : "64-bit";
+    info.CurrentMajorVersionNumber = "10";
+    return info;
+}
+
+void BuildFleetIndex(OperatingSystemInfoBitmapIndex& index)
+{
+    for (uint32_t host = 0; host < BitmapIndexHosts; ++host)
+    {
+        index.Update(host, MakeFleetSnapshot(host));
+    }
+}
+
+// EditionID = "Enterprise" AND Codename = "RS5" AND OSArchitecture = "64-bit" over one million hosts.
+void OperatingSystemInfoBitmapIndex_Filter(benchmark::State& state, SimdLevel level)
+{
+    OperatingSystemInfoBitmapIndex index;
+    BuildFleetIndex(index);
+    OperatingSystemInfoBitmap result;
+    for (auto _ : state)
+    {
+        const OperatingSystemInfoBitmapView terms[] = {index.Find(Field::EditionID, "Enterprise"),
+                                                       index.Find(Field::Codename, "RS5"),
+                                                       index.Find(Field::OSArchitecture, "64-bit")};
+        AndBitmaps(terms, std::size(terms), result, level);
+        benchmark::DoNotOptimize(result.Empty());
+    }
+    state.counters["hosts"] = static_cast<double>(result.Cardinality());
+}
+BENCHMARK_CAPTURE(OperatingSystemInfoBitmapIndex_Filter, Scalar, SimdLevel::Scalar)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(OperatingSystemInfoBitmapIndex_Filter, Avx2, SimdLevel::Avx2)->Unit(benchmark::kMicrosecond);
+
+// EditionID = "Enterprise" AND OSArchitecture = "64-bit", every container stays a bitset, so this times only the
+// bitset combine. The filter above spends most of its time turning small results into arrays.
+void OperatingSystemInfoBitmapIndex_FilterBitsets(benchmark::State& state, SimdLevel level)
+{
+    OperatingSystemInfoBitmapIndex index;
+    BuildFleetIndex(index);
+    OperatingSystemInfoBitmap result;
+    for (auto _ : state)
+    {
+        AndBitmaps(index.Find(Field::EditionID, "Enterprise"), index.Find(Field::OSArchitecture, "64-bit"), result,
+                   level);
+        benchmark::DoNotOptimize(result.Empty());
+    }
+    state.counters["hosts"] = static_cast<double>(result.Cardinality());
+}
+BENCHMARK_CAPTURE(OperatingSystemInfoBitmapIndex_FilterBitsets, Scalar, SimdLevel::Scalar)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(OperatingSystemInfoBitmapIndex_FilterBitsets, Avx2, SimdLevel::Avx2)->Unit(benchmark::kMicrosecond);
+
+// New snapshot of one host in an index of one million, changing its edition and codename.
+void OperatingSystemInfoBitmapIndex_Update(benchmark::State& state)
+{
+    OperatingSystemInfoBitmapIndex index;
+    BuildFleetIndex(index);
+    const OperatingSystemInfo snapshots[] = {MakeFleetSnapshot(1), MakeFleetSnapshot(2)};
+    uint32_t host = 0;
+    for (auto _ : state)
+    {
+        host = (host + 7919) % BitmapIndexHosts;
+        index.Update(host, snapshots[host & 1]);
+    }
+}
+BENCHMARK(OperatingSystemInfoBitmapIndex_Update);
+} // namespace
+
+#ifdef __linux__
+// Round trip of one client to an OperatingSystemInfoServer answering from its response cache: the request and
+// response syscalls, two context switches and the record parse.
+void SocketQuery_Cached(benchmark::State& state)
+{
+    OperatingSystemInfoProvider provider(std::make_unique<InMemoryFetcher>(GetMachine()), std::chrono::hours(1));
+    OperatingSystemInfoServerOptions options;
+    options.TimeToLive = std::chrono::hours(1);
+    OperatingSystemInfoServer server(provider, options);
+    OperatingSystemInfoClient client;
+    const auto path = (std::filesystem::temp_directory_path() / "OperatingSystemInfoBenchmark.sock").string();
+    OperatingSystemInfo info;
+    if (!server.Start(path) || !client.Connect(path) || !client.Query(OperatingSystemInfoFieldMask::All(), info))
+    {
+        state.SkipWithError("Cannot start the server");
+        return;
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(client.Query(OperatingSystemInfoFieldMask::All(), info));
+    }
+}
+BENCHMARK(SocketQuery_Cached)->UseRealTime();
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,87 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <CompactOperatingSystemInfo.h>
+
+namespace
+{
+OperatingSystemInfo MakeInfo(const char* ubr)
+{
+    OperatingSystemInfo info;
+    info.OSVersion = "Microsoft Windows 10 Pro[64-bit OS][System Locale en-US]";
+    info.Caption = "Microsoft Windows 10 Pro";
+    info.EditionID = "Professional";
+    info.OSArchitecture = "64-bit";
+    info.BuildBranch = "rs5_release";
+    info.ReleaseId = "1809";
+    info.Version = "10.0.17763";
+    info.CurrentMajorVersionNumber = "10";
+    info.CurrentMinorVersionNumber = "0";
+    info.CurrentVersion = "6.3";
+    info.CurrentBuildNumber = "17763";
+    info.UBR = ubr;
+    info.MUILanguage = "en-US";
+    info.OSLanguage = "1033";
+    info.Locale = "0409";
+    info.ServicePackMajorVersion = "N/A";
+    return info;
+}
+
+void ExpectEqual(const OperatingSystemInfo& expected, const OperatingSystemInfo& actual)
+{
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        auto field = static_cast<OperatingSystemInfoField>(i);
+        EXPECT_EQ(GetField(expected, field), GetField(actual, field)) << "field " << i;
+    }
+}
+} // namespace
+
+TEST(CompactOperatingSystemInfo, RoundTripsLosslessly)
+{
+    OperatingSystemInfoStringPool strings;
+    auto info = MakeInfo("4252");
+    info.CurrentMinorVersionNumber = "00";
+    info.ServicePackMinorVersion = "";
+    info.CSDBuildNumber = "4294967296";
+
+    auto compact = CompactOperatingSystemInfo::Pack(info, strings);
+    EXPECT_TRUE(compact.Inlined.Has(OperatingSystemInfoField::UBR));
+    EXPECT_TRUE(compact.Inlined.Has(OperatingSystemInfoField::OSLanguage));
+    EXPECT_FALSE(compact.Inlined.Has(OperatingSystemInfoField::CurrentMinorVersionNumber));
+    EXPECT_FALSE(compact.Inlined.Has(OperatingSystemInfoField::ServicePackMajorVersion));
+    EXPECT_FALSE(compact.Present.Has(OperatingSystemInfoField::Codename));
+
+    ExpectEqual(info, compact.Unpack(strings));
+}
+
+TEST(CompactOperatingSystemInfo, SharesStringsAcrossRecords)
+{
+    OperatingSystemInfoStringPool strings;
+    auto first = CompactOperatingSystemInfo::Pack(MakeInfo("1"), strings);
+    auto interned = strings.Size();
+    auto second = CompactOperatingSystemInfo::Pack(MakeInfo("2"), strings);
+
+    EXPECT_EQ(strings.Size(), interned);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first, CompactOperatingSystemInfo::Pack(MakeInfo("1"), strings));
+    EXPECT_EQ(first.Hash(), CompactOperatingSystemInfo::Pack(MakeInfo("1"), strings).Hash());
+    EXPECT_LE(sizeof(CompactOperatingSystemInfo) * 8, sizeof(OperatingSystemInfo));
+}
+
+TEST(OperatingSystemInfoInventory, DeduplicatesSnapshots)
+{
+    OperatingSystemInfoInventory inventory;
+    std::vector<uint32_t> hosts;
+    for (int host = 0; host < 1000; ++host)
+    {
+        hosts.push_back(inventory.Add(MakeInfo(host % 2 ? "4252" : "4377")));
+    }
+    hosts.push_back(inventory.Add(OperatingSystemInfo{}));
+
+    EXPECT_EQ(inventory.Size(), 3u);
+    EXPECT_EQ(hosts[0], hosts[2]);
+    EXPECT_NE(hosts[0], hosts[1]);
+    ExpectEqual(MakeInfo("4377"), inventory.Get(hosts[0]));
+    ExpectEqual(OperatingSystemInfo{}, inventory.Get(hosts.back()));
+}
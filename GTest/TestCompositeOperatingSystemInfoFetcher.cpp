@@ -0,0 +1,339 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <CompositeOperatingSystemInfoFetcher.h>
+#include <OperatingSystemInfoDiff.h>
+#include <ThreadPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace
+{
+using Field = OperatingSystemInfoField;
+
+// Answers after an optional delay or once released, with its name as the value of every requested field.
+class FakeFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit FakeFetcher(std::string name, std::chrono::milliseconds delay = {}, bool blocked = false)
+        : m_Name(std::move(name)), m_Delay(delay), m_Blocked(blocked)
+    {
+    }
+
+    OperatingSystemInfo GetInformation() override
+    {
+        return GetInformation(OperatingSystemInfoFieldMask::All());
+    }
+
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields) override
+    {
+        ++Calls;
+        LastFields = fields;
+        std::this_thread::sleep_for(m_Delay);
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Released.wait(lock, [this] { return !m_Blocked; });
+        }
+        if (m_Name == "throw")
+        {
+            throw std::runtime_error("unavailable");
+        }
+        OperatingSystemInfo info;
+        for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+        {
+            if (fields.Has(static_cast<Field>(i)))
+            {
+                GetField(info, static_cast<Field>(i)) = m_Name;
+            }
+        }
+        // An empty value counts as missing.
+        info.Locale = "";
+        return info;
+    }
+
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Blocked = false;
+        m_Released.notify_all();
+    }
+
+    std::atomic<int> Calls{0};
+    OperatingSystemInfoFieldMask LastFields;
+
+private:
+    std::string m_Name;
+    std::chrono::milliseconds m_Delay;
+    std::mutex m_Mutex;
+    std::condition_variable m_Released;
+    bool m_Blocked;
+};
+
+// Stands for WMI stopping at its deadline partway: answers the Caption and times out on the other fields.
+class PartialFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    OperatingSystemInfo GetInformation() override
+    {
+        return GetInformation(OperatingSystemInfoFieldMask::All());
+    }
+
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields, std::chrono::steady_clock::time_point,
+                                       OperatingSystemInfoFieldMask& timedOut, LateFieldsCallback) override
+    {
+        OperatingSystemInfo info;
+        info.Caption = "wmi";
+        timedOut = fields & ~OperatingSystemInfoFieldMask{Field::Caption};
+        return info;
+    }
+    using IOperatingSystemInfoFetcher::GetInformation;
+};
+} // namespace
+
+TEST(CompositeOperatingSystemInfoFetcher, MergesByFieldPriority)
+{
+    ThreadPool pool(3);
+    auto registry = std::make_shared<FakeFetcher>("registry", std::chrono::milliseconds(20));
+    auto hive = std::make_shared<FakeFetcher>("hive");
+    auto wmi = std::make_shared<FakeFetcher>("wmi");
+    CompositeOperatingSystemInfoFetcher fetcher(pool);
+    auto registrySource = fetcher.AddSource(registry, 10, {Field::EditionID, Field::UBR, Field::CurrentBuildNumber});
+    fetcher.AddSource(hive, 5, {Field::EditionID, Field::UBR, Field::CurrentBuildNumber, Field::BuildBranch});
+    fetcher.AddSource(wmi, 10, {Field::Caption, Field::Locale, Field::CurrentBuildNumber});
+    fetcher.SetPriority(registrySource, Field::UBR, 1);
+
+    auto info = fetcher.GetInformation({Field::EditionID, Field::UBR, Field::BuildBranch, Field::Caption,
+                                        Field::Locale, Field::CurrentBuildNumber, Field::OSVersion});
+    // The slower registry wins over the hive, except for UBR where it has the lowest priority.
+    EXPECT_EQ(info.EditionID, "registry");
+    EXPECT_EQ(info.UBR, "hive");
+    EXPECT_EQ(info.BuildBranch, "hive");
+    EXPECT_EQ(info.Caption, "wmi");
+    // Same priority, the source added first wins.
+    EXPECT_EQ(info.CurrentBuildNumber, "registry");
+    // Empty everywhere, or provided by no source.
+    EXPECT_FALSE(info.Locale);
+    EXPECT_FALSE(info.OSVersion);
+    EXPECT_FALSE(info.ReleaseId);
+
+    // Each source is only asked for its own fields.
+    EXPECT_EQ(wmi->LastFields, (OperatingSystemInfoFieldMask{Field::Caption, Field::Locale, Field::CurrentBuildNumber}));
+
+    info = fetcher.GetInformation(OperatingSystemInfoFieldMask{Field::BuildBranch});
+    EXPECT_EQ(info.BuildBranch, "hive");
+    EXPECT_EQ(registry->Calls, 1);
+    EXPECT_EQ(hive->Calls, 2);
+    EXPECT_EQ(fetcher.GetStatistics().Started, 4u);
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, ReturnsBeforeSlowerSources)
+{
+    ThreadPool pool(2);
+    auto fast = std::make_shared<FakeFetcher>("fast");
+    auto slow = std::make_shared<FakeFetcher>("slow", std::chrono::milliseconds(0), true);
+    {
+        CompositeOperatingSystemInfoFetcher fetcher(pool);
+        fetcher.AddSource(fast, 10, {Field::Caption, Field::Version});
+        fetcher.AddSource(slow, 1);
+
+        // The slow source can't replace anything, the call does not wait for it.
+        auto info = fetcher.GetInformation({Field::Caption, Field::Version});
+        EXPECT_EQ(info.Caption, "fast");
+        EXPECT_EQ(info.Version, "fast");
+
+        // Blocks until the slow source answers, it is the only one with the field.
+        std::thread release([&slow] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            slow->Release();
+        });
+        info = fetcher.GetInformation({Field::Caption, Field::UBR});
+        release.join();
+        EXPECT_EQ(info.Caption, "fast");
+        EXPECT_EQ(info.UBR, "slow");
+        EXPECT_EQ(slow->Calls, 2);
+
+        // The first slow fetch ended after its call returned, its result was dropped.
+        auto statistics = fetcher.GetStatistics();
+        EXPECT_EQ(statistics.Started, 4u);
+        EXPECT_EQ(statistics.Late, 1u);
+    }
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, SkipsSourcesNotStartedYet)
+{
+    ThreadPool pool(1);
+    auto preferred = std::make_shared<FakeFetcher>("preferred");
+    auto fallback = std::make_shared<FakeFetcher>("fallback");
+    CompositeOperatingSystemInfoFetcher fetcher(pool);
+    fetcher.AddSource(fallback, 1);
+    fetcher.AddSource(preferred, 2);
+
+    // Hold the only worker until both sources are queued.
+    std::promise<void> gate;
+    auto started = pool.Run([future = gate.get_future()]() mutable { future.wait(); });
+    std::thread caller([&fetcher] { EXPECT_EQ(fetcher.GetInformation({Field::Caption, Field::UBR}).Caption, "preferred"); });
+    while (fetcher.GetStatistics().Calls == 0)
+    {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    gate.set_value();
+    caller.join();
+    started.get();
+    while (fetcher.GetStatistics().Skipped == 0)
+    {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(fallback->Calls, 0);
+    EXPECT_EQ(fetcher.GetStatistics().Started, 1u);
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, FallsBackWhenSourceThrows)
+{
+    ThreadPool pool(2);
+    CompositeOperatingSystemInfoFetcher fetcher(pool);
+    fetcher.AddSource(std::make_shared<FakeFetcher>("throw"), 10);
+    fetcher.AddSource(std::make_shared<FakeFetcher>("linux"), 1);
+
+    auto info = fetcher.GetInformation(OperatingSystemInfoFieldMask{Field::Caption});
+    EXPECT_EQ(info.Caption, "linux");
+    EXPECT_EQ(fetcher.GetStatistics().Failed, 1u);
+
+    CompositeOperatingSystemInfoFetcher empty(pool);
+    EXPECT_FALSE(empty.GetInformation().Caption);
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, RunsSourcesConcurrently)
+{
+    ThreadPool pool(3);
+    CompositeOperatingSystemInfoFetcher fetcher(pool);
+    fetcher.AddSource(std::make_shared<FakeFetcher>("wmi", std::chrono::milliseconds(100)), 1, {Field::Caption});
+    fetcher.AddSource(std::make_shared<FakeFetcher>("registry", std::chrono::milliseconds(100)), 1, {Field::UBR});
+    fetcher.AddSource(std::make_shared<FakeFetcher>("hive", std::chrono::milliseconds(100)), 1, {Field::EditionID});
+
+    auto begin = std::chrono::steady_clock::now();
+    auto info = fetcher.GetInformation();
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    EXPECT_EQ(info.Caption, "wmi");
+    EXPECT_EQ(info.UBR, "registry");
+    EXPECT_EQ(info.EditionID, "hive");
+    EXPECT_LT(elapsed, std::chrono::milliseconds(250));
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, GivesUpOnSourcesPastTheirBudget)
+{
+    ThreadPool pool(3);
+    auto wmi = std::make_shared<FakeFetcher>("wmi", std::chrono::milliseconds(0), true);
+    auto registry = std::make_shared<FakeFetcher>("registry");
+    auto hive = std::make_shared<FakeFetcher>("hive", std::chrono::milliseconds(0), true);
+    CompositeOperatingSystemInfoFetcher fetcher(pool);
+    auto wmiSource = fetcher.AddSource(wmi, 10, {Field::Caption, Field::Version});
+    fetcher.AddSource(registry, 1, {Field::UBR, Field::Version});
+    auto hiveSource = fetcher.AddSource(hive, 10, {Field::EditionID});
+    fetcher.SetBudget(wmiSource, std::chrono::milliseconds(30));
+    fetcher.SetBudget(hiveSource, std::chrono::milliseconds(10));
+
+    std::mutex mutex;
+    std::condition_variable lateArrived;
+    OperatingSystemInfo late;
+    OperatingSystemInfoFieldMask lateFields;
+    OperatingSystemInfoFieldMask timedOut;
+    auto begin = std::chrono::steady_clock::now();
+    auto info = fetcher.GetInformation({Field::Caption, Field::Version, Field::UBR, Field::EditionID},
+                                       std::chrono::steady_clock::time_point::max(), timedOut,
+                                       [&](const OperatingSystemInfo& values, OperatingSystemInfoFieldMask fields) {
+                                           std::lock_guard<std::mutex> lock(mutex);
+                                           ApplyOperatingSystemInfoChanges(late, values, fields);
+                                           lateFields |= fields;
+                                           lateArrived.notify_all();
+                                       });
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(500));
+    // Version falls back to the registry, Caption and EditionID only had the sources given up on.
+    EXPECT_EQ(info.UBR, "registry");
+    EXPECT_EQ(info.Version, "registry");
+    EXPECT_FALSE(info.Caption);
+    EXPECT_FALSE(info.EditionID);
+    EXPECT_EQ(timedOut, (OperatingSystemInfoFieldMask{Field::Caption, Field::EditionID}));
+    EXPECT_EQ(fetcher.GetStatistics().TimedOut, 2u);
+
+    // Only the fields the call timed out on, not the better Version which had a value in time.
+    wmi->Release();
+    hive->Release();
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(lateArrived.wait_for(lock, std::chrono::seconds(5), [&] { return lateFields == timedOut; }));
+    EXPECT_EQ(late.Caption, "wmi");
+    EXPECT_EQ(late.EditionID, "hive");
+    EXPECT_FALSE(late.Version);
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, ReturnsByTheDeadline)
+{
+    ThreadPool pool(2);
+    auto stuck = std::make_shared<FakeFetcher>("stuck", std::chrono::milliseconds(0), true);
+    CompositeOperatingSystemInfoFetcher fetcher(pool);
+    fetcher.AddSource(stuck, 1);
+    fetcher.AddSource(std::make_shared<FakeFetcher>("registry"), 1, {Field::UBR});
+
+    OperatingSystemInfoFieldMask timedOut;
+    auto info = fetcher.GetInformation({Field::Caption, Field::UBR},
+                                       std::chrono::steady_clock::now() + std::chrono::milliseconds(20), timedOut, nullptr);
+    EXPECT_EQ(info.UBR, "registry");
+    EXPECT_FALSE(info.Caption);
+    // Only requested fields, not every field of the stuck source.
+    EXPECT_EQ(timedOut, OperatingSystemInfoFieldMask{Field::Caption});
+    stuck->Release();
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, ReportsFieldsASourceTimedOutOn)
+{
+    ThreadPool pool(2);
+    CompositeOperatingSystemInfoFetcher fetcher(pool);
+    fetcher.AddSource(std::make_shared<PartialFetcher>(), 10, {Field::Caption, Field::Version, Field::UBR});
+    fetcher.AddSource(std::make_shared<FakeFetcher>("registry"), 1, {Field::UBR});
+
+    OperatingSystemInfoFieldMask timedOut;
+    auto info = fetcher.GetInformation({Field::Caption, Field::Version, Field::UBR},
+                                       std::chrono::steady_clock::now() + std::chrono::seconds(10), timedOut, nullptr);
+    EXPECT_EQ(info.Caption, "wmi");
+    EXPECT_FALSE(info.Version);
+    // Another source filled it, so it did not time out.
+    EXPECT_EQ(info.UBR, "registry");
+    EXPECT_EQ(timedOut, OperatingSystemInfoFieldMask{Field::Version});
+}
+
+TEST(CompositeOperatingSystemInfoFetcher, StuckSourceHoldsOneWorker)
+{
+    ThreadPool pool(2);
+    auto stuck = std::make_shared<FakeFetcher>("stuck", std::chrono::milliseconds(0), true);
+    auto registry = std::make_shared<FakeFetcher>("registry");
+    {
+        CompositeOperatingSystemInfoFetcher fetcher(pool);
+        auto stuckSource = fetcher.AddSource(stuck, 1, {Field::Caption});
+        fetcher.AddSource(registry, 1, {Field::UBR});
+        fetcher.SetBudget(stuckSource, std::chrono::milliseconds(10));
+
+        // Later calls queue behind the stuck fetch instead of taking the other worker.
+        for (int i = 0; i < 5; ++i)
+        {
+            OperatingSystemInfoFieldMask timedOut;
+            auto info = fetcher.GetInformation({Field::Caption, Field::UBR}, std::chrono::steady_clock::time_point::max(),
+                                               timedOut, nullptr);
+            EXPECT_EQ(info.UBR, "registry") << i;
+            EXPECT_EQ(timedOut, OperatingSystemInfoFieldMask{Field::Caption}) << i;
+        }
+        EXPECT_EQ(stuck->Calls, 1);
+        EXPECT_EQ(fetcher.GetStatistics().Queued, 4u);
+
+        stuck->Release();
+    }
+    // The queued calls returned meanwhile, no fetch is made for them.
+    EXPECT_EQ(stuck->Calls, 1);
+    EXPECT_EQ(registry->Calls, 5);
+}
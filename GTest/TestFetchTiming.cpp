@@ -0,0 +1,99 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <FetchTiming.h>
+#include <LatencyHistogram.h>
+#ifndef _WIN32
+#include <LinuxOperatingSystemInfoFetcher.h>
+#endif
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using namespace std::chrono_literals;
+} // namespace
+
+TEST(LatencyHistogram, BucketsCoverEveryDurationWithinAQuarterOfItsPowerOfTwo)
+{
+    EXPECT_EQ(LatencyHistogram::GetBucket(0), 0u);
+    EXPECT_EQ(LatencyHistogram::GetBucket(7), 7u);
+    EXPECT_EQ(LatencyHistogram::GetBucket(8), 8u);
+    EXPECT_EQ(LatencyHistogram::GetBucket(UINT64_MAX), LatencyHistogram::BucketCount - 1);
+    for (uint64_t value : {uint64_t{9}, uint64_t{1000}, uint64_t{1023}, uint64_t{1024}, uint64_t{123456789}, uint64_t{1} << 40})
+    {
+        auto bucket = LatencyHistogram::GetBucket(value);
+        EXPECT_LE(LatencyHistogramSnapshot::BucketLowerBound(bucket).count(), static_cast<int64_t>(value)) << value;
+        EXPECT_GE(LatencyHistogramSnapshot::BucketUpperBound(bucket).count(), static_cast<int64_t>(value)) << value;
+        EXPECT_EQ(LatencyHistogramSnapshot::BucketUpperBound(bucket - 1).count() + 1,
+                  LatencyHistogramSnapshot::BucketLowerBound(bucket).count())
+            << value;
+    }
+}
+
+TEST(LatencyHistogram, ReportsPercentilesOfConcurrentRecords)
+{
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&histogram] {
+            // 1 to 100 us, 250 times each per thread.
+            for (int i = 0; i < 250; ++i)
+            {
+                for (int us = 1; us <= 100; ++us)
+                {
+                    histogram.Record(std::chrono::microseconds(us));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    auto snapshot = histogram.Snapshot();
+    EXPECT_EQ(snapshot.Count, 100000u);
+    EXPECT_EQ(snapshot.Max, 100us);
+    EXPECT_EQ(snapshot.Mean(), 50500ns);
+    EXPECT_GE(snapshot.Percentile(0.5), 50us);
+    EXPECT_LE(snapshot.Percentile(0.5), 50us * 1.19);
+    EXPECT_GE(snapshot.Percentile(0.99), 99us);
+    EXPECT_EQ(snapshot.Percentile(1.0), 100us);
+    EXPECT_LE(snapshot.Percentile(0.0), 1us * 1.19);
+
+    histogram.Reset();
+    EXPECT_EQ(histogram.Snapshot().Count, 0u);
+    EXPECT_EQ(histogram.Snapshot().Percentile(0.5), 0ns);
+}
+
+#if OPERATINGSYSTEMINFO_TIMING
+TEST(FetchTiming, SpansRecordTheirStage)
+{
+    ResetFetchTiming();
+    {
+        FetchTimingSpan span(FetchStage::ExecQuery);
+        std::this_thread::sleep_for(2ms);
+    }
+    auto statistics = GetFetchTimingStatistics();
+    EXPECT_TRUE(statistics.Enabled);
+    EXPECT_EQ(statistics[FetchStage::ExecQuery].Count, 1u);
+    EXPECT_GE(statistics[FetchStage::ExecQuery].Max, 2ms);
+    EXPECT_EQ(statistics[FetchStage::ConnectServer].Count, 0u);
+    EXPECT_EQ(GetFetchStageName(FetchStage::ExecQuery), "ExecQuery");
+}
+
+#ifndef _WIN32
+TEST(FetchTiming, FetcherRecordsGetInformation)
+{
+    ResetFetchTiming();
+    LinuxOperatingSystemInfoFetcher fetcher;
+    fetcher.GetInformation();
+    fetcher.GetInformation();
+    EXPECT_EQ(GetFetchTimingStatistics()[FetchStage::GetInformation].Count, 2u);
+}
+#endif
+#endif
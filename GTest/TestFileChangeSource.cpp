@@ -0,0 +1,150 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <FileChangeSource.h>
+#ifndef _WIN32
+#include <LinuxOperatingSystemInfoFetcher.h>
+#include <OperatingSystemInfoProvider.h>
+#include <OperatingSystemInfoWatcher.h>
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace
+{
+using namespace std::chrono_literals;
+
+// Counts the notifications of a source.
+class Notifications
+{
+public:
+    std::function<void()> Callback()
+    {
+        return [this] {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            ++m_Count;
+            m_Changed.notify_all();
+        };
+    }
+
+    bool WaitFor(int count, std::chrono::milliseconds timeout = 5000ms)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        return m_Changed.wait_for(lock, timeout, [this, count] { return m_Count >= count; });
+    }
+
+    int Count()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Count;
+    }
+
+private:
+    std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    int m_Count = 0;
+};
+
+class FileChangeSourceTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_Directory = std::filesystem::temp_directory_path() /
+                      ("FileChangeSourceTest" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::filesystem::create_directories(m_Directory);
+        Write(m_Directory / "os-release", "ID=debian\nVERSION_ID=\"12\"\n");
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(m_Directory);
+    }
+
+    static void Write(const std::filesystem::path& path, const std::string& content)
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    }
+
+    std::filesystem::path m_Directory;
+};
+} // namespace
+
+TEST_F(FileChangeSourceTest, ReportsWritesAndReplacementsOfWatchedFilesOnly)
+{
+    auto osRelease = m_Directory / "os-release";
+    FileChangeSource source({osRelease.string()});
+    Notifications notifications;
+    ASSERT_TRUE(source.Start(notifications.Callback()));
+
+    Write(m_Directory / "unrelated", "x");
+    Write(osRelease, "ID=debian\nVERSION_ID=\"12\"\nVERSION_CODENAME=bookworm\n");
+    ASSERT_TRUE(notifications.WaitFor(1));
+
+    // Replaced through a rename, as package managers do.
+    auto count = notifications.Count();
+    Write(m_Directory / "os-release.new", "ID=debian\nVERSION_ID=\"13\"\n");
+    std::filesystem::rename(m_Directory / "os-release.new", osRelease);
+    ASSERT_TRUE(notifications.WaitFor(count + 1));
+
+    source.Stop();
+    count = notifications.Count();
+    Write(osRelease, "ID=debian\n");
+    std::this_thread::sleep_for(100ms);
+    EXPECT_EQ(notifications.Count(), count);
+}
+
+TEST_F(FileChangeSourceTest, FailsWhenNoDirectoryExists)
+{
+    FileChangeSource source({(m_Directory / "missing" / "os-release").string()});
+    Notifications notifications;
+    EXPECT_FALSE(source.Start(notifications.Callback()));
+}
+
+#ifndef _WIN32
+TEST_F(FileChangeSourceTest, FollowsSymbolicLinks)
+{
+    // Like /etc/os-release -> ../usr/lib/os-release.
+    std::filesystem::create_directories(m_Directory / "etc");
+    std::filesystem::create_symlink("../os-release", m_Directory / "etc" / "os-release");
+    FileChangeSource source({(m_Directory / "etc" / "os-release").string()});
+    Notifications notifications;
+    ASSERT_TRUE(source.Start(notifications.Callback()));
+
+    Write(m_Directory / "os-release", "ID=debian\nVERSION_ID=\"13\"\n");
+    EXPECT_TRUE(notifications.WaitFor(1));
+}
+
+TEST_F(FileChangeSourceTest, WatcherPublishesOsReleaseUpdates)
+{
+    std::mutex mutex;
+    std::condition_variable published;
+    std::optional<std::string> releaseId;
+    auto osRelease = (m_Directory / "os-release").string();
+    OperatingSystemInfoProvider provider(std::make_unique<LinuxOperatingSystemInfoFetcher>(osRelease),
+                                         std::chrono::hours(1));
+    OperatingSystemInfoWatcher watcher(provider, {OperatingSystemInfoField::ReleaseId}, 10ms);
+    watcher.AddSource(std::make_unique<FileChangeSource>(std::vector<std::string>{osRelease}));
+    watcher.Subscribe([&](const OperatingSystemInfo& info) {
+        std::lock_guard<std::mutex> lock(mutex);
+        releaseId = info.ReleaseId;
+        published.notify_all();
+    });
+    ASSERT_TRUE(watcher.Start());
+    EXPECT_EQ(provider.GetInformation({OperatingSystemInfoField::ReleaseId}).ReleaseId, "12");
+
+    Write(m_Directory / "os-release", "ID=debian\nVERSION_ID=\"13\"\n");
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(published.wait_for(lock, 5s, [&] { return releaseId.has_value(); }));
+    EXPECT_EQ(releaseId, "13");
+    EXPECT_EQ(provider.GetInformation({OperatingSystemInfoField::ReleaseId}).ReleaseId, "13");
+}
+#endif
@@ -0,0 +1,231 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <HostCollectionScheduler.h>
+#include <InMemoryHostTransport.h>
+#include <InMemoryReg.h>
+#include <InMemoryWmi.h>
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using namespace std::chrono_literals;
+
+constexpr char CurrentVersionPath[] = "SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion";
+
+struct Machine
+{
+    Machine()
+    {
+        Wmi.AddInstance(L"Win32_OperatingSystem", {{L"Caption", std::wstring(L"Microsoft Windows 10 Pro")},
+                                                   {L"OSArchitecture", std::wstring(L"64-bit")}});
+        Registry.SetStringValue(CurrentVersionPath, "EditionID", L"Professional");
+        Registry.SetIntValue(CurrentVersionPath, "UBR", 3803);
+    }
+
+    InMemoryWmiRepository Wmi;
+    InMemoryRegistry Registry;
+};
+
+std::vector<std::string> MakeHosts(size_t count)
+{
+    std::vector<std::string> hosts;
+    for (size_t i = 0; i < count; ++i)
+    {
+        hosts.push_back("host" + std::to_string(i));
+    }
+    return hosts;
+}
+
+// Counts the attempts running at once.
+class ConcurrencyProbe final : public IHostTransport
+{
+public:
+    bool Collect(const std::string&, OperatingSystemInfoFieldMask, std::chrono::steady_clock::time_point,
+                 OperatingSystemInfo& result, std::string&) override
+    {
+        auto running = ++m_Running;
+        auto peak = Peak.load();
+        while (running > peak && !Peak.compare_exchange_weak(peak, running))
+        {
+        }
+        std::this_thread::sleep_for(5ms);
+        --m_Running;
+        result.Caption = "Microsoft Windows 10 Pro";
+        return true;
+    }
+
+    std::atomic<int> Peak{0};
+
+private:
+    std::atomic<int> m_Running{0};
+};
+
+// Blocks on the "slow" hosts past any deadline, like a connection stuck in the network stack.
+class StuckTransport final : public IHostTransport
+{
+public:
+    bool Collect(const std::string& host, OperatingSystemInfoFieldMask, std::chrono::steady_clock::time_point,
+                 OperatingSystemInfo& result, std::string&) override
+    {
+        if (host.compare(0, 4, "slow") == 0)
+        {
+            std::this_thread::sleep_for(600ms);
+        }
+        result.Caption = "Microsoft Windows 10 Pro";
+        return true;
+    }
+};
+} // namespace
+
+TEST(HostCollectionScheduler, StreamsEveryHostResultOnTheCallingThread)
+{
+    Machine machine;
+    InMemoryHostTransport transport(machine.Wmi, machine.Registry, {1ms, 3ms});
+    ThreadPool pool(8);
+    HostCollectionOptions options;
+    options.Fields = {OperatingSystemInfoField::Caption, OperatingSystemInfoField::EditionID, OperatingSystemInfoField::UBR};
+    options.MaxConcurrency = 8;
+    HostCollectionScheduler scheduler(pool, transport, options);
+
+    auto hosts = MakeHosts(50);
+    std::vector<std::string> seen;
+    auto caller = std::this_thread::get_id();
+    auto statistics = scheduler.Collect(hosts, [&](const HostCollectionResult& result) {
+        EXPECT_EQ(std::this_thread::get_id(), caller);
+        EXPECT_EQ(result.Status, HostCollectionStatus::Succeeded);
+        EXPECT_EQ(result.Info.Caption, "Microsoft Windows 10 Pro");
+        EXPECT_EQ(result.Info.EditionID, "Professional");
+        EXPECT_EQ(result.Info.UBR, "3803");
+        EXPECT_FALSE(result.Info.OSArchitecture.has_value());
+        EXPECT_EQ(result.Attempts, 1u);
+        seen.push_back(result.Host);
+    });
+
+    std::sort(seen.begin(), seen.end());
+    std::sort(hosts.begin(), hosts.end());
+    EXPECT_EQ(seen, hosts);
+    EXPECT_EQ(statistics.Hosts, 50u);
+    EXPECT_EQ(statistics.Succeeded, 50u);
+    EXPECT_EQ(statistics.Attempts, 50u);
+    EXPECT_GT(statistics.HostsPerSecond, 0);
+}
+
+TEST(HostCollectionScheduler, BoundsConcurrentAttempts)
+{
+    ConcurrencyProbe transport;
+    ThreadPool pool(8);
+    HostCollectionOptions options;
+    options.MaxConcurrency = 3;
+    HostCollectionScheduler scheduler(pool, transport, options);
+
+    auto statistics = scheduler.Collect(MakeHosts(30), [](const HostCollectionResult&) {});
+    EXPECT_EQ(statistics.Succeeded, 30u);
+    EXPECT_LE(transport.Peak, 3);
+}
+
+TEST(HostCollectionScheduler, RetriesFailedAttemptsWithBackoff)
+{
+    Machine machine;
+    InMemoryHostTransport transport(machine.Wmi, machine.Registry);
+    transport.SetFailures("flaky", 2);
+    transport.SetFailures("down", UINT32_MAX);
+    ThreadPool pool(4);
+    HostCollectionOptions options;
+    options.MaxAttempts = 3;
+    options.InitialBackoff = 20ms;
+    HostCollectionScheduler scheduler(pool, transport, options);
+
+    std::map<std::string, HostCollectionResult> results;
+    auto statistics = scheduler.Collect({"flaky", "down", "healthy"},
+                                        [&](const HostCollectionResult& result) { results[result.Host] = result; });
+
+    EXPECT_EQ(results["flaky"].Status, HostCollectionStatus::Succeeded);
+    EXPECT_EQ(results["flaky"].Attempts, 3u);
+    EXPECT_TRUE(results["flaky"].Error.empty());
+    // Backoffs of 10 to 20 ms, then 20 to 40 ms.
+    EXPECT_GE(results["flaky"].Elapsed, 30ms);
+    EXPECT_EQ(results["down"].Status, HostCollectionStatus::Failed);
+    EXPECT_EQ(results["down"].Attempts, 3u);
+    EXPECT_EQ(results["down"].Error, "Injected failure on down");
+    EXPECT_EQ(results["healthy"].Attempts, 1u);
+    EXPECT_EQ(statistics.Succeeded, 2u);
+    EXPECT_EQ(statistics.Failed, 1u);
+    EXPECT_EQ(statistics.Attempts, 7u);
+    EXPECT_EQ(statistics.Retries, 4u);
+    EXPECT_EQ(transport.GetStatistics().InjectedFailures, 5u);
+}
+
+TEST(HostCollectionScheduler, TimesOutSlowHostsWithoutWaitingForThem)
+{
+    StuckTransport transport;
+    ThreadPool pool(2);
+    HostCollectionOptions options;
+    options.HostTimeout = 100ms;
+    HostCollectionScheduler scheduler(pool, transport, options);
+
+    std::map<std::string, HostCollectionResult> results;
+    auto start = std::chrono::steady_clock::now();
+    auto statistics = scheduler.Collect({"slow", "fast"},
+                                        [&](const HostCollectionResult& result) { results[result.Host] = result; });
+
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 500ms);
+    EXPECT_EQ(results["slow"].Status, HostCollectionStatus::TimedOut);
+    EXPECT_EQ(results["slow"].Error, "Deadline exceeded");
+    EXPECT_FALSE(results["slow"].Info.Caption.has_value());
+    EXPECT_EQ(results["fast"].Status, HostCollectionStatus::Succeeded);
+    EXPECT_EQ(statistics.TimedOut, 1u);
+}
+
+TEST(HostCollectionScheduler, DoesNotRetryPastTheDeadline)
+{
+    Machine machine;
+    InMemoryHostTransport transport(machine.Wmi, machine.Registry);
+    transport.SetFailures("down", UINT32_MAX);
+    transport.SetLatency("slow", 10s);
+    ThreadPool pool(2);
+    HostCollectionOptions options;
+    options.HostTimeout = 100ms;
+    options.InitialBackoff = 1s;
+    HostCollectionScheduler scheduler(pool, transport, options);
+
+    std::map<std::string, HostCollectionResult> results;
+    auto statistics = scheduler.Collect({"down", "slow"},
+                                        [&](const HostCollectionResult& result) { results[result.Host] = result; });
+
+    // The backoff would end past the deadline.
+    EXPECT_EQ(results["down"].Status, HostCollectionStatus::Failed);
+    EXPECT_EQ(results["down"].Attempts, 1u);
+    EXPECT_EQ(results["slow"].Status, HostCollectionStatus::TimedOut);
+    EXPECT_EQ(statistics.Attempts, 2u);
+}
+
+TEST(HostCollectionScheduler, StuckAttemptsDoNotHoldTheirSlot)
+{
+    StuckTransport transport;
+    ThreadPool pool(4);
+    HostCollectionOptions options;
+    options.HostTimeout = 100ms;
+    options.MaxConcurrency = 2;
+    HostCollectionScheduler scheduler(pool, transport, options);
+
+    // Both slots are taken by stuck hosts until their deadline, after which the queued host gets one.
+    std::map<std::string, HostCollectionResult> results;
+    auto start = std::chrono::steady_clock::now();
+    auto statistics = scheduler.Collect({"slow1", "slow2", "fast"},
+                                        [&](const HostCollectionResult& result) { results[result.Host] = result; });
+
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 500ms);
+    EXPECT_EQ(results["slow1"].Status, HostCollectionStatus::TimedOut);
+    EXPECT_EQ(results["slow2"].Status, HostCollectionStatus::TimedOut);
+    EXPECT_EQ(results["fast"].Status, HostCollectionStatus::Succeeded);
+    EXPECT_EQ(statistics.TimedOut, 2u);
+}
@@ -0,0 +1,218 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <InMemoryWmi.h>
+#include <WmiCimv2.h>
+
+#include <cstdio>
+#include <cwchar>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr const char* OperatingSystemMof = R"(
+#pragma namespace("\\\\.\\root\\cimv2")
+// Exported from a Windows 10 Pro machine, trimmed.
+instance of Win32_OperatingSystem
+{
+    Caption = "Microsoft Windows 10 Pro";
+    OSArchitecture = "64-bit";
+    MUILanguages = {"ja-JP", "en-US"};
+    Locale = "0411";
+    Version = "10.0.17763";
+    OSLanguage = 1041;
+    ServicePackMajorVersion = 0;
+    ServicePackMinorVersion = 0;
+    Primary = TRUE;
+    CSDVersion = NULL;
+    TotalVisibleMemorySize = "16658932";
+};
+)";
+
+constexpr const char* ServiceMof = R"(
+instance of Win32_Service { Name = "Dhcp"; State = "Running"; ProcessId = 1300; PathName = "C:\\Windows\\system32\\svchost.exe -k LocalServiceNetworkRestricted"; };
+instance of Win32_Service { Name = "wuauserv"; State = "Stopped"; ProcessId = 0; /* demand start */ };
+instance of Win32_Service { Name = "WinRM"; State = "Running"; ProcessId = 4021; DelayedAutoStart = TRUE; };
+)";
+
+class Collector final : public IWmiObjectVisitor
+{
+public:
+    explicit Collector(const wchar_t* property, size_t limit = 100) : m_Property(property), m_Limit(limit)
+    {
+    }
+
+    bool Visit(const IWmiObject& object) override
+    {
+        WmiValue value;
+        object.Get(m_Property, value);
+        Values.push_back(std::move(value));
+        return Values.size() < m_Limit;
+    }
+
+    std::vector<WmiValue> Values;
+
+private:
+    const wchar_t* m_Property;
+    size_t m_Limit;
+};
+
+std::vector<std::wstring> Names(InMemoryWmi& wmi, const wchar_t* where)
+{
+    Collector collector(L"Name");
+    EXPECT_TRUE(wmi.ExecQuery((std::wstring(L"SELECT Name FROM Win32_Service WHERE ") + where).c_str(), collector)) << where;
+    std::vector<std::wstring> names;
+    for (const auto& value : collector.Values)
+    {
+        names.push_back(std::get<std::wstring>(value));
+    }
+    return names;
+}
+} // namespace
+
+TEST(InMemoryWmi, RunsOSInfoExtraction)
+{
+    InMemoryWmiRepository repository;
+    ASSERT_TRUE(repository.Parse(OperatingSystemMof));
+    InMemoryWmi provider(repository);
+    WmiCimv2 wmi(provider);
+
+    auto info = wmi.GetOSInfo();
+    EXPECT_EQ(info.Caption, L"Microsoft Windows 10 Pro");
+    EXPECT_EQ(info.OSArchitecture, L"64-bit");
+    EXPECT_EQ(info.MUILanguage, L"ja-JP");
+    EXPECT_EQ(info.Locale, L"0411");
+    EXPECT_EQ(info.Version, L"10.0.17763");
+    EXPECT_EQ(info.OSLanguage, 1041);
+    EXPECT_EQ(info.ServicePackMajorVersion, 0);
+    EXPECT_EQ(provider.GetStatistics().PropertiesMaterialized, 8u);
+
+    // Only the two selected properties are copied out of the instance.
+    info = wmi.GetOSInfo({OperatingSystemInfoField::Caption, OperatingSystemInfoField::Version});
+    EXPECT_EQ(info.Caption, L"Microsoft Windows 10 Pro");
+    EXPECT_EQ(info.Version, L"10.0.17763");
+    EXPECT_TRUE(info.Locale.empty());
+    EXPECT_EQ(provider.GetStatistics().Queries, 2u);
+    EXPECT_EQ(provider.GetStatistics().PropertiesMaterialized, 10u);
+
+    info = wmi.GetOSInfo(OperatingSystemInfoFieldMask{OperatingSystemInfoField::UBR});
+    EXPECT_TRUE(info.Caption.empty());
+    EXPECT_EQ(provider.GetStatistics().Queries, 2u);
+}
+
+TEST(InMemoryWmi, ProjectsSelectedProperties)
+{
+    InMemoryWmiRepository repository;
+    ASSERT_TRUE(repository.Parse(OperatingSystemMof));
+    InMemoryWmi wmi(repository);
+
+    struct Visitor final : public IWmiObjectVisitor
+    {
+        bool Visit(const IWmiObject& object) override
+        {
+            WmiValue value;
+            EXPECT_TRUE(object.Get(L"caption", value));
+            EXPECT_EQ(GetWmiValueType(value), WmiValueType::String);
+            // Not selected, found as NULL.
+            EXPECT_TRUE(object.Get(L"Locale", value));
+            EXPECT_EQ(GetWmiValueType(value), WmiValueType::Null);
+            EXPECT_FALSE(object.Get(L"NoSuchProperty", value));
+
+            std::vector<std::wstring> languages;
+            EXPECT_TRUE(StoreWmiPropertyValue(object, L"MUILanguages", languages));
+            EXPECT_EQ(languages.size(), 2u);
+            int32_t language = 0;
+            EXPECT_FALSE(StoreWmiPropertyValue(object, L"Caption", language));
+            ++Count;
+            return true;
+        }
+        int Count = 0;
+    } visitor;
+    ASSERT_TRUE(wmi.ExecQuery(L"select Caption, MUILanguages, Caption from win32_operatingsystem", visitor));
+    EXPECT_EQ(visitor.Count, 1);
+    EXPECT_EQ(wmi.GetStatistics().PropertiesMaterialized, 2u);
+}
+
+TEST(InMemoryWmi, FiltersWithWhere)
+{
+    InMemoryWmiRepository repository;
+    ASSERT_TRUE(repository.Parse(ServiceMof));
+    ASSERT_TRUE(repository.Parse(OperatingSystemMof));
+    InMemoryWmi wmi(repository);
+    using Names_ = std::vector<std::wstring>;
+
+    EXPECT_EQ(Names(wmi, L"State = 'running'"), (Names_{L"Dhcp", L"WinRM"}));
+    EXPECT_EQ(Names(wmi, L"State <> \"Running\""), (Names_{L"wuauserv"}));
+    EXPECT_EQ(Names(wmi, L"ProcessId > 1300 OR Name = 'wuauserv'"), (Names_{L"wuauserv", L"WinRM"}));
+    EXPECT_EQ(Names(wmi, L"NOT (ProcessId >= 1300 AND State = 'Running')"), (Names_{L"wuauserv"}));
+    EXPECT_EQ(Names(wmi, L"ProcessId = '4021'"), (Names_{L"WinRM"}));
+    EXPECT_EQ(Names(wmi, L"Name LIKE 'w%'"), (Names_{L"wuauserv", L"WinRM"}));
+    EXPECT_EQ(Names(wmi, L"Name LIKE '_in__'"), (Names_{L"WinRM"}));
+    EXPECT_EQ(Names(wmi, L"PathName LIKE 'C:\\\\Windows\\\\%'"), (Names_{L"Dhcp"}));
+    EXPECT_EQ(Names(wmi, L"DelayedAutoStart = TRUE"), (Names_{L"WinRM"}));
+    EXPECT_EQ(Names(wmi, L"DelayedAutoStart IS NULL"), (Names_{L"Dhcp", L"wuauserv"}));
+    EXPECT_EQ(Names(wmi, L"PathName <> NULL"), (Names_{L"Dhcp"}));
+    // No instance sets it, so it is NULL everywhere.
+    EXPECT_EQ(Names(wmi, L"StartName IS NOT NULL"), Names_{});
+
+    Collector collector(L"TotalVisibleMemorySize");
+    ASSERT_TRUE(wmi.ExecQuery(L"SELECT * FROM Win32_OperatingSystem WHERE TotalVisibleMemorySize > 8000000", collector));
+    ASSERT_EQ(collector.Values.size(), 1u);
+    EXPECT_EQ(std::get<std::wstring>(collector.Values[0]), L"16658932");
+
+    Collector first(L"Name", 1);
+    ASSERT_TRUE(wmi.ExecQuery(L"SELECT Name FROM Win32_Service", first));
+    EXPECT_EQ(first.Values.size(), 1u);
+    EXPECT_EQ(wmi.GetStatistics().ObjectsScanned, 3 * 12 + 1 + 1u);
+}
+
+TEST(InMemoryWmi, RejectsMalformedQueries)
+{
+    InMemoryWmiRepository repository;
+    ASSERT_TRUE(repository.Parse(ServiceMof));
+    InMemoryWmi wmi(repository);
+    Collector collector(L"Name");
+
+    for (auto query : {L"", L"SELECT FROM Win32_Service", L"SELECT Name Win32_Service", L"SELECT Name FROM Win32_Process",
+                       L"SELECT Name FROM Win32_Service WHERE", L"SELECT Name FROM Win32_Service WHERE Name = 'x",
+                       L"SELECT Name FROM Win32_Service WHERE (Name = 'x'", L"SELECT Name FROM Win32_Service WHERE Name LIKE 1",
+                       L"SELECT Name FROM Win32_Service WHERE Name = 'x' extra", L"SELECT Name FROM Win32_Service WHERE Name ~ 'x'"})
+    {
+        EXPECT_FALSE(wmi.ExecQuery(query, collector)) << std::string(query, query + std::wcslen(query));
+    }
+    EXPECT_FALSE(wmi.ExecQuery(nullptr, collector));
+    EXPECT_TRUE(collector.Values.empty());
+    EXPECT_EQ(wmi.GetStatistics().Queries, 0u);
+}
+
+TEST(InMemoryWmi, LoadsMofFile)
+{
+    const char* path = "TestInMemoryWmi.mof";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "instance of Win32_OperatingSystem { Caption = \"Microsoft Windows 10 Pro \xC3\xA9\" \"dition\";"
+                " Description = \"tab\\there \\x263A\"; OSLanguage = 4294967295; };\n";
+    }
+    InMemoryWmiRepository repository;
+    ASSERT_TRUE(repository.Load(path));
+    std::remove(path);
+    EXPECT_FALSE(repository.Load(path));
+
+    auto wmiClass = repository.FindClass(L"WIN32_OPERATINGSYSTEM");
+    ASSERT_NE(wmiClass, nullptr);
+    ASSERT_EQ(wmiClass->Instances.size(), 1u);
+    const auto& instance = wmiClass->Instances[0];
+    EXPECT_EQ(std::get<std::wstring>(instance[0]), L"Microsoft Windows 10 Pro \u00E9dition");
+    EXPECT_EQ(std::get<std::wstring>(instance[1]), L"tab\there \u263A");
+    EXPECT_EQ(std::get<int32_t>(instance[2]), -1);
+
+    for (auto mof : {"instance of { };", "instance Win32_Service { Name = \"x\"; };", "instance of A { Name = \"x\" };",
+                     "instance of A { Name = \"x; };", "instance of A { Name = {1}; };", "instance of A { Name = 4294967296; };",
+                     "instance of A { Name = \"x\"; }"})
+    {
+        EXPECT_FALSE(repository.Parse(mof)) << mof;
+    }
+    EXPECT_EQ(repository.FindClass(L"A"), nullptr);
+}
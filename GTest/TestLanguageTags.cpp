@@ -0,0 +1,82 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <LanguageTags.h>
+#include <OperatingSystemInfoIngestion.h>
+#include <ThreadPool.h>
+
+#include <sstream>
+#include <string>
+
+TEST(LanguageTags, MapsLcidsToTagsAndBack)
+{
+    EXPECT_EQ(GetLanguageTag(0x0409), "en-US");
+    EXPECT_EQ(GetLanguageTag(0x0411), "ja-JP");
+    EXPECT_EQ(GetLanguageTag(0x7C04), "zh-Hant");
+    EXPECT_EQ(GetLanguageTag(0x0009), "en");
+    // Sort orders share the tag of their locale.
+    EXPECT_EQ(GetLanguageTag(0x10407), "de-DE");
+    EXPECT_EQ(GetLanguageTag(0x040A), "es-ES");
+    EXPECT_EQ(GetLanguageTag(0x0000), "");
+    EXPECT_EQ(GetLanguageTag(0x0458), "");
+    EXPECT_EQ(GetLanguageTag(0xFC09), "");
+
+    uint32_t lcid = 0;
+    ASSERT_TRUE(FindLcid("en-US", lcid));
+    EXPECT_EQ(lcid, 0x0409u);
+    ASSERT_TRUE(FindLcid("ZH-hant", lcid));
+    EXPECT_EQ(lcid, 0x7C04u);
+    ASSERT_TRUE(FindLcid("es-ES", lcid));
+    EXPECT_EQ(lcid, 0x0C0Au);
+    EXPECT_FALSE(FindLcid("", lcid));
+    EXPECT_FALSE(FindLcid("en-XX", lcid));
+    EXPECT_FALSE(FindLcid("en_US", lcid));
+    EXPECT_FALSE(FindLcid("ca-ES-valencia-x", lcid));
+
+    // Every tag goes back to an LCID with that tag.
+    for (uint32_t id = 0; id <= 0xFFFF; ++id)
+    {
+        auto tag = GetLanguageTag(id);
+        if (!tag.empty())
+        {
+            ASSERT_TRUE(FindLcid(tag, lcid)) << tag;
+            EXPECT_EQ(GetLanguageTag(lcid), tag);
+        }
+    }
+}
+
+TEST(LanguageTags, NormalizesOSLanguageAndLocale)
+{
+    OperatingSystemInfo info;
+    info.OSLanguage = "1041";
+    info.Locale = "0411";
+    info.MUILanguage = "1033";
+    NormalizeLanguageFields(info);
+    EXPECT_EQ(info.OSLanguage, "ja-JP");
+    EXPECT_EQ(info.Locale, "ja-JP");
+    EXPECT_EQ(info.MUILanguage, "1033");
+
+    // Unknown LCIDs and tags are kept.
+    EXPECT_EQ(NormalizeLanguageField(OperatingSystemInfoField::OSLanguage, "99999"), "99999");
+    EXPECT_EQ(NormalizeLanguageField(OperatingSystemInfoField::Locale, "en-US"), "en-US");
+    EXPECT_EQ(NormalizeLanguageField(OperatingSystemInfoField::OSLanguage, ""), "");
+
+    ThreadPool pool(2);
+    OperatingSystemInfoIngestionOptions options;
+    options.LanguageTags = true;
+    OperatingSystemInfoIngestion ingestion(pool, options);
+    std::istringstream input(R"({"OSLanguage":1033,"Locale":"0409"})"
+                             "\n"
+                             R"({"OSLanguage":"1031","Locale":"N/A"})"
+                             "\n");
+    OperatingSystemInfoInventory inventory;
+    std::vector<uint32_t> ids;
+    ASSERT_TRUE(ingestion.Ingest(input, inventory, &ids));
+    ASSERT_EQ(ids.size(), 2u);
+    auto first = inventory.Get(ids[0]);
+    EXPECT_EQ(first.OSLanguage, "en-US");
+    EXPECT_EQ(first.Locale, "en-US");
+    auto second = inventory.Get(ids[1]);
+    EXPECT_EQ(second.OSLanguage, "de-DE");
+    EXPECT_EQ(second.Locale, "N/A");
+}
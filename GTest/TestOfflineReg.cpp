@@ -0,0 +1,351 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <OfflineOperatingSystemInfoFetcher.h>
+#include <OfflineReg.h>
+#include <RegistryBatch.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Writes a minimal regf hive with a single hive bin, enough to exercise key and value lookups.
+class HiveBuilder
+{
+public:
+    HiveBuilder() : m_Bin(0x20)
+    {
+        std::memcpy(m_Bin.data(), "hbin", 4);
+    }
+
+    uint32_t AddKey(const std::string& name, uint32_t subkeyList, uint32_t subkeyCount, uint32_t valueList,
+                    uint32_t valueCount)
+    {
+        std::vector<std::byte> cell(0x4C + name.size());
+        Put<char>(cell, 0, 'n');
+        Put<char>(cell, 1, 'k');
+        Put<uint16_t>(cell, 0x02, 0x0020);
+        Put<uint32_t>(cell, 0x14, subkeyCount);
+        Put<uint32_t>(cell, 0x1C, subkeyList);
+        Put<uint32_t>(cell, 0x24, valueCount);
+        Put<uint32_t>(cell, 0x28, valueList);
+        Put<uint16_t>(cell, 0x48, static_cast<uint16_t>(name.size()));
+        std::memcpy(cell.data() + 0x4C, name.data(), name.size());
+        return AddCell(cell);
+    }
+
+    uint32_t AddSubkeyList(const char (&signature)[3], const std::vector<uint32_t>& keys)
+    {
+        const bool withHash = signature[1] != 'i';
+        std::vector<std::byte> cell(4 + keys.size() * (withHash ? 8 : 4));
+        Put<char>(cell, 0, signature[0]);
+        Put<char>(cell, 1, signature[1]);
+        Put<uint16_t>(cell, 2, static_cast<uint16_t>(keys.size()));
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            Put<uint32_t>(cell, 4 + i * (withHash ? 8 : 4), keys[i]);
+        }
+        return AddCell(cell);
+    }
+
+    void SetLhHash(uint32_t list, size_t index, const std::string& name)
+    {
+        uint32_t hash = 0;
+        for (auto c : name)
+        {
+            hash = hash * 37 + static_cast<uint32_t>(toupper(c));
+        }
+        std::memcpy(m_Bin.data() + list + 4 + 4 + index * 8 + 4, &hash, sizeof(hash));
+    }
+
+    uint32_t AddValue(const std::string& name, uint32_t type, const std::vector<std::byte>& data)
+    {
+        auto cell = MakeValue(name, type);
+        if (data.size() <= 4)
+        {
+            Put<uint32_t>(cell, 0x04, static_cast<uint32_t>(data.size()) | 0x80000000);
+            std::memcpy(cell.data() + 0x08, data.data(), data.size());
+            return AddCell(cell);
+        }
+        Put<uint32_t>(cell, 0x04, static_cast<uint32_t>(data.size()));
+        Put<uint32_t>(cell, 0x08, AddCell(data));
+        return AddCell(cell);
+    }
+
+    // Big data value, data split into db segments. size is what the value claims, normally data.size().
+    uint32_t AddBigValue(const std::string& name, uint32_t type, const std::vector<std::byte>& data, uint32_t size)
+    {
+        constexpr size_t SegmentSize = 16344;
+        std::vector<uint32_t> segments;
+        for (size_t offset = 0; offset < data.size(); offset += SegmentSize)
+        {
+            segments.push_back(AddCell({data.begin() + static_cast<ptrdiff_t>(offset),
+                                        data.begin() + static_cast<ptrdiff_t>((std::min)(data.size(), offset + SegmentSize))}));
+        }
+        std::vector<std::byte> bigData(8);
+        Put<char>(bigData, 0, 'd');
+        Put<char>(bigData, 1, 'b');
+        Put<uint16_t>(bigData, 2, static_cast<uint16_t>(segments.size()));
+        Put<uint32_t>(bigData, 4, AddValueList(segments));
+
+        auto cell = MakeValue(name, type);
+        Put<uint32_t>(cell, 0x04, size);
+        Put<uint32_t>(cell, 0x08, AddCell(bigData));
+        return AddCell(cell);
+    }
+
+    uint32_t AddValueList(const std::vector<uint32_t>& values)
+    {
+        std::vector<std::byte> cell(values.size() * 4);
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            Put<uint32_t>(cell, i * 4, values[i]);
+        }
+        return AddCell(cell);
+    }
+
+    void Write(const std::filesystem::path& path, uint32_t root) const
+    {
+        std::vector<std::byte> base(4096);
+        std::memcpy(base.data(), "regf", 4);
+        auto binSize = static_cast<uint32_t>(m_Bin.size());
+        std::memcpy(base.data() + 0x24, &root, sizeof(root));
+        std::memcpy(base.data() + 0x28, &binSize, sizeof(binSize));
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(base.data()), base.size());
+        out.write(reinterpret_cast<const char*>(m_Bin.data()), m_Bin.size());
+    }
+
+    static std::vector<std::byte> Utf16(const std::string& ascii)
+    {
+        std::vector<std::byte> out;
+        for (auto c : ascii)
+        {
+            out.push_back(static_cast<std::byte>(c));
+            out.push_back(std::byte{0});
+        }
+        out.push_back(std::byte{0});
+        out.push_back(std::byte{0});
+        return out;
+    }
+
+    template <class T> static std::vector<std::byte> Bytes(T value)
+    {
+        std::vector<std::byte> out(sizeof(value));
+        std::memcpy(out.data(), &value, sizeof(value));
+        return out;
+    }
+
+private:
+    // Value key cell without its data size and offset.
+    static std::vector<std::byte> MakeValue(const std::string& name, uint32_t type)
+    {
+        std::vector<std::byte> cell(0x14 + name.size());
+        Put<char>(cell, 0, 'v');
+        Put<char>(cell, 1, 'k');
+        Put<uint16_t>(cell, 0x02, static_cast<uint16_t>(name.size()));
+        Put<uint32_t>(cell, 0x0C, type);
+        Put<uint16_t>(cell, 0x10, 0x0001);
+        std::memcpy(cell.data() + 0x14, name.data(), name.size());
+        return cell;
+    }
+
+    template <class T> static void Put(std::vector<std::byte>& cell, size_t offset, T value)
+    {
+        std::memcpy(cell.data() + offset, &value, sizeof(value));
+    }
+
+    uint32_t AddCell(const std::vector<std::byte>& payload)
+    {
+        auto offset = static_cast<uint32_t>(m_Bin.size());
+        std::vector<std::byte> cell((payload.size() + 4 + 7) & ~size_t{7});
+        Put<int32_t>(cell, 0, -static_cast<int32_t>(cell.size()));
+        std::copy(payload.begin(), payload.end(), cell.begin() + 4);
+        m_Bin.insert(m_Bin.end(), cell.begin(), cell.end());
+        return offset;
+    }
+
+    std::vector<std::byte> m_Bin;
+};
+
+class OfflineRegTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        HiveBuilder builder;
+        auto values = builder.AddValueList({
+            builder.AddValue("EditionID", 1, HiveBuilder::Utf16("Professional")),
+            builder.AddValue("CurrentMajorVersionNumber", 4, HiveBuilder::Bytes<uint32_t>(10)),
+            builder.AddValue("InstallTime", 11, HiveBuilder::Bytes<uint64_t>(0x01D5F1A2B3C4D5E6)),
+            builder.AddValue("DigitalProductId", 3, {std::byte{1}, std::byte{2}, std::byte{3}, std::byte{4}, std::byte{5}}),
+        });
+        auto currentVersion = builder.AddKey("CurrentVersion", 0, 0, values, 4);
+        auto windowsNt = builder.AddKey("Windows NT", builder.AddSubkeyList("li", {currentVersion}), 1, 0, 0);
+        auto microsoft = builder.AddKey("Microsoft", builder.AddSubkeyList("lf", {windowsNt}), 1, 0, 0);
+        auto rootList = builder.AddSubkeyList("lh", {microsoft});
+        builder.SetLhHash(rootList, 0, "Microsoft");
+        auto root = builder.AddKey("ROOT", rootList, 1, 0, 0);
+
+        m_Path = std::filesystem::temp_directory_path() / "OfflineRegTest.hiv";
+        builder.Write(m_Path, root);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(m_Path);
+    }
+
+    std::filesystem::path m_Path;
+};
+} // namespace
+
+TEST_F(OfflineRegTest, ReadsValuesOfNestedKey)
+{
+    RegistryHive hive;
+    ASSERT_TRUE(hive.Load(m_Path.string().c_str()));
+    OfflineReg reg;
+    ASSERT_TRUE(reg.Open(hive, L"Microsoft\\Windows NT\\CurrentVersion"));
+
+    std::string edition;
+    EXPECT_TRUE(reg.ReadStringValue("EditionID", edition));
+    EXPECT_EQ(edition, "Professional");
+
+    std::wstring wideEdition;
+    EXPECT_TRUE(reg.ReadStringValue(L"editionid", wideEdition));
+    EXPECT_EQ(wideEdition, L"Professional");
+
+    uint32_t major = 0;
+    EXPECT_TRUE(reg.ReadIntValue(L"CurrentMajorVersionNumber", major));
+    EXPECT_EQ(major, 10u);
+
+    uint64_t installTime = 0;
+    EXPECT_TRUE(reg.ReadInt64Value(L"InstallTime", installTime));
+    EXPECT_EQ(installTime, 0x01D5F1A2B3C4D5E6u);
+
+    std::vector<std::byte> productId;
+    EXPECT_TRUE(reg.ReadBinaryValue(L"DigitalProductId", productId));
+    EXPECT_EQ(productId.size(), 5u);
+}
+
+TEST_F(OfflineRegTest, RejectsMissingKeysValuesAndTypeMismatches)
+{
+    RegistryHive hive;
+    ASSERT_TRUE(hive.Load(m_Path.string().c_str()));
+    OfflineReg reg;
+    EXPECT_FALSE(reg.Open(hive, "Microsoft\\Windows"));
+    ASSERT_TRUE(reg.Open(hive, "MICROSOFT\\windows nt\\CurrentVersion"));
+
+    std::string missing;
+    EXPECT_FALSE(reg.ReadStringValue("ReleaseId", missing));
+    uint32_t notADword = 0;
+    EXPECT_FALSE(reg.ReadIntValue(L"EditionID", notADword));
+}
+
+TEST_F(OfflineRegTest, ReadsValuesInBatch)
+{
+    RegistryHive hive;
+    ASSERT_TRUE(hive.Load(m_Path.string().c_str()));
+    OfflineReg reg;
+    ASSERT_TRUE(reg.Open(hive, "Microsoft\\Windows NT\\CurrentVersion"));
+
+    std::optional<std::string> edition;
+    std::optional<std::string> major;
+    std::optional<std::string> ubr;
+    EXPECT_EQ(ReadValues(reg,
+                         Bind<RegistryValueType::String>("EditionID", edition),
+                         Bind<RegistryValueType::Dword>("CurrentMajorVersionNumber", major),
+                         Bind<RegistryValueType::Dword>("UBR", ubr)),
+              2u);
+    EXPECT_EQ(edition, "Professional");
+    EXPECT_EQ(major, "10");
+    EXPECT_FALSE(ubr);
+}
+
+TEST(OfflineReg, FailsOnNonHiveFile)
+{
+    RegistryHive hive;
+    EXPECT_FALSE(hive.Load("this file does not exist"));
+    OfflineReg reg;
+    EXPECT_FALSE(reg.Open(hive, "Microsoft"));
+}
+
+TEST(OfflineReg, GathersBigDataAndRejectsForgedSizes)
+{
+    HiveBuilder builder;
+    std::vector<std::byte> large(20000, std::byte{0x5A});
+    auto values = builder.AddValueList({
+        builder.AddBigValue("Large", 3, large, static_cast<uint32_t>(large.size())),
+        // One segment of 16 bytes claiming almost 2 GB.
+        builder.AddBigValue("Forged", 3, std::vector<std::byte>(16), 0x7FFFFFF0),
+    });
+    auto root = builder.AddKey("ROOT", 0, 0, values, 2);
+    auto path = std::filesystem::temp_directory_path() / "OfflineRegBigData.hiv";
+    builder.Write(path, root);
+
+    {
+        RegistryHive hive;
+        ASSERT_TRUE(hive.Load(path.string().c_str()));
+        OfflineReg reg;
+        ASSERT_TRUE(reg.Open(hive, L""));
+        std::vector<std::byte> data;
+        EXPECT_TRUE(reg.ReadBinaryValue(L"Large", data));
+        EXPECT_EQ(data, large);
+        EXPECT_FALSE(reg.ReadBinaryValue(L"Forged", data));
+        // Refused before anything is allocated for it.
+        RegistryValue value;
+        std::vector<std::byte> scratch;
+        EXPECT_FALSE(reg.ReadValue(L"Forged", value, scratch));
+        EXPECT_EQ(scratch.capacity(), 0u);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(OfflineOperatingSystemInfoFetcher, DerivesTheWmiFieldsFromTheHive)
+{
+    HiveBuilder builder;
+    auto values = builder.AddValueList({
+        // Windows 11 still says Windows 10 here.
+        builder.AddValue("ProductName", 1, HiveBuilder::Utf16("Windows 10 Pro")),
+        builder.AddValue("EditionID", 1, HiveBuilder::Utf16("Professional")),
+        builder.AddValue("CurrentMajorVersionNumber", 4, HiveBuilder::Bytes<uint32_t>(10)),
+        builder.AddValue("CurrentMinorVersionNumber", 4, HiveBuilder::Bytes<uint32_t>(0)),
+        builder.AddValue("CurrentBuildNumber", 1, HiveBuilder::Utf16("22631")),
+        builder.AddValue("UBR", 4, HiveBuilder::Bytes<uint32_t>(3880)),
+    });
+    auto currentVersion = builder.AddKey("CurrentVersion", 0, 0, values, 6);
+    auto windowsNt = builder.AddKey("Windows NT", builder.AddSubkeyList("li", {currentVersion}), 1, 0, 0);
+    auto microsoft = builder.AddKey("Microsoft", builder.AddSubkeyList("li", {windowsNt}), 1, 0, 0);
+    auto wow64 = builder.AddKey("WOW6432Node", 0, 0, 0, 0);
+    auto root = builder.AddKey("ROOT", builder.AddSubkeyList("li", {microsoft, wow64}), 2, 0, 0);
+    auto path = std::filesystem::temp_directory_path() / "OfflineFetcherTest.hiv";
+    builder.Write(path, root);
+
+    OfflineOperatingSystemInfoFetcher fetcher(path.string());
+    auto info = fetcher.GetInformation();
+    EXPECT_EQ(info.Caption, "Microsoft Windows 11 Pro");
+    EXPECT_EQ(info.Version, "10.0.22631");
+    EXPECT_EQ(info.OSArchitecture, "64-bit");
+    EXPECT_EQ(info.ServicePackMajorVersion, "0");
+    EXPECT_EQ(info.EditionID, "Professional");
+    EXPECT_EQ(info.UBR, "3880");
+    EXPECT_EQ(info.Codename, "SV3 (Sun Valley 3)");
+    // Nothing comes from the host running the fetcher.
+    EXPECT_FALSE(info.Locale);
+    EXPECT_FALSE(info.MUILanguage);
+    EXPECT_FALSE(info.OSVersion);
+
+    auto caption = fetcher.GetInformation({OperatingSystemInfoField::Caption});
+    EXPECT_EQ(caption.Caption, "Microsoft Windows 11 Pro");
+    EXPECT_FALSE(caption.UBR);
+    std::filesystem::remove(path);
+
+    OfflineOperatingSystemInfoFetcher missing("this file does not exist");
+    EXPECT_FALSE(missing.GetInformation().Caption);
+}
@@ -0,0 +1,212 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <OperatingSystemInfoBitmap.h>
+#include <OperatingSystemInfoBitmapIndex.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Ids spread over a few containers, some sparse enough to be arrays, some dense enough to be bitsets.
+std::set<uint32_t> MakeRandomSet(std::mt19937& random)
+{
+    std::set<uint32_t> hosts;
+    for (uint32_t key = 0; key < 6; ++key)
+    {
+        const uint32_t count = random() % 3 == 0 ? 0 : random() % 2 == 0 ? random() % 3000 : 3000 + random() % 40000;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            hosts.insert((key << 16) | (random() & 0xFFFF));
+        }
+    }
+    return hosts;
+}
+
+OperatingSystemInfoBitmap MakeBitmap(const std::set<uint32_t>& hosts)
+{
+    OperatingSystemInfoBitmap bitmap;
+    for (auto host : hosts)
+    {
+        EXPECT_TRUE(bitmap.Add(host));
+    }
+    return bitmap;
+}
+
+std::vector<uint32_t> ToVector(const std::set<uint32_t>& hosts)
+{
+    return {hosts.begin(), hosts.end()};
+}
+
+OperatingSystemInfo MakeSnapshot(const char* edition, const char* codename, const char* architecture)
+{
+    OperatingSystemInfo info;
+    info.EditionID = edition;
+    info.Codename = codename;
+    info.OSArchitecture = architecture;
+    info.CurrentMajorVersionNumber = "10";
+    return info;
+}
+} // namespace
+
+TEST(OperatingSystemInfoBitmap, MatchesSetOperations)
+{
+    std::mt19937 random(24);
+    for (int round = 0; round < 8; ++round)
+    {
+        const auto lhs = MakeRandomSet(random);
+        const auto rhs = MakeRandomSet(random);
+        const auto left = MakeBitmap(lhs);
+        const auto right = MakeBitmap(rhs);
+        ASSERT_EQ(left.ToVector(), ToVector(lhs));
+        ASSERT_EQ(left.Cardinality(), lhs.size());
+
+        std::vector<uint32_t> expectedAnd;
+        std::vector<uint32_t> expectedOr;
+        std::vector<uint32_t> expectedAndNot;
+        std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(expectedAnd));
+        std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(expectedOr));
+        std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(expectedAndNot));
+        for (auto level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2})
+        {
+            OperatingSystemInfoBitmap result;
+            AndBitmaps(left.View(), right.View(), result, level);
+            EXPECT_EQ(result.ToVector(), expectedAnd);
+            EXPECT_EQ(result.Cardinality(), expectedAnd.size());
+            OrBitmaps(left.View(), right.View(), result, level);
+            EXPECT_EQ(result.ToVector(), expectedOr);
+            EXPECT_EQ(result.Cardinality(), expectedOr.size());
+            AndNotBitmaps(left.View(), right.View(), result, level);
+            EXPECT_EQ(result.ToVector(), expectedAndNot);
+            EXPECT_EQ(result.Cardinality(), expectedAndNot.size());
+        }
+
+        // Removing every other host crosses back from bitsets to arrays.
+        OperatingSystemInfoBitmap copy;
+        copy.Assign(left.View());
+        auto remaining = lhs;
+        for (auto host : lhs)
+        {
+            if (host % 2 == 0)
+            {
+                EXPECT_TRUE(copy.Remove(host));
+                EXPECT_FALSE(copy.Remove(host));
+                remaining.erase(host);
+            }
+        }
+        EXPECT_EQ(copy.ToVector(), ToVector(remaining));
+        for (auto host : lhs)
+        {
+            EXPECT_EQ(copy.Contains(host), host % 2 != 0);
+        }
+    }
+
+    std::set<uint32_t> sets[3] = {MakeRandomSet(random), MakeRandomSet(random), MakeRandomSet(random)};
+    std::vector<uint32_t> expected = ToVector(sets[0]);
+    for (const auto& hosts : {sets[1], sets[2]})
+    {
+        std::vector<uint32_t> next;
+        std::set_intersection(expected.begin(), expected.end(), hosts.begin(), hosts.end(), std::back_inserter(next));
+        expected.swap(next);
+    }
+    OperatingSystemInfoBitmap bitmaps[3] = {MakeBitmap(sets[0]), MakeBitmap(sets[1]), MakeBitmap(sets[2])};
+    OperatingSystemInfoBitmapView views[3] = {bitmaps[0].View(), bitmaps[1].View(), bitmaps[2].View()};
+    OperatingSystemInfoBitmap result;
+    AndBitmaps(views, 3, result);
+    EXPECT_EQ(result.ToVector(), expected);
+    AndBitmaps(views, 0, result);
+    EXPECT_TRUE(result.Empty());
+}
+
+TEST(OperatingSystemInfoBitmapIndex, FiltersHostsAndFollowsUpdates)
+{
+    OperatingSystemInfoBitmapIndex index;
+    std::mt19937 random(5);
+    const char* editions[] = {"Enterprise", "Professional", "Core"};
+    const char* codenames[] = {"RS5", "19H1", "20H2", "21H2"};
+    const char* architectures[] = {"64-bit", "32-bit"};
+    constexpr uint32_t HostCount = 20000;
+    std::vector<OperatingSystemInfo> snapshots(HostCount);
+    auto update = [&](uint32_t host) {
+        snapshots[host] = MakeSnapshot(editions[random() % 3], codenames[random() % 4], architectures[random() % 2]);
+        index.Update(host, snapshots[host]);
+    };
+    for (uint32_t host = 0; host < HostCount; ++host)
+    {
+        update(host);
+    }
+    // New snapshots for some hosts, and a few leaving the fleet.
+    for (int i = 0; i < 5000; ++i)
+    {
+        update(random() % HostCount);
+    }
+    std::vector<bool> removed(HostCount);
+    for (uint32_t host = 0; host < HostCount; host += 97)
+    {
+        EXPECT_TRUE(index.Remove(host));
+        EXPECT_FALSE(index.Remove(host));
+        removed[host] = true;
+    }
+
+    std::vector<uint32_t> expected;
+    std::vector<uint32_t> expectedNot;
+    for (uint32_t host = 0; host < HostCount; ++host)
+    {
+        if (removed[host])
+        {
+            continue;
+        }
+        const auto& info = snapshots[host];
+        if (*info.EditionID == "Enterprise" && *info.Codename == "RS5" && *info.OSArchitecture == "64-bit")
+        {
+            expected.push_back(host);
+        }
+        if (*info.EditionID != "Enterprise")
+        {
+            expectedNot.push_back(host);
+        }
+    }
+
+    auto check = [&](auto& source) {
+        OperatingSystemInfoBitmapView terms[] = {source.Find(OperatingSystemInfoField::EditionID, "Enterprise"),
+                                                 source.Find(OperatingSystemInfoField::Codename, "RS5"),
+                                                 source.Find(OperatingSystemInfoField::OSArchitecture, "64-bit")};
+        OperatingSystemInfoBitmap result;
+        AndBitmaps(terms, std::size(terms), result);
+        EXPECT_EQ(result.ToVector(), expected);
+        AndNotBitmaps(source.Hosts(), terms[0], result);
+        EXPECT_EQ(result.ToVector(), expectedNot);
+        EXPECT_EQ(source.Hosts().Cardinality(), HostCount - (HostCount + 96) / 97);
+        // Inlined numbers are found by their text.
+        EXPECT_EQ(source.Find(OperatingSystemInfoField::CurrentMajorVersionNumber, "10").Cardinality(),
+                  source.Hosts().Cardinality());
+        EXPECT_TRUE(source.Find(OperatingSystemInfoField::EditionID, "Education").Empty());
+        EXPECT_TRUE(source.Find(OperatingSystemInfoField::Caption, "Enterprise").Empty());
+    };
+    check(index);
+    EXPECT_EQ(index.GetValueCount(OperatingSystemInfoField::Codename), 4u);
+
+    const auto path = (std::filesystem::temp_directory_path() / "OperatingSystemInfoBitmapIndexTest.bin").string();
+    ASSERT_TRUE(index.WriteFile(path.c_str()));
+    MappedOperatingSystemInfoBitmapIndex mapped;
+    ASSERT_TRUE(mapped.Open(path.c_str()));
+    check(mapped);
+    mapped.Close();
+
+    // Truncated files are rejected.
+    std::string content;
+    {
+        std::ifstream file(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content.substr(0, content.size() / 2);
+    EXPECT_FALSE(mapped.Open(path.c_str()));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,152 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <CompactOperatingSystemInfo.h>
+#include <OperatingSystemInfoDiff.h>
+#include <ThreadPool.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+OperatingSystemInfo MakeInfo(const std::string& ubr)
+{
+    OperatingSystemInfo info;
+    info.Caption = "Microsoft Windows 10 Pro";
+    info.EditionID = "Professional";
+    info.CurrentBuildNumber = "19045";
+    info.UBR = ubr;
+    return info;
+}
+} // namespace
+
+TEST(OperatingSystemInfoDiff, ReportsChangedFieldsPointingIntoTheSnapshots)
+{
+    auto previous = MakeInfo("3803");
+    auto current = MakeInfo("4046");
+    current.EditionID.reset();
+    current.ReleaseId = "";
+
+    OperatingSystemInfoChangeSet changes;
+    ASSERT_EQ(DiffOperatingSystemInfo(previous, current, changes), 3u);
+    EXPECT_EQ(changes[0].Field, OperatingSystemInfoField::EditionID);
+    EXPECT_EQ(changes[0].Old, &previous.EditionID);
+    EXPECT_EQ(changes[0].New, &current.EditionID);
+    // An empty value is not the same as no value.
+    EXPECT_EQ(changes[1].Field, OperatingSystemInfoField::ReleaseId);
+    EXPECT_EQ(changes[2].Field, OperatingSystemInfoField::UBR);
+    EXPECT_EQ(*changes[2].Old, "3803");
+    EXPECT_EQ(*changes[2].New, "4046");
+    EXPECT_EQ(changes.Fields(), (OperatingSystemInfoFieldMask{OperatingSystemInfoField::EditionID,
+                                                              OperatingSystemInfoField::ReleaseId,
+                                                              OperatingSystemInfoField::UBR}));
+    EXPECT_EQ(GetChangedFields(previous, current), changes.Fields());
+
+    // Only the requested fields are compared, the set is reused.
+    EXPECT_EQ(DiffOperatingSystemInfo(previous, current, changes, {OperatingSystemInfoField::Caption}), 0u);
+    EXPECT_TRUE(changes.Empty());
+    EXPECT_EQ(changes.begin(), changes.end());
+}
+
+TEST(OperatingSystemInfoDiff, AppliedChangesRebuildTheCurrentSnapshot)
+{
+    auto previous = MakeInfo("3803");
+    auto current = MakeInfo("4046");
+    current.Caption.reset();
+    current.Locale = "0409";
+
+    OperatingSystemInfoChangeSet changes;
+    DiffOperatingSystemInfo(previous, current, changes);
+    auto rebuilt = previous;
+    ApplyOperatingSystemInfoChanges(rebuilt, changes);
+    EXPECT_EQ(GetChangedFields(rebuilt, current), OperatingSystemInfoFieldMask());
+
+    rebuilt = previous;
+    ApplyOperatingSystemInfoChanges(rebuilt, current, GetChangedFields(previous, current));
+    EXPECT_EQ(GetChangedFields(rebuilt, current), OperatingSystemInfoFieldMask());
+}
+
+TEST(OperatingSystemInfoDiff, ComparesCompactRecordsOfOnePool)
+{
+    OperatingSystemInfoStringPool strings;
+    auto previousInfo = MakeInfo("3803");
+    auto currentInfo = MakeInfo("4046");
+    // Same slot value, once a string id and once an inlined number.
+    previousInfo.Caption = "0";
+    currentInfo.Caption = "0";
+    previousInfo.ServicePackMajorVersion = "0";
+    currentInfo.ServicePackMajorVersion = "00";
+    currentInfo.CurrentBuildNumber.reset();
+
+    auto previous = CompactOperatingSystemInfo::Pack(previousInfo, strings);
+    auto current = CompactOperatingSystemInfo::Pack(currentInfo, strings);
+    EXPECT_EQ(GetChangedFields(previous, current), GetChangedFields(previousInfo, currentInfo));
+    EXPECT_EQ(GetChangedFields(previous, current, {OperatingSystemInfoField::UBR}),
+              (OperatingSystemInfoFieldMask{OperatingSystemInfoField::UBR}));
+    EXPECT_TRUE(GetChangedFields(current, current).Empty());
+}
+
+TEST(OperatingSystemInfoDiff, BatchDiffsEveryPairAcrossChunks)
+{
+    ThreadPool pool(4);
+    OperatingSystemInfoBatchDiff diff(pool, 7);
+    OperatingSystemInfoStringPool strings;
+    std::vector<OperatingSystemInfo> previous;
+    std::vector<OperatingSystemInfo> current;
+    std::vector<CompactOperatingSystemInfo> previousCompact;
+    std::vector<CompactOperatingSystemInfo> currentCompact;
+    for (int i = 0; i < 100; ++i)
+    {
+        previous.push_back(MakeInfo("3803"));
+        current.push_back(MakeInfo(i % 3 == 0 ? "4046" : "3803"));
+        if (i % 10 == 0)
+        {
+            current.back().EditionID = "Enterprise";
+        }
+        previousCompact.push_back(CompactOperatingSystemInfo::Pack(previous.back(), strings));
+        currentCompact.push_back(CompactOperatingSystemInfo::Pack(current.back(), strings));
+    }
+
+    std::vector<OperatingSystemInfoFieldMask> changed;
+    ASSERT_TRUE(diff.Diff(previous, current, changed));
+    ASSERT_EQ(changed.size(), 100u);
+    for (size_t i = 0; i < changed.size(); ++i)
+    {
+        EXPECT_EQ(changed[i], GetChangedFields(previous[i], current[i])) << i;
+    }
+    auto statistics = diff.GetStatistics();
+    EXPECT_EQ(statistics.Pairs, 100u);
+    // 34 new UBRs and 10 new editions, 4 of the hosts have both.
+    EXPECT_EQ(statistics.ChangedPairs, 40u);
+    EXPECT_EQ(statistics.ChangedFields, 44u);
+
+    std::vector<OperatingSystemInfoFieldMask> changedCompact;
+    ASSERT_TRUE(diff.Diff(previousCompact, currentCompact, changedCompact, {OperatingSystemInfoField::EditionID}));
+    for (size_t i = 0; i < changedCompact.size(); ++i)
+    {
+        EXPECT_EQ(changedCompact[i], changed[i] & OperatingSystemInfoFieldMask{OperatingSystemInfoField::EditionID}) << i;
+    }
+    EXPECT_EQ(diff.GetStatistics().ChangedPairs, 10u);
+
+    EXPECT_TRUE(diff.Diff(std::vector<OperatingSystemInfo>(), std::vector<OperatingSystemInfo>(), changed));
+    EXPECT_TRUE(changed.empty());
+    EXPECT_FALSE(diff.Diff(previous, std::vector<OperatingSystemInfo>(), changed));
+}
+
+TEST(OperatingSystemInfoDiff, BatchDiffRunsOnAPoolWorker)
+{
+    // The only worker waits for the chunks it queued, it has to run them itself.
+    ThreadPool pool(1);
+    OperatingSystemInfoBatchDiff diff(pool, 4);
+    std::vector<OperatingSystemInfo> previous(20, MakeInfo("3803"));
+    std::vector<OperatingSystemInfo> current(20, MakeInfo("4046"));
+    std::vector<OperatingSystemInfoFieldMask> changed;
+    ASSERT_TRUE(pool.Run([&] { return diff.Diff(previous, current, changed); }).get());
+    ASSERT_EQ(changed.size(), 20u);
+    for (auto fields : changed)
+    {
+        EXPECT_EQ(fields, (OperatingSystemInfoFieldMask{OperatingSystemInfoField::UBR}));
+    }
+    EXPECT_EQ(diff.GetStatistics().ChangedPairs, 20u);
+}
@@ -0,0 +1,77 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <OperatingSystemInfoField.h>
+
+#include <string>
+#include <unordered_set>
+
+namespace
+{
+// The schema is usable in constant expressions.
+static_assert(GetFieldName(OperatingSystemInfoField::UBR) == "UBR");
+static_assert(GetFieldDescriptor(OperatingSystemInfoField::Caption).Member == &OperatingSystemInfo::Caption);
+static_assert(GetSourceFields(OperatingSystemInfoFieldSource::Derived) ==
+              OperatingSystemInfoFieldMask{OperatingSystemInfoField::OSVersion, OperatingSystemInfoField::Codename,
+                                           OperatingSystemInfoField::MarketName});
+static_assert((GetSourceFields(OperatingSystemInfoFieldSource::Derived) | GetSourceFields(OperatingSystemInfoFieldSource::Wmi) |
+               GetSourceFields(OperatingSystemInfoFieldSource::Registry)) == OperatingSystemInfoFieldMask::All());
+
+OperatingSystemInfo MakeInfo()
+{
+    OperatingSystemInfo info;
+    info.Caption = "Microsoft Windows 10 Pro";
+    info.CurrentBuildNumber = "19045";
+    info.UBR = "4046";
+    return info;
+}
+} // namespace
+
+TEST(OperatingSystemInfoField, VisitsEveryFieldInDeclarationOrder)
+{
+    size_t index = 0;
+    ForEachField([&index](const OperatingSystemInfoFieldDescriptor& field) {
+        EXPECT_EQ(static_cast<size_t>(field.Field), index);
+        OperatingSystemInfoField found;
+        ASSERT_TRUE(FindField(field.Name, found));
+        EXPECT_EQ(found, field.Field);
+        ++index;
+    });
+    EXPECT_EQ(index, OperatingSystemInfoFieldCount);
+
+    // The members are laid out in the order of the schema.
+    OperatingSystemInfo info;
+    const std::optional<std::string>* previous = nullptr;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        EXPECT_LT(previous, &field.Get(info)) << field.Name;
+        previous = &field.Get(info);
+    });
+
+    size_t visited = 0;
+    EXPECT_FALSE(AllOfFields([&visited](const OperatingSystemInfoFieldDescriptor& field) {
+        ++visited;
+        return field.Field != OperatingSystemInfoField::EditionID;
+    }));
+    EXPECT_EQ(visited, static_cast<size_t>(OperatingSystemInfoField::EditionID) + 1);
+}
+
+TEST(OperatingSystemInfoField, ComparesAndHashesEveryField)
+{
+    auto info = MakeInfo();
+    EXPECT_TRUE(info == MakeInfo());
+    EXPECT_EQ(HashOperatingSystemInfo(info), HashOperatingSystemInfo(MakeInfo()));
+
+    auto empty = info;
+    empty.ServicePackMinorVersion = "";
+    EXPECT_TRUE(empty != info);
+    EXPECT_NE(HashOperatingSystemInfo(empty), HashOperatingSystemInfo(info));
+
+    // Moving characters from a field to the next one changes the hash.
+    auto moved = info;
+    moved.CurrentBuildNumber = "190";
+    moved.UBR = "454046";
+    EXPECT_NE(HashOperatingSystemInfo(moved), HashOperatingSystemInfo(info));
+
+    std::unordered_set<OperatingSystemInfo, OperatingSystemInfoHash> set{info, MakeInfo(), empty, moved};
+    EXPECT_EQ(set.size(), 3u);
+}
@@ -0,0 +1,88 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <OperatingSystemInfoIngestion.h>
+#include <ThreadPool.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::string MakeLine(int host)
+{
+    return R"({"Caption":"Microsoft Windows 10 Pro","EditionID":"Professional","CurrentBuildNumber":"17763","UBR":")" +
+           std::to_string(host % 7) + R"(","Host":"host-)" + std::to_string(host) + "\"}";
+}
+} // namespace
+
+TEST(OperatingSystemInfoIngestion, ParsesJsonLine)
+{
+    OperatingSystemInfoView view{};
+    std::string scratch;
+    ASSERT_TRUE(ParseOperatingSystemInfoLine(
+        R"( { "Caption" : "Windows \"10\" é😀", "UBR": 1234, "Locale": null,)"
+        R"( "Extra": {"a": ["}", 1]}, "OSArchitecture":"64-bit" } )",
+        view, scratch));
+
+    EXPECT_EQ(view.Present, (OperatingSystemInfoFieldMask{OperatingSystemInfoField::Caption, OperatingSystemInfoField::UBR,
+                                                          OperatingSystemInfoField::OSArchitecture}));
+    EXPECT_EQ(view.Values[static_cast<size_t>(OperatingSystemInfoField::Caption)], "Windows \"10\" \xC3\xA9\xF0\x9F\x98\x80");
+    EXPECT_EQ(view.Values[static_cast<size_t>(OperatingSystemInfoField::UBR)], "1234");
+    EXPECT_EQ(view.Values[static_cast<size_t>(OperatingSystemInfoField::OSArchitecture)], "64-bit");
+
+    EXPECT_TRUE(ParseOperatingSystemInfoLine("{}", view, scratch));
+    EXPECT_TRUE(view.Present.Empty());
+    EXPECT_FALSE(ParseOperatingSystemInfoLine(R"({"Caption":"unterminated})", view, scratch));
+    EXPECT_FALSE(ParseOperatingSystemInfoLine(R"({"Caption":"a" "UBR":"1"})", view, scratch));
+    EXPECT_FALSE(ParseOperatingSystemInfoLine(R"({"Caption":"a"} trailing)", view, scratch));
+    EXPECT_FALSE(ParseOperatingSystemInfoLine(R"(["Caption"])", view, scratch));
+}
+
+TEST(OperatingSystemInfoIngestion, IngestsChunksInInputOrder)
+{
+    std::string input;
+    for (int host = 0; host < 500; ++host)
+    {
+        input += MakeLine(host) + (host % 50 == 0 ? "\r\n\n" : "\n");
+    }
+    input += "not json\n";
+    // Longer than a chunk, and the last line has no newline.
+    input += R"({"Caption":")" + std::string(300, 'x') + "\"}";
+
+    ThreadPool pool(4);
+    OperatingSystemInfoIngestionOptions options;
+    options.ChunkSize = 128;
+    options.ChunksInFlight = 3;
+    OperatingSystemInfoIngestion ingestion(pool, options);
+    OperatingSystemInfoInventory inventory;
+    std::vector<uint32_t> records;
+    std::istringstream stream(input);
+    ASSERT_TRUE(ingestion.Ingest(stream, inventory, &records));
+
+    const auto& statistics = ingestion.GetStatistics();
+    EXPECT_EQ(statistics.Lines, 502u);
+    EXPECT_EQ(statistics.Records, 501u);
+    EXPECT_EQ(statistics.Malformed, 1u);
+    EXPECT_EQ(statistics.Read.Bytes, input.size());
+    EXPECT_EQ(statistics.Parse.Bytes, input.size());
+
+    ASSERT_EQ(records.size(), 501u);
+    EXPECT_EQ(inventory.Size(), 8u);
+    for (int host = 0; host < 500; ++host)
+    {
+        EXPECT_EQ(inventory.Get(records[host]).UBR, std::to_string(host % 7));
+        EXPECT_EQ(records[host], records[host % 7]);
+    }
+    EXPECT_EQ(inventory.Get(records.back()).Caption, std::string(300, 'x'));
+}
+
+TEST(OperatingSystemInfoIngestion, FailsOnMissingFile)
+{
+    ThreadPool pool(1);
+    OperatingSystemInfoIngestion ingestion(pool);
+    OperatingSystemInfoInventory inventory;
+    EXPECT_FALSE(ingestion.IngestFile("does-not-exist.jsonl", inventory));
+    EXPECT_EQ(inventory.Size(), 0u);
+}
@@ -0,0 +1,307 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <CompositeOperatingSystemInfoFetcher.h>
+#include <IOperatingSystemInfoFetcher.h>
+#include <OperatingSystemInfoProvider.h>
+#include <ThreadPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// Reports a fixed Caption and EditionID and remembers the mask it was asked for.
+class FixedFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit FixedFetcher(OperatingSystemInfoFieldMask& requested) : m_Requested(requested)
+    {
+    }
+
+    OperatingSystemInfo GetInformation() override
+    {
+        OperatingSystemInfo info;
+        info.Caption = "Microsoft Windows 10 Pro";
+        info.EditionID = "Professional";
+        return info;
+    }
+
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields) override
+    {
+        m_Requested = fields;
+        return IOperatingSystemInfoFetcher::GetInformation(fields);
+    }
+
+private:
+    OperatingSystemInfoFieldMask& m_Requested;
+};
+
+// Takes a while so that concurrent callers pile up behind the first one.
+class SlowFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit SlowFetcher(std::atomic<int>& calls) : m_Calls(calls)
+    {
+    }
+
+    OperatingSystemInfo GetInformation() override
+    {
+        ++m_Calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        OperatingSystemInfo info;
+        info.Caption = "Microsoft Windows 10 Pro";
+        return info;
+    }
+
+private:
+    std::atomic<int>& m_Calls;
+};
+
+// Stands for a stuck WMI service, answers the Caption once released.
+class StuckFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    OperatingSystemInfo GetInformation() override
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Released.wait(lock, [this] { return m_Free; });
+        OperatingSystemInfo info;
+        info.Caption = "Microsoft Windows 10 Pro";
+        return info;
+    }
+
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Free = true;
+        m_Released.notify_all();
+    }
+
+private:
+    std::mutex m_Mutex;
+    std::condition_variable m_Released;
+    bool m_Free = false;
+};
+
+// Reports the UBR right away.
+class RegistryFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    OperatingSystemInfo GetInformation() override
+    {
+        OperatingSystemInfo info;
+        info.UBR = "3803";
+        return info;
+    }
+};
+} // namespace
+
+TEST(OperatingSystemInfoProvider, FillsOnlyRequestedFields)
+{
+    OperatingSystemInfoFieldMask requested;
+    OperatingSystemInfoProvider provider(std::make_unique<FixedFetcher>(requested));
+
+    auto info = provider.GetInformation({OperatingSystemInfoField::Caption, OperatingSystemInfoField::UBR});
+
+    EXPECT_EQ(requested, (OperatingSystemInfoFieldMask{OperatingSystemInfoField::Caption, OperatingSystemInfoField::UBR}));
+    EXPECT_EQ(info.Caption, "Microsoft Windows 10 Pro");
+    EXPECT_EQ(info.UBR, "N/A");
+    EXPECT_FALSE(info.EditionID.has_value());
+    EXPECT_FALSE(info.OSVersion.has_value());
+}
+
+TEST(OperatingSystemInfoProvider, FillsEveryFieldByDefault)
+{
+    OperatingSystemInfoFieldMask requested;
+    OperatingSystemInfoProvider provider(std::make_unique<FixedFetcher>(requested));
+
+    auto info = provider.GetInformation();
+
+    EXPECT_EQ(requested, OperatingSystemInfoFieldMask::All());
+    EXPECT_EQ(info.EditionID, "Professional");
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        EXPECT_TRUE(GetField(info, static_cast<OperatingSystemInfoField>(i)).has_value());
+    }
+}
+
+TEST(OperatingSystemInfoProvider, CachesSnapshotUntilInvalidated)
+{
+    OperatingSystemInfoFieldMask requested;
+    OperatingSystemInfoProvider provider(std::make_unique<FixedFetcher>(requested), std::chrono::hours(1));
+
+    EXPECT_EQ(provider.GetInformation().Caption, "Microsoft Windows 10 Pro");
+    EXPECT_EQ(provider.GetInformation({OperatingSystemInfoField::Caption}).Caption, "Microsoft Windows 10 Pro");
+    auto statistics = provider.GetCacheStatistics();
+    EXPECT_EQ(statistics.Hits, 1u);
+    EXPECT_EQ(statistics.Misses, 1u);
+    EXPECT_EQ(statistics.Refreshes, 1u);
+
+    provider.Invalidate();
+    provider.GetInformation({OperatingSystemInfoField::Caption});
+    EXPECT_EQ(requested, OperatingSystemInfoFieldMask{OperatingSystemInfoField::Caption});
+    EXPECT_EQ(provider.GetCacheStatistics().Refreshes, 2u);
+}
+
+TEST(OperatingSystemInfoProvider, WidensSnapshotForUncachedFields)
+{
+    OperatingSystemInfoFieldMask requested;
+    OperatingSystemInfoProvider provider(std::make_unique<FixedFetcher>(requested), std::chrono::hours(1));
+
+    provider.GetInformation({OperatingSystemInfoField::Caption});
+    auto info = provider.GetInformation({OperatingSystemInfoField::EditionID});
+    EXPECT_EQ(info.EditionID, "Professional");
+    EXPECT_FALSE(info.Caption.has_value());
+    EXPECT_EQ(requested, (OperatingSystemInfoFieldMask{OperatingSystemInfoField::Caption, OperatingSystemInfoField::EditionID}));
+
+    provider.GetInformation({OperatingSystemInfoField::Caption, OperatingSystemInfoField::EditionID});
+    EXPECT_EQ(provider.GetCacheStatistics().Refreshes, 2u);
+    EXPECT_EQ(provider.GetCacheStatistics().Hits, 1u);
+}
+
+TEST(OperatingSystemInfoProvider, RefetchesAfterTimeToLive)
+{
+    OperatingSystemInfoFieldMask requested;
+    OperatingSystemInfoProvider provider(std::make_unique<FixedFetcher>(requested), std::chrono::milliseconds(1));
+
+    provider.GetInformation();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    provider.GetInformation();
+    EXPECT_EQ(provider.GetCacheStatistics().Refreshes, 2u);
+}
+
+TEST(OperatingSystemInfoProvider, CoalescesConcurrentMisses)
+{
+    std::atomic<int> calls{0};
+    OperatingSystemInfoProvider provider(std::make_unique<SlowFetcher>(calls), std::chrono::hours(1));
+
+    std::vector<std::thread> threads;
+    std::atomic<int> answered{0};
+    for (int i = 0; i < 64; ++i)
+    {
+        threads.emplace_back([&] {
+            if (provider.GetInformation().Caption == "Microsoft Windows 10 Pro")
+            {
+                ++answered;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(answered, 64);
+    auto statistics = provider.GetCacheStatistics();
+    EXPECT_EQ(statistics.Refreshes, 1u);
+    EXPECT_EQ(statistics.Hits + statistics.Misses, 64u);
+}
+
+TEST(OperatingSystemInfoProvider, ReadsWhileSnapshotsAreReplaced)
+{
+    OperatingSystemInfoFieldMask requested;
+    OperatingSystemInfoProvider provider(std::make_unique<FixedFetcher>(requested), std::chrono::hours(1));
+
+    std::atomic<bool> done{false};
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&] {
+            while (!done)
+            {
+                if (provider.GetInformation({OperatingSystemInfoField::Caption}).Caption != "Microsoft Windows 10 Pro")
+                {
+                    ++wrong;
+                }
+            }
+        });
+    }
+    // Every invalidation frees the snapshot the readers may be copying from.
+    for (int i = 0; i < 1000; ++i)
+    {
+        provider.Invalidate();
+        provider.GetInformation({OperatingSystemInfoField::Caption});
+    }
+    done = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(wrong, 0);
+    EXPECT_GE(provider.GetCacheStatistics().Refreshes, 1000u);
+}
+
+TEST(OperatingSystemInfoProvider, ReturnsFieldsFetchedByTheDeadlineAndCachesLateOnes)
+{
+    ThreadPool pool(2);
+    auto stuck = std::make_shared<StuckFetcher>();
+    auto composite = std::make_unique<CompositeOperatingSystemInfoFetcher>(pool);
+    composite->AddSource(stuck, 1, {OperatingSystemInfoField::Caption});
+    composite->AddSource(std::make_shared<RegistryFetcher>(), 1, {OperatingSystemInfoField::UBR, OperatingSystemInfoField::ReleaseId});
+    OperatingSystemInfoProvider provider(std::move(composite), std::chrono::hours(1));
+    OperatingSystemInfoFieldMask fields{OperatingSystemInfoField::Caption, OperatingSystemInfoField::UBR,
+                                        OperatingSystemInfoField::ReleaseId};
+
+    OperatingSystemInfoFieldMask timedOut;
+    auto begin = std::chrono::steady_clock::now();
+    auto info = provider.GetInformation(fields, begin + std::chrono::milliseconds(50), &timedOut);
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(500));
+    EXPECT_EQ(info.Caption, OperatingSystemInfoProvider::TimedOutValue);
+    EXPECT_EQ(info.UBR, "3803");
+    EXPECT_EQ(info.ReleaseId, "N/A");
+    EXPECT_EQ(timedOut, OperatingSystemInfoFieldMask{OperatingSystemInfoField::Caption});
+
+    // The Caption arrives late and goes to the cache, the next call does not fetch.
+    stuck->Release();
+    auto waitUntil = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (provider.GetCacheStatistics().LateUpdates == 0 && std::chrono::steady_clock::now() < waitUntil)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    info = provider.GetInformation(fields, std::chrono::steady_clock::now() + std::chrono::milliseconds(50), &timedOut);
+    EXPECT_EQ(info.Caption, "Microsoft Windows 10 Pro");
+    EXPECT_EQ(info.UBR, "3803");
+    EXPECT_TRUE(timedOut.Empty());
+    auto statistics = provider.GetCacheStatistics();
+    EXPECT_EQ(statistics.Refreshes, 1u);
+    EXPECT_EQ(statistics.Hits, 1u);
+    EXPECT_EQ(statistics.TimedOut, 1u);
+    EXPECT_EQ(statistics.LateUpdates, 1u);
+}
+
+TEST(OperatingSystemInfoProvider, MarksTimedOutFieldsWithoutCache)
+{
+    ThreadPool pool(2);
+    auto stuck = std::make_shared<StuckFetcher>();
+    auto composite = std::make_unique<CompositeOperatingSystemInfoFetcher>(pool);
+    composite->AddSource(stuck, 1, {OperatingSystemInfoField::Caption});
+    OperatingSystemInfoProvider provider(std::move(composite));
+
+    auto info = provider.GetInformation({OperatingSystemInfoField::Caption},
+                                        std::chrono::steady_clock::now() + std::chrono::milliseconds(20));
+    EXPECT_EQ(info.Caption, OperatingSystemInfoProvider::TimedOutValue);
+    stuck->Release();
+    EXPECT_EQ(provider.GetInformation({OperatingSystemInfoField::Caption}).Caption, "Microsoft Windows 10 Pro");
+}
+
+TEST(OperatingSystemInfoFieldMask, CombinesAndComplements)
+{
+    constexpr OperatingSystemInfoFieldMask versions{OperatingSystemInfoField::CurrentMajorVersionNumber,
+                                                    OperatingSystemInfoField::CurrentMinorVersionNumber};
+    static_assert(versions.Has(OperatingSystemInfoField::CurrentMajorVersionNumber), "constexpr mask");
+
+    auto rest = ~versions;
+    EXPECT_FALSE(rest.Intersects(versions));
+    EXPECT_EQ(rest | versions, OperatingSystemInfoFieldMask::All());
+    EXPECT_TRUE(OperatingSystemInfoFieldMask::All().Contains(versions));
+    EXPECT_TRUE((rest & versions).Empty());
+}
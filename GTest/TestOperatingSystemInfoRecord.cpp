@@ -0,0 +1,155 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <MappedFile.h>
+#include <OperatingSystemInfoRecord.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace
+{
+OperatingSystemInfo MakeInfo()
+{
+    OperatingSystemInfo info;
+    info.OSVersion = "Microsoft Windows 10 Pro[64-bit OS][System Locale ja-JP]";
+    info.Caption = "Microsoft Windows 10 Pro";
+    info.EditionID = "";
+    info.Codename = "RS5 (Redstone 5)";
+    info.UBR = "1234";
+    info.MUILanguage = "ja-JP";
+    info.ServicePackMinorVersion = "0";
+    return info;
+}
+
+void ExpectEqual(const OperatingSystemInfo& expected, const OperatingSystemInfo& actual)
+{
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        auto field = static_cast<OperatingSystemInfoField>(i);
+        EXPECT_EQ(GetField(expected, field), GetField(actual, field)) << GetFieldName(field);
+    }
+}
+} // namespace
+
+TEST(OperatingSystemInfoRecord, RoundTripsInPlace)
+{
+    OperatingSystemInfoRecordWriter writer;
+    auto first = writer.Append(MakeInfo());
+    writer.Append(OperatingSystemInfo{});
+    EXPECT_EQ(first % OperatingSystemInfoRecordFormat::Alignment, 0u);
+
+    OperatingSystemInfoRecordReader reader(writer.Data(), writer.Size());
+    OperatingSystemInfoRecordView record;
+    ASSERT_TRUE(reader.Next(record));
+    EXPECT_EQ(record.Size(), first);
+    EXPECT_TRUE(record.Has(OperatingSystemInfoField::EditionID));
+    EXPECT_FALSE(record.Has(OperatingSystemInfoField::Locale));
+    EXPECT_EQ(record.Get(OperatingSystemInfoField::Caption), "Microsoft Windows 10 Pro");
+    EXPECT_EQ(record.Get(OperatingSystemInfoField::EditionID), "");
+    EXPECT_EQ(record.Get(OperatingSystemInfoField::Locale), "");
+    // Views point into the writer's buffer.
+    EXPECT_GE(reinterpret_cast<const std::byte*>(record.Get(OperatingSystemInfoField::UBR).data()), writer.Data());
+    ExpectEqual(MakeInfo(), record.ToOperatingSystemInfo());
+
+    ASSERT_TRUE(reader.Next(record));
+    ExpectEqual(OperatingSystemInfo{}, record.ToOperatingSystemInfo());
+    EXPECT_FALSE(reader.Next(record));
+    EXPECT_FALSE(reader.Failed());
+
+    // Clear keeps the buffer, the same record is written at the same place.
+    auto data = writer.Data();
+    writer.Clear();
+    writer.Append(MakeInfo());
+    EXPECT_EQ(writer.Data(), data);
+    EXPECT_EQ(writer.Size(), first);
+}
+
+TEST(OperatingSystemInfoRecord, RejectsDamagedRecords)
+{
+    OperatingSystemInfoRecordWriter writer;
+    writer.Append(MakeInfo());
+    std::vector<std::byte> bytes(writer.Data(), writer.Data() + writer.Size());
+
+    OperatingSystemInfoRecordView record;
+    EXPECT_FALSE(record.Parse(bytes.data(), bytes.size() - 4));
+
+    auto corrupt = bytes;
+    corrupt[0] = std::byte{'X'};
+    EXPECT_FALSE(record.Parse(corrupt.data(), corrupt.size()));
+
+    corrupt = bytes;
+    // End of the first field past the string area.
+    corrupt[16 + 3] = std::byte{0x7F};
+    EXPECT_FALSE(record.Parse(corrupt.data(), corrupt.size()));
+
+    bytes.push_back(std::byte{0});
+    OperatingSystemInfoRecordReader reader(bytes.data(), bytes.size());
+    EXPECT_TRUE(reader.Next(record));
+    EXPECT_FALSE(reader.Next(record));
+    EXPECT_TRUE(reader.Failed());
+}
+
+TEST(OperatingSystemInfoRecord, IgnoresFieldsAppendedByNewerWriters)
+{
+    OperatingSystemInfoRecordWriter writer;
+    writer.Append(MakeInfo());
+    std::vector<std::byte> bytes(writer.Data(), writer.Data() + writer.Size());
+
+    // Insert one more End entry covering a trailing "new" string, as a newer writer would.
+    const size_t endTable = OperatingSystemInfoRecordFormat::HeaderSize;
+    const size_t strings = endTable + OperatingSystemInfoFieldCount * 4;
+    uint32_t lastEnd = 0;
+    std::memcpy(&lastEnd, &bytes[strings - 4], 4);
+    std::vector<std::byte> extended(bytes.begin(), bytes.begin() + strings);
+    uint32_t newEnd = lastEnd + 4;
+    extended.insert(extended.end(), reinterpret_cast<std::byte*>(&newEnd), reinterpret_cast<std::byte*>(&newEnd) + 4);
+    extended.insert(extended.end(), bytes.begin() + strings, bytes.begin() + strings + lastEnd);
+    for (char c : std::string("next"))
+    {
+        extended.push_back(static_cast<std::byte>(c));
+    }
+    extended.resize((extended.size() + 3) & ~size_t{3});
+    extended[6] = static_cast<std::byte>(OperatingSystemInfoFieldCount + 1);
+    uint32_t size = static_cast<uint32_t>(extended.size());
+    std::memcpy(&extended[8], &size, 4);
+    extended[12 + 2] |= std::byte{0x20}; // bit 21
+
+    OperatingSystemInfoRecordView record;
+    ASSERT_TRUE(record.Parse(extended.data(), extended.size()));
+    ExpectEqual(MakeInfo(), record.ToOperatingSystemInfo());
+}
+
+TEST(OperatingSystemInfoRecord, ReadsMappedFile)
+{
+    OperatingSystemInfoRecordWriter writer;
+    for (int i = 0; i < 100; ++i)
+    {
+        auto info = MakeInfo();
+        info.UBR = std::to_string(i);
+        writer.Append(info);
+    }
+    const char* path = "TestOperatingSystemInfoRecord.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(writer.Data()), static_cast<std::streamsize>(writer.Size()));
+    }
+
+    {
+        MappedFile mapped;
+        ASSERT_TRUE(mapped.Open(path));
+        OperatingSystemInfoRecordReader reader(mapped.Data(), mapped.Size());
+        OperatingSystemInfoRecordView record;
+        int count = 0;
+        while (reader.Next(record))
+        {
+            EXPECT_EQ(record.Get(OperatingSystemInfoField::UBR), std::to_string(count));
+            ++count;
+        }
+        EXPECT_EQ(count, 100);
+        EXPECT_FALSE(reader.Failed());
+    }
+    std::remove(path);
+}
@@ -0,0 +1,191 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <IOperatingSystemInfoFetcher.h>
+#include <OperatingSystemInfoProvider.h>
+#include <OperatingSystemInfoSocket.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+// Takes a while so that the requests sent meanwhile pile up behind the first one.
+class SlowFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit SlowFetcher(std::atomic<int>& calls) : m_Calls(calls)
+    {
+    }
+
+    OperatingSystemInfo GetInformation() override
+    {
+        ++m_Calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        OperatingSystemInfo info;
+        info.Caption = "Microsoft Windows 10 Pro";
+        info.EditionID = "Professional";
+        info.CurrentBuildNumber = "19045";
+        return info;
+    }
+
+private:
+    std::atomic<int>& m_Calls;
+};
+
+std::string GetSocketPath()
+{
+    return (std::filesystem::temp_directory_path() / "OperatingSystemInfoSocketTest.sock").string();
+}
+} // namespace
+
+TEST(OperatingSystemInfoServer, CoalescesAndCachesRequests)
+{
+    std::atomic<int> calls{0};
+    OperatingSystemInfoProvider provider(std::make_unique<SlowFetcher>(calls));
+    OperatingSystemInfoServerOptions options;
+    options.TimeToLive = std::chrono::minutes(1);
+    OperatingSystemInfoServer server(provider, options);
+    const auto path = GetSocketPath();
+    ASSERT_TRUE(server.Start(path));
+
+    // Every client asks for the same fields while the first fetch runs.
+    constexpr uint32_t ClientCount = 16;
+    const OperatingSystemInfoFieldMask fields{OperatingSystemInfoField::Caption, OperatingSystemInfoField::EditionID};
+    std::vector<std::unique_ptr<OperatingSystemInfoClient>> clients;
+    for (uint32_t i = 0; i < ClientCount; ++i)
+    {
+        clients.push_back(std::make_unique<OperatingSystemInfoClient>());
+        ASSERT_TRUE(clients.back()->Connect(path));
+        ASSERT_TRUE(clients.back()->Send(i, fields));
+    }
+    for (uint32_t i = 0; i < ClientCount; ++i)
+    {
+        uint32_t id = 0;
+        OperatingSystemInfoRecordView record;
+        ASSERT_TRUE(clients[i]->Receive(id, record));
+        EXPECT_EQ(id, i);
+        EXPECT_EQ(record.Present(), fields);
+        EXPECT_EQ(record.Get(OperatingSystemInfoField::EditionID), "Professional");
+    }
+    auto statistics = server.GetStatistics();
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(statistics.Connections, ClientCount);
+    EXPECT_EQ(statistics.Requests, ClientCount);
+    EXPECT_EQ(statistics.Fetches, 1u);
+    EXPECT_EQ(statistics.Coalesced, ClientCount - 1);
+
+    // The same fields again come from the cache, other fields need a fetch.
+    OperatingSystemInfo info;
+    ASSERT_TRUE(clients[0]->Query(fields, info));
+    EXPECT_EQ(info.Caption, "Microsoft Windows 10 Pro");
+    EXPECT_FALSE(info.CurrentBuildNumber);
+    ASSERT_TRUE(clients[0]->Query({OperatingSystemInfoField::CurrentBuildNumber}, info));
+    EXPECT_EQ(info.CurrentBuildNumber, "19045");
+    EXPECT_FALSE(info.Caption);
+    statistics = server.GetStatistics();
+    EXPECT_EQ(statistics.CacheHits, 1u);
+    EXPECT_EQ(statistics.Fetches, 2u);
+    EXPECT_EQ(calls, 2);
+
+    // A second server does not take over the socket of a running one.
+    OperatingSystemInfoServer other(provider, options);
+    EXPECT_FALSE(other.Start(path));
+
+    server.Stop();
+    EXPECT_FALSE(server.IsRunning());
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_FALSE(clients[1]->Query(fields, info));
+    EXPECT_FALSE(clients[1]->IsConnected());
+}
+
+TEST(OperatingSystemInfoServer, RejectsBadRequests)
+{
+    std::atomic<int> calls{0};
+    OperatingSystemInfoProvider provider(std::make_unique<SlowFetcher>(calls));
+    OperatingSystemInfoServer server(provider);
+    const auto path = GetSocketPath();
+    ASSERT_TRUE(server.Start(path));
+
+    const int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_NE(socket, -1);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    ASSERT_EQ(connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    const uint32_t request[3] = {0x31515358, 7, OperatingSystemInfoFieldMask::All().Bits()};
+    ASSERT_EQ(write(socket, request, sizeof(request)), static_cast<ssize_t>(sizeof(request)));
+
+    // A BadRequest response, then the end of the stream.
+    uint32_t response[3] = {};
+    ASSERT_EQ(read(socket, response, sizeof(response)), static_cast<ssize_t>(sizeof(response)));
+    EXPECT_EQ(response[1], OperatingSystemInfoSocketFormat::BadRequest);
+    EXPECT_EQ(response[2], 0u);
+    EXPECT_EQ(read(socket, response, sizeof(response)), 0);
+    close(socket);
+
+    EXPECT_EQ(server.GetStatistics().BadRequests, 1u);
+    EXPECT_EQ(server.GetStatistics().Fetches, 0u);
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(OperatingSystemInfoServer, RefusesConnectionsWhenOutOfDescriptors)
+{
+    std::atomic<int> calls{0};
+    OperatingSystemInfoProvider provider(std::make_unique<SlowFetcher>(calls));
+    OperatingSystemInfoServer server(provider);
+    const auto path = GetSocketPath();
+    ASSERT_TRUE(server.Start(path));
+
+    // Takes every descriptor below a lowered limit but one, which goes to the client.
+    rlimit saved{};
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &saved), 0);
+    const int next = dup(0);
+    ASSERT_NE(next, -1);
+    close(next);
+    rlimit limit = saved;
+    limit.rlim_cur = static_cast<rlim_t>(next + 16);
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+    std::vector<int> descriptors;
+    for (int descriptor; (descriptor = dup(0)) != -1;)
+    {
+        descriptors.push_back(descriptor);
+    }
+    close(descriptors.back());
+    descriptors.pop_back();
+
+    OperatingSystemInfoClient client;
+    OperatingSystemInfo info;
+    ASSERT_TRUE(client.Connect(path));
+    EXPECT_FALSE(client.Query(OperatingSystemInfoFieldMask::All(), info));
+    EXPECT_EQ(server.GetStatistics().Refused, 1u);
+
+    // The event loop does not spin on the listener meanwhile.
+    timespec before{};
+    timespec after{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &before);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &after);
+    EXPECT_LT((after.tv_sec - before.tv_sec) * 1000 + (after.tv_nsec - before.tv_nsec) / 1000000, 50);
+
+    for (auto descriptor : descriptors)
+    {
+        close(descriptor);
+    }
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &saved), 0);
+    ASSERT_TRUE(client.Connect(path));
+    EXPECT_TRUE(client.Query({OperatingSystemInfoField::Caption}, info));
+    EXPECT_EQ(info.Caption, "Microsoft Windows 10 Pro");
+}
@@ -0,0 +1,205 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <IOperatingSystemInfoFetcher.h>
+#include <OperatingSystemInfoProvider.h>
+#include <OperatingSystemInfoWatcher.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using namespace std::chrono_literals;
+
+// Reports the UBR it is given, as an update would change it.
+class UpdatableFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    OperatingSystemInfo GetInformation() override
+    {
+        ++Calls;
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        OperatingSystemInfo info;
+        info.Caption = "Microsoft Windows 10 Pro";
+        info.UBR = m_Ubr;
+        return info;
+    }
+
+    void SetUbr(std::string ubr)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Ubr = std::move(ubr);
+    }
+
+    std::atomic<int> Calls{0};
+
+private:
+    std::mutex m_Mutex;
+    std::string m_Ubr = "1288";
+};
+
+// Notifies when the test says so.
+class ManualChangeSource final : public IChangeSource
+{
+public:
+    explicit ManualChangeSource(bool canStart = true) : m_CanStart(canStart)
+    {
+    }
+
+    bool Start(std::function<void()> onChange) override
+    {
+        m_OnChange = std::move(onChange);
+        return m_CanStart;
+    }
+
+    void Stop() override
+    {
+        m_OnChange = nullptr;
+    }
+
+    void Notify()
+    {
+        m_OnChange();
+    }
+
+private:
+    bool m_CanStart;
+    std::function<void()> m_OnChange;
+};
+
+// Collects the snapshots published to a subscriber.
+class Published
+{
+public:
+    OperatingSystemInfoWatcher::Callback Callback()
+    {
+        return [this](const OperatingSystemInfo& info) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Snapshots.push_back(info);
+            m_Changed.notify_all();
+        };
+    }
+
+    bool WaitFor(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        return m_Changed.wait_for(lock, 5s, [this, count] { return m_Snapshots.size() >= count; });
+    }
+
+    std::vector<OperatingSystemInfo> Snapshots()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Snapshots;
+    }
+
+private:
+    std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    std::vector<OperatingSystemInfo> m_Snapshots;
+};
+} // namespace
+
+TEST(OperatingSystemInfoWatcher, PublishesNewSnapshotAndRefreshesProviderCache)
+{
+    auto fetcher = std::make_unique<UpdatableFetcher>();
+    auto& updatable = *fetcher;
+    OperatingSystemInfoProvider provider(std::move(fetcher), std::chrono::hours(1));
+    auto source = std::make_unique<ManualChangeSource>();
+    auto& manual = *source;
+    OperatingSystemInfoWatcher watcher(provider, OperatingSystemInfoFieldMask::All(), 1ms);
+    watcher.AddSource(std::move(source));
+    Published published;
+    watcher.Subscribe(published.Callback());
+    ASSERT_TRUE(watcher.Start());
+    EXPECT_EQ(watcher.GetInformation().UBR, "1288");
+
+    updatable.SetUbr("1348");
+    manual.Notify();
+    ASSERT_TRUE(published.WaitFor(1));
+    EXPECT_EQ(published.Snapshots()[0].UBR, "1348");
+    EXPECT_EQ(published.Snapshots()[0].Caption, "Microsoft Windows 10 Pro");
+    EXPECT_EQ(watcher.GetInformation().UBR, "1348");
+    // The provider's cache was refreshed long before its time to live.
+    EXPECT_EQ(provider.GetInformation().UBR, "1348");
+    EXPECT_EQ(updatable.Calls, 2);
+}
+
+TEST(OperatingSystemInfoWatcher, CoalescesNotificationsAndSkipsUnchangedSnapshots)
+{
+    auto fetcher = std::make_unique<UpdatableFetcher>();
+    auto& updatable = *fetcher;
+    OperatingSystemInfoProvider provider(std::move(fetcher), std::chrono::hours(1));
+    auto source = std::make_unique<ManualChangeSource>();
+    auto& manual = *source;
+    OperatingSystemInfoWatcher watcher(provider, {OperatingSystemInfoField::UBR}, 200ms);
+    watcher.AddSource(std::move(source));
+    Published published;
+    watcher.Subscribe(published.Callback());
+    ASSERT_TRUE(watcher.Start());
+
+    // Nothing changed, the refresh is not published.
+    manual.Notify();
+    std::this_thread::sleep_for(400ms);
+    EXPECT_TRUE(published.Snapshots().empty());
+
+    // A burst within the settle delay makes one refresh.
+    updatable.SetUbr("1348");
+    for (int i = 0; i < 3; ++i)
+    {
+        manual.Notify();
+    }
+    ASSERT_TRUE(published.WaitFor(1));
+    watcher.Stop();
+
+    auto snapshots = published.Snapshots();
+    ASSERT_EQ(snapshots.size(), 1u);
+    EXPECT_EQ(snapshots[0].UBR, "1348");
+    EXPECT_FALSE(snapshots[0].Caption.has_value());
+    auto statistics = watcher.GetStatistics();
+    EXPECT_EQ(statistics.Notifications, 4u);
+    EXPECT_EQ(statistics.Refreshes, 2u);
+    EXPECT_EQ(statistics.Published, 1u);
+}
+
+TEST(OperatingSystemInfoWatcher, StopsCallingUnsubscribedCallbacks)
+{
+    auto fetcher = std::make_unique<UpdatableFetcher>();
+    auto& updatable = *fetcher;
+    OperatingSystemInfoProvider provider(std::move(fetcher), std::chrono::hours(1));
+    auto source = std::make_unique<ManualChangeSource>();
+    auto& manual = *source;
+    OperatingSystemInfoWatcher watcher(provider, OperatingSystemInfoFieldMask::All(), 1ms);
+    watcher.AddSource(std::move(source));
+    Published first;
+    Published second;
+    auto subscription = watcher.Subscribe(first.Callback());
+    watcher.Subscribe(second.Callback());
+    ASSERT_TRUE(watcher.Start());
+
+    updatable.SetUbr("1348");
+    manual.Notify();
+    ASSERT_TRUE(second.WaitFor(1));
+    watcher.Unsubscribe(subscription);
+    updatable.SetUbr("1413");
+    manual.Notify();
+    ASSERT_TRUE(second.WaitFor(2));
+
+    EXPECT_EQ(first.Snapshots().size(), 1u);
+    EXPECT_EQ(second.Snapshots()[1].UBR, "1413");
+}
+
+TEST(OperatingSystemInfoWatcher, FailsToStartWhenASourceCannotBeWatched)
+{
+    OperatingSystemInfoProvider provider(std::make_unique<UpdatableFetcher>(), std::chrono::hours(1));
+    OperatingSystemInfoWatcher watcher(provider);
+    watcher.AddSource(std::make_unique<ManualChangeSource>());
+    watcher.AddSource(std::make_unique<ManualChangeSource>(false));
+    EXPECT_FALSE(watcher.Start());
+}
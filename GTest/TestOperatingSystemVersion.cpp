@@ -0,0 +1,188 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <CompactOperatingSystemInfo.h>
+#include <OperatingSystemVersion.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+OperatingSystemVersion ParseOrInvalid(std::string_view text)
+{
+    OperatingSystemVersion version;
+    ParseOperatingSystemVersion(text, version);
+    return version;
+}
+
+// Every level must agree with the scalar parser.
+void ExpectSameAtEveryLevel(const std::vector<std::string>& texts)
+{
+    std::vector<std::string_view> views(texts.begin(), texts.end());
+    std::vector<OperatingSystemVersion> expected(views.size());
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        expected[i] = ParseOrInvalid(views[i]);
+    }
+    const auto valid = static_cast<size_t>(
+        std::count_if(expected.begin(), expected.end(), [](OperatingSystemVersion version) { return version.IsValid(); }));
+    for (auto level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2})
+    {
+        std::vector<OperatingSystemVersion> versions(views.size());
+        EXPECT_EQ(ParseOperatingSystemVersions(views.data(), views.size(), versions.data(), level), valid);
+        for (size_t i = 0; i < views.size(); ++i)
+        {
+            ASSERT_EQ(versions[i], expected[i]) << '"' << views[i] << "\" at level " << static_cast<int>(level);
+        }
+    }
+}
+} // namespace
+
+TEST(OperatingSystemVersion, ParsesVersionStrings)
+{
+    EXPECT_EQ(ParseOrInvalid("10.0.19041.1234"), OperatingSystemVersion::Make(10, 0, 19041, 1234));
+    EXPECT_EQ(ParseOrInvalid("10.0.19041.1234").Packed, 0x000A00004A6104D2u);
+    EXPECT_EQ(ParseOrInvalid("10.0.15063"), OperatingSystemVersion::Make(10, 0, 15063, 0));
+    EXPECT_EQ(ParseOrInvalid("6.3"), OperatingSystemVersion::Make(6, 3, 0, 0));
+    EXPECT_EQ(ParseOrInvalid("65535.65535.65535.65535"), OperatingSystemVersion::Make(65535, 65535, 65535, 65535));
+    EXPECT_EQ(ParseOrInvalid("10.0.19041.1234").ToString(), "10.0.19041.1234");
+    EXPECT_LT(ParseOrInvalid("10.0.19041.999"), ParseOrInvalid("10.0.19041.1234"));
+    EXPECT_LT(ParseOrInvalid("6.3.9600"), ParseOrInvalid("10.0.10240"));
+    for (auto text : {"", "10", "10.", ".10", "10..0", "10.0.", "10.0.1.2.3", "10.0.65536", "10.0.123456", "10,0",
+                      "10.0.19041 ", "-1.0", "0.0", "0.0.0.0"})
+    {
+        EXPECT_FALSE(ParseOrInvalid(text).IsValid()) << '"' << text << '"';
+    }
+
+    ExpectSameAtEveryLevel({"10.0.19041.1234", "10.0.15063", "6.3", "6.1.7601", "0.0", "1.2", "10.0.22631.3880",
+                            "00010.00000.1.1", "99999.0", "65535.1.2.3", "10.0.65536", "1..2", "1.2.", ".1.2", "1.2.3.4.",
+                            "1.2.3.4.5", "123456.1", "10.0.19041.12345", "65535.65535.65535.65535", "10/0", "10:0", "",
+                            std::string("10.0\0.1", 7), "10.0.19041.1234.", "a.b"});
+    // Random strings of digits and dots, most of them invalid.
+    std::mt19937 random(42);
+    std::vector<std::string> texts;
+    for (int i = 0; i < 20000; ++i)
+    {
+        std::string text(random() % 24, '0');
+        for (auto& c : text)
+        {
+            c = "0123456789....x"[random() % 15];
+        }
+        texts.push_back(std::move(text));
+    }
+    ExpectSameAtEveryLevel(texts);
+}
+
+TEST(OperatingSystemVersion, BuildsTheVersionOfASnapshot)
+{
+    OperatingSystemInfo info;
+    info.Version = "10.0.19045";
+    info.CurrentVersion = "6.3";
+    info.CurrentMajorVersionNumber = "10";
+    info.CurrentMinorVersionNumber = "0";
+    info.CurrentBuildNumber = "19045";
+    info.UBR = "4046";
+    OperatingSystemVersion version;
+    ASSERT_TRUE(GetOperatingSystemVersion(info, version));
+    EXPECT_EQ(version, OperatingSystemVersion::Make(10, 0, 19045, 4046));
+
+    OperatingSystemInfoStringPool strings;
+    OperatingSystemVersion compact;
+    ASSERT_TRUE(GetOperatingSystemVersion(CompactOperatingSystemInfo::Pack(info, strings), strings, compact));
+    EXPECT_EQ(compact, version);
+
+    // Windows 7 has neither the version numbers nor UBR.
+    OperatingSystemInfo windows7;
+    windows7.Version = "6.1.7601";
+    windows7.CurrentVersion = "6.1";
+    windows7.CurrentBuildNumber = "7601";
+    ASSERT_TRUE(GetOperatingSystemVersion(windows7, version));
+    EXPECT_EQ(version, OperatingSystemVersion::Make(6, 1, 7601, 0));
+    ASSERT_TRUE(GetOperatingSystemVersion(CompactOperatingSystemInfo::Pack(windows7, strings), strings, compact));
+    EXPECT_EQ(compact, version);
+
+    windows7.Version.reset();
+    ASSERT_TRUE(GetOperatingSystemVersion(windows7, version));
+    EXPECT_EQ(version, OperatingSystemVersion::Make(6, 1, 7601, 0));
+    windows7.CurrentBuildNumber = "N/A";
+    EXPECT_FALSE(GetOperatingSystemVersion(windows7, version));
+    EXPECT_FALSE(GetOperatingSystemVersion(OperatingSystemInfo(), version));
+}
+
+TEST(OperatingSystemVersionIndex, AnswersRangeQueries)
+{
+    OperatingSystemInfoInventory inventory;
+    std::vector<uint32_t> recordIds;
+    std::vector<OperatingSystemVersion> versions;
+    std::mt19937 random(7);
+    const uint16_t builds[] = {7601, 9600, 17763, 19041, 19045, 22621, 22631};
+    for (int i = 0; i < 5000; ++i)
+    {
+        OperatingSystemInfo info;
+        if (random() % 10 == 0)
+        {
+            // No version.
+            info.Caption = "Unknown";
+            versions.emplace_back();
+        }
+        else
+        {
+            const auto build = builds[random() % std::size(builds)];
+            const auto ubr = static_cast<uint16_t>(random() % 300 * 17);
+            const uint16_t major = build > 9600 ? 10 : 6;
+            const uint16_t minor = build == 7601 ? 1 : build == 9600 ? 3 : 0;
+            info.CurrentMajorVersionNumber = std::to_string(major);
+            info.CurrentMinorVersionNumber = std::to_string(minor);
+            info.CurrentBuildNumber = std::to_string(build);
+            info.UBR = std::to_string(ubr);
+            versions.push_back(OperatingSystemVersion::Make(major, minor, build, ubr));
+        }
+        recordIds.push_back(inventory.Add(info));
+    }
+
+    OperatingSystemVersionIndex fromVersions;
+    fromVersions.Build(versions.data(), versions.size());
+    OperatingSystemVersionIndex fromInventory;
+    fromInventory.Build(inventory, recordIds);
+    for (const auto* index : {&fromVersions, &fromInventory})
+    {
+        auto expect = [&](OperatingSystemVersionMatches matches, OperatingSystemVersion low, OperatingSystemVersion high) {
+            std::vector<uint32_t> expected;
+            for (uint32_t i = 0; i < versions.size(); ++i)
+            {
+                if (versions[i].IsValid() && versions[i] >= low && versions[i] < high)
+                {
+                    expected.push_back(i);
+                }
+            }
+            std::vector<uint32_t> found(matches.begin(), matches.end());
+            std::sort(found.begin(), found.end());
+            EXPECT_EQ(found, expected);
+        };
+        const auto threshold = OperatingSystemVersion::Make(10, 0, 19041, 1234);
+        const auto high = OperatingSystemVersion::Make(10, 0, 22621, 0);
+        const auto none = OperatingSystemVersion();
+        const auto all = OperatingSystemVersion{~uint64_t{0}};
+        expect(index->Below(threshold), none, threshold);
+        expect(index->AtLeast(threshold), threshold, all);
+        expect(index->Between(threshold, high), threshold, high);
+        EXPECT_TRUE(index->Between(high, threshold).Empty());
+
+        // Sorted by version, equal versions by snapshot.
+        auto snapshots = index->Snapshots();
+        ASSERT_EQ(snapshots.Size(), index->Size());
+        for (size_t i = 1; i < snapshots.Size(); ++i)
+        {
+            ASSERT_LE(index->GetVersion(i - 1), index->GetVersion(i));
+            if (index->GetVersion(i - 1) == index->GetVersion(i))
+            {
+                ASSERT_LT(snapshots.Begin[i - 1], snapshots.Begin[i]);
+            }
+            ASSERT_EQ(index->GetVersion(i), versions[snapshots.Begin[i]]);
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <OsRelease.h>
+
+#include <map>
+#include <string>
+
+#ifdef __linux__
+#include <LinuxOperatingSystemInfoFetcher.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#endif
+
+namespace
+{
+constexpr char UbuntuOsRelease[] = R"os-release(PRETTY_NAME="Ubuntu 22.04.4 LTS"
+NAME="Ubuntu"
+# comment line
+VERSION_ID="22.04"
+VERSION="22.04.4 LTS (Jammy Jellyfish)"
+VERSION_CODENAME=jammy
+ID=ubuntu
+
+  ID_LIKE = debian
+HOME_URL='https://www.ubuntu.com/'
+ESCAPED="say \"hi\" \\ \$HOME"
+malformed line
+=novalue
+)os-release";
+
+std::map<std::string, std::string> Parse(const char* content)
+{
+    std::map<std::string, std::string> entries;
+    ForEachOsReleaseEntry(content, [&entries](std::string_view key, const OsReleaseValue& value) {
+        entries.emplace(std::string(key), value.ToString());
+    });
+    return entries;
+}
+} // namespace
+
+TEST(OsRelease, ParsesQuotedAndUnquotedValues)
+{
+    auto entries = Parse(UbuntuOsRelease);
+    EXPECT_EQ(entries["PRETTY_NAME"], "Ubuntu 22.04.4 LTS");
+    EXPECT_EQ(entries["VERSION_CODENAME"], "jammy");
+    EXPECT_EQ(entries["HOME_URL"], "https://www.ubuntu.com/");
+    EXPECT_EQ(entries["ESCAPED"], "say \"hi\" \\ $HOME");
+    EXPECT_EQ(entries.count("malformed line"), 0u);
+    EXPECT_EQ(entries.size(), 9u);
+}
+
+TEST(OsRelease, HandlesMissingTrailingNewlineAndCrLf)
+{
+    auto entries = Parse("ID=fedora\r\nVERSION_ID=40");
+    EXPECT_EQ(entries["ID"], "fedora");
+    EXPECT_EQ(entries["VERSION_ID"], "40");
+}
+
+#ifdef __linux__
+TEST(LinuxOperatingSystemInfoFetcher, MapsOsReleaseAndLocale)
+{
+    auto path = std::filesystem::temp_directory_path() / "LinuxOperatingSystemInfoFetcherTest-os-release";
+    std::ofstream(path) << UbuntuOsRelease;
+    setenv("LC_ALL", "de_DE.UTF-8@euro", 1);
+
+    LinuxOperatingSystemInfoFetcher fetcher(path.string());
+    auto info = fetcher.GetInformation();
+    std::filesystem::remove(path);
+    unsetenv("LC_ALL");
+
+    EXPECT_EQ(info.Caption, "Ubuntu 22.04.4 LTS");
+    EXPECT_EQ(info.EditionID, "ubuntu");
+    EXPECT_EQ(info.BuildBranch, "jammy");
+    EXPECT_EQ(info.MarketName, "22.04.4 LTS (Jammy Jellyfish)");
+    EXPECT_EQ(info.CurrentVersion, "22.04");
+    EXPECT_EQ(info.CurrentMajorVersionNumber, "22");
+    EXPECT_EQ(info.CurrentMinorVersionNumber, "4");
+    EXPECT_EQ(info.MUILanguage, "de-DE");
+    EXPECT_EQ(info.Locale, "de-DE");
+    EXPECT_TRUE(info.Version);
+    EXPECT_TRUE(info.OSArchitecture);
+    EXPECT_FALSE(info.UBR);
+}
+#endif
@@ -0,0 +1,96 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <InMemoryReg.h>
+#include <RegistryBatch.h>
+
+#include <optional>
+#include <string>
+
+namespace
+{
+constexpr char CurrentVersionPath[] = "SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion";
+
+class CountingVisitor final : public IRegistryValueVisitor
+{
+public:
+    bool Visit(const RegistryValue&) override
+    {
+        ++Visited;
+        return true;
+    }
+
+    size_t Visited = 0;
+};
+} // namespace
+
+TEST(RegistryBatch, FillsAllBindingsInOnePass)
+{
+    InMemoryRegistry registry;
+    registry.SetStringValue(CurrentVersionPath, "EditionID", L"Professional");
+    registry.SetStringValue(CurrentVersionPath, "BuildBranch", L"rs5_release");
+    registry.SetIntValue(CurrentVersionPath, "UBR", 674);
+    registry.SetInt64Value(CurrentVersionPath, "InstallTime", 42);
+
+    InMemoryReg reg;
+    ASSERT_TRUE(reg.Open(registry, "software\\microsoft\\windows nt\\currentversion"));
+
+    std::optional<std::string> editionId;
+    std::string buildBranch;
+    std::optional<std::string> ubr;
+    uint32_t ubrNumber = 0;
+    uint64_t installTime = 0;
+    auto found = ReadValues(reg,
+                            Bind<RegistryValueType::String>("EditionID", editionId),
+                            Bind<RegistryValueType::String>("buildbranch", buildBranch),
+                            Bind<RegistryValueType::Dword>("UBR", ubr),
+                            Bind<RegistryValueType::Qword>("InstallTime", installTime));
+    EXPECT_EQ(found, 4u);
+    EXPECT_EQ(editionId, "Professional");
+    EXPECT_EQ(buildBranch, "rs5_release");
+    EXPECT_EQ(ubr, "674");
+    EXPECT_EQ(installTime, 42u);
+
+    EXPECT_EQ(ReadValues(reg, Bind<RegistryValueType::Dword>("UBR", ubrNumber)), 1u);
+    EXPECT_EQ(ubrNumber, 674u);
+}
+
+TEST(RegistryBatch, LeavesMissingAndMistypedBindingsUntouched)
+{
+    InMemoryRegistry registry;
+    registry.SetStringValue(CurrentVersionPath, "UBR", L"674");
+
+    InMemoryReg reg;
+    ASSERT_TRUE(reg.Open(registry, CurrentVersionPath));
+
+    std::optional<std::string> ubr;
+    std::optional<std::string> releaseId;
+    EXPECT_EQ(ReadValues(reg,
+                         Bind<RegistryValueType::Dword>("UBR", ubr),
+                         Bind<RegistryValueType::String>("ReleaseId", releaseId)),
+              0u);
+    EXPECT_FALSE(ubr);
+    EXPECT_FALSE(releaseId);
+}
+
+TEST(RegistryBatch, StopsScanningOnceEveryBindingIsFound)
+{
+    InMemoryRegistry registry;
+    registry.SetStringValue(CurrentVersionPath, "EditionID", L"Professional");
+    registry.SetStringValue(CurrentVersionPath, "ProductName", L"Windows 10 Pro");
+    registry.SetStringValue(CurrentVersionPath, "ReleaseId", L"1809");
+
+    InMemoryReg reg;
+    ASSERT_TRUE(reg.Open(registry, CurrentVersionPath));
+
+    CountingVisitor counter;
+    EXPECT_TRUE(reg.ForEachValue(counter));
+    EXPECT_EQ(counter.Visited, 3u);
+
+    std::string editionId;
+    EXPECT_EQ(ReadValues(reg, Bind<RegistryValueType::String>("EditionID", editionId)), 1u);
+
+    InMemoryReg missing;
+    EXPECT_FALSE(missing.Open(registry, "SOFTWARE\\Microsoft\\Windows"));
+    EXPECT_EQ(ReadValues(missing, Bind<RegistryValueType::String>("EditionID", editionId)), 0u);
+}
@@ -0,0 +1,166 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <InMemoryReg.h>
+#include <RegistryBatch.h>
+#include <RegistryValueDecoder.h>
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr char CurrentVersionPath[] = "SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion";
+
+// UTF-16LE data as stored in the registry, with the NULs written explicitly in text.
+std::vector<std::byte> ToData(const std::u16string& text)
+{
+    std::vector<std::byte> data;
+    for (auto c : text)
+    {
+        data.push_back(static_cast<std::byte>(c & 0xFF));
+        data.push_back(static_cast<std::byte>(c >> 8));
+    }
+    return data;
+}
+
+RegistryValue MakeValue(RegistryValueType type, const std::vector<std::byte>& data)
+{
+    return {{"Value", 5, false}, type, data.data(), data.size()};
+}
+
+std::vector<std::string> Entries(const std::vector<std::byte>& data)
+{
+    RegistryMultiStringView view;
+    EXPECT_TRUE(DecodeRegistryMultiString(MakeValue(RegistryValueType::MultiString, data), view));
+    return view.ToUtf8();
+}
+} // namespace
+
+TEST(RegistryValueDecoder, DecodesStringsWithAndWithoutTerminator)
+{
+    auto terminated = ToData(std::u16string(u"Professional\0junk", 17));
+    RegistryStringView text;
+    ASSERT_TRUE(DecodeRegistryString(MakeValue(RegistryValueType::String, terminated), text));
+    EXPECT_EQ(text.Length(), 12u);
+    EXPECT_TRUE(text == "Professional");
+    EXPECT_TRUE(text != "Professional ");
+
+    auto unterminated = ToData(u"caf\u00E9");
+    ASSERT_TRUE(DecodeRegistryString(MakeValue(RegistryValueType::ExpandString, unterminated), text));
+    EXPECT_EQ(text.ToUtf8(), u8"caf\u00E9");
+    EXPECT_EQ(text.ToWide(), L"caf\u00E9");
+    EXPECT_EQ(text[3], u'\u00E9');
+
+    // An odd trailing byte is not part of the text.
+    unterminated.push_back(std::byte{'x'});
+    ASSERT_TRUE(DecodeRegistryString(MakeValue(RegistryValueType::String, unterminated), text));
+    EXPECT_EQ(text.Length(), 4u);
+
+    EXPECT_FALSE(DecodeRegistryString(MakeValue(RegistryValueType::MultiString, terminated), text));
+    EXPECT_EQ(text.Length(), 4u);
+}
+
+TEST(RegistryValueDecoder, IteratesMultiStringEntries)
+{
+    EXPECT_EQ(Entries(ToData(std::u16string(u"en-US\0ja-JP\0\0", 14))), (std::vector<std::string>{"en-US", "ja-JP"}));
+    // Missing terminators, the last entry ends with the data.
+    EXPECT_EQ(Entries(ToData(std::u16string(u"en-US\0ja-JP", 11))), (std::vector<std::string>{"en-US", "ja-JP"}));
+    EXPECT_EQ(Entries(ToData(u"en-US")), (std::vector<std::string>{"en-US"}));
+    // The list ends at the first empty entry.
+    EXPECT_EQ(Entries(ToData(std::u16string(u"a\0\0b\0\0", 6))), (std::vector<std::string>{"a"}));
+    EXPECT_TRUE(Entries({}).empty());
+    EXPECT_TRUE(Entries(ToData(std::u16string(u"\0", 1))).empty());
+
+    auto data = ToData(std::u16string(u"one\0two\0\0", 9));
+    RegistryMultiStringView view;
+    ASSERT_TRUE(DecodeRegistryMultiString(MakeValue(RegistryValueType::MultiString, data), view));
+    EXPECT_FALSE(view.Empty());
+    auto it = view.begin();
+    EXPECT_TRUE(*it++ == "one");
+    EXPECT_EQ(it->Length(), 3u);
+    EXPECT_EQ(++it, view.end());
+}
+
+TEST(RegistryValueDecoder, DecodesNumbersOfTheExactSize)
+{
+    std::vector<std::byte> little{std::byte{0xA2}, std::byte{0x02}, std::byte{0}, std::byte{0}};
+    std::vector<std::byte> big{std::byte{0}, std::byte{0}, std::byte{0x02}, std::byte{0xA2}};
+    uint32_t dword = 0;
+    ASSERT_TRUE(DecodeRegistryDword(MakeValue(RegistryValueType::Dword, little), dword));
+    EXPECT_EQ(dword, 674u);
+    dword = 0;
+    ASSERT_TRUE(DecodeRegistryDword(MakeValue(RegistryValueType::DwordBigEndian, big), dword));
+    EXPECT_EQ(dword, 674u);
+
+    std::vector<std::byte> shortData(little.begin(), little.begin() + 2);
+    EXPECT_FALSE(DecodeRegistryDword(MakeValue(RegistryValueType::Dword, shortData), dword));
+    EXPECT_FALSE(DecodeRegistryDword(MakeValue(RegistryValueType::Binary, little), dword));
+
+    std::vector<std::byte> eight(8);
+    eight[0] = std::byte{42};
+    uint64_t qword = 0;
+    EXPECT_FALSE(DecodeRegistryQword(MakeValue(RegistryValueType::Qword, little), qword));
+    ASSERT_TRUE(DecodeRegistryQword(MakeValue(RegistryValueType::Qword, eight), qword));
+    EXPECT_EQ(qword, 42u);
+
+    const std::byte* data = nullptr;
+    size_t size = 0;
+    ASSERT_TRUE(DecodeRegistryBinary(MakeValue(RegistryValueType::Dword, little), data, size));
+    EXPECT_EQ(data, little.data());
+    EXPECT_EQ(size, 4u);
+}
+
+TEST(RegistryValueDecoder, ExpandsEnvironmentVariables)
+{
+    std::map<std::string, std::string> environment{{"SystemRoot", "C:\\Windows"}, {"Empty", ""}};
+    auto lookup = [&environment](std::string_view name, std::string& value) {
+        auto found = environment.find(std::string(name));
+        if (found == environment.end())
+        {
+            return false;
+        }
+        value = found->second;
+        return true;
+    };
+    auto expand = [&lookup](const std::u16string& text) {
+        auto data = ToData(text);
+        RegistryStringView view;
+        EXPECT_TRUE(DecodeRegistryString(MakeValue(RegistryValueType::ExpandString, data), view));
+        std::string result;
+        ExpandRegistryString(view, lookup, result);
+        return result;
+    };
+
+    EXPECT_EQ(expand(u"%SystemRoot%\\System32"), "C:\\Windows\\System32");
+    EXPECT_EQ(expand(u"[%Empty%]"), "[]");
+    // Unknown names and a lone % are kept, the closing % of an unknown name may open a variable.
+    EXPECT_EQ(expand(u"%Unknown%"), "%Unknown%");
+    EXPECT_EQ(expand(u"100% %SystemRoot%"), "100% C:\\Windows");
+    EXPECT_EQ(expand(u"50%"), "50%");
+    EXPECT_EQ(expand(u"%%"), "%%");
+}
+
+TEST(RegistryValueDecoder, BindsMultiStringValuesInABatch)
+{
+    InMemoryRegistry registry;
+    registry.SetValue(CurrentVersionPath, "Languages", RegistryValueType::MultiString,
+                      ToData(std::u16string(u"en-US\0\u65E5\u672C\u8A9E\0\0", 11)));
+    registry.SetValue(CurrentVersionPath, "PathName", RegistryValueType::ExpandString, ToData(u"%SystemRoot%"));
+
+    InMemoryReg reg;
+    ASSERT_TRUE(reg.Open(registry, CurrentVersionPath));
+    std::vector<std::string> languages;
+    std::vector<std::wstring> wideLanguages;
+    std::string pathName;
+    EXPECT_EQ(ReadValues(reg,
+                         Bind<RegistryValueType::MultiString>("Languages", languages),
+                         Bind<RegistryValueType::ExpandString>("PathName", pathName)),
+              2u);
+    EXPECT_EQ(ReadValues(reg, Bind<RegistryValueType::MultiString>("Languages", wideLanguages)), 1u);
+    EXPECT_EQ(languages, (std::vector<std::string>{"en-US", u8"\u65E5\u672C\u8A9E"}));
+    EXPECT_EQ(wideLanguages, (std::vector<std::wstring>{L"en-US", L"\u65E5\u672C\u8A9E"}));
+    EXPECT_EQ(pathName, "%SystemRoot%");
+}
@@ -0,0 +1,172 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <IOperatingSystemInfoFetcher.h>
+#include <SharedOperatingSystemInfo.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+using namespace std::chrono_literals;
+
+// Segments outlive the process on Linux when a test fails, so every test uses its own name.
+std::string MakeSegmentName(const char* test)
+{
+    return std::string("Test.") + test + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+OperatingSystemInfo MakeInfo(const std::string& ubr)
+{
+    OperatingSystemInfo info;
+    info.Caption = "Microsoft Windows 10 Pro";
+    info.EditionID = "Professional";
+    info.CurrentBuildNumber = "19045";
+    info.UBR = ubr;
+    return info;
+}
+
+class CountingFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit CountingFetcher(std::atomic<int>& calls) : m_Calls(calls)
+    {
+    }
+
+    OperatingSystemInfo GetInformation() override
+    {
+        ++m_Calls;
+        return MakeInfo("1");
+    }
+
+private:
+    std::atomic<int>& m_Calls;
+};
+} // namespace
+
+TEST(SharedOperatingSystemInfo, ReadsTheLastPublishedSnapshot)
+{
+    auto name = MakeSegmentName("Read");
+    SharedOperatingSystemInfoReader reader(name);
+    EXPECT_FALSE(reader.Open());
+
+    SharedOperatingSystemInfoPublisher publisher(name);
+    ASSERT_TRUE(publisher.Open());
+    ASSERT_TRUE(reader.Open());
+    OperatingSystemInfo info;
+    // Nothing published yet.
+    EXPECT_FALSE(reader.Read(info, 1h));
+
+    ASSERT_TRUE(publisher.Publish(MakeInfo("3803")));
+    ASSERT_TRUE(publisher.Publish(MakeInfo("4046")));
+    ASSERT_TRUE(reader.Read(info, 1h));
+    EXPECT_TRUE(info == MakeInfo("4046"));
+    OperatingSystemInfoRecordView record;
+    ASSERT_TRUE(reader.Read(record, 1h));
+    EXPECT_EQ(record.Get(OperatingSystemInfoField::UBR), "4046");
+    EXPECT_FALSE(record.Has(OperatingSystemInfoField::ReleaseId));
+
+    std::this_thread::sleep_for(2ms);
+    EXPECT_FALSE(reader.Read(info, 1ms));
+    publisher.Withdraw();
+    EXPECT_FALSE(reader.Read(info, 1h));
+
+    // Records which do not fit are refused, the segment keeps the previous one.
+    ASSERT_TRUE(publisher.Publish(MakeInfo("4046")));
+    auto large = MakeInfo("4046");
+    large.Caption = std::string(SharedOperatingSystemInfoFormat::Capacity, 'x');
+    EXPECT_FALSE(publisher.Publish(large));
+    ASSERT_TRUE(reader.Read(info, 1h));
+    EXPECT_EQ(info.Caption, "Microsoft Windows 10 Pro");
+}
+
+TEST(SharedOperatingSystemInfo, FetcherFallsBackWhenThereIsNoFreshSnapshot)
+{
+    auto name = MakeSegmentName("Fetcher");
+    std::atomic<int> calls{0};
+    SharedOperatingSystemInfoFetcher fetcher(name, 1h, std::make_unique<CountingFetcher>(calls));
+    EXPECT_EQ(fetcher.GetInformation().UBR, "1");
+    EXPECT_EQ(calls, 1);
+
+    {
+        SharedOperatingSystemInfoPublisher publisher(name);
+        ASSERT_TRUE(publisher.Open());
+        ASSERT_TRUE(publisher.Publish(MakeInfo("4046")));
+        auto info = fetcher.GetInformation({OperatingSystemInfoField::UBR});
+        EXPECT_EQ(info.UBR, "4046");
+        EXPECT_FALSE(info.Caption);
+        EXPECT_EQ(calls, 1);
+    }
+
+    // The publisher withdrew its snapshot when it went away.
+    EXPECT_EQ(fetcher.GetInformation().UBR, "1");
+    EXPECT_EQ(calls, 2);
+    auto statistics = fetcher.GetStatistics();
+    EXPECT_EQ(statistics.Hits, 1u);
+    EXPECT_EQ(statistics.Misses, 2u);
+}
+
+TEST(SharedOperatingSystemInfo, FetcherFollowsARestartedPublisher)
+{
+    auto name = MakeSegmentName("Restart");
+    std::atomic<int> calls{0};
+    SharedOperatingSystemInfoFetcher fetcher(name, 1h, std::make_unique<CountingFetcher>(calls));
+    {
+        SharedOperatingSystemInfoPublisher publisher(name);
+        ASSERT_TRUE(publisher.Open());
+        ASSERT_TRUE(publisher.Publish(MakeInfo("3803")));
+        EXPECT_EQ(fetcher.GetInformation().UBR, "3803");
+    }
+    EXPECT_EQ(fetcher.GetInformation().UBR, "1");
+
+    // On Linux the new publisher creates a new segment, the reader maps it on its next miss.
+    SharedOperatingSystemInfoPublisher publisher(name);
+    ASSERT_TRUE(publisher.Open());
+    ASSERT_TRUE(publisher.Publish(MakeInfo("4046")));
+    EXPECT_EQ(fetcher.GetInformation().UBR, "4046");
+    EXPECT_EQ(fetcher.GetInformation().UBR, "4046");
+    EXPECT_EQ(calls, 1);
+    auto statistics = fetcher.GetStatistics();
+    EXPECT_EQ(statistics.Hits, 3u);
+    EXPECT_EQ(statistics.Misses, 1u);
+}
+
+TEST(SharedOperatingSystemInfo, ReadersNeverSeeAPartialSnapshot)
+{
+    auto name = MakeSegmentName("Torn");
+    SharedOperatingSystemInfoPublisher publisher(name);
+    ASSERT_TRUE(publisher.Open());
+    auto first = MakeInfo("1");
+    auto second = MakeInfo("4046");
+    second.Caption = "Microsoft Windows 11 Enterprise";
+    second.ReleaseId = "22H2";
+    ASSERT_TRUE(publisher.Publish(first));
+
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (int i = 0; !done; ++i)
+        {
+            publisher.Publish(i % 2 ? first : second);
+        }
+    });
+
+    SharedOperatingSystemInfoReader reader(name);
+    ASSERT_TRUE(reader.Open());
+    int reads = 0;
+    for (int i = 0; i < 20000; ++i)
+    {
+        OperatingSystemInfo info;
+        if (reader.Read(info, 1h))
+        {
+            ++reads;
+            ASSERT_TRUE(info == first || info == second);
+        }
+    }
+    done = true;
+    writer.join();
+    EXPECT_GT(reads, 0);
+}
@@ -0,0 +1,52 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <ThreadPool.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(ThreadPool, RunsEveryTaskBeforeDestruction)
+{
+    std::atomic<int> done{0};
+    {
+        ThreadPool pool(4);
+        EXPECT_EQ(pool.Size(), 4u);
+        for (int i = 0; i < 1000; ++i)
+        {
+            pool.Submit([&done] { ++done; });
+        }
+    }
+    EXPECT_EQ(done, 1000);
+}
+
+TEST(ThreadPool, RunsNestedTasksAndReturnsResults)
+{
+    ThreadPool pool(3);
+    std::atomic<int> leaves{0};
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 16; ++i)
+    {
+        results.push_back(pool.Run([&pool, &leaves, i] {
+            for (int j = 0; j < 8; ++j)
+            {
+                pool.Submit([&leaves] { ++leaves; });
+            }
+            return i * i;
+        }));
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        EXPECT_EQ(results[i].get(), i * i);
+    }
+
+    auto failure = pool.Run([]() -> int { throw std::runtime_error("failed"); });
+    EXPECT_THROW(failure.get(), std::runtime_error);
+
+    pool.Run([] {}).get();
+    while (leaves != 16 * 8)
+    {
+        std::this_thread::yield();
+    }
+}
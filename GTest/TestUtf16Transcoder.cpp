@@ -0,0 +1,166 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <Utf16Transcoder.h>
+
+#include <cstring>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr SimdLevel Levels[] = {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2};
+
+// Straightforward encoder the vectorized paths are checked against.
+std::string Reference(const std::u16string& utf16)
+{
+    std::string result;
+    auto append = [&result](uint32_t c) {
+        if (c < 0x80)
+        {
+            result += static_cast<char>(c);
+        }
+        else if (c < 0x800)
+        {
+            result += static_cast<char>(0xC0 | (c >> 6));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000)
+        {
+            result += static_cast<char>(0xE0 | (c >> 12));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            result += static_cast<char>(0xF0 | (c >> 18));
+            result += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    };
+    for (size_t i = 0; i < utf16.size(); ++i)
+    {
+        uint32_t c = utf16[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < utf16.size() && utf16[i + 1] >= 0xDC00 && utf16[i + 1] <= 0xDFFF)
+        {
+            append(0x10000 + ((c - 0xD800) << 10) + (utf16[++i] - 0xDC00));
+        }
+        else
+        {
+            append(c >= 0xD800 && c <= 0xDFFF ? 0xFFFD : c);
+        }
+    }
+    return result;
+}
+
+std::string Convert(const std::u16string& utf16, SimdLevel level)
+{
+    std::string result(GetUtf8BufferSize(utf16.size()), '\0');
+    result.resize(ConvertUtf16ToUtf8(utf16.data(), utf16.size(), &result[0], level));
+    return result;
+}
+} // namespace
+
+TEST(Utf16Transcoder, ConvertsAsciiWithoutTerminator)
+{
+    std::u16string caption = u"Microsoft Windows 10 Pro";
+    for (auto level : Levels)
+    {
+        auto utf8 = Convert(caption, level);
+        EXPECT_EQ(utf8, "Microsoft Windows 10 Pro");
+        EXPECT_EQ(utf8.size(), caption.size());
+    }
+    EXPECT_EQ(Convert(u"", SimdLevel::Avx2), "");
+}
+
+TEST(Utf16Transcoder, ConvertsEveryPlaneAndReplacesUnpairedSurrogates)
+{
+    std::u16string text = u"Windows 10 Pro \u65E5\u672C\u8A9E\u7248 caf\u00E9 \U0001F600";
+    EXPECT_EQ(Convert(text, SimdLevel::Scalar), u8"Windows 10 Pro \u65E5\u672C\u8A9E\u7248 caf\u00E9 \U0001F600");
+
+    // High surrogate alone, at the end, low surrogate alone, and a pair across the 16 and 32 unit blocks.
+    std::u16string broken = u"abc\xD800z\xDC00";
+    broken += std::u16string(9, u'x') + u"\xD83D\xDE00" + std::u16string(14, u'y') + u"\xD83D\xDE00\xD800";
+    for (auto level : Levels)
+    {
+        EXPECT_EQ(Convert(text, level), Reference(text));
+        EXPECT_EQ(Convert(broken, level), Reference(broken));
+    }
+    EXPECT_EQ(Convert(u"\xD800", SimdLevel::Avx2), "\xEF\xBF\xBD");
+}
+
+TEST(Utf16Transcoder, MatchesReferenceOnRandomInput)
+{
+    std::mt19937 random(1234);
+    // Mostly ASCII with runs of BMP characters and some surrogates, to go through every block kind.
+    std::uniform_int_distribution<int> kind(0, 99);
+    std::uniform_int_distribution<int> length(0, 200);
+    for (int round = 0; round < 500; ++round)
+    {
+        std::u16string text;
+        for (int n = length(random); n > 0; --n)
+        {
+            auto k = kind(random);
+            auto c = k < 70 ? random() % 0x80 : k < 85 ? 0x80 + random() % 0xD780 : k < 95 ? 0xD800 + random() % 0x800 : 0xE000 + random() % 0x2000;
+            text += static_cast<char16_t>(c);
+        }
+        auto expected = Reference(text);
+        for (auto level : Levels)
+        {
+            ASSERT_EQ(Convert(text, level), expected) << "round " << round << " level " << static_cast<int>(level);
+        }
+    }
+}
+
+TEST(Utf16Transcoder, ReadsUnalignedInput)
+{
+    std::u16string text = u"Professional \u00E9dition Windows 10 Enterprise LTSC 2019";
+    std::vector<char> bytes(text.size() * 2 + 1);
+    std::memcpy(bytes.data() + 1, text.data(), text.size() * 2);
+    std::string utf8(GetUtf8BufferSize(text.size()), '\0');
+    utf8.resize(ConvertUtf16ToUtf8(bytes.data() + 1, text.size(), &utf8[0]));
+    EXPECT_EQ(utf8, Reference(text));
+}
+
+TEST(Utf16Transcoder, ConvertsManyStringsInOneCall)
+{
+    std::u16string values[] = {u"Professional", u"", u"vb_release", u"\u65E5\u672C\u8A9E", u"19045"};
+    std::vector<Utf16String> strings;
+    size_t count = 0;
+    for (const auto& value : values)
+    {
+        strings.push_back({value.data(), value.size()});
+        count += value.size();
+    }
+    std::string output(GetUtf8BufferSize(count), '\0');
+    std::vector<size_t> ends(strings.size());
+    auto size = ConvertUtf16ToUtf8(strings.data(), strings.size(), &output[0], ends.data());
+    output.resize(size);
+    EXPECT_EQ(output, u8"Professionalvb_release\u65E5\u672C\u8A9E19045");
+    EXPECT_EQ(ends, (std::vector<size_t>{12, 12, 22, 31, 36}));
+}
+
+TEST(Utf16Transcoder, ValidatesSurrogatePairs)
+{
+    std::u16string ascii(40, u'a');
+    EXPECT_TRUE(IsValidUtf16(ascii.data(), ascii.size()));
+    EXPECT_TRUE(IsValidUtf16(u"", 0));
+
+    // A pair across the 8 unit blocks is valid, a lone half anywhere is not.
+    auto pair = ascii.substr(0, 7) + u"\xD83D\xDE00" + ascii;
+    EXPECT_TRUE(IsValidUtf16(pair.data(), pair.size()));
+    for (auto lone : {u"\xD83D", u"\xDE00"})
+    {
+        for (size_t position : {0, 7, 8, 20, 40})
+        {
+            auto text = ascii;
+            text.insert(position, lone);
+            EXPECT_FALSE(IsValidUtf16(text.data(), text.size())) << position;
+        }
+    }
+    auto swapped = ascii + u"\xDE00\xD83D";
+    EXPECT_FALSE(IsValidUtf16(swapped.data(), swapped.size()));
+}
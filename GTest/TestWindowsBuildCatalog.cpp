@@ -0,0 +1,59 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <WindowsBuildCatalog.h>
+
+TEST(WindowsBuildCatalog, FindsReleaseByBuild)
+{
+    auto release = FindWindowsRelease(17763);
+    ASSERT_NE(release, nullptr);
+    EXPECT_EQ(release->Version, "1809");
+    EXPECT_EQ(release->Codename, "RS5 (RedStone 5)");
+    EXPECT_EQ(release->MarketName, "October 2018 Update");
+
+    release = FindWindowsRelease(22631);
+    ASSERT_NE(release, nullptr);
+    EXPECT_EQ(release->Version, "23H2");
+
+    EXPECT_EQ(FindWindowsRelease(0), nullptr);
+    EXPECT_EQ(FindWindowsRelease(17764), nullptr);
+    EXPECT_EQ(FindWindowsRelease(99999), nullptr);
+}
+
+TEST(WindowsBuildCatalog, FindsUpdateByBuildAndUbr)
+{
+    auto update = FindWindowsUpdate(19045, 2965);
+    ASSERT_NE(update, nullptr);
+    EXPECT_EQ(update->KB, 5026361u);
+    EXPECT_EQ(update->Year, 2023);
+    EXPECT_EQ(update->Month, 5);
+    EXPECT_EQ(update->Day, 9);
+
+    EXPECT_EQ(FindWindowsUpdate(19045, 2966), nullptr);
+    EXPECT_EQ(FindWindowsUpdate(19046, 2965), nullptr);
+
+    // UBRs missing from the catalog resolve to the newest update below them, within the same build.
+    update = FindLatestWindowsUpdate(19045, 3000);
+    ASSERT_NE(update, nullptr);
+    EXPECT_EQ(update->KB, 5026361u);
+    EXPECT_EQ(FindLatestWindowsUpdate(19045, 3570)->KB, 5031356u);
+    EXPECT_EQ(FindLatestWindowsUpdate(19045, 99999)->KB, 5036892u);
+    EXPECT_EQ(FindLatestWindowsUpdate(19045, 2964), nullptr);
+    EXPECT_EQ(FindLatestWindowsUpdate(19046, 5000), nullptr);
+    EXPECT_EQ(FindLatestWindowsUpdate(0, 0), nullptr);
+}
+
+TEST(WindowsBuildCatalog, FindsBaseReleaseByBranch)
+{
+    auto release = FindWindowsReleaseByBranch("rs5_release");
+    ASSERT_NE(release, nullptr);
+    EXPECT_EQ(release->Build, 17763u);
+
+    // 19042..19045 are enablement packages on top of 19041.
+    release = FindWindowsReleaseByBranch("vb_release");
+    ASSERT_NE(release, nullptr);
+    EXPECT_EQ(release->Build, 19041u);
+
+    EXPECT_EQ(FindWindowsReleaseByBranch("rs5_releasf"), nullptr);
+    EXPECT_EQ(FindWindowsReleaseByBranch(""), nullptr);
+}
@@ -0,0 +1,93 @@
+// Serves the snapshot of this host to local processes, see OperatingSystemInfoSocket.h for the protocol.
+//   OperatingSystemInfoDaemon [--socket PATH] [--ttl-ms N] [--fetch-threads N]
+// Runs until SIGINT or SIGTERM, then prints its statistics.
+
+#include <LinuxOperatingSystemInfoFetcher.h>
+#include <OperatingSystemInfoProvider.h>
+#include <OperatingSystemInfoSocket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <signal.h>
+#include <string>
+#include <sys/resource.h>
+
+namespace
+{
+// Each client holds a descriptor for as long as it is connected.
+void RaiseDescriptorLimit()
+{
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string path = "/tmp/OperatingSystemInfo.sock";
+    auto timeToLive = std::chrono::milliseconds(1000);
+    OperatingSystemInfoServerOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--socket") == 0)
+        {
+            path = argv[++i];
+        }
+        else if (hasValue && std::strcmp(argv[i], "--ttl-ms") == 0)
+        {
+            timeToLive = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (hasValue && std::strcmp(argv[i], "--fetch-threads") == 0)
+        {
+            options.FetchThreads = (std::max)(std::strtoul(argv[++i], nullptr, 10), 1ul);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--socket PATH] [--ttl-ms N] [--fetch-threads N]" << std::endl;
+            return 2;
+        }
+    }
+    options.TimeToLive = timeToLive;
+
+    // Blocked before any thread starts so that every thread inherits the mask and sigwait gets them.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    RaiseDescriptorLimit();
+
+    OperatingSystemInfoProvider provider(std::make_unique<LinuxOperatingSystemInfoFetcher>(), timeToLive);
+    OperatingSystemInfoServer server(provider, options);
+    if (!server.Start(path))
+    {
+        std::cerr << "Cannot listen on " << path << std::endl;
+        return 1;
+    }
+    std::cout << "Listening on " << path << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.Stop();
+
+    const auto statistics = server.GetStatistics();
+    std::cout << "Connections " << statistics.Connections << "\n"
+              << "Requests    " << statistics.Requests << "\n"
+              << "CacheHits   " << statistics.CacheHits << "\n"
+              << "Coalesced   " << statistics.Coalesced << "\n"
+              << "Fetches     " << statistics.Fetches << "\n"
+              << "Batches     " << statistics.Batches << "\n"
+              << "BadRequests " << statistics.BadRequests << "\n"
+              << "Refused     " << statistics.Refused << std::endl;
+    return 0;
+}
@@ -0,0 +1,172 @@
+// Load generator for OperatingSystemInfoDaemon: many connections from one thread, each keeping requests in flight.
+//   OperatingSystemInfoLoad [--socket PATH] [--clients N] [--seconds N] [--pipeline N] [--masks N]
+// Clients cycle through --masks distinct field masks, so that concurrent requests can be coalesced by the server.
+// Prints the throughput and the latency percentiles of the requests, measured from Send to TryReceive.
+
+#include <LatencyHistogram.h>
+#include <OperatingSystemInfoField.h>
+#include <OperatingSystemInfoSocket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+void RaiseDescriptorLimit()
+{
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+struct LoadClient
+{
+    OperatingSystemInfoClient Client;
+    OperatingSystemInfoFieldMask Fields;
+    uint32_t NextId = 0;
+    // Send time of the requests in flight, by Id modulo the pipeline depth.
+    std::vector<Clock::time_point> Sent;
+};
+
+bool Send(LoadClient& client)
+{
+    const auto id = client.NextId++;
+    client.Sent[id % client.Sent.size()] = Clock::now();
+    return client.Client.Send(id, client.Fields);
+}
+
+double ToMicroseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string path = "/tmp/OperatingSystemInfo.sock";
+    unsigned long clientCount = 1000;
+    unsigned long seconds = 5;
+    unsigned long pipeline = 1;
+    unsigned long maskCount = 4;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--socket") == 0)
+        {
+            path = argv[++i];
+        }
+        else if (hasValue && std::strcmp(argv[i], "--clients") == 0)
+        {
+            clientCount = (std::max)(std::strtoul(argv[++i], nullptr, 10), 1ul);
+        }
+        else if (hasValue && std::strcmp(argv[i], "--seconds") == 0)
+        {
+            seconds = (std::max)(std::strtoul(argv[++i], nullptr, 10), 1ul);
+        }
+        else if (hasValue && std::strcmp(argv[i], "--pipeline") == 0)
+        {
+            pipeline = (std::max)(std::strtoul(argv[++i], nullptr, 10), 1ul);
+        }
+        else if (hasValue && std::strcmp(argv[i], "--masks") == 0)
+        {
+            maskCount = (std::min)((std::max)(std::strtoul(argv[++i], nullptr, 10), 1ul),
+                                   static_cast<unsigned long>(OperatingSystemInfoFieldCount));
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--socket PATH] [--clients N] [--seconds N] [--pipeline N] [--masks N]" << std::endl;
+            return 2;
+        }
+    }
+    RaiseDescriptorLimit();
+
+    const int epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll == -1)
+    {
+        std::cerr << "epoll_create1 failed" << std::endl;
+        return 1;
+    }
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    clients.reserve(clientCount);
+    for (unsigned long i = 0; i < clientCount; ++i)
+    {
+        auto client = std::make_unique<LoadClient>();
+        // Mask i drops the first i fields, every mask is distinct and none is empty.
+        client->Fields = OperatingSystemInfoFieldMask::FromBits(OperatingSystemInfoFieldMask::All().Bits() << (i % maskCount));
+        client->Sent.resize(pipeline);
+        if (!client->Client.Connect(path))
+        {
+            std::cerr << "Cannot connect client " << i << " to " << path << std::endl;
+            return 1;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, client->Client.Socket(), &event);
+        clients.push_back(std::move(client));
+    }
+
+    LatencyHistogram latencies;
+    uint64_t failures = 0;
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::seconds(seconds);
+    for (auto& client : clients)
+    {
+        for (unsigned long i = 0; i < pipeline; ++i)
+        {
+            Send(*client);
+        }
+    }
+
+    std::vector<epoll_event> events(1024);
+    while (Clock::now() < deadline)
+    {
+        const int count = epoll_wait(epoll, events.data(), static_cast<int>(events.size()), 100);
+        for (int i = 0; i < count; ++i)
+        {
+            auto& client = *clients[events[i].data.u64];
+            uint32_t id = 0;
+            OperatingSystemInfoRecordView record;
+            while (client.Client.TryReceive(id, record))
+            {
+                latencies.Record(Clock::now() - client.Sent[id % client.Sent.size()]);
+                Send(client);
+            }
+            if (!client.Client.IsConnected())
+            {
+                // Closing the descriptor removed it from the epoll set.
+                ++failures;
+            }
+        }
+    }
+    const auto elapsed = Clock::now() - start;
+
+    const auto snapshot = latencies.Snapshot();
+    const double rate = static_cast<double>(snapshot.Count) / std::chrono::duration<double>(elapsed).count();
+    std::cout << "Clients      " << clientCount << "\n"
+              << "Requests     " << snapshot.Count << "\n"
+              << "Requests/s   " << static_cast<uint64_t>(rate) << "\n"
+              << "Mean us      " << ToMicroseconds(snapshot.Mean()) << "\n"
+              << "p50 us       " << ToMicroseconds(snapshot.Percentile(0.5)) << "\n"
+              << "p99 us       " << ToMicroseconds(snapshot.Percentile(0.99)) << "\n"
+              << "Max us       " << ToMicroseconds(snapshot.Max) << "\n"
+              << "Failures     " << failures << std::endl;
+    clients.clear();
+    close(epoll);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+#include <array>
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Dictionary of distinct strings. Each string is stored once and referred to by a dense id.
+// Not thread safe, ids are only meaningful together with the pool which produced them.
+class OperatingSystemInfoStringPool final
+{
+public:
+    OperatingSystemInfoStringPool() = default;
+    ~OperatingSystemInfoStringPool() = default;
+    OperatingSystemInfoStringPool(const OperatingSystemInfoStringPool&) = delete;
+    OperatingSystemInfoStringPool(OperatingSystemInfoStringPool&&) = delete;
+    OperatingSystemInfoStringPool& operator=(const OperatingSystemInfoStringPool&) = delete;
+    OperatingSystemInfoStringPool& operator=(OperatingSystemInfoStringPool&&) = delete;
+
+    // Returns the id of value, adding it when it is not in the pool yet.
+    uint32_t Intern(std::string_view value);
+    // Looks value up without adding it.
+    bool Find(std::string_view value, uint32_t& id) const;
+
+    std::string_view Get(uint32_t id) const
+    {
+        return m_Strings[id];
+    }
+
+    size_t Size() const noexcept
+    {
+        return m_Strings.size();
+    }
+
+private:
+    // std::deque never moves its elements, so the views used as keys stay valid.
+    std::deque<std::string> m_Strings;
+    std::unordered_map<std::string_view, uint32_t> m_Ids;
+};
+
+// Borrowed field values, ex. pointing into a parse buffer. Values of fields not in Present are ignored.
+struct OperatingSystemInfoView
+{
+    OperatingSystemInfoFieldMask Present;
+    std::array<std::string_view, OperatingSystemInfoFieldCount> Values;
+
+    // Borrows the values of info, which must outlive the view.
+    static OperatingSystemInfoView Of(const OperatingSystemInfo& info) noexcept
+    {
+        OperatingSystemInfoView view{};
+        ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+            if (const auto& value = field.Get(info))
+            {
+                view.Present.Set(field.Field);
+                view.Values[static_cast<size_t>(field.Field)] = *value;
+            }
+        });
+        return view;
+    }
+};
+
+// OperatingSystemInfo in 92 bytes instead of 21 std::optional<std::string>.
+// Every field is one 32-bit slot: a string id in the pool, or the value itself for numeric fields
+// holding a canonical decimal number (no sign, no leading zero, fits in 32 bits). Anything else,
+// ex. "N/A" or "0409", is interned like the other strings so the conversion is lossless.
+struct CompactOperatingSystemInfo
+{
+    // Fields whose value is inlined when it is a canonical decimal number.
+    static constexpr OperatingSystemInfoFieldMask NumericFields = GetTypeFields(OperatingSystemInfoFieldType::Number);
+
+    static CompactOperatingSystemInfo Pack(const OperatingSystemInfo& info, OperatingSystemInfoStringPool& strings);
+    static CompactOperatingSystemInfo Pack(const OperatingSystemInfoView& info, OperatingSystemInfoStringPool& strings);
+    OperatingSystemInfo Unpack(const OperatingSystemInfoStringPool& strings) const;
+    // Slot which Pack would give value in field, without interning it. Fails when value is not in the pool.
+    static bool FindSlot(OperatingSystemInfoField field, std::string_view value, const OperatingSystemInfoStringPool& strings,
+                         uint32_t& slot, bool& inlined);
+
+    // Only valid with records packed by the same pool, equal records then have equal words.
+    uint64_t Hash() const noexcept;
+
+    friend bool operator==(const CompactOperatingSystemInfo& lhs, const CompactOperatingSystemInfo& rhs) noexcept
+    {
+        return lhs.Present == rhs.Present && lhs.Inlined == rhs.Inlined && lhs.Slots == rhs.Slots;
+    }
+
+    friend bool operator!=(const CompactOperatingSystemInfo& lhs, const CompactOperatingSystemInfo& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    // Fields which have a value. The slots of absent fields are zero.
+    OperatingSystemInfoFieldMask Present;
+    // Fields whose slot holds the number itself rather than a string id.
+    OperatingSystemInfoFieldMask Inlined;
+    std::array<uint32_t, OperatingSystemInfoFieldCount> Slots{};
+};
+
+// Deduplicating store of snapshots for large inventories. Hosts reporting the same
+// information share one CompactOperatingSystemInfo, so each of them costs only its record id.
+class OperatingSystemInfoInventory final
+{
+public:
+    OperatingSystemInfoInventory() = default;
+    ~OperatingSystemInfoInventory() = default;
+    OperatingSystemInfoInventory(const OperatingSystemInfoInventory&) = delete;
+    OperatingSystemInfoInventory(OperatingSystemInfoInventory&&) = delete;
+    OperatingSystemInfoInventory& operator=(const OperatingSystemInfoInventory&) = delete;
+    OperatingSystemInfoInventory& operator=(OperatingSystemInfoInventory&&) = delete;
+
+    // Returns the id of the record equal to info, adding it when it is new.
+    uint32_t Add(const OperatingSystemInfo& info);
+    uint32_t Add(const OperatingSystemInfoView& info);
+    // Adds a record packed with another pool, ex. when merging inventories.
+    uint32_t Add(const CompactOperatingSystemInfo& record, const OperatingSystemInfoStringPool& strings);
+
+    OperatingSystemInfo Get(uint32_t id) const
+    {
+        return m_Records[id].Unpack(m_Strings);
+    }
+
+    const CompactOperatingSystemInfo& GetCompact(uint32_t id) const
+    {
+        return m_Records[id];
+    }
+
+    // Number of distinct records.
+    size_t Size() const noexcept
+    {
+        return m_Records.size();
+    }
+
+    const OperatingSystemInfoStringPool& Strings() const noexcept
+    {
+        return m_Strings;
+    }
+
+private:
+    uint32_t AddPacked(const CompactOperatingSystemInfo& record);
+
+    OperatingSystemInfoStringPool m_Strings;
+    std::vector<CompactOperatingSystemInfo> m_Records;
+    // Record hash to the ids of the records with that hash.
+    std::unordered_multimap<uint64_t, uint32_t> m_Index;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "IOperatingSystemInfoFetcher.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+struct CompositeOperatingSystemInfoStatistics
+{
+    uint64_t Calls = 0;
+    // Source fetches run on the pool.
+    uint64_t Started = 0;
+    // Calls which found their source busy with the fetch of another call and were served by its next fetch.
+    uint64_t Queued = 0;
+    // Source fetches not started because the call already had every field.
+    uint64_t Skipped = 0;
+    // Source fetches given up on because of their budget or the deadline of the call.
+    uint64_t TimedOut = 0;
+    // Source fetches which ended after their call returned. Their values of the fields the call timed out on
+    // go to the late callback of the call, the rest is dropped.
+    uint64_t Late = 0;
+    // Source fetches which threw, they count as having no field.
+    uint64_t Failed = 0;
+};
+
+// Runs several fetchers concurrently on a thread pool and merges their results field by field.
+// A field takes the value of the source with the highest priority for it which returned a non-empty value,
+// ties go to the source added first. The call returns as soon as no running source could still
+// replace a field, so its duration is the one of the slowest source it needs. Sources which are not
+// needed anymore are not started, the ones already running are left to finish and their result is dropped.
+//
+// The same fetcher may back several sources with disjoint fields, ex. an OperatingSystemInfoFetcher
+// for the WMI fields and another for the registry fields runs WMI and the registry side by side.
+// A source is never called by two threads at once. A call finding its source busy, ex. with a late fetch,
+// is queued rather than waiting on a worker: the worker of the running fetch serves the queued calls with one
+// more fetch once it is done. A stuck source thus holds one worker, the other sources keep theirs.
+//
+// A call waits for a source at most the budget of the source, and for none of them past its deadline.
+// Sources get that time as the deadline of their own GetInformation. Requested fields left without a value
+// by the sources the call gave up on, or which a source reported timed out on, are reported as timed out.
+//
+// Sources are set up before the first GetInformation. The pool must outlive the fetcher, whose destructor
+// waits for the late fetches. GetInformation must not be called from one of the pool's workers.
+class CompositeOperatingSystemInfoFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit CompositeOperatingSystemInfoFetcher(ThreadPool& pool) noexcept;
+    ~CompositeOperatingSystemInfoFetcher() override;
+    CompositeOperatingSystemInfoFetcher(CompositeOperatingSystemInfoFetcher&&) = delete;
+    CompositeOperatingSystemInfoFetcher(const CompositeOperatingSystemInfoFetcher&) = delete;
+    CompositeOperatingSystemInfoFetcher& operator=(const CompositeOperatingSystemInfoFetcher&) = delete;
+    CompositeOperatingSystemInfoFetcher& operator=(CompositeOperatingSystemInfoFetcher&&) = delete;
+
+    // Only the given fields are asked from the fetcher and taken from its result, all with the same priority.
+    // Returns the index of the source for SetPriority.
+    size_t AddSource(std::shared_ptr<IOperatingSystemInfoFetcher> fetcher, int priority,
+                     OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All());
+    void SetPriority(size_t source, OperatingSystemInfoField field, int priority);
+    // Longest time a call waits for the source, from the start of the call. Unlimited by default.
+    void SetBudget(size_t source, std::chrono::steady_clock::duration budget);
+
+    OperatingSystemInfo GetInformation() override;
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields) override;
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields, std::chrono::steady_clock::time_point deadline,
+                                       OperatingSystemInfoFieldMask& timedOut, LateFieldsCallback onLate) override;
+
+    CompositeOperatingSystemInfoStatistics GetStatistics() const noexcept;
+
+private:
+    struct Call;
+    struct Source
+    {
+        std::shared_ptr<IOperatingSystemInfoFetcher> Fetcher;
+        OperatingSystemInfoFieldMask Fields;
+        std::array<int, OperatingSystemInfoFieldCount> Priorities;
+        std::chrono::steady_clock::duration Budget = std::chrono::steady_clock::duration::max();
+        // Guards Busy and Queued.
+        std::mutex Mutex;
+        // Set while a worker fetches the source.
+        bool Busy = false;
+        std::vector<std::pair<std::shared_ptr<Call>, OperatingSystemInfoFieldMask>> Queued;
+    };
+
+    void Run(const std::shared_ptr<Call>& call, size_t index, OperatingSystemInfoFieldMask fields);
+    void Fetch(size_t index, std::vector<std::pair<std::shared_ptr<Call>, OperatingSystemInfoFieldMask>>& calls);
+    void Complete(Call& call, size_t index, const OperatingSystemInfo* info, OperatingSystemInfoFieldMask timedOut);
+    void CompleteLate(Call& call, size_t index, const OperatingSystemInfo* info);
+    void GiveUp(Call& call, size_t index);
+    void Resolve(Call& call);
+    bool IsBetter(size_t source, size_t other, size_t field) const noexcept;
+
+    ThreadPool& m_Pool;
+    std::vector<std::unique_ptr<Source>> m_Sources;
+
+    std::atomic<uint64_t> m_Calls{0};
+    std::atomic<uint64_t> m_Started{0};
+    std::atomic<uint64_t> m_Queued{0};
+    std::atomic<uint64_t> m_Skipped{0};
+    std::atomic<uint64_t> m_TimedOut{0};
+    std::atomic<uint64_t> m_Late{0};
+    std::atomic<uint64_t> m_Failed{0};
+
+    // Fetches submitted to the pool and not finished yet.
+    std::mutex m_RunningMutex;
+    std::condition_variable m_Idle;
+    size_t m_Running = 0;
+};
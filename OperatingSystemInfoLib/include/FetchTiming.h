@@ -0,0 +1,104 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+
+#include <array>
+#include <chrono>
+#include <stdint.h>
+#include <string_view>
+
+// Set to 0 to compile the fetch timing out, FetchTimingSpan is then an empty object and
+// GetFetchTimingStatistics reports nothing. The CMake option OPERATINGSYSTEMINFO_ENABLE_TIMING sets it.
+#ifndef OPERATINGSYSTEMINFO_TIMING
+#define OPERATINGSYSTEMINFO_TIMING 1
+#endif
+
+// Timed stages of OperatingSystemInfoFetcher::GetInformation.
+enum class FetchStage : uint32_t
+{
+    // The whole call, also recorded by LinuxOperatingSystemInfoFetcher.
+    GetInformation,
+    // CoInitializeEx and CoInitializeSecurity in ComCtx.
+    ComInitialize,
+    // Locator creation, IWbemLocator::ConnectServer and CoSetProxyBlanket.
+    ConnectServer,
+    ExecQuery,
+    // One IEnumWbemClassObject::Next call.
+    NextObject,
+    RegistryOpen,
+    // One WindowsReg read, or a whole enumeration of the values of a key.
+    RegistryRead,
+    Count
+};
+
+constexpr size_t FetchStageCount = static_cast<size_t>(FetchStage::Count);
+
+constexpr std::array<std::string_view, FetchStageCount> s_FetchStageNames{{
+    "GetInformation",
+    "ComInitialize",
+    "ConnectServer",
+    "ExecQuery",
+    "NextObject",
+    "RegistryOpen",
+    "RegistryRead",
+}};
+
+constexpr std::string_view GetFetchStageName(FetchStage stage)
+{
+    return s_FetchStageNames[static_cast<size_t>(stage)];
+}
+
+struct FetchTimingStatistics
+{
+    // False when the timing is compiled out.
+    bool Enabled = false;
+    std::array<LatencyHistogramSnapshot, FetchStageCount> Stages;
+
+    const LatencyHistogramSnapshot& operator[](FetchStage stage) const noexcept
+    {
+        return Stages[static_cast<size_t>(stage)];
+    }
+};
+
+// Latencies of every stage since the start of the process or the last reset, over all threads.
+FetchTimingStatistics GetFetchTimingStatistics() noexcept;
+void ResetFetchTiming() noexcept;
+
+#if OPERATINGSYSTEMINFO_TIMING
+namespace detail
+{
+extern std::array<LatencyHistogram, FetchStageCount> s_FetchStageHistograms;
+} // namespace detail
+#endif
+
+// Records the time from its construction to its destruction as one sample of stage.
+class FetchTimingSpan final
+{
+public:
+#if OPERATINGSYSTEMINFO_TIMING
+    explicit FetchTimingSpan(FetchStage stage) noexcept : m_Stage(stage), m_Start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~FetchTimingSpan()
+    {
+        detail::s_FetchStageHistograms[static_cast<size_t>(m_Stage)].Record(std::chrono::steady_clock::now() - m_Start);
+    }
+#else
+    explicit FetchTimingSpan(FetchStage) noexcept
+    {
+    }
+
+    ~FetchTimingSpan() = default;
+#endif
+    FetchTimingSpan(const FetchTimingSpan&) = delete;
+    FetchTimingSpan(FetchTimingSpan&&) = delete;
+    FetchTimingSpan& operator=(const FetchTimingSpan&) = delete;
+    FetchTimingSpan& operator=(FetchTimingSpan&&) = delete;
+
+#if OPERATINGSYSTEMINFO_TIMING
+private:
+    FetchStage m_Stage;
+    std::chrono::steady_clock::time_point m_Start;
+#endif
+};
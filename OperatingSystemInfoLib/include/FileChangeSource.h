@@ -0,0 +1,48 @@
+#pragma once
+
+#include "IChangeSource.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reports changes of a set of files: os-release(5) on Linux, an offline SOFTWARE hive on Windows.
+// The directories holding the files are watched rather than the files themselves, so files replaced by
+// a rename, as package managers do, and files created after Start are reported as well.
+// Symbolic links are followed once, ex. /etc/os-release -> ../usr/lib/os-release watches both directories.
+//
+// Linux uses inotify. Windows uses a directory change notification, and only reports a file
+// when its last write time or size differs from the one seen before.
+class FileChangeSource final : public IChangeSource
+{
+public:
+    explicit FileChangeSource(std::vector<std::string> paths) noexcept;
+    ~FileChangeSource() override;
+    FileChangeSource(FileChangeSource&&) = delete;
+    FileChangeSource(const FileChangeSource&) = delete;
+    FileChangeSource& operator=(const FileChangeSource&) = delete;
+    FileChangeSource& operator=(FileChangeSource&&) = delete;
+
+    // Fails when none of the directories can be watched.
+    bool Start(std::function<void()> onChange) override;
+    void Stop() override;
+
+private:
+    struct Watch;
+
+    void AddWatchedFile(const std::string& path);
+    void Run();
+
+    std::vector<std::string> m_Paths;
+    std::vector<Watch> m_Watches;
+    std::function<void()> m_OnChange;
+    std::thread m_Thread;
+#ifdef _WIN32
+    // Signaled by Stop.
+    void* m_StopEvent = nullptr;
+#else
+    int m_Notify = -1;
+    // Written by Stop to wake the thread up.
+    int m_StopPipe[2] = {-1, -1};
+#endif
+};
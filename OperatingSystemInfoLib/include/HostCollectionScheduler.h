@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+class IHostTransport;
+class ThreadPool;
+
+struct HostCollectionOptions
+{
+    OperatingSystemInfoFieldMask Fields = OperatingSystemInfoFieldMask::All();
+    // Attempts running at once, abandoned ones excluded. Keep it at most the size of the pool, an attempt
+    // waiting for a worker already counts against the deadline of its host.
+    size_t MaxConcurrency = 64;
+    // Time given to a host from its first attempt, retries and backoff included.
+    std::chrono::steady_clock::duration HostTimeout = std::chrono::seconds(30);
+    unsigned MaxAttempts = 3;
+    // The backoff doubles after each failed attempt up to MaxBackoff, and is drawn between half and all of it
+    // so that the hosts which failed together do not retry together.
+    std::chrono::steady_clock::duration InitialBackoff = std::chrono::milliseconds(200);
+    std::chrono::steady_clock::duration MaxBackoff = std::chrono::seconds(5);
+};
+
+enum class HostCollectionStatus
+{
+    Succeeded,
+    // Every attempt failed, or the next one would not have started before the deadline.
+    Failed,
+    // The deadline passed while an attempt was running.
+    TimedOut,
+};
+
+struct HostCollectionResult
+{
+    std::string Host;
+    HostCollectionStatus Status = HostCollectionStatus::Failed;
+    // Only the requested fields, empty unless the collection succeeded.
+    OperatingSystemInfo Info;
+    // Error of the last failed attempt.
+    std::string Error;
+    unsigned Attempts = 0;
+    // From the first attempt to the result.
+    std::chrono::steady_clock::duration Elapsed{};
+};
+
+struct HostCollectionStatistics
+{
+    uint64_t Hosts = 0;
+    uint64_t Succeeded = 0;
+    uint64_t Failed = 0;
+    uint64_t TimedOut = 0;
+    uint64_t Attempts = 0;
+    uint64_t Retries = 0;
+    std::chrono::steady_clock::duration Elapsed{};
+    double HostsPerSecond = 0;
+};
+
+// Collects OperatingSystemInfo from many hosts through a transport, running up to MaxConcurrency attempts
+// on a thread pool. A failed attempt is retried after a backoff while the host has attempts and time left.
+// A host whose deadline passes gets its TimedOut result at once. The attempt still running is abandoned: its
+// slot goes to the next host right away, it keeps its worker until the transport returns.
+//
+// The pool and the transport must outlive the scheduler, whose destructor waits for the abandoned attempts.
+class HostCollectionScheduler final
+{
+public:
+    using ResultCallback = std::function<void(const HostCollectionResult& result)>;
+
+    HostCollectionScheduler(ThreadPool& pool, IHostTransport& transport, HostCollectionOptions options = {}) noexcept;
+    ~HostCollectionScheduler();
+    HostCollectionScheduler(HostCollectionScheduler&&) = delete;
+    HostCollectionScheduler(const HostCollectionScheduler&) = delete;
+    HostCollectionScheduler& operator=(const HostCollectionScheduler&) = delete;
+    HostCollectionScheduler& operator=(HostCollectionScheduler&&) = delete;
+
+    // Returns once every host has its result. onResult is called on the calling thread for each host as soon as
+    // its result is known, in completion order. Must not be called from one of the pool's workers.
+    HostCollectionStatistics Collect(const std::vector<std::string>& hosts, const ResultCallback& onResult);
+
+private:
+    struct Batch;
+
+    void Attempt(const std::shared_ptr<Batch>& batch, size_t index);
+
+    ThreadPool& m_Pool;
+    IHostTransport& m_Transport;
+    HostCollectionOptions m_Options;
+
+    // Attempts submitted to the pool and not finished yet, abandoned ones included.
+    std::mutex m_RunningMutex;
+    std::condition_variable m_Idle;
+    size_t m_Running = 0;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <functional>
+
+// Something an OperatingSystemInfo is read from, which tells when it may have changed.
+// Notifications may be spurious and several changes may be reported by one notification.
+class IChangeSource
+{
+public:
+    virtual ~IChangeSource() = default;
+
+    // Starts watching, onChange is called from a thread of the source for each change until Stop.
+    // Returns false when the source cannot be watched, ex. a missing registry key.
+    virtual bool Start(std::function<void()> onChange) = 0;
+    // Waits for a running onChange call to return, no call is made afterwards.
+    virtual void Stop() = 0;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+// Collects OperatingSystemInfo from another machine for HostCollectionScheduler, implemented by
+// WmiHostTransport (remote WMI and registry) and InMemoryHostTransport (stand-in for tests and benchmarks).
+// Collect is called concurrently for different hosts, and again for the same host on a retry.
+class IHostTransport
+{
+public:
+    virtual ~IHostTransport() = default;
+
+    // Fills the requested fields of result, the others are left empty. Returns false with a description in
+    // error when the attempt failed, it may be retried. The attempt should give up at deadline, a result
+    // returned later is dropped.
+    virtual bool Collect(const std::string& host, OperatingSystemInfoFieldMask fields,
+                         std::chrono::steady_clock::time_point deadline, OperatingSystemInfo& result,
+                         std::string& error) = 0;
+};
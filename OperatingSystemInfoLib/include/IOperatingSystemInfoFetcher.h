@@ -1,11 +1,42 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
 #include <vector>
 #include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
 
 class IOperatingSystemInfoFetcher
 {
 public:
     virtual ~IOperatingSystemInfoFetcher() = default;
     virtual OperatingSystemInfo GetInformation() = 0;
+
+    // Fetches only the requested fields, the other fields of the result are left empty.
+    // Fetchers which can skip expensive sources override this, the default fetches everything.
+    virtual OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields)
+    {
+        auto info = GetInformation();
+        ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+            if (!fields.Has(field.Field))
+            {
+                field.Get(info).reset();
+            }
+        });
+        return info;
+    }
+
+    // Receives the values of fields a call gave up on, once their source is done. fields tells which ones they are.
+    using LateFieldsCallback = std::function<void(const OperatingSystemInfo& info, OperatingSystemInfoFieldMask fields)>;
+
+    // Like GetInformation(fields), giving up by deadline on the sources which are not done yet. timedOut receives the
+    // requested fields left without a value because of that, onLate, when given, may be called later from another
+    // thread with their values. Fetchers which cannot give up do not override this, the deadline is then ignored.
+    virtual OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields,
+                                               std::chrono::steady_clock::time_point /* deadline */,
+                                               OperatingSystemInfoFieldMask& timedOut, LateFieldsCallback /* onLate */)
+    {
+        timedOut = {};
+        return GetInformation(fields);
+    }
 };
\ No newline at end of file
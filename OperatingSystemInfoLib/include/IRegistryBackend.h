@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+
+// Registry value types, same numbering as REG_SZ / REG_DWORD / ... in winnt.h.
+enum class RegistryValueType : uint32_t
+{
+    None = 0,
+    String = 1,
+    ExpandString = 2,
+    Binary = 3,
+    Dword = 4,
+    DwordBigEndian = 5,
+    Link = 6,
+    MultiString = 7,
+    Qword = 11,
+};
+
+// Name of a value as the backend stores it, either single byte characters or UTF-16LE code units.
+struct RegistryValueName
+{
+    const void* Data;
+    size_t Length; // in characters
+    bool Wide;
+
+    // Registry names compare case-insensitively, we fold ASCII only which covers every name we look up.
+    bool EqualsAscii(const char* name, size_t length) const
+    {
+        if (Length != length)
+        {
+            return false;
+        }
+        auto fold = [](uint32_t c) { return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c; };
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint32_t c = 0;
+            if (Wide)
+            {
+                uint16_t unit = 0;
+                std::memcpy(&unit, static_cast<const std::byte*>(Data) + i * 2, sizeof(unit));
+                c = unit;
+            }
+            else
+            {
+                c = static_cast<const unsigned char*>(Data)[i];
+            }
+            if (fold(c) != fold(static_cast<unsigned char>(name[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// A value of the opened key. Data is the raw little-endian content (UTF-16LE for string types)
+// and is only valid during the visit.
+struct RegistryValue
+{
+    RegistryValueName Name;
+    RegistryValueType Type;
+    const std::byte* Data;
+    size_t Size;
+};
+
+class IRegistryValueVisitor
+{
+public:
+    virtual ~IRegistryValueVisitor() = default;
+    // Return false to stop the enumeration.
+    virtual bool Visit(const RegistryValue& value) = 0;
+};
+
+// Read access to the values of one opened key, implemented by WindowsReg (live registry),
+// OfflineReg (hive file) and InMemoryReg (fake for tests and benchmarks).
+class IRegistryBackend
+{
+public:
+    virtual ~IRegistryBackend() = default;
+
+    // Visits every value of the opened key once, in storage order.
+    // Returns false when no key is opened or the enumeration failed.
+    virtual bool ForEachValue(IRegistryValueVisitor& visitor) const = 0;
+};
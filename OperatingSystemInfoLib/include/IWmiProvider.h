@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Value types of the properties we read, same numbering as VT_I4 / VT_BSTR / ... in wtypes.h.
+enum class WmiValueType : uint16_t
+{
+    Null = 1,
+    Int32 = 3,
+    String = 8,
+    Bool = 11,
+    StringArray = 0x2008,
+};
+
+// A property value, std::monostate for NULL (ex. a property left out of the SELECT list).
+using WmiValue = std::variant<std::monostate, int32_t, std::wstring, bool, std::vector<std::wstring>>;
+
+inline WmiValueType GetWmiValueType(const WmiValue& value)
+{
+    constexpr WmiValueType Types[] = {WmiValueType::Null, WmiValueType::Int32, WmiValueType::String, WmiValueType::Bool,
+                                      WmiValueType::StringArray};
+    return Types[value.index()];
+}
+
+// One object of a query result, only valid during the visit.
+class IWmiObject
+{
+public:
+    virtual ~IWmiObject() = default;
+
+    // Returns false when the class has no such property. Properties of the class which
+    // were not selected are found with a NULL value, like WMI does.
+    virtual bool Get(const wchar_t* name, WmiValue& value) const = 0;
+};
+
+class IWmiObjectVisitor
+{
+public:
+    virtual ~IWmiObjectVisitor() = default;
+    // Return false to stop the enumeration.
+    virtual bool Visit(const IWmiObject& object) = 0;
+};
+
+// Runs WQL queries against one namespace, implemented by WmiQuery (COM, root\cimv2)
+// and InMemoryWmi (fake for tests and benchmarks).
+class IWmiProvider
+{
+public:
+    virtual ~IWmiProvider() = default;
+
+    // Visits every object of the result in order.
+    // Returns false when the query could not be run, ex. no connection or a malformed query.
+    virtual bool ExecQuery(const wchar_t* query, IWmiObjectVisitor& visitor) = 0;
+
+    // Same, giving up on the objects not returned by deadline, which also returns false. Providers which cannot
+    // give up do not override this, the deadline is then ignored.
+    virtual bool ExecQuery(const wchar_t* query, IWmiObjectVisitor& visitor,
+                           std::chrono::steady_clock::time_point /* deadline */)
+    {
+        return ExecQuery(query, visitor);
+    }
+};
+
+// Assigns the property value when it has the expected type, otherwise leaves outValue untouched and returns false.
+template <class T> bool StoreWmiPropertyValue(const IWmiObject& object, const wchar_t* propertyName, T& outValue)
+{
+    WmiValue data;
+    if (!object.Get(propertyName, data))
+    {
+        return false;
+    }
+    if (auto value = std::get_if<T>(&data))
+    {
+        outValue = std::move(*value);
+        return true;
+    }
+    return false;
+}
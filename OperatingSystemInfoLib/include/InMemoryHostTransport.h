@@ -0,0 +1,79 @@
+#pragma once
+
+#include "IHostTransport.h"
+
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+class InMemoryRegistry;
+class InMemoryWmiRepository;
+
+struct InMemoryHostTransportOptions
+{
+    // Each attempt takes a latency drawn uniformly between the two, like a network round trip would.
+    std::chrono::steady_clock::duration MinLatency{};
+    std::chrono::steady_clock::duration MaxLatency{};
+    // Probability that an attempt fails once its latency has passed.
+    double FailureRate = 0;
+    uint32_t Seed = 1;
+};
+
+struct InMemoryHostTransportStatistics
+{
+    uint64_t Attempts = 0;
+    // Attempts failed by FailureRate or SetFailures.
+    uint64_t InjectedFailures = 0;
+    // Attempts given up at their deadline.
+    uint64_t TimedOut = 0;
+};
+
+// Stand-in for WmiHostTransport without a network, to test and benchmark HostCollectionScheduler.
+// Every host is the same machine, held in an InMemoryWmiRepository and an InMemoryRegistry, and is read
+// through the same steps as OperatingSystemInfoFetcher. Latency and failures are injected per attempt.
+//
+// Hosts are set up before the first Collect. The repository and the registry must outlive the transport.
+class InMemoryHostTransport final : public IHostTransport
+{
+public:
+    InMemoryHostTransport(const InMemoryWmiRepository& wmi, const InMemoryRegistry& registry,
+                          InMemoryHostTransportOptions options = {}) noexcept;
+    ~InMemoryHostTransport() override = default;
+    InMemoryHostTransport(InMemoryHostTransport&&) = delete;
+    InMemoryHostTransport(const InMemoryHostTransport&) = delete;
+    InMemoryHostTransport& operator=(const InMemoryHostTransport&) = delete;
+    InMemoryHostTransport& operator=(InMemoryHostTransport&&) = delete;
+
+    // The first attempts of host fail, all of them with UINT32_MAX as for an unreachable host.
+    void SetFailures(const std::string& host, uint32_t attempts);
+    // Replaces the drawn latency of every attempt of host, ex. to make it miss its deadline.
+    void SetLatency(const std::string& host, std::chrono::steady_clock::duration latency);
+
+    bool Collect(const std::string& host, OperatingSystemInfoFieldMask fields,
+                 std::chrono::steady_clock::time_point deadline, OperatingSystemInfo& result,
+                 std::string& error) override;
+
+    InMemoryHostTransportStatistics GetStatistics() const;
+
+private:
+    struct Host
+    {
+        uint32_t Failures = 0;
+        bool HasLatency = false;
+        std::chrono::steady_clock::duration Latency{};
+        uint32_t Attempts = 0;
+    };
+
+    const InMemoryWmiRepository& m_Wmi;
+    const InMemoryRegistry& m_Registry;
+    InMemoryHostTransportOptions m_Options;
+
+    // Guards the hosts, the random generator and the statistics.
+    mutable std::mutex m_Mutex;
+    std::unordered_map<std::string, Host> m_Hosts;
+    std::mt19937 m_Random;
+    InMemoryHostTransportStatistics m_Statistics;
+};
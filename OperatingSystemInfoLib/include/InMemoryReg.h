@@ -0,0 +1,64 @@
+#pragma once
+
+#include "IRegistryBackend.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Registry content held in memory, used as a fake backend for tests and benchmarks on any platform.
+// Key paths and value names are case-insensitive (ASCII), values are stored in the registry's own
+// encoding so readers go through the same decoding as with the live registry or a hive file.
+class InMemoryRegistry final
+{
+public:
+    struct Value
+    {
+        std::string Name;
+        RegistryValueType Type;
+        std::vector<std::byte> Data;
+    };
+
+    InMemoryRegistry() = default;
+    ~InMemoryRegistry() = default;
+    InMemoryRegistry(const InMemoryRegistry&) = delete;
+    InMemoryRegistry(InMemoryRegistry&&) = delete;
+    InMemoryRegistry& operator=(const InMemoryRegistry&) = delete;
+    InMemoryRegistry& operator=(InMemoryRegistry&&) = delete;
+
+    void SetStringValue(const char* path, const char* name, const wchar_t* value);
+    void SetIntValue(const char* path, const char* name, uint32_t value);
+    void SetInt64Value(const char* path, const char* name, uint64_t value);
+    void SetBinaryValue(const char* path, const char* name, std::vector<std::byte> value);
+    void SetValue(const char* path, const char* name, RegistryValueType type, std::vector<std::byte> data);
+
+    // Returns nullptr when the key does not exist.
+    const std::vector<Value>* FindKey(const char* path) const;
+
+private:
+    std::unordered_map<std::string, std::vector<Value>> m_Keys;
+};
+
+class InMemoryReg final : public IRegistryBackend
+{
+public:
+    InMemoryReg() : m_Values(nullptr)
+    {
+    }
+    ~InMemoryReg() override = default;
+
+    InMemoryReg(const InMemoryReg&) = delete;
+    InMemoryReg(InMemoryReg&&) = delete;
+    InMemoryReg& operator = (const InMemoryReg&) = delete;
+    InMemoryReg& operator = (InMemoryReg&&) = delete;
+
+    // The registry must outlive the opened key.
+    bool Open(const InMemoryRegistry& registry, const char* path);
+    void Close();
+
+    bool ForEachValue(IRegistryValueVisitor& visitor) const override;
+
+private:
+    const std::vector<InMemoryRegistry::Value>* m_Values;
+};
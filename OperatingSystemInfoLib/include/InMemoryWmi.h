@@ -0,0 +1,97 @@
+#pragma once
+
+#include "IWmiProvider.h"
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// WMI class instances held in memory, used as a fake provider for tests and benchmarks on any platform.
+// Class and property names are case-insensitive (ASCII) like in WMI.
+class InMemoryWmiRepository final
+{
+public:
+    struct Class
+    {
+        std::wstring Name;
+        // Union of the properties set on any instance, instances hold NULL for the ones they don't set.
+        std::vector<std::wstring> Properties;
+        std::vector<std::vector<WmiValue>> Instances;
+    };
+
+    InMemoryWmiRepository() = default;
+    ~InMemoryWmiRepository() = default;
+    InMemoryWmiRepository(const InMemoryWmiRepository&) = delete;
+    InMemoryWmiRepository(InMemoryWmiRepository&&) = delete;
+    InMemoryWmiRepository& operator=(const InMemoryWmiRepository&) = delete;
+    InMemoryWmiRepository& operator=(InMemoryWmiRepository&&) = delete;
+
+    // Adds the instances declared in a UTF-8 MOF file, as written by "mofcomp -MOF:" or by hand:
+    //
+    //   instance of Win32_OperatingSystem
+    //   {
+    //       Caption = "Microsoft Windows 10 Pro";
+    //       OSLanguage = 1033;
+    //       MUILanguages = {"en-US"};
+    //   };
+    //
+    // Values are strings, integers (32-bit), TRUE / FALSE, NULL or arrays of strings.
+    // Comments and #pragma lines are skipped. Nothing is added when the content is malformed.
+    bool Load(const char* path);
+    bool Parse(std::string_view mof);
+
+    void AddInstance(const wchar_t* className, std::vector<std::pair<std::wstring, WmiValue>> properties);
+
+    // Returns nullptr when the class has no instance.
+    const Class* FindClass(const wchar_t* name) const;
+
+private:
+    Class& GetClass(const std::wstring& name);
+
+    std::vector<Class> m_Classes;
+};
+
+struct InMemoryWmiStatistics
+{
+    uint64_t Queries = 0;
+    uint64_t ObjectsScanned = 0;
+    uint64_t ObjectsReturned = 0;
+    // Property values copied into result objects, only the selected ones are.
+    uint64_t PropertiesMaterialized = 0;
+};
+
+// Runs WQL over an InMemoryWmiRepository. The supported subset is
+//
+//   SELECT * | Property [, Property]... FROM Class [WHERE Condition]
+//
+// where a condition combines with AND, OR, NOT and parentheses the comparisons
+// Property = | <> | != | < | <= | > | >= Literal, Property LIKE 'pattern' (% and _) and Property IS [NOT] NULL.
+// String comparisons are case-insensitive (ASCII).
+class InMemoryWmi final : public IWmiProvider
+{
+public:
+    // The repository must outlive this object.
+    explicit InMemoryWmi(const InMemoryWmiRepository& repository) noexcept : m_Repository(repository)
+    {
+    }
+    ~InMemoryWmi() override = default;
+
+    InMemoryWmi(const InMemoryWmi&) = delete;
+    InMemoryWmi(InMemoryWmi&&) = delete;
+    InMemoryWmi& operator=(const InMemoryWmi&) = delete;
+    InMemoryWmi& operator=(InMemoryWmi&&) = delete;
+
+    using IWmiProvider::ExecQuery;
+    bool ExecQuery(const wchar_t* query, IWmiObjectVisitor& visitor) override;
+
+    const InMemoryWmiStatistics& GetStatistics() const noexcept
+    {
+        return m_Statistics;
+    }
+
+private:
+    const InMemoryWmiRepository& m_Repository;
+    InMemoryWmiStatistics m_Statistics;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CompactOperatingSystemInfo.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+#include <stdint.h>
+#include <string_view>
+
+// BCP-47 tag of a Windows LCID, ex. "en-US" for 0x0409, "zh-Hant" for 0x7C04. The sort order bits are ignored.
+// Empty for unknown LCIDs. Constant time, the view points to static storage.
+std::string_view GetLanguageTag(uint32_t lcid) noexcept;
+
+// LCID of a tag, ignoring case. Constant time: one perfect hash probe and one comparison.
+bool FindLcid(std::string_view tag, uint32_t& lcid) noexcept;
+
+// Tag of an OSLanguage value, the LCID in decimal ("1033"), or of a Locale value, the LCID in hexadecimal ("0409").
+// Values of other fields, and values which are not a known LCID, ex. tags already, are returned unchanged.
+std::string_view NormalizeLanguageField(OperatingSystemInfoField field, std::string_view value) noexcept;
+
+// Replace OSLanguage and Locale by their tag. Neither allocates: views are pointed to static storage,
+// and tags are short enough for the inline buffer of std::string.
+void NormalizeLanguageFields(OperatingSystemInfoView& info) noexcept;
+void NormalizeLanguageFields(OperatingSystemInfo& info);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+// Bucket counts of a LatencyHistogram at one point in time.
+struct LatencyHistogramSnapshot
+{
+    static constexpr size_t BucketCount = 252;
+
+    uint64_t Count = 0;
+    std::chrono::nanoseconds Total{0};
+    std::chrono::nanoseconds Max{0};
+    std::array<uint64_t, BucketCount> Buckets{};
+
+    std::chrono::nanoseconds Mean() const noexcept
+    {
+        return Count > 0 ? Total / static_cast<std::chrono::nanoseconds::rep>(Count) : std::chrono::nanoseconds(0);
+    }
+
+    // Upper bound of the bucket holding the given fraction of the samples, ex. 0.99 for p99.
+    // Less than 25% above the exact value, the width of a quarter of a power of two, and never above Max.
+    std::chrono::nanoseconds Percentile(double fraction) const noexcept;
+
+    // Smallest and largest duration counted in a bucket.
+    static std::chrono::nanoseconds BucketLowerBound(size_t index) noexcept;
+    static std::chrono::nanoseconds BucketUpperBound(size_t index) noexcept;
+};
+
+// Lock-free histogram of durations, recording is a few relaxed atomic additions and can run on any thread.
+// Durations below 8 ns have a bucket each, then every power of two is split into 4 buckets.
+class LatencyHistogram final
+{
+public:
+    static constexpr size_t BucketCount = LatencyHistogramSnapshot::BucketCount;
+
+    LatencyHistogram() noexcept = default;
+    ~LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram(LatencyHistogram&&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(LatencyHistogram&&) = delete;
+
+    void Record(std::chrono::nanoseconds duration) noexcept
+    {
+        auto value = static_cast<uint64_t>((std::max)(duration.count(), std::chrono::nanoseconds::rep{0}));
+        m_Buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+        m_Total.fetch_add(value, std::memory_order_relaxed);
+        auto max = m_Max.load(std::memory_order_relaxed);
+        while (value > max && !m_Max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Samples recorded during the snapshot may be counted in some buckets and not yet in Total.
+    LatencyHistogramSnapshot Snapshot() const noexcept;
+    void Reset() noexcept;
+
+    static size_t GetBucket(uint64_t nanoseconds) noexcept
+    {
+        if (nanoseconds < 8)
+        {
+            return static_cast<size_t>(nanoseconds);
+        }
+        unsigned exponent = 0;
+        for (unsigned shift = 32; shift > 0; shift /= 2)
+        {
+            if (nanoseconds >> (exponent + shift))
+            {
+                exponent += shift;
+            }
+        }
+        // The two bits below the leading one pick the quarter of [2^exponent, 2^(exponent + 1)).
+        return (exponent - 1) * 4 + ((nanoseconds >> (exponent - 2)) & 3);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> m_Buckets{};
+    std::atomic<uint64_t> m_Total{0};
+    std::atomic<uint64_t> m_Max{0};
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "IOperatingSystemInfoFetcher.h"
+#include "OperatingSystemInfo.h"
+#include <string>
+
+// Fills OperatingSystemInfo on Linux from uname(2), os-release(5) and the locale environment.
+// Each call is one uname syscall plus a single read of os-release, no process is spawned.
+//
+// Field mapping:
+//   Caption                  PRETTY_NAME                 "Debian GNU/Linux 12 (bookworm)"
+//   EditionID                VARIANT_ID, else ID         "server" / "debian"
+//   OSArchitecture           uname machine               "64-bit"
+//   BuildBranch / Codename   VERSION_CODENAME            "bookworm"
+//   MarketName               VERSION                     "12 (bookworm)"
+//   ReleaseId                VERSION_ID                  "12"
+//   Version                  uname release (kernel)      "6.1.0-18-amd64"
+//   CurrentVersion           VERSION_ID                  "12"
+//   CurrentMajor/MinorVersionNumber   VERSION_ID parts   "12" / "0"
+//   CurrentBuildNumber       BUILD_ID (rolling distros)  "rolling"
+//   MUILanguage              LC_ALL, LC_MESSAGES, LANG   "en-US"
+//   Locale                   LC_ALL, LC_CTYPE, LANG      "en-US"
+// OSLanguage, UBR and the service pack fields have no Linux equivalent and are left empty.
+class LinuxOperatingSystemInfoFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    // Reads /etc/os-release, falling back to /usr/lib/os-release.
+    LinuxOperatingSystemInfoFetcher() noexcept = default;
+    explicit LinuxOperatingSystemInfoFetcher(std::string osReleasePath) noexcept;
+    ~LinuxOperatingSystemInfoFetcher() override = default;
+    LinuxOperatingSystemInfoFetcher(LinuxOperatingSystemInfoFetcher&&) = delete;
+    LinuxOperatingSystemInfoFetcher(const LinuxOperatingSystemInfoFetcher&) = delete;
+    LinuxOperatingSystemInfoFetcher& operator=(const LinuxOperatingSystemInfoFetcher&) = delete;
+    LinuxOperatingSystemInfoFetcher& operator=(LinuxOperatingSystemInfoFetcher&&) = delete;
+
+    using IOperatingSystemInfoFetcher::GetInformation;
+    OperatingSystemInfo GetInformation() override;
+
+private:
+    std::string m_OsReleasePath;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Empty files cannot be mapped.
+class MappedFile final
+{
+public:
+    MappedFile() noexcept = default;
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+    MappedFile& operator = (MappedFile&&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_Data != nullptr;
+    }
+
+    const std::byte* Data() const
+    {
+        return m_Data;
+    }
+
+    size_t Size() const
+    {
+        return m_Size;
+    }
+
+private:
+    const std::byte* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "IOperatingSystemInfoFetcher.h"
+#include "OperatingSystemInfo.h"
+#include <string>
+
+// Fills OperatingSystemInfo from an offline SOFTWARE hive file, ex. one captured from another machine,
+// on any platform. Nothing is read from the host running it, WMI included.
+//
+// Besides the values of [Microsoft\Windows NT\CurrentVersion] read like OperatingSystemInfoFetcher,
+// the fields of Win32_OperatingSystem are derived from the hive:
+//   Caption                  "Microsoft " ProductName    "Microsoft Windows 11 Pro"
+//                            (builds from 22000 say Windows 11, ProductName still says Windows 10)
+//   Version                  Major.Minor.CurrentBuildNumber, else CurrentVersion.CurrentBuildNumber
+//                                                        "10.0.22631"
+//   OSArchitecture           WOW6432Node present         "64-bit" / "32-bit"
+//   ServicePackMajorVersion  CSDVersion number, else 0   "1"
+//   ServicePackMinorVersion  0                           "0"
+// MUILanguage, OSLanguage and Locale live in the SYSTEM hive and OSVersion is made from MUILanguage,
+// they are left empty.
+class OfflineOperatingSystemInfoFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    explicit OfflineOperatingSystemInfoFetcher(std::string softwareHivePath) noexcept;
+    ~OfflineOperatingSystemInfoFetcher() override = default;
+    OfflineOperatingSystemInfoFetcher(OfflineOperatingSystemInfoFetcher&&) = delete;
+    OfflineOperatingSystemInfoFetcher(const OfflineOperatingSystemInfoFetcher&) = delete;
+    OfflineOperatingSystemInfoFetcher& operator=(const OfflineOperatingSystemInfoFetcher&) = delete;
+    OfflineOperatingSystemInfoFetcher& operator=(OfflineOperatingSystemInfoFetcher&&) = delete;
+
+    using IOperatingSystemInfoFetcher::GetInformation;
+    // Empty when the file is not a hive with a CurrentVersion key.
+    OperatingSystemInfo GetInformation() override;
+
+private:
+    std::string m_SoftwareHivePath;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "IRegistryBackend.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Read-only view of a registry hive file (regf format), e.g. a captured
+// %SystemRoot%\System32\config\SOFTWARE. The file is memory mapped and every
+// cell is accessed in place, so opening keys and reading values never copies
+// hive data except into the caller's result object.
+class RegistryHive final
+{
+public:
+    RegistryHive() noexcept = default;
+    ~RegistryHive()
+    {
+        Close();
+    }
+
+    RegistryHive(const RegistryHive&) = delete;
+    RegistryHive(RegistryHive&&) = delete;
+    RegistryHive& operator = (const RegistryHive&) = delete;
+    RegistryHive& operator = (RegistryHive&&) = delete;
+
+    bool Load(const char* path);
+    void Close();
+
+    bool IsLoaded() const
+    {
+        return m_Data != nullptr;
+    }
+
+    // Bytes of the hive, up to the end of its hive bins.
+    size_t Size() const
+    {
+        return m_Size;
+    }
+
+    // Offset of the root key node, relative to the first hive bin.
+    uint32_t RootCell() const
+    {
+        return m_RootCell;
+    }
+
+    // Returns the payload of the allocated cell at the given offset (relative to the first hive bin)
+    // and its usable size, or nullptr when the offset does not point at an allocated cell inside the hive.
+    const std::byte* Cell(uint32_t offset, uint32_t& size) const;
+
+private:
+    MappedFile m_File;
+    // Hive data within the file, without any trailing bytes past the hive bins.
+    const std::byte* m_Data = nullptr;
+    size_t m_Size = 0;
+    uint32_t m_RootCell = 0;
+};
+
+// Key accessor over a RegistryHive with the same reading surface as WindowsReg.
+// Paths are relative to the hive root, ex. "Microsoft\\Windows NT\\CurrentVersion" in a SOFTWARE hive.
+// The hive must outlive every OfflineReg opened on it.
+class OfflineReg final : public IRegistryBackend
+{
+public:
+    OfflineReg() : m_Hive(nullptr), m_KeyCell(0)
+    {
+    }
+    ~OfflineReg() override
+    {
+        Close();
+    }
+
+    OfflineReg(const OfflineReg&) = delete;
+    OfflineReg(OfflineReg&&) = delete;
+    OfflineReg& operator = (const OfflineReg&) = delete;
+    OfflineReg& operator = (OfflineReg&&) = delete;
+
+    bool Open(const RegistryHive& hive, const wchar_t* path);
+    bool Open(const RegistryHive& hive, const char* path);
+    void Close();
+
+    // Finds a value for the decoders of RegistryValueDecoder.h. The data is referenced in place in the hive,
+    // except values over 16 KB which are stored in segments and gathered into scratch.
+    bool ReadValue(const wchar_t* name, RegistryValue& result, std::vector<std::byte>& scratch) const;
+    bool ReadValue(const char* name, RegistryValue& result, std::vector<std::byte>& scratch) const;
+
+    // REG_SZ and REG_EXPAND_SZ, the latter as stored. The std::string overload returns UTF-8.
+    bool ReadStringValue(const wchar_t* name, std::wstring& result) const;
+    bool ReadStringValue(const char* name, std::string& result) const;
+
+    bool ReadMultiStringValue(const wchar_t* name, std::vector<std::wstring>& result) const;
+    bool ReadMultiStringValue(const char* name, std::vector<std::string>& result) const;
+
+    bool ReadIntValue(const wchar_t* name, uint32_t& result) const;
+
+    bool ReadInt64Value(const wchar_t* name, uint64_t& result) const;
+
+    bool ReadBinaryValue(const wchar_t* name, std::vector<std::byte>& result) const;
+
+    bool ForEachValue(IRegistryValueVisitor& visitor) const override;
+
+private:
+    const RegistryHive* m_Hive;
+    uint32_t m_KeyCell;
+};
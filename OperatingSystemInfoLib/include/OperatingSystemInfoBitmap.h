@@ -0,0 +1,213 @@
+#pragma once
+
+#include "Utf16Transcoder.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Compressed sets of host ids, split like Roaring bitmaps into containers of 65536 ids sharing their high 16 bits.
+// A container of up to ArrayLimit ids stores their low 16 bits as a sorted array of uint16_t, a fuller one as a
+// bitset of 1024 uint64_t, so that a container never takes more than 8 KB.
+
+namespace detail
+{
+// Index of the lowest set bit of a non-zero word.
+inline uint32_t LowestBit(uint64_t bits) noexcept
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<uint32_t>(bits)))
+    {
+        return index;
+    }
+    _BitScanForward(&index, static_cast<uint32_t>(bits >> 32));
+    return index + 32;
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+}
+
+enum class BitmapOperation
+{
+    And,
+    Or,
+    AndNot,
+};
+} // namespace detail
+
+// One container, with the same layout in memory and in OperatingSystemInfoBitmapIndex files.
+struct OperatingSystemInfoBitmapContainer
+{
+    static constexpr uint32_t ArrayLimit = 4096;
+    static constexpr size_t BitsetWords = 1024;
+
+    // High 16 bits of the ids.
+    uint16_t Key;
+    uint16_t Reserved;
+    uint32_t Cardinality;
+    // Address of the array or bitset, relative to the Base of the view.
+    uint64_t Offset;
+
+    bool IsBitset() const noexcept
+    {
+        return Cardinality > ArrayLimit;
+    }
+};
+static_assert(sizeof(OperatingSystemInfoBitmapContainer) == 16, "Containers are stored as is in index files");
+
+// Read-only bitmap: containers sorted by key, with their data at Base + Offset. Views of an
+// OperatingSystemInfoBitmap have a null Base and absolute offsets, views into a mapped index file
+// have the start of the mapping as Base, so both are read in place.
+struct OperatingSystemInfoBitmapView
+{
+    const OperatingSystemInfoBitmapContainer* Containers = nullptr;
+    size_t Count = 0;
+    const std::byte* Base = nullptr;
+
+    const uint16_t* Array(size_t i) const noexcept
+    {
+        return reinterpret_cast<const uint16_t*>(reinterpret_cast<uintptr_t>(Base) + Containers[i].Offset);
+    }
+
+    const uint64_t* Bits(size_t i) const noexcept
+    {
+        return reinterpret_cast<const uint64_t*>(reinterpret_cast<uintptr_t>(Base) + Containers[i].Offset);
+    }
+
+    bool Empty() const noexcept
+    {
+        return Count == 0;
+    }
+
+    uint64_t Cardinality() const noexcept;
+    bool Contains(uint32_t host) const noexcept;
+
+    // Calls visitor(host) in increasing order.
+    template <class TVisitor> void ForEach(TVisitor&& visitor) const
+    {
+        for (size_t i = 0; i < Count; ++i)
+        {
+            const uint32_t high = uint32_t{Containers[i].Key} << 16;
+            if (Containers[i].IsBitset())
+            {
+                const auto bits = Bits(i);
+                for (uint32_t word = 0; word < OperatingSystemInfoBitmapContainer::BitsetWords; ++word)
+                {
+                    for (auto w = bits[word]; w != 0; w &= w - 1)
+                    {
+                        visitor(high | (word * 64 + detail::LowestBit(w)));
+                    }
+                }
+            }
+            else
+            {
+                const auto values = Array(i);
+                for (uint32_t j = 0; j < Containers[i].Cardinality; ++j)
+                {
+                    visitor(high | values[j]);
+                }
+            }
+        }
+    }
+};
+
+class OperatingSystemInfoBitmap;
+
+// Set operations, result gets lhs AND rhs, lhs OR rhs, lhs AND NOT rhs. Bitset containers are combined 256 bits
+// at a time with AVX2, arrays are merged, or probed into the bitset of the other side. result may not be one of
+// the operands. Levels above GetSupportedSimdLevel() run at the supported level, SSE2 runs the scalar loops.
+void AndBitmaps(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+                OperatingSystemInfoBitmap& result, SimdLevel level = GetSupportedSimdLevel());
+void OrBitmaps(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+               OperatingSystemInfoBitmap& result, SimdLevel level = GetSupportedSimdLevel());
+void AndNotBitmaps(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+                   OperatingSystemInfoBitmap& result, SimdLevel level = GetSupportedSimdLevel());
+// Intersection of count bitmaps, from the smallest up so that the intermediate results stay small and an
+// empty one ends the evaluation. No bitmap gives an empty result.
+void AndBitmaps(const OperatingSystemInfoBitmapView* bitmaps, size_t count, OperatingSystemInfoBitmap& result,
+                SimdLevel level = GetSupportedSimdLevel());
+
+// Mutable bitmap. Views are invalidated by any change.
+class OperatingSystemInfoBitmap final
+{
+public:
+    OperatingSystemInfoBitmap() = default;
+    ~OperatingSystemInfoBitmap() = default;
+    OperatingSystemInfoBitmap(const OperatingSystemInfoBitmap&) = delete;
+    // Moves keep the data where it is, views stay valid.
+    OperatingSystemInfoBitmap(OperatingSystemInfoBitmap&&) noexcept = default;
+    OperatingSystemInfoBitmap& operator=(const OperatingSystemInfoBitmap&) = delete;
+    OperatingSystemInfoBitmap& operator=(OperatingSystemInfoBitmap&&) noexcept = default;
+
+    // Return false when host was already in, or not in, the bitmap.
+    bool Add(uint32_t host);
+    bool Remove(uint32_t host);
+
+    void Assign(const OperatingSystemInfoBitmapView& bitmap);
+    void Clear();
+
+    OperatingSystemInfoBitmapView View() const noexcept
+    {
+        return {m_Containers.data(), m_Containers.size(), nullptr};
+    }
+
+    bool Contains(uint32_t host) const noexcept
+    {
+        return View().Contains(host);
+    }
+
+    uint64_t Cardinality() const noexcept
+    {
+        return View().Cardinality();
+    }
+
+    bool Empty() const noexcept
+    {
+        return m_Containers.empty();
+    }
+
+    std::vector<uint32_t> ToVector() const;
+
+private:
+    struct Storage
+    {
+        std::vector<uint16_t> Array;
+        std::vector<uint64_t> Bits;
+    };
+
+    friend void AndBitmaps(const OperatingSystemInfoBitmapView&, const OperatingSystemInfoBitmapView&,
+                           OperatingSystemInfoBitmap&, SimdLevel);
+    friend void OrBitmaps(const OperatingSystemInfoBitmapView&, const OperatingSystemInfoBitmapView&,
+                          OperatingSystemInfoBitmap&, SimdLevel);
+    friend void AndNotBitmaps(const OperatingSystemInfoBitmapView&, const OperatingSystemInfoBitmapView&,
+                              OperatingSystemInfoBitmap&, SimdLevel);
+
+    // Appends a container with a key above the others. Empty ones are dropped, bitsets of ArrayLimit ids or
+    // less are stored as arrays.
+    void Append(uint16_t key, Storage&& storage, uint32_t cardinality);
+    void Append(const OperatingSystemInfoBitmapView& bitmap, size_t i);
+    // Replaces the content with lhs op rhs.
+    void Combine(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+                 detail::BitmapOperation operation, SimdLevel level);
+    void Combine(const OperatingSystemInfoBitmapView& lhs, size_t i, const OperatingSystemInfoBitmapView& rhs, size_t j,
+                 detail::BitmapOperation operation, SimdLevel level);
+    Storage TakeStorage();
+    // Points the container at its storage again, after it changed kind or reallocated.
+    void Refresh(size_t i) noexcept;
+    void ToArray(size_t i);
+    void ToBitset(size_t i);
+
+    std::vector<OperatingSystemInfoBitmapContainer> m_Containers;
+    std::vector<Storage> m_Storage;
+    // Storage of removed containers, reused by the next ones.
+    std::vector<Storage> m_Spare;
+};
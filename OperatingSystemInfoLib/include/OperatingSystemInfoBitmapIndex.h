@@ -0,0 +1,154 @@
+#pragma once
+
+#include "CompactOperatingSystemInfo.h"
+#include "MappedFile.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoBitmap.h"
+#include "OperatingSystemInfoField.h"
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <stdint.h>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Index file of an OperatingSystemInfoBitmapIndex, mapped and queried in place by MappedOperatingSystemInfoBitmapIndex.
+// Integers are in host byte order, since the containers are read as they are. Offsets are relative to the start of
+// the file:
+//
+//   0   uint32  Magic "OSBI"
+//   4   uint32  Version (1)
+//   8   uint32  FieldCount, number of Field entries
+//   12  uint32  Reserved
+//   16  uint64  Offset of the containers of Hosts()
+//   24  uint64  Number of those containers
+//   32  Field[FieldCount], the values of field i, in OperatingSystemInfoField order
+//   ..  Value[], the values of each field sorted by string
+//   ..  OperatingSystemInfoBitmapContainer[], with Offset relative to the start of the file
+//   ..  arrays and bitsets of the containers, each aligned to 8 bytes
+//   ..  strings of the values, no terminators
+//
+// Readers ignore the fields they don't know and treat fields missing from an older file as having no value.
+struct OperatingSystemInfoBitmapIndexFormat
+{
+    static constexpr uint32_t Magic = 0x4942534F; // "OSBI"
+    static constexpr uint32_t Version = 1;
+    static constexpr size_t Alignment = 8;
+
+    struct Header
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t FieldCount;
+        uint32_t Reserved;
+        uint64_t HostsOffset;
+        uint64_t HostsCount;
+    };
+
+    struct Field
+    {
+        uint64_t ValuesOffset;
+        uint64_t ValueCount;
+    };
+
+    struct Value
+    {
+        uint64_t StringOffset;
+        uint32_t StringSize;
+        uint32_t Reserved;
+        uint64_t ContainersOffset;
+        uint64_t ContainerCount;
+    };
+};
+static_assert(sizeof(OperatingSystemInfoBitmapIndexFormat::Header) == 32, "Header is stored as is");
+static_assert(sizeof(OperatingSystemInfoBitmapIndexFormat::Field) == 16, "Field is stored as is");
+static_assert(sizeof(OperatingSystemInfoBitmapIndexFormat::Value) == 32, "Value is stored as is");
+
+// Inverted index of the latest snapshot of each host: for every field, a bitmap of the hosts per distinct value.
+// Filters like EditionID = "Enterprise" AND OSArchitecture = "64-bit" are intersections of the bitmaps of Find.
+// Host ids are meant to be dense, ex. positions in a fleet list, the index keeps a record id per host up to the
+// largest. Snapshots are deduplicated like in OperatingSystemInfoInventory, so an unchanged snapshot costs one
+// lookup and a changed one only touches the bitmaps of the fields which changed. Not thread safe.
+class OperatingSystemInfoBitmapIndex final
+{
+public:
+    OperatingSystemInfoBitmapIndex() = default;
+    ~OperatingSystemInfoBitmapIndex() = default;
+    OperatingSystemInfoBitmapIndex(const OperatingSystemInfoBitmapIndex&) = delete;
+    OperatingSystemInfoBitmapIndex(OperatingSystemInfoBitmapIndex&&) = delete;
+    OperatingSystemInfoBitmapIndex& operator=(const OperatingSystemInfoBitmapIndex&) = delete;
+    OperatingSystemInfoBitmapIndex& operator=(OperatingSystemInfoBitmapIndex&&) = delete;
+
+    // Indexes the snapshot of host in place of its previous one.
+    void Update(uint32_t host, const OperatingSystemInfo& info);
+    void Update(uint32_t host, const OperatingSystemInfoView& info);
+    // Returns false when host is not indexed.
+    bool Remove(uint32_t host);
+
+    // Hosts whose field has value, empty when there are none. Views are invalidated by Update and Remove.
+    OperatingSystemInfoBitmapView Find(OperatingSystemInfoField field, std::string_view value) const;
+
+    // Every indexed host, ex. to evaluate NOT with AndNotBitmaps.
+    OperatingSystemInfoBitmapView Hosts() const noexcept
+    {
+        return m_Hosts.View();
+    }
+
+    // Number of distinct values of field.
+    size_t GetValueCount(OperatingSystemInfoField field) const noexcept
+    {
+        return m_Values[static_cast<size_t>(field)].size();
+    }
+
+    bool Write(std::ostream& output) const;
+    bool WriteFile(const char* path) const;
+
+private:
+    static constexpr uint32_t NoRecord = UINT32_MAX;
+
+    void UpdateRecord(uint32_t host, uint32_t record);
+
+    OperatingSystemInfoInventory m_Inventory;
+    // Record of each host, NoRecord for hosts not indexed.
+    std::vector<uint32_t> m_HostRecords;
+    // Per field, the bitmaps by value: the slot of the value, with bit 32 set when it is inlined.
+    std::array<std::unordered_map<uint64_t, OperatingSystemInfoBitmap>, OperatingSystemInfoFieldCount> m_Values;
+    OperatingSystemInfoBitmap m_Hosts;
+};
+
+// Index file written by OperatingSystemInfoBitmapIndex::Write, mapped read-only. Open checks the structure once,
+// after which queries read the containers in place, without decoding. Queries are thread-safe.
+class MappedOperatingSystemInfoBitmapIndex final
+{
+public:
+    MappedOperatingSystemInfoBitmapIndex() noexcept = default;
+    ~MappedOperatingSystemInfoBitmapIndex() = default;
+    MappedOperatingSystemInfoBitmapIndex(const MappedOperatingSystemInfoBitmapIndex&) = delete;
+    MappedOperatingSystemInfoBitmapIndex(MappedOperatingSystemInfoBitmapIndex&&) = delete;
+    MappedOperatingSystemInfoBitmapIndex& operator=(const MappedOperatingSystemInfoBitmapIndex&) = delete;
+    MappedOperatingSystemInfoBitmapIndex& operator=(MappedOperatingSystemInfoBitmapIndex&&) = delete;
+
+    // Fails for missing, truncated or malformed files.
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const noexcept
+    {
+        return m_File.IsOpen();
+    }
+
+    // Views stay valid until Close.
+    OperatingSystemInfoBitmapView Find(OperatingSystemInfoField field, std::string_view value) const noexcept;
+    OperatingSystemInfoBitmapView Hosts() const noexcept;
+
+private:
+    bool Validate() const noexcept;
+    bool ValidateBitmap(uint64_t offset, uint64_t count) const noexcept;
+    std::string_view GetString(const OperatingSystemInfoBitmapIndexFormat::Value& value) const noexcept;
+
+    MappedFile m_File;
+    const OperatingSystemInfoBitmapIndexFormat::Header* m_Header = nullptr;
+    const OperatingSystemInfoBitmapIndexFormat::Field* m_Fields = nullptr;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "CompactOperatingSystemInfo.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+#include <array>
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+class ThreadPool;
+
+// One changed field. Old and New point into the compared snapshots, which must outlive the change.
+struct OperatingSystemInfoChange
+{
+    OperatingSystemInfoField Field;
+    const std::optional<std::string>* Old;
+    const std::optional<std::string>* New;
+};
+
+// Changes between two snapshots, in field order. Has room for every field so diffing never allocates.
+class OperatingSystemInfoChangeSet
+{
+public:
+    using const_iterator = const OperatingSystemInfoChange*;
+
+    void Clear() noexcept
+    {
+        m_Size = 0;
+        m_Fields = {};
+    }
+
+    void Add(OperatingSystemInfoField field, const std::optional<std::string>& oldValue,
+             const std::optional<std::string>& newValue) noexcept
+    {
+        m_Changes[m_Size++] = {field, &oldValue, &newValue};
+        m_Fields.Set(field);
+    }
+
+    // The changed fields.
+    OperatingSystemInfoFieldMask Fields() const noexcept
+    {
+        return m_Fields;
+    }
+
+    size_t Size() const noexcept
+    {
+        return m_Size;
+    }
+
+    bool Empty() const noexcept
+    {
+        return m_Size == 0;
+    }
+
+    const OperatingSystemInfoChange& operator[](size_t index) const noexcept
+    {
+        return m_Changes[index];
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return m_Changes.data();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return m_Changes.data() + m_Size;
+    }
+
+private:
+    std::array<OperatingSystemInfoChange, OperatingSystemInfoFieldCount> m_Changes;
+    size_t m_Size = 0;
+    OperatingSystemInfoFieldMask m_Fields;
+};
+
+// Fills changes with the fields in fields whose value differs, a value and no value differ too.
+// Returns the number of changes.
+size_t DiffOperatingSystemInfo(const OperatingSystemInfo& previous, const OperatingSystemInfo& current,
+                               OperatingSystemInfoChangeSet& changes,
+                               OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All());
+
+// Same comparison as DiffOperatingSystemInfo, only reporting which fields changed.
+OperatingSystemInfoFieldMask GetChangedFields(const OperatingSystemInfo& previous, const OperatingSystemInfo& current,
+                                              OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All());
+
+// Both records must have been packed by the same pool, the slots are compared without looking at the strings.
+OperatingSystemInfoFieldMask GetChangedFields(const CompactOperatingSystemInfo& previous,
+                                              const CompactOperatingSystemInfo& current,
+                                              OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All()) noexcept;
+
+// Sets the changed fields of target to their new value, ex. on the receiving side of a delta.
+void ApplyOperatingSystemInfoChanges(OperatingSystemInfo& target, const OperatingSystemInfoChangeSet& changes);
+
+// Copies the fields in fields from source to target.
+void ApplyOperatingSystemInfoChanges(OperatingSystemInfo& target, const OperatingSystemInfo& source,
+                                     OperatingSystemInfoFieldMask fields);
+
+struct OperatingSystemInfoBatchDiffStatistics
+{
+    uint64_t Pairs = 0;
+    // Pairs with at least one changed field.
+    uint64_t ChangedPairs = 0;
+    // Changed fields over all pairs.
+    uint64_t ChangedFields = 0;
+    std::chrono::nanoseconds Elapsed{0};
+
+    double PairsPerSecond() const noexcept
+    {
+        return Elapsed.count() > 0 ? Pairs * 1e9 / Elapsed.count() : 0.0;
+    }
+};
+
+// Diffs large sets of (previous, current) pairs, ex. the last and the new snapshot of every host, so that
+// only the pairs and fields which changed need to be forwarded. The pairs are cut into chunks diffed on the pool.
+// While its chunks are pending the calling thread runs queued pool tasks, so Diff may be called from a pool task.
+class OperatingSystemInfoBatchDiff final
+{
+public:
+    // Pairs per pool task, zero means the default.
+    explicit OperatingSystemInfoBatchDiff(ThreadPool& pool, size_t chunkSize = 0) noexcept;
+    ~OperatingSystemInfoBatchDiff() = default;
+    OperatingSystemInfoBatchDiff(const OperatingSystemInfoBatchDiff&) = delete;
+    OperatingSystemInfoBatchDiff(OperatingSystemInfoBatchDiff&&) = delete;
+    OperatingSystemInfoBatchDiff& operator=(const OperatingSystemInfoBatchDiff&) = delete;
+    OperatingSystemInfoBatchDiff& operator=(OperatingSystemInfoBatchDiff&&) = delete;
+
+    // changed[i] receives the fields of pair i which changed. Returns false when the sizes differ.
+    bool Diff(const std::vector<OperatingSystemInfo>& previous, const std::vector<OperatingSystemInfo>& current,
+              std::vector<OperatingSystemInfoFieldMask>& changed,
+              OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All());
+    // Records of both sides must have been packed by the same pool, ex. ids of one inventory resolved with GetCompact.
+    bool Diff(const std::vector<CompactOperatingSystemInfo>& previous,
+              const std::vector<CompactOperatingSystemInfo>& current, std::vector<OperatingSystemInfoFieldMask>& changed,
+              OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All());
+
+    // Statistics of the last diff.
+    const OperatingSystemInfoBatchDiffStatistics& GetStatistics() const noexcept
+    {
+        return m_Statistics;
+    }
+
+private:
+    template <class TRecord>
+    bool DiffAll(const std::vector<TRecord>& previous, const std::vector<TRecord>& current,
+                 std::vector<OperatingSystemInfoFieldMask>& changed, OperatingSystemInfoFieldMask fields);
+
+    ThreadPool& m_Pool;
+    size_t m_ChunkSize;
+    OperatingSystemInfoBatchDiffStatistics m_Statistics;
+};
@@ -2,17 +2,38 @@
 
 #include "IOperatingSystemInfoFetcher.h"
 #include "OperatingSystemInfo.h"
+#include <string>
 #include <vector>
 
 class OperatingSystemInfoFetcher final : public IOperatingSystemInfoFetcher
 {
 public:
     OperatingSystemInfoFetcher() noexcept = default;
+    // Reads an offline SOFTWARE hive file instead of the live registry and WMI, see OfflineOperatingSystemInfoFetcher
+    // which does the same on any platform.
+    explicit OperatingSystemInfoFetcher(std::string softwareHivePath) noexcept;
     ~OperatingSystemInfoFetcher() override = default;
     OperatingSystemInfoFetcher(OperatingSystemInfoFetcher&&) = delete;
     OperatingSystemInfoFetcher(const OperatingSystemInfoFetcher&) = delete;
     OperatingSystemInfoFetcher& operator=(const OperatingSystemInfoFetcher&) = delete;
     OperatingSystemInfoFetcher& operator=(OperatingSystemInfoFetcher&&) = delete;
 
+    // Reports OSLanguage and Locale as BCP-47 tags, ex. "en-US", instead of the LCID in decimal and in hexadecimal.
+    // Values without a known tag are kept as they are. Off by default.
+    void SetLanguageTags(bool enable) noexcept
+    {
+        m_LanguageTags = enable;
+    }
+
     OperatingSystemInfo GetInformation() override;
+    // Skips WMI entirely when no WMI-sourced field is requested and only selects the requested properties.
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields) override;
+    // The deadline bounds the wait for the WMI objects, the registry is read anyway. WMI fields are reported as
+    // timed out when it passed, onLate is not called.
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields, std::chrono::steady_clock::time_point deadline,
+                                       OperatingSystemInfoFieldMask& timedOut, LateFieldsCallback onLate) override;
+
+private:
+    std::string m_SoftwareHivePath;
+    bool m_LanguageTags = false;
 };
@@ -0,0 +1,326 @@
+#pragma once
+
+#include "OperatingSystemInfo.h"
+
+#include <array>
+#include <initializer_list>
+#include <stdint.h>
+#include <string_view>
+#include <utility>
+
+// One enumerator per OperatingSystemInfo member, in declaration order.
+enum class OperatingSystemInfoField : uint32_t
+{
+#define OPERATINGSYSTEMINFO_FIELD(member, source, type) member,
+#include "OperatingSystemInfoFields.inc"
+#undef OPERATINGSYSTEMINFO_FIELD
+    Count
+};
+
+constexpr size_t OperatingSystemInfoFieldCount = static_cast<size_t>(OperatingSystemInfoField::Count);
+
+// Where OperatingSystemInfoFetcher reads a field on Windows.
+enum class OperatingSystemInfoFieldSource : uint8_t
+{
+    // Made out of other fields.
+    Derived,
+    // Win32_OperatingSystem
+    Wmi,
+    // [HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Windows NT\CurrentVersion]
+    Registry
+};
+
+enum class OperatingSystemInfoFieldType : uint8_t
+{
+    String,
+    // Canonical decimal number, ex. "1903" but not "0409".
+    Number
+};
+
+// Set of OperatingSystemInfo fields a caller is interested in.
+class OperatingSystemInfoFieldMask
+{
+public:
+    constexpr OperatingSystemInfoFieldMask() noexcept : m_Bits(0)
+    {
+    }
+
+    constexpr OperatingSystemInfoFieldMask(std::initializer_list<OperatingSystemInfoField> fields) noexcept : m_Bits(0)
+    {
+        for (auto field : fields)
+        {
+            Set(field);
+        }
+    }
+
+    static constexpr OperatingSystemInfoFieldMask All() noexcept
+    {
+        return FromBits((uint32_t{1} << OperatingSystemInfoFieldCount) - 1);
+    }
+
+    static constexpr OperatingSystemInfoFieldMask FromBits(uint32_t bits) noexcept
+    {
+        OperatingSystemInfoFieldMask mask;
+        mask.m_Bits = bits & ((uint32_t{1} << OperatingSystemInfoFieldCount) - 1);
+        return mask;
+    }
+
+    constexpr uint32_t Bits() const noexcept
+    {
+        return m_Bits;
+    }
+
+    constexpr bool Has(OperatingSystemInfoField field) const noexcept
+    {
+        return (m_Bits & Bit(field)) != 0;
+    }
+
+    constexpr bool Intersects(OperatingSystemInfoFieldMask other) const noexcept
+    {
+        return (m_Bits & other.m_Bits) != 0;
+    }
+
+    constexpr bool Contains(OperatingSystemInfoFieldMask other) const noexcept
+    {
+        return (m_Bits & other.m_Bits) == other.m_Bits;
+    }
+
+    constexpr bool Empty() const noexcept
+    {
+        return m_Bits == 0;
+    }
+
+    constexpr OperatingSystemInfoFieldMask& Set(OperatingSystemInfoField field) noexcept
+    {
+        m_Bits |= Bit(field);
+        return *this;
+    }
+
+    constexpr OperatingSystemInfoFieldMask& Reset(OperatingSystemInfoField field) noexcept
+    {
+        m_Bits &= ~Bit(field);
+        return *this;
+    }
+
+    constexpr OperatingSystemInfoFieldMask& operator|=(OperatingSystemInfoFieldMask other) noexcept
+    {
+        m_Bits |= other.m_Bits;
+        return *this;
+    }
+
+    constexpr OperatingSystemInfoFieldMask& operator&=(OperatingSystemInfoFieldMask other) noexcept
+    {
+        m_Bits &= other.m_Bits;
+        return *this;
+    }
+
+    friend constexpr OperatingSystemInfoFieldMask operator|(OperatingSystemInfoFieldMask lhs, OperatingSystemInfoFieldMask rhs) noexcept
+    {
+        return lhs |= rhs;
+    }
+
+    friend constexpr OperatingSystemInfoFieldMask operator&(OperatingSystemInfoFieldMask lhs, OperatingSystemInfoFieldMask rhs) noexcept
+    {
+        return lhs &= rhs;
+    }
+
+    friend constexpr OperatingSystemInfoFieldMask operator~(OperatingSystemInfoFieldMask mask) noexcept
+    {
+        return FromBits(~mask.m_Bits);
+    }
+
+    friend constexpr bool operator==(OperatingSystemInfoFieldMask lhs, OperatingSystemInfoFieldMask rhs) noexcept
+    {
+        return lhs.m_Bits == rhs.m_Bits;
+    }
+
+    friend constexpr bool operator!=(OperatingSystemInfoFieldMask lhs, OperatingSystemInfoFieldMask rhs) noexcept
+    {
+        return lhs.m_Bits != rhs.m_Bits;
+    }
+
+private:
+    static constexpr uint32_t Bit(OperatingSystemInfoField field) noexcept
+    {
+        return uint32_t{1} << static_cast<uint32_t>(field);
+    }
+
+    uint32_t m_Bits;
+};
+
+
+// Compile-time description of an OperatingSystemInfo member, generated from OperatingSystemInfoFields.inc.
+struct OperatingSystemInfoFieldDescriptor
+{
+    OperatingSystemInfoField Field;
+    // Member name, used as key by the text formats.
+    std::string_view Name;
+    std::optional<std::string> OperatingSystemInfo::*Member;
+    OperatingSystemInfoFieldSource Source;
+    OperatingSystemInfoFieldType Type;
+
+    std::optional<std::string>& Get(OperatingSystemInfo& info) const noexcept
+    {
+        return info.*Member;
+    }
+
+    const std::optional<std::string>& Get(const OperatingSystemInfo& info) const noexcept
+    {
+        return info.*Member;
+    }
+};
+
+// Descriptor of each field, indexed by OperatingSystemInfoField.
+constexpr std::array<OperatingSystemInfoFieldDescriptor, OperatingSystemInfoFieldCount> s_OperatingSystemInfoFields{{
+#define OPERATINGSYSTEMINFO_FIELD(member, source, type)                                                                 \
+    {OperatingSystemInfoField::member, #member, &OperatingSystemInfo::member, OperatingSystemInfoFieldSource::source,    \
+     OperatingSystemInfoFieldType::type},
+#include "OperatingSystemInfoFields.inc"
+#undef OPERATINGSYSTEMINFO_FIELD
+}};
+
+// Catches a member added to OperatingSystemInfo without its row in OperatingSystemInfoFields.inc.
+static_assert(sizeof(OperatingSystemInfo) == OperatingSystemInfoFieldCount * sizeof(std::optional<std::string>),
+              "Every OperatingSystemInfo member needs a row in OperatingSystemInfoFields.inc");
+static_assert(OperatingSystemInfoFieldCount <= 32, "OperatingSystemInfoFieldMask holds 32 fields");
+
+namespace detail
+{
+template <typename Visitor, size_t... Indices>
+constexpr void VisitFields(Visitor& visitor, std::index_sequence<Indices...>)
+{
+    (visitor(s_OperatingSystemInfoFields[Indices]), ...);
+}
+
+template <typename Predicate, size_t... Indices>
+constexpr bool MatchFields(Predicate& predicate, std::index_sequence<Indices...>)
+{
+    return (predicate(s_OperatingSystemInfoFields[Indices]) && ...);
+}
+} // namespace detail
+
+// Calls visitor with the descriptor of every field in declaration order. The calls are unrolled, so each one sees
+// its descriptor as a constant and member accesses compile to fixed offsets.
+template <typename Visitor>
+constexpr void ForEachField(Visitor&& visitor)
+{
+    detail::VisitFields(visitor, std::make_index_sequence<OperatingSystemInfoFieldCount>());
+}
+
+// Like ForEachField, stopping at the first field for which predicate returns false.
+template <typename Predicate>
+constexpr bool AllOfFields(Predicate&& predicate)
+{
+    return detail::MatchFields(predicate, std::make_index_sequence<OperatingSystemInfoFieldCount>());
+}
+
+constexpr const OperatingSystemInfoFieldDescriptor& GetFieldDescriptor(OperatingSystemInfoField field)
+{
+    return s_OperatingSystemInfoFields[static_cast<size_t>(field)];
+}
+
+inline std::optional<std::string>& GetField(OperatingSystemInfo& info, OperatingSystemInfoField field)
+{
+    return GetFieldDescriptor(field).Get(info);
+}
+
+inline const std::optional<std::string>& GetField(const OperatingSystemInfo& info, OperatingSystemInfoField field)
+{
+    return GetFieldDescriptor(field).Get(info);
+}
+
+constexpr std::string_view GetFieldName(OperatingSystemInfoField field)
+{
+    return GetFieldDescriptor(field).Name;
+}
+
+// Case-sensitive lookup of a member name.
+constexpr bool FindField(std::string_view name, OperatingSystemInfoField& field)
+{
+    for (const auto& descriptor : s_OperatingSystemInfoFields)
+    {
+        if (descriptor.Name == name)
+        {
+            field = descriptor.Field;
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr OperatingSystemInfoFieldMask GetSourceFields(OperatingSystemInfoFieldSource source)
+{
+    OperatingSystemInfoFieldMask fields;
+    for (const auto& descriptor : s_OperatingSystemInfoFields)
+    {
+        if (descriptor.Source == source)
+        {
+            fields.Set(descriptor.Field);
+        }
+    }
+    return fields;
+}
+
+constexpr OperatingSystemInfoFieldMask GetTypeFields(OperatingSystemInfoFieldType type)
+{
+    OperatingSystemInfoFieldMask fields;
+    for (const auto& descriptor : s_OperatingSystemInfoFields)
+    {
+        if (descriptor.Type == type)
+        {
+            fields.Set(descriptor.Field);
+        }
+    }
+    return fields;
+}
+
+inline bool operator==(const OperatingSystemInfo& lhs, const OperatingSystemInfo& rhs)
+{
+    return AllOfFields([&](const OperatingSystemInfoFieldDescriptor& field) { return field.Get(lhs) == field.Get(rhs); });
+}
+
+inline bool operator!=(const OperatingSystemInfo& lhs, const OperatingSystemInfo& rhs)
+{
+    return !(lhs == rhs);
+}
+
+// 64-bit FNV-1a of the fields, stable across processes and platforms. A missing field and an empty one differ.
+inline uint64_t HashOperatingSystemInfo(const OperatingSystemInfo& info) noexcept
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        const auto& value = field.Get(info);
+        uint64_t length = ~uint64_t{0};
+        if (value)
+        {
+            for (char c : *value)
+            {
+                mix(static_cast<unsigned char>(c));
+            }
+            length = value->size();
+        }
+        // The length ends the value, so that moving characters across fields changes the hash.
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            mix(static_cast<unsigned char>(length >> shift));
+        }
+    });
+    // Final avalanche so that the low bits are usable as bucket index.
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// For unordered containers of OperatingSystemInfo.
+struct OperatingSystemInfoHash
+{
+    size_t operator()(const OperatingSystemInfo& info) const noexcept
+    {
+        return static_cast<size_t>(HashOperatingSystemInfo(info));
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CompactOperatingSystemInfo.h"
+
+#include <chrono>
+#include <iosfwd>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// Parses one line of the snapshot stream: a flat JSON object whose keys are OperatingSystemInfo member
+// names, ex. {"Caption":"Microsoft Windows 10 Pro","UBR":"1234"}. Numbers and booleans are kept as their
+// text, null and unknown keys are ignored. Values point into line, or into scratch for strings with escapes.
+// Returns false for anything which is not a single JSON object.
+bool ParseOperatingSystemInfoLine(std::string_view line, OperatingSystemInfoView& result, std::string& scratch);
+
+struct OperatingSystemInfoIngestionOptions
+{
+    // Bytes read per chunk, a chunk only grows beyond this for a longer line.
+    size_t ChunkSize = 4 << 20;
+    // Chunks read and not merged yet, memory in use stays around ChunksInFlight * ChunkSize.
+    // Zero means two per pool thread.
+    size_t ChunksInFlight = 0;
+    // Stores OSLanguage and Locale LCIDs as BCP-47 tags, ex. "1033" and "0409" as "en-US", see LanguageTags.h.
+    bool LanguageTags = false;
+};
+
+struct OperatingSystemInfoIngestionStage
+{
+    uint64_t Bytes = 0;
+    // Time spent in the stage, summed over the threads running it.
+    std::chrono::nanoseconds Busy{0};
+
+    double MegabytesPerSecond() const noexcept
+    {
+        return Busy.count() > 0 ? Bytes * 1e3 / Busy.count() : 0.0;
+    }
+};
+
+struct OperatingSystemInfoIngestionStatistics
+{
+    // Reading the input, on the calling thread.
+    OperatingSystemInfoIngestionStage Read;
+    // Splitting lines, parsing and interning into a chunk-local inventory, on the pool.
+    OperatingSystemInfoIngestionStage Parse;
+    // Merging chunk-local records into the destination inventory, in input order.
+    OperatingSystemInfoIngestionStage Merge;
+
+    uint64_t Lines = 0;
+    uint64_t Records = 0;
+    uint64_t Malformed = 0;
+    std::chrono::nanoseconds Elapsed{0};
+
+    double MegabytesPerSecond() const noexcept
+    {
+        return Elapsed.count() > 0 ? Read.Bytes * 1e3 / Elapsed.count() : 0.0;
+    }
+};
+
+// Streams line-delimited snapshots (see ParseOperatingSystemInfoLine) into an inventory.
+// The input is cut into chunks at line boundaries, chunks are parsed in parallel on the pool into
+// chunk-local inventories, and those are merged into the destination in input order.
+// Blank lines are skipped, malformed lines are counted and skipped.
+class OperatingSystemInfoIngestion final
+{
+public:
+    OperatingSystemInfoIngestion(ThreadPool& pool, OperatingSystemInfoIngestionOptions options = {}) noexcept;
+    ~OperatingSystemInfoIngestion() = default;
+    OperatingSystemInfoIngestion(const OperatingSystemInfoIngestion&) = delete;
+    OperatingSystemInfoIngestion(OperatingSystemInfoIngestion&&) = delete;
+    OperatingSystemInfoIngestion& operator=(const OperatingSystemInfoIngestion&) = delete;
+    OperatingSystemInfoIngestion& operator=(OperatingSystemInfoIngestion&&) = delete;
+
+    // recordIds, when given, receives the inventory id of every valid line in input order.
+    // Returns false when the input could not be opened or read, what was read before is still ingested.
+    bool IngestFile(const char* path, OperatingSystemInfoInventory& inventory, std::vector<uint32_t>* recordIds = nullptr);
+    bool Ingest(std::istream& input, OperatingSystemInfoInventory& inventory, std::vector<uint32_t>* recordIds = nullptr);
+
+    // Statistics of the last ingestion.
+    const OperatingSystemInfoIngestionStatistics& GetStatistics() const noexcept
+    {
+        return m_Statistics;
+    }
+
+private:
+    ThreadPool& m_Pool;
+    OperatingSystemInfoIngestionOptions m_Options;
+    OperatingSystemInfoIngestionStatistics m_Statistics;
+};
@@ -1,15 +1,43 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <stdint.h>
 #include <vector>
 #include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
 
 class IOperatingSystemInfoFetcher;
 
+struct OperatingSystemInfoCacheStatistics
+{
+    // Calls answered from the cached snapshot.
+    uint64_t Hits = 0;
+    // Calls which found no fresh snapshot covering the requested fields. Concurrent misses share one fetch.
+    uint64_t Misses = 0;
+    // Calls made to the fetcher.
+    uint64_t Refreshes = 0;
+    // Calls which returned with timed out fields.
+    uint64_t TimedOut = 0;
+    // Values which arrived after their call had returned and were added to the cached snapshot.
+    uint64_t LateUpdates = 0;
+};
+
 class OperatingSystemInfoProvider final
 {
 public:
+    // Value of the requested fields which were not fetched by the deadline.
+    static constexpr char TimedOutValue[] = "Timed out";
+
+    // Every GetInformation call goes to the fetcher.
     OperatingSystemInfoProvider(std::unique_ptr<IOperatingSystemInfoFetcher> fetcher) noexcept;
+    // Results are cached for timeToLive and the provider may be used from any number of threads.
+    // The fetcher is never called by two threads at once. A zero timeToLive disables the cache.
+    OperatingSystemInfoProvider(std::unique_ptr<IOperatingSystemInfoFetcher> fetcher,
+                                std::chrono::steady_clock::duration timeToLive) noexcept;
     ~OperatingSystemInfoProvider();
     OperatingSystemInfoProvider(OperatingSystemInfoProvider&&) = delete;
     OperatingSystemInfoProvider(const OperatingSystemInfoProvider&) = delete;
@@ -17,7 +45,59 @@ public:
     OperatingSystemInfoProvider& operator=(OperatingSystemInfoProvider&&) = delete;
 
     OperatingSystemInfo GetInformation();
+    // Only the requested fields are fetched and filled, the others are left empty.
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields);
+    // Returns by deadline with the fields fetched in time, the others are set to TimedOutValue and added to timedOut
+    // when given. The fetcher runs the sources with their own budgets, ex. CompositeOperatingSystemInfoFetcher,
+    // a fetcher which cannot give up makes the call wait for it. Values arriving after the deadline are added
+    // to the cached snapshot, so the next call finds them.
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields, std::chrono::steady_clock::time_point deadline,
+                                       OperatingSystemInfoFieldMask* timedOut = nullptr);
+
+    // Drops the cached snapshot, the next call fetches again. A fetch already in flight is not published.
+    void Invalidate();
+
+    OperatingSystemInfoCacheStatistics GetCacheStatistics() const noexcept;
 
 private:
+    struct Snapshot;
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+
+    OperatingSystemInfo GetCachedInformation(OperatingSystemInfoFieldMask fields,
+                                             std::chrono::steady_clock::time_point deadline,
+                                             OperatingSystemInfoFieldMask& timedOut);
+    SnapshotPtr FetchSnapshot(OperatingSystemInfoFieldMask fields, std::chrono::steady_clock::time_point deadline,
+                              uint64_t generation, uint64_t refresh) noexcept;
+    void AddLateFields(uint64_t generation, uint64_t refresh, const OperatingSystemInfo& info,
+                       OperatingSystemInfoFieldMask fields);
+    void Publish(SnapshotPtr snapshot);
+    void WaitForReaders();
+
     std::unique_ptr<IOperatingSystemInfoFetcher> m_Fetcher;
-};
\ No newline at end of file
+    std::chrono::steady_clock::duration m_TimeToLive;
+
+    // Snapshot read on a hit, wait-free: a reader counts itself in m_Readers[m_ReaderEpoch & 1] while it copies
+    // out of it and never takes m_RefreshMutex. Publish frees the replaced snapshot once both counts drained.
+    std::atomic<const Snapshot*> m_Snapshot{nullptr};
+    std::atomic<uint64_t> m_ReaderEpoch{0};
+    std::atomic<uint32_t> m_Readers[2]{};
+
+    // Guards the in-flight fetch, the generation, the late values and the owner of m_Snapshot.
+    std::mutex m_RefreshMutex;
+    SnapshotPtr m_Published;
+    std::shared_future<SnapshotPtr> m_Refresh;
+    OperatingSystemInfoFieldMask m_RefreshFields;
+    uint64_t m_Generation = 0;
+    // Id of the last fetch, a snapshot takes the id of the fetch which made it.
+    uint64_t m_LastRefresh = 0;
+    // Late values of a fetch whose snapshot is not published yet.
+    OperatingSystemInfo m_LateInfo;
+    OperatingSystemInfoFieldMask m_LateFields;
+    uint64_t m_LateRefresh = 0;
+
+    std::atomic<uint64_t> m_Hits{0};
+    std::atomic<uint64_t> m_Misses{0};
+    std::atomic<uint64_t> m_Refreshes{0};
+    std::atomic<uint64_t> m_TimedOut{0};
+    std::atomic<uint64_t> m_LateUpdates{0};
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "CompactOperatingSystemInfo.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+// Binary record of one OperatingSystemInfo, read in place without deserialization.
+// All integers are little-endian, offsets are relative to the start of the record:
+//
+//   0   uint32  Magic "OSIR"
+//   4   uint16  Version (1)
+//   6   uint16  FieldCount, number of End entries
+//   8   uint32  Size of the whole record including padding, a multiple of 4
+//   12  uint32  Present, bit i set when field i has a value
+//   16  uint32  End[FieldCount], end of the string of field i relative to the string area
+//   ..  char    string area, field i spans [End[i - 1], End[i]) (End[-1] = 0), no terminators
+//   ..  padding to a multiple of 4, so consecutive records stay aligned
+//
+// Fields are in OperatingSystemInfoField order. Newer writers may only append fields, readers
+// ignore the ones they don't know and treat fields missing from an older record as absent.
+struct OperatingSystemInfoRecordFormat
+{
+    static constexpr uint32_t Magic = 0x5249534F; // "OSIR"
+    static constexpr uint16_t Version = 1;
+    static constexpr size_t HeaderSize = 16;
+    static constexpr size_t Alignment = 4;
+};
+
+// Accessors over one record in a caller-owned buffer, ex. a MappedFile. Views stay valid as long as the buffer.
+class OperatingSystemInfoRecordView final
+{
+public:
+    OperatingSystemInfoRecordView() noexcept = default;
+
+    // Validates the record at the start of data. On success Size() is the number of bytes it occupies.
+    bool Parse(const std::byte* data, size_t size) noexcept;
+
+    size_t Size() const noexcept
+    {
+        return m_Size;
+    }
+
+    OperatingSystemInfoFieldMask Present() const noexcept
+    {
+        return m_Present;
+    }
+
+    bool Has(OperatingSystemInfoField field) const noexcept
+    {
+        return m_Present.Has(field);
+    }
+
+    // Empty for absent fields, use Has to tell them from empty values.
+    std::string_view Get(OperatingSystemInfoField field) const noexcept;
+
+    OperatingSystemInfo ToOperatingSystemInfo() const;
+    OperatingSystemInfoView ToView() const noexcept;
+
+private:
+    uint32_t End(size_t index) const noexcept;
+
+    const std::byte* m_Data = nullptr;
+    size_t m_Size = 0;
+    size_t m_FieldCount = 0;
+    OperatingSystemInfoFieldMask m_Present;
+};
+
+// Iterates the records stored back to back in a buffer.
+class OperatingSystemInfoRecordReader final
+{
+public:
+    OperatingSystemInfoRecordReader(const std::byte* data, size_t size) noexcept : m_Data(data), m_Size(size), m_Offset(0), m_Failed(false)
+    {
+    }
+
+    // Returns false at the end of the buffer or at the first invalid record, see Failed().
+    bool Next(OperatingSystemInfoRecordView& record) noexcept
+    {
+        if (m_Failed || m_Offset == m_Size)
+        {
+            return false;
+        }
+        if (!record.Parse(m_Data + m_Offset, m_Size - m_Offset))
+        {
+            m_Failed = true;
+            return false;
+        }
+        m_Offset += record.Size();
+        return true;
+    }
+
+    bool Failed() const noexcept
+    {
+        return m_Failed;
+    }
+
+private:
+    const std::byte* m_Data;
+    size_t m_Size;
+    size_t m_Offset;
+    bool m_Failed;
+};
+
+// Appends records to a buffer which is kept across Clear(), so steady-state writing does not allocate.
+class OperatingSystemInfoRecordWriter final
+{
+public:
+    OperatingSystemInfoRecordWriter() = default;
+    ~OperatingSystemInfoRecordWriter() = default;
+    OperatingSystemInfoRecordWriter(const OperatingSystemInfoRecordWriter&) = delete;
+    OperatingSystemInfoRecordWriter(OperatingSystemInfoRecordWriter&&) = delete;
+    OperatingSystemInfoRecordWriter& operator=(const OperatingSystemInfoRecordWriter&) = delete;
+    OperatingSystemInfoRecordWriter& operator=(OperatingSystemInfoRecordWriter&&) = delete;
+
+    // Returns the size of the appended record.
+    size_t Append(const OperatingSystemInfo& info);
+    size_t Append(const OperatingSystemInfoView& info);
+
+    void Clear() noexcept
+    {
+        m_Buffer.clear();
+    }
+
+    const std::byte* Data() const noexcept
+    {
+        return m_Buffer.data();
+    }
+
+    size_t Size() const noexcept
+    {
+        return m_Buffer.size();
+    }
+
+private:
+    std::vector<std::byte> m_Buffer;
+};
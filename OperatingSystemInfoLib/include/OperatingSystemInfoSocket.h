@@ -0,0 +1,225 @@
+#pragma once
+
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+#include "OperatingSystemInfoRecord.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class OperatingSystemInfoProvider;
+class ThreadPool;
+
+// Protocol of OperatingSystemInfoServer over a Unix domain stream socket, Linux only. Integers are in host byte
+// order, both ends run on the same host. Clients may send requests back to back without waiting for the
+// responses, which come back in any order with the Id of their request:
+//
+// Request
+//   0   uint32  Magic "OSQ1"
+//   4   uint32  Id, chosen by the client
+//   8   uint32  Fields, OperatingSystemInfoFieldMask bits, unknown fields are ignored
+//
+// Response
+//   0   uint32  Id of the request
+//   4   uint32  Status
+//   8   uint32  Size of the OperatingSystemInfoRecord which follows, zero unless Status is Ok
+//
+// A request with another magic gets a BadRequest response, after which the server closes the connection.
+// Requests are answered by the provider's GetInformation(Fields), fields it could not get are absent.
+struct OperatingSystemInfoSocketFormat
+{
+    static constexpr uint32_t RequestMagic = 0x3151534F; // "OSQ1"
+    static constexpr size_t RequestSize = 12;
+    static constexpr size_t ResponseHeaderSize = 12;
+    // Larger records are a broken stream rather than a response.
+    static constexpr uint32_t MaxRecordSize = 1 << 20;
+
+    enum Status : uint32_t
+    {
+        Ok = 0,
+        BadRequest = 1,
+        // The provider call failed.
+        Failed = 2,
+    };
+};
+
+struct OperatingSystemInfoServerOptions
+{
+    // Responses are kept per field mask for this long, requests in that time are answered by the event loop
+    // without calling the provider. Zero disables the cache.
+    std::chrono::steady_clock::duration TimeToLive = std::chrono::seconds(1);
+    // Threads calling the provider, so that a slow fetch does not hold up the event loop.
+    size_t FetchThreads = 2;
+};
+
+struct OperatingSystemInfoServerStatistics
+{
+    uint64_t Connections = 0;
+    uint64_t Requests = 0;
+    // Requests answered from the cached response of their field mask.
+    uint64_t CacheHits = 0;
+    // Requests which joined the provider call of an earlier request with the same field mask.
+    uint64_t Coalesced = 0;
+    // Calls made to the provider.
+    uint64_t Fetches = 0;
+    // Event loop iterations which received requests. Requests/Batches is the mean batch size.
+    uint64_t Batches = 0;
+    uint64_t BadRequests = 0;
+    // Connections closed right after being accepted because the server was out of descriptors.
+    uint64_t Refused = 0;
+};
+
+// Serves the snapshots of a provider to local processes. One thread runs an epoll loop over the listening
+// socket and every connection: it reads all the requests which arrived, then answers them as one batch.
+// Requests of a batch with the same field mask share one response, taken from the cache when it is fresh,
+// from one provider call otherwise. Requests arriving while that call runs wait for it too.
+class OperatingSystemInfoServer final
+{
+public:
+    // The server does not own provider, it only keeps a reference. The caller keeps provider alive until
+    // the server is destroyed, the destructor stops the server and waits for the provider calls in flight.
+    explicit OperatingSystemInfoServer(OperatingSystemInfoProvider& provider, OperatingSystemInfoServerOptions options = {});
+    ~OperatingSystemInfoServer();
+    OperatingSystemInfoServer(const OperatingSystemInfoServer&) = delete;
+    OperatingSystemInfoServer(OperatingSystemInfoServer&&) = delete;
+    OperatingSystemInfoServer& operator=(const OperatingSystemInfoServer&) = delete;
+    OperatingSystemInfoServer& operator=(OperatingSystemInfoServer&&) = delete;
+
+    // Listens on path, replacing a socket file left by a previous server, and starts the event loop.
+    bool Start(const std::string& path);
+    // Closes every connection and removes the socket file. Provider calls in flight are waited for.
+    void Stop();
+
+    bool IsRunning() const noexcept
+    {
+        return m_Thread.joinable();
+    }
+
+    OperatingSystemInfoServerStatistics GetStatistics() const noexcept;
+
+private:
+    struct Connection;
+    struct Fetch;
+    struct Pending
+    {
+        uint64_t Connection;
+        uint32_t Id;
+        uint32_t Fields;
+    };
+    struct CachedResponse
+    {
+        // Response with a zero Id, patched for each request.
+        std::vector<std::byte> Bytes;
+        std::chrono::steady_clock::time_point Expires;
+    };
+
+    void Run();
+    void Accept();
+    void Refuse();
+    void Receive(Connection& connection);
+    void Dispatch();
+    void Complete();
+    void Respond(uint64_t connection, uint32_t id, const std::vector<std::byte>& response);
+    void Flush(Connection& connection);
+    void Close(uint64_t connection);
+    void CloseAll();
+
+    OperatingSystemInfoProvider& m_Provider;
+    OperatingSystemInfoServerOptions m_Options;
+    std::string m_Path;
+    int m_Listener = -1;
+    int m_Epoll = -1;
+    // Signaled by the fetch threads when a response is ready, and by Stop.
+    int m_Wakeup = -1;
+    // Kept open to be given up when out of descriptors, see Refuse.
+    int m_Reserve = -1;
+    // The listener is not polled until a connection closes, when Refuse could not get its reserve back.
+    bool m_ListenerPaused = false;
+    std::atomic<bool> m_Stopping{false};
+    std::thread m_Thread;
+
+    // Owned by the event loop thread. Connections are keyed by an id which is never reused, so that a response
+    // for a closed connection cannot reach a new one with the same descriptor.
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> m_Connections;
+    uint64_t m_NextConnection = 0;
+    std::vector<Pending> m_Pending;
+    std::vector<uint64_t> m_Dirty;
+    std::unordered_map<uint32_t, CachedResponse> m_Cache;
+    std::unordered_map<uint32_t, std::unique_ptr<Fetch>> m_Fetches;
+
+    // Responses made by the fetch threads, waiting for the event loop.
+    std::mutex m_CompletedMutex;
+    std::vector<std::pair<uint32_t, std::vector<std::byte>>> m_Completed;
+
+    std::atomic<uint64_t> m_ConnectionCount{0};
+    std::atomic<uint64_t> m_Requests{0};
+    std::atomic<uint64_t> m_CacheHits{0};
+    std::atomic<uint64_t> m_Coalesced{0};
+    std::atomic<uint64_t> m_FetchCount{0};
+    std::atomic<uint64_t> m_Batches{0};
+    std::atomic<uint64_t> m_BadRequests{0};
+    std::atomic<uint64_t> m_Refused{0};
+
+    // Declared last so that it is destroyed first, its tasks use the members above.
+    std::unique_ptr<ThreadPool> m_Pool;
+};
+
+// Connection to an OperatingSystemInfoServer. Query is a blocking round trip. Send and TryReceive let one
+// thread keep requests in flight on many clients, ex. from its own epoll loop over Socket(). Not thread safe.
+class OperatingSystemInfoClient final
+{
+public:
+    OperatingSystemInfoClient() noexcept = default;
+    ~OperatingSystemInfoClient()
+    {
+        Close();
+    }
+
+    OperatingSystemInfoClient(const OperatingSystemInfoClient&) = delete;
+    OperatingSystemInfoClient(OperatingSystemInfoClient&&) = delete;
+    OperatingSystemInfoClient& operator=(const OperatingSystemInfoClient&) = delete;
+    OperatingSystemInfoClient& operator=(OperatingSystemInfoClient&&) = delete;
+
+    bool Connect(const std::string& path);
+    void Close() noexcept;
+
+    bool IsConnected() const noexcept
+    {
+        return m_Socket != -1;
+    }
+
+    int Socket() const noexcept
+    {
+        return m_Socket;
+    }
+
+    // Only the requested fields are filled. Fails, closing the connection, when it broke or the server
+    // could not answer.
+    bool Query(OperatingSystemInfoFieldMask fields, OperatingSystemInfo& info);
+
+    bool Send(uint32_t id, OperatingSystemInfoFieldMask fields);
+    // Waits for the next response, record views it until the next call.
+    bool Receive(uint32_t& id, OperatingSystemInfoRecordView& record);
+    // Same without waiting: false when no complete response arrived yet, or when the connection failed and
+    // was closed, see IsConnected().
+    bool TryReceive(uint32_t& id, OperatingSystemInfoRecordView& record);
+
+private:
+    // Parses the next response out of the buffer. Closes the connection when it is malformed.
+    bool Parse(uint32_t& id, OperatingSystemInfoRecordView& record);
+    // Reads once from the socket, returns false when the connection was closed.
+    bool Fill(bool wait);
+
+    int m_Socket = -1;
+    std::vector<std::byte> m_Input;
+    // Bytes of m_Input consumed by the responses already returned.
+    size_t m_Consumed = 0;
+};
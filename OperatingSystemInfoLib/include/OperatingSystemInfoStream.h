@@ -0,0 +1,8 @@
+#pragma once
+
+#include "OperatingSystemInfo.h"
+
+#include <ostream>
+
+// Writes one "Name = value" line per field which has a value, in declaration order.
+std::ostream& operator<<(std::ostream& out, const OperatingSystemInfo& info);
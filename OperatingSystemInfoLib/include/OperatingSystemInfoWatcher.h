@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "IChangeSource.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+
+class OperatingSystemInfoProvider;
+
+struct OperatingSystemInfoWatcherStatistics
+{
+    // Notifications received from the sources.
+    uint64_t Notifications = 0;
+    // Snapshots fetched after a notification, the notifications within one settle delay share one.
+    uint64_t Refreshes = 0;
+    // Refreshes which found a different snapshot and called the subscribers.
+    uint64_t Published = 0;
+};
+
+// Refreshes a provider when one of its sources changes instead of on a timer. On a notification the cached
+// snapshot of the provider is invalidated and fetched again, and the subscribers are called with the new
+// snapshot when it differs from the previous one. Notifications are coalesced for a settle delay first,
+// an update usually rewrites several values or files in a row.
+//
+// The sources are set up before Start. The subscribers are called on the watcher's thread, one at a time,
+// and must not call Subscribe or Unsubscribe. The provider must outlive the watcher.
+class OperatingSystemInfoWatcher final
+{
+public:
+    using Callback = std::function<void(const OperatingSystemInfo& info)>;
+
+    OperatingSystemInfoWatcher(OperatingSystemInfoProvider& provider,
+                               OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All(),
+                               std::chrono::steady_clock::duration settleDelay = std::chrono::milliseconds(100)) noexcept;
+    ~OperatingSystemInfoWatcher();
+    OperatingSystemInfoWatcher(OperatingSystemInfoWatcher&&) = delete;
+    OperatingSystemInfoWatcher(const OperatingSystemInfoWatcher&) = delete;
+    OperatingSystemInfoWatcher& operator=(const OperatingSystemInfoWatcher&) = delete;
+    OperatingSystemInfoWatcher& operator=(OperatingSystemInfoWatcher&&) = delete;
+
+    void AddSource(std::unique_ptr<IChangeSource> source);
+
+    // Reads the first snapshot and starts every source. Fails when a source cannot be started.
+    bool Start();
+    // Stops the sources, then waits for a refresh in progress.
+    void Stop();
+
+    // Returns the id for Unsubscribe. A callback is not called anymore once Unsubscribe returns.
+    size_t Subscribe(Callback callback);
+    void Unsubscribe(size_t subscription);
+
+    // The last snapshot read, the fields not requested are left empty.
+    OperatingSystemInfo GetInformation() const;
+
+    OperatingSystemInfoWatcherStatistics GetStatistics() const noexcept;
+
+private:
+    void OnChange();
+    void Run();
+    void Refresh();
+
+    OperatingSystemInfoProvider& m_Provider;
+    OperatingSystemInfoFieldMask m_Fields;
+    std::chrono::steady_clock::duration m_SettleDelay;
+    std::vector<std::unique_ptr<IChangeSource>> m_Sources;
+    std::thread m_Thread;
+
+    // Guards the change flag between the sources and the watcher's thread.
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeUp;
+    bool m_Changed = false;
+    bool m_Stopping = false;
+
+    mutable std::mutex m_InfoMutex;
+    OperatingSystemInfo m_Info;
+
+    // Held while the subscribers are called.
+    std::mutex m_SubscribersMutex;
+    std::vector<std::pair<size_t, Callback>> m_Subscribers;
+    size_t m_NextSubscription = 0;
+
+    std::atomic<uint64_t> m_Notifications{0};
+    std::atomic<uint64_t> m_Refreshes{0};
+    std::atomic<uint64_t> m_Published{0};
+};
+
+// The source telling when the live OperatingSystemInfo of this machine may have changed:
+// the CurrentVersion registry key on Windows, /etc/os-release and /usr/lib/os-release elsewhere.
+// Use a FileChangeSource on the hive file to watch an offline SOFTWARE hive.
+std::unique_ptr<IChangeSource> CreateSystemChangeSource();
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "CompactOperatingSystemInfo.h"
+#include "OperatingSystemInfo.h"
+#include "Utf16Transcoder.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Windows version as one 64-bit integer: major, minor, build and UBR in 16 bits each, from the most significant
+// down, so that versions compare as integers. 10.0.19041.1234 is 0x000A'0000'4A61'04D2. Zero is "no version".
+struct OperatingSystemVersion
+{
+    static constexpr OperatingSystemVersion Make(uint16_t major, uint16_t minor, uint16_t build, uint16_t ubr) noexcept
+    {
+        return {(uint64_t{major} << 48) | (uint64_t{minor} << 32) | (uint64_t{build} << 16) | ubr};
+    }
+
+    constexpr uint16_t Major() const noexcept
+    {
+        return static_cast<uint16_t>(Packed >> 48);
+    }
+
+    constexpr uint16_t Minor() const noexcept
+    {
+        return static_cast<uint16_t>(Packed >> 32);
+    }
+
+    constexpr uint16_t Build() const noexcept
+    {
+        return static_cast<uint16_t>(Packed >> 16);
+    }
+
+    constexpr uint16_t UBR() const noexcept
+    {
+        return static_cast<uint16_t>(Packed);
+    }
+
+    constexpr bool IsValid() const noexcept
+    {
+        return Packed != 0;
+    }
+
+    // "10.0.19041.1234"
+    std::string ToString() const;
+
+    friend constexpr bool operator==(OperatingSystemVersion lhs, OperatingSystemVersion rhs) noexcept
+    {
+        return lhs.Packed == rhs.Packed;
+    }
+
+    friend constexpr bool operator!=(OperatingSystemVersion lhs, OperatingSystemVersion rhs) noexcept
+    {
+        return lhs.Packed != rhs.Packed;
+    }
+
+    friend constexpr bool operator<(OperatingSystemVersion lhs, OperatingSystemVersion rhs) noexcept
+    {
+        return lhs.Packed < rhs.Packed;
+    }
+
+    friend constexpr bool operator<=(OperatingSystemVersion lhs, OperatingSystemVersion rhs) noexcept
+    {
+        return lhs.Packed <= rhs.Packed;
+    }
+
+    friend constexpr bool operator>(OperatingSystemVersion lhs, OperatingSystemVersion rhs) noexcept
+    {
+        return lhs.Packed > rhs.Packed;
+    }
+
+    friend constexpr bool operator>=(OperatingSystemVersion lhs, OperatingSystemVersion rhs) noexcept
+    {
+        return lhs.Packed >= rhs.Packed;
+    }
+
+    uint64_t Packed = 0;
+};
+
+// Parses "major.minor[.build[.ubr]]", ex. the Version field "10.0.19041" or CurrentVersion "6.3". Missing
+// components are zero. Fails for anything else, for components above 65535 and for "0.0".
+bool ParseOperatingSystemVersion(std::string_view text, OperatingSystemVersion& version) noexcept;
+
+// Parses a column of version strings like ParseOperatingSystemVersion, failures give an invalid version.
+// Returns the number of valid ones. With AVX2, strings of up to 16 characters, ex. "10.0.19041.1234", are checked
+// 16 bytes at a time and their four components are converted at once. Longer ones go through the scalar parser,
+// as does everything at lower levels: SSE2 has no per-lane shifts to align the components, and converting them
+// one by one is not faster than the scalar parser.
+size_t ParseOperatingSystemVersions(const std::string_view* texts, size_t count, OperatingSystemVersion* versions) noexcept;
+// Levels above GetSupportedSimdLevel() run at the supported level.
+size_t ParseOperatingSystemVersions(const std::string_view* texts, size_t count, OperatingSystemVersion* versions,
+                                    SimdLevel level) noexcept;
+
+// Version of a snapshot: major and minor from CurrentMajorVersionNumber and CurrentMinorVersionNumber, build from
+// CurrentBuildNumber, UBR from UBR (zero when missing). Versions before Windows 10 have no version numbers,
+// major and minor then come from Version or CurrentVersion, as does the build when CurrentBuildNumber is missing.
+// Fails when no major, minor and build could be found.
+bool GetOperatingSystemVersion(const OperatingSystemInfoView& info, OperatingSystemVersion& version) noexcept;
+bool GetOperatingSystemVersion(const OperatingSystemInfo& info, OperatingSystemVersion& version) noexcept;
+// Numbers inlined in the record are read as they are, without parsing.
+bool GetOperatingSystemVersion(const CompactOperatingSystemInfo& info, const OperatingSystemInfoStringPool& strings,
+                               OperatingSystemVersion& version) noexcept;
+
+// Snapshots whose version is in a range, see OperatingSystemVersionIndex.
+struct OperatingSystemVersionMatches
+{
+    const uint32_t* Begin = nullptr;
+    const uint32_t* End = nullptr;
+
+    const uint32_t* begin() const noexcept
+    {
+        return Begin;
+    }
+
+    const uint32_t* end() const noexcept
+    {
+        return End;
+    }
+
+    size_t Size() const noexcept
+    {
+        return static_cast<size_t>(End - Begin);
+    }
+
+    bool Empty() const noexcept
+    {
+        return Begin == End;
+    }
+};
+
+// Snapshots sorted by version, so that range queries are two binary searches returning a contiguous run of
+// snapshot numbers. Snapshots without a version are left out. Building is a radix sort, which skips the bytes
+// all versions share, ex. major and minor when every host runs Windows 10. Queries are thread-safe.
+class OperatingSystemVersionIndex final
+{
+public:
+    OperatingSystemVersionIndex() = default;
+    ~OperatingSystemVersionIndex() = default;
+    OperatingSystemVersionIndex(const OperatingSystemVersionIndex&) = delete;
+    OperatingSystemVersionIndex(OperatingSystemVersionIndex&&) = delete;
+    OperatingSystemVersionIndex& operator=(const OperatingSystemVersionIndex&) = delete;
+    OperatingSystemVersionIndex& operator=(OperatingSystemVersionIndex&&) = delete;
+
+    // Snapshot i has versions[i].
+    void Build(const OperatingSystemVersion* versions, size_t count);
+    // Snapshot i is the record recordIds[i] of inventory, ex. as given by OperatingSystemInfoIngestion.
+    // The version of each distinct record is computed once.
+    void Build(const OperatingSystemInfoInventory& inventory, const std::vector<uint32_t>& recordIds);
+
+    // Snapshots older than version.
+    OperatingSystemVersionMatches Below(OperatingSystemVersion version) const noexcept;
+    // Snapshots at least as recent as version.
+    OperatingSystemVersionMatches AtLeast(OperatingSystemVersion version) const noexcept;
+    // Snapshots from low included to high excluded.
+    OperatingSystemVersionMatches Between(OperatingSystemVersion low, OperatingSystemVersion high) const noexcept;
+
+    // Version of the snapshot at a position of Snapshots().
+    OperatingSystemVersion GetVersion(size_t position) const noexcept
+    {
+        return {m_Versions[position]};
+    }
+
+    // Every indexed snapshot, by version then snapshot number.
+    OperatingSystemVersionMatches Snapshots() const noexcept
+    {
+        return {m_Snapshots.data(), m_Snapshots.data() + m_Snapshots.size()};
+    }
+
+    size_t Size() const noexcept
+    {
+        return m_Snapshots.size();
+    }
+
+private:
+    void Sort();
+    size_t LowerBound(OperatingSystemVersion version) const noexcept;
+
+    std::vector<uint64_t> m_Versions;
+    std::vector<uint32_t> m_Snapshots;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// A value of an os-release(5) assignment. Raw is the text between the quotes (if any),
+// escapes are only resolved by ToString() so parsing itself never allocates.
+struct OsReleaseValue
+{
+    std::string_view Raw;
+    bool DoubleQuoted;
+
+    std::string ToString() const
+    {
+        if (!DoubleQuoted || Raw.find('\\') == std::string_view::npos)
+        {
+            return std::string(Raw);
+        }
+
+        // Inside double quotes, a backslash escapes the next character ("\"", "\\", "\$", "\`").
+        std::string result;
+        result.reserve(Raw.size());
+        for (size_t i = 0; i < Raw.size(); ++i)
+        {
+            if (Raw[i] == '\\' && i + 1 < Raw.size())
+            {
+                ++i;
+            }
+            result.push_back(Raw[i]);
+        }
+        return result;
+    }
+};
+
+// Calls visitor(std::string_view key, const OsReleaseValue& value) for every KEY=VALUE line of
+// os-release content. Blank lines, comments and malformed lines are skipped.
+template <class TVisitor> void ForEachOsReleaseEntry(std::string_view content, TVisitor&& visitor)
+{
+    constexpr std::string_view Blanks = " \t\r";
+    while (!content.empty())
+    {
+        auto lineEnd = content.find('\n');
+        auto line = content.substr(0, lineEnd);
+        content.remove_prefix(lineEnd == std::string_view::npos ? content.size() : lineEnd + 1);
+
+        auto begin = line.find_first_not_of(Blanks);
+        if (begin == std::string_view::npos || line[begin] == '#')
+        {
+            continue;
+        }
+        line.remove_prefix(begin);
+        line.remove_suffix(line.size() - 1 - line.find_last_not_of(Blanks));
+
+        auto equal = line.find('=');
+        if (equal == 0 || equal == std::string_view::npos)
+        {
+            continue;
+        }
+        auto key = line.substr(0, equal);
+        auto value = line.substr(equal + 1);
+
+        OsReleaseValue result{value, false};
+        if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front())
+        {
+            result.DoubleQuoted = value.front() == '"';
+            result.Raw = value.substr(1, value.size() - 2);
+        }
+        visitor(key, result);
+    }
+}
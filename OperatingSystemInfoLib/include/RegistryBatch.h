@@ -0,0 +1,148 @@
+#pragma once
+
+#include "IRegistryBackend.h"
+
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Batched reading of several values of one key:
+//
+//   ReadValues(reg,
+//              Bind<RegistryValueType::String>("EditionID", info.EditionID),
+//              Bind<RegistryValueType::Dword>("UBR", info.UBR));
+//
+// The bindings are resolved during a single enumeration of the key's values instead of one lookup per value.
+// A destination is only assigned when the value exists with the bound type, otherwise it is left untouched.
+template <RegistryValueType Type, class TDestination> struct RegistryBinding
+{
+    const char* Name;
+    size_t NameLength;
+    TDestination& Destination;
+    bool Found;
+};
+
+template <RegistryValueType Type, class TDestination, size_t N>
+constexpr RegistryBinding<Type, TDestination> Bind(const char (&name)[N], TDestination& destination)
+{
+    return {name, N - 1, destination, false};
+}
+
+namespace detail
+{
+// Decoders from the raw value data. Strings are UTF-16LE in the registry and converted to UTF-8 for std::string.
+bool DecodeRegistryValue(const RegistryValue& value, std::string& result);
+bool DecodeRegistryValue(const RegistryValue& value, std::wstring& result);
+// REG_MULTI_SZ entries.
+bool DecodeRegistryValue(const RegistryValue& value, std::vector<std::string>& result);
+bool DecodeRegistryValue(const RegistryValue& value, std::vector<std::wstring>& result);
+bool DecodeRegistryValue(const RegistryValue& value, uint32_t& result);
+bool DecodeRegistryValue(const RegistryValue& value, uint64_t& result);
+bool DecodeRegistryValue(const RegistryValue& value, std::vector<std::byte>& result);
+
+template <class T> bool DecodeRegistryValue(const RegistryValue& value, std::optional<T>& result)
+{
+    T decoded{};
+    if (!DecodeRegistryValue(value, decoded))
+    {
+        return false;
+    }
+    result = std::move(decoded);
+    return true;
+}
+
+// Numbers bound to a string field keep the decimal representation, ex. UBR=dword:0x2a2 -> "674".
+template <RegistryValueType Type> bool DecodeRegistryValueAsText(const RegistryValue& value, std::string& result)
+{
+    if constexpr (Type == RegistryValueType::Dword)
+    {
+        uint32_t number = 0;
+        if (!DecodeRegistryValue(value, number))
+        {
+            return false;
+        }
+        result = std::to_string(number);
+        return true;
+    }
+    else if constexpr (Type == RegistryValueType::Qword)
+    {
+        uint64_t number = 0;
+        if (!DecodeRegistryValue(value, number))
+        {
+            return false;
+        }
+        result = std::to_string(number);
+        return true;
+    }
+    else
+    {
+        return DecodeRegistryValue(value, result);
+    }
+}
+
+template <RegistryValueType Type, class TDestination>
+bool AssignBinding(RegistryBinding<Type, TDestination>& binding, const RegistryValue& value)
+{
+    if (binding.Found || value.Type != Type || !value.Name.EqualsAscii(binding.Name, binding.NameLength))
+    {
+        return false;
+    }
+    if constexpr (std::is_same_v<TDestination, std::string>)
+    {
+        binding.Found = DecodeRegistryValueAsText<Type>(value, binding.Destination);
+    }
+    else if constexpr (std::is_same_v<TDestination, std::optional<std::string>>)
+    {
+        std::string text;
+        binding.Found = DecodeRegistryValueAsText<Type>(value, text);
+        if (binding.Found)
+        {
+            binding.Destination = std::move(text);
+        }
+    }
+    else
+    {
+        binding.Found = DecodeRegistryValue(value, binding.Destination);
+    }
+    return binding.Found;
+}
+
+template <class... TBindings> class RegistryBatchVisitor final : public IRegistryValueVisitor
+{
+public:
+    explicit RegistryBatchVisitor(TBindings&... bindings) : m_Bindings(bindings...), m_Remaining(sizeof...(TBindings))
+    {
+    }
+
+    bool Visit(const RegistryValue& value) override
+    {
+        // Value names are unique within a key, so at most one binding can match.
+        bool assigned = std::apply(
+            [&value](auto&... bindings) { return (AssignBinding(bindings, value) || ...); }, m_Bindings);
+        if (assigned)
+        {
+            --m_Remaining;
+        }
+        return m_Remaining > 0;
+    }
+
+    size_t Found() const
+    {
+        return sizeof...(TBindings) - m_Remaining;
+    }
+
+private:
+    std::tuple<TBindings&...> m_Bindings;
+    size_t m_Remaining;
+};
+} // namespace detail
+
+// Returns the number of bindings which have been assigned.
+template <class... TBindings> size_t ReadValues(const IRegistryBackend& reg, TBindings&&... bindings)
+{
+    static_assert(sizeof...(TBindings) > 0, "ReadValues needs at least one binding.");
+    detail::RegistryBatchVisitor<std::remove_reference_t<TBindings>...> visitor(bindings...);
+    reg.ForEachValue(visitor);
+    return visitor.Found();
+}
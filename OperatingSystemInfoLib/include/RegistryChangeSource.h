@@ -0,0 +1,39 @@
+#pragma once
+
+#include "IChangeSource.h"
+
+#include <windows.h>
+#include <string>
+#include <thread>
+
+// Reports changes of the values of a registry key with RegNotifyChangeKeyValue, by default
+// HKLM\SOFTWARE\Microsoft\Windows NT\CurrentVersion which an update rewrites with its build and UBR.
+// Subkeys are not watched.
+class RegistryChangeSource final : public IChangeSource
+{
+public:
+    RegistryChangeSource() noexcept;
+    RegistryChangeSource(HKEY rootKey, std::wstring path) noexcept;
+    ~RegistryChangeSource() override;
+    RegistryChangeSource(RegistryChangeSource&&) = delete;
+    RegistryChangeSource(const RegistryChangeSource&) = delete;
+    RegistryChangeSource& operator=(const RegistryChangeSource&) = delete;
+    RegistryChangeSource& operator=(RegistryChangeSource&&) = delete;
+
+    // Fails when the key cannot be opened.
+    bool Start(std::function<void()> onChange) override;
+    void Stop() override;
+
+private:
+    bool Arm();
+    void Run();
+
+    HKEY m_RootKey;
+    std::wstring m_Path;
+    HKEY m_Key = nullptr;
+    // Signaled by the registry on a change and by Stop.
+    HANDLE m_ChangeEvent = nullptr;
+    HANDLE m_StopEvent = nullptr;
+    std::function<void()> m_OnChange;
+    std::thread m_Thread;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "IRegistryBackend.h"
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Decoding of raw RegistryValue data shared by every backend. The decoders return views into the value data,
+// nothing is copied until a view is converted into its destination, and there is no length limit.
+// Views are valid as long as the value data is, ex. during the visit for ForEachValue.
+
+// UTF-16LE text of a string value, without its terminating NUL. The data has no alignment guarantee.
+class RegistryStringView
+{
+public:
+    constexpr RegistryStringView() noexcept : m_Data(nullptr), m_Length(0)
+    {
+    }
+    constexpr RegistryStringView(const std::byte* data, size_t length) noexcept : m_Data(data), m_Length(length)
+    {
+    }
+
+    const std::byte* Data() const noexcept
+    {
+        return m_Data;
+    }
+    // In UTF-16 code units.
+    size_t Length() const noexcept
+    {
+        return m_Length;
+    }
+    bool Empty() const noexcept
+    {
+        return m_Length == 0;
+    }
+    char16_t operator[](size_t index) const noexcept;
+
+    void ToUtf8(std::string& result) const;
+    std::string ToUtf8() const;
+    void ToWide(std::wstring& result) const;
+    std::wstring ToWide() const;
+
+    // Exact comparison with a UTF-8 string.
+    bool operator==(std::string_view utf8) const noexcept;
+    bool operator!=(std::string_view utf8) const noexcept
+    {
+        return !(*this == utf8);
+    }
+
+private:
+    const std::byte* m_Data;
+    size_t m_Length;
+};
+
+// Entries of a REG_MULTI_SZ value, found one at a time while iterating. The list ends at the first empty entry,
+// which is the final double NUL of well-formed data, or at the end of the data when the terminators are missing.
+class RegistryMultiStringView
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = RegistryStringView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const RegistryStringView*;
+        using reference = const RegistryStringView&;
+
+        Iterator() noexcept = default;
+
+        reference operator*() const noexcept
+        {
+            return m_Current;
+        }
+        pointer operator->() const noexcept
+        {
+            return &m_Current;
+        }
+        Iterator& operator++() noexcept;
+        Iterator operator++(int) noexcept
+        {
+            auto previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const Iterator& other) const noexcept
+        {
+            return m_Position == other.m_Position;
+        }
+        bool operator!=(const Iterator& other) const noexcept
+        {
+            return m_Position != other.m_Position;
+        }
+
+    private:
+        friend class RegistryMultiStringView;
+        Iterator(const std::byte* data, size_t count, size_t position) noexcept;
+        void Find() noexcept;
+
+        const std::byte* m_Data = nullptr;
+        size_t m_Count = 0;
+        // Code unit where m_Current starts, m_Count for the end.
+        size_t m_Position = 0;
+        RegistryStringView m_Current;
+    };
+
+    constexpr RegistryMultiStringView() noexcept : m_Data(nullptr), m_Count(0)
+    {
+    }
+    constexpr RegistryMultiStringView(const std::byte* data, size_t count) noexcept : m_Data(data), m_Count(count)
+    {
+    }
+
+    Iterator begin() const noexcept;
+    Iterator end() const noexcept;
+    bool Empty() const noexcept
+    {
+        return begin() == end();
+    }
+
+    std::vector<std::string> ToUtf8() const;
+    std::vector<std::wstring> ToWide() const;
+
+private:
+    const std::byte* m_Data;
+    // In UTF-16 code units.
+    size_t m_Count;
+};
+
+// Each decoder returns false and leaves result untouched when the value does not have a matching type or size.
+
+// REG_SZ and REG_EXPAND_SZ, up to the first NUL. REG_EXPAND_SZ text is returned as stored.
+bool DecodeRegistryString(const RegistryValue& value, RegistryStringView& result) noexcept;
+bool DecodeRegistryMultiString(const RegistryValue& value, RegistryMultiStringView& result) noexcept;
+// REG_DWORD and REG_DWORD_BIG_ENDIAN.
+bool DecodeRegistryDword(const RegistryValue& value, uint32_t& result) noexcept;
+bool DecodeRegistryQword(const RegistryValue& value, uint64_t& result) noexcept;
+// Any type, the data as stored.
+bool DecodeRegistryBinary(const RegistryValue& value, const std::byte*& data, size_t& size) noexcept;
+
+// Returns false when the variable is not set.
+using RegistryEnvironmentLookup = std::function<bool(std::string_view name, std::string& value)>;
+
+// Replaces %NAME% with the value of the environment variable like ExpandEnvironmentStrings, for REG_EXPAND_SZ text.
+// Variables which are not set and a lone % are kept as written. The process environment is looked up when no
+// lookup is given, names are case-insensitive on Windows only.
+void ExpandRegistryString(RegistryStringView text, std::string& result);
+void ExpandRegistryString(RegistryStringView text, const RegistryEnvironmentLookup& lookup, std::string& result);
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "IOperatingSystemInfoFetcher.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+#include "OperatingSystemInfoRecord.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Named shared-memory segment holding the latest OperatingSystemInfo of the host, so that local processes
+// share one fetch. The segment is "/OperatingSystemInfo.<name>" in POSIX shared memory, or
+// "Local\OperatingSystemInfo.<name>" on Windows. Integers are in host byte order, only processes of the
+// same host read it:
+//
+//   0   uint32  Magic "OSIS", written last by the publisher which creates the segment
+//   4   uint32  Version (1)
+//   8   uint32  Capacity of the record area in bytes
+//   12  uint32  Sequence, odd while the publisher writes, even otherwise
+//   16  int64   Published, steady_clock time of the last publish in nanoseconds, 0 when withdrawn
+//   24  uint32  Size of the record
+//   ..  padding to HeaderSize
+//   64  one OperatingSystemInfoRecord, see OperatingSystemInfoRecord.h
+//
+// Sequence, Published, Size and the record form a seqlock: readers copy them without taking any lock and
+// retry when Sequence changed meanwhile. steady_clock is system-wide on Linux and Windows, so readers
+// compare Published with their own clock to tell how old the snapshot is.
+struct SharedOperatingSystemInfoFormat
+{
+    static constexpr uint32_t Magic = 0x5349534F; // "OSIS"
+    static constexpr uint32_t Version = 1;
+    static constexpr size_t HeaderSize = 64;
+    static constexpr size_t Capacity = 4096;
+};
+
+namespace detail
+{
+struct SharedSegment;
+} // namespace detail
+
+// Writes snapshots into the segment. One publisher per name and host, ex. the agent which owns the
+// OperatingSystemInfoProvider, publishing from an OperatingSystemInfoWatcher callback and again before
+// the snapshot gets older than the maxAge of its readers. Publish and Withdraw must not run concurrently.
+class SharedOperatingSystemInfoPublisher final
+{
+public:
+    explicit SharedOperatingSystemInfoPublisher(std::string name) noexcept;
+    // Withdraws the snapshot and removes the name, readers which mapped it already then see it as stale.
+    ~SharedOperatingSystemInfoPublisher();
+    SharedOperatingSystemInfoPublisher(const SharedOperatingSystemInfoPublisher&) = delete;
+    SharedOperatingSystemInfoPublisher(SharedOperatingSystemInfoPublisher&&) = delete;
+    SharedOperatingSystemInfoPublisher& operator=(const SharedOperatingSystemInfoPublisher&) = delete;
+    SharedOperatingSystemInfoPublisher& operator=(SharedOperatingSystemInfoPublisher&&) = delete;
+
+    // Creates the segment, or takes over the one left by a previous publisher.
+    bool Open();
+
+    bool IsOpen() const noexcept
+    {
+        return m_Segment != nullptr;
+    }
+
+    // Fails when the segment is not open or the record does not fit in its capacity.
+    bool Publish(const OperatingSystemInfo& info);
+    // Marks the snapshot as stale so that readers fall back to their own fetch.
+    void Withdraw() noexcept;
+
+private:
+    std::string m_Name;
+    detail::SharedSegment* m_Segment = nullptr;
+    OperatingSystemInfoRecordWriter m_Writer;
+#ifdef _WIN32
+    void* m_Mapping = nullptr;
+#endif
+};
+
+// Lock-free reader of the segment. Once open, a read is a copy of the record out of the mapping,
+// with no syscall and no lock.
+class SharedOperatingSystemInfoReader final
+{
+public:
+    explicit SharedOperatingSystemInfoReader(std::string name) noexcept;
+    ~SharedOperatingSystemInfoReader();
+    SharedOperatingSystemInfoReader(const SharedOperatingSystemInfoReader&) = delete;
+    SharedOperatingSystemInfoReader(SharedOperatingSystemInfoReader&&) = delete;
+    SharedOperatingSystemInfoReader& operator=(const SharedOperatingSystemInfoReader&) = delete;
+    SharedOperatingSystemInfoReader& operator=(SharedOperatingSystemInfoReader&&) = delete;
+
+    // Maps the segment read-only. Fails while no publisher created it, can then be called again.
+    // Once open, maps it again when a restarted publisher created a new segment under the name, which is
+    // a new object on Linux. Thread-safe, every segment mapped stays mapped until the reader is destroyed,
+    // so a Read running meanwhile finishes on the one it started with.
+    bool Open();
+
+    bool IsOpen() const noexcept
+    {
+        return m_Segment.load(std::memory_order_acquire) != nullptr;
+    }
+
+    // Copies the snapshot into the reader's buffer, record views it until the next Read on this reader.
+    // Fails when the segment is not open, nothing was published yet, the snapshot is older than maxAge,
+    // or the publisher kept rewriting it during the read. Not thread-safe.
+    bool Read(OperatingSystemInfoRecordView& record, std::chrono::steady_clock::duration maxAge) noexcept;
+
+    // Same as above into info, thread-safe.
+    bool Read(OperatingSystemInfo& info, std::chrono::steady_clock::duration maxAge) const;
+
+private:
+    bool Read(std::byte* buffer, OperatingSystemInfoRecordView& record, std::chrono::steady_clock::duration maxAge) const noexcept;
+
+    std::string m_Name;
+    std::mutex m_OpenMutex;
+    std::atomic<const detail::SharedSegment*> m_Segment{nullptr};
+#ifdef _WIN32
+    void* m_Mapping = nullptr;
+#else
+    // Identity of the mapped segment, a restarted publisher creates a new one.
+    uint64_t m_Device = 0;
+    uint64_t m_Inode = 0;
+    // Segments replaced by a newer one, guarded by m_OpenMutex.
+    std::vector<const detail::SharedSegment*> m_Retired;
+#endif
+    alignas(8) std::array<std::byte, SharedOperatingSystemInfoFormat::Capacity> m_Buffer;
+};
+
+struct SharedOperatingSystemInfoStatistics
+{
+    // Calls answered from the segment.
+    uint64_t Hits = 0;
+    // Calls which went to the fallback fetcher, because the segment was missing or stale.
+    uint64_t Misses = 0;
+};
+
+// Answers from the shared snapshot when there is a fresh one, from the fallback fetcher otherwise.
+// Processes which are not the publisher use it in place of their own fetcher, ex. inside an
+// OperatingSystemInfoProvider. Without a fallback, misses return an empty OperatingSystemInfo.
+class SharedOperatingSystemInfoFetcher final : public IOperatingSystemInfoFetcher
+{
+public:
+    SharedOperatingSystemInfoFetcher(std::string name, std::chrono::steady_clock::duration maxAge,
+                                     std::unique_ptr<IOperatingSystemInfoFetcher> fallback) noexcept;
+    ~SharedOperatingSystemInfoFetcher() override = default;
+    SharedOperatingSystemInfoFetcher(const SharedOperatingSystemInfoFetcher&) = delete;
+    SharedOperatingSystemInfoFetcher(SharedOperatingSystemInfoFetcher&&) = delete;
+    SharedOperatingSystemInfoFetcher& operator=(const SharedOperatingSystemInfoFetcher&) = delete;
+    SharedOperatingSystemInfoFetcher& operator=(SharedOperatingSystemInfoFetcher&&) = delete;
+
+    using IOperatingSystemInfoFetcher::GetInformation;
+    OperatingSystemInfo GetInformation() override;
+    // Misses only ask the requested fields from the fallback.
+    OperatingSystemInfo GetInformation(OperatingSystemInfoFieldMask fields) override;
+
+    SharedOperatingSystemInfoStatistics GetStatistics() const noexcept;
+
+private:
+    SharedOperatingSystemInfoReader m_Reader;
+    std::chrono::steady_clock::duration m_MaxAge;
+    std::unique_ptr<IOperatingSystemInfoFetcher> m_Fallback;
+
+    std::atomic<uint64_t> m_Hits{0};
+    std::atomic<uint64_t> m_Misses{0};
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads with one task deque per worker. A worker runs its own tasks
+// newest first and steals the oldest task of another worker when its deque is empty.
+// Tasks submitted from a worker go to that worker's deque, others are spread round-robin.
+// The destructor runs every task already submitted, then joins the workers.
+// Tasks given to Submit must not throw, Run reports exceptions through the returned future.
+class ThreadPool final
+{
+public:
+    // Zero means one worker per hardware thread.
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    // Runs function on the pool, the future holds its result or exception.
+    template <class TFunction> auto Run(TFunction&& function) -> std::future<std::invoke_result_t<std::decay_t<TFunction>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<TFunction>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<TFunction>(function));
+        auto result = task->get_future();
+        Submit([task] { (*task)(); });
+        return result;
+    }
+
+    // Runs one submitted task on the calling thread, returns false when none is queued. A thread waiting for tasks
+    // it submitted calls it instead of blocking, so a worker waiting on its own tasks cannot starve the pool.
+    bool RunPending();
+
+    size_t Size() const noexcept
+    {
+        return m_Workers.size();
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex Mutex;
+        std::deque<std::function<void()>> Tasks;
+    };
+
+    void Work(size_t index);
+    bool TryPop(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    std::vector<std::thread> m_Workers;
+    std::atomic<size_t> m_NextQueue{0};
+
+    // Tasks submitted and not yet taken by a worker. Only incremented with m_Mutex held so that
+    // a worker going to sleep cannot miss a submission, and before the task is queued so that
+    // the worker taking it never decrements below zero.
+    std::atomic<size_t> m_Pending{0};
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeUp;
+    bool m_Stopping = false;
+};
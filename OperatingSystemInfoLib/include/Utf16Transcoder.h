@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+
+// UTF-16LE to UTF-8 conversion into caller-provided buffers, for WMI strings and registry data.
+// Runs of ASCII are converted 16 (SSE2) or 32 (AVX2) code units at a time, blocks without surrogates
+// skip the pair checks, the rest goes through the scalar encoder. Unpaired surrogates become U+FFFD.
+// Input has no alignment requirement and no terminating NUL is read or written.
+
+enum class SimdLevel
+{
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// Best level supported by the CPU and the build, used when no level is given.
+SimdLevel GetSupportedSimdLevel() noexcept;
+
+// Upper bound of the UTF-8 size of count code units: 3 bytes per unit, a surrogate pair takes 4 bytes for 2 units.
+constexpr size_t GetUtf8BufferSize(size_t count) noexcept
+{
+    return count * 3;
+}
+
+// Converts count code units, output holds at least GetUtf8BufferSize(count) bytes. Returns the number of bytes written.
+size_t ConvertUtf16ToUtf8(const void* utf16, size_t count, char* output) noexcept;
+// Levels above GetSupportedSimdLevel() run at the supported level.
+size_t ConvertUtf16ToUtf8(const void* utf16, size_t count, char* output, SimdLevel level) noexcept;
+
+struct Utf16String
+{
+    const void* Data;
+    // Code units.
+    size_t Count;
+};
+
+// Converts several strings in one call, back to back into output, which holds at least GetUtf8BufferSize
+// of their total count. ends[i] receives the offset of the end of string i in output. Returns the bytes written.
+size_t ConvertUtf16ToUtf8(const Utf16String* strings, size_t stringCount, char* output, size_t* ends) noexcept;
+
+// False when the code units hold an unpaired surrogate, which the conversion would replace.
+bool IsValidUtf16(const void* utf16, size_t count) noexcept;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+
+// Feature update of Windows 10 / 11, identified by CurrentBuildNumber.
+struct WindowsRelease
+{
+    uint32_t Build;
+    // "1809", "22H2"
+    std::string_view Version;
+    // "RS5 (RedStone 5)"
+    std::string_view Codename;
+    // "October 2018 Update"
+    std::string_view MarketName;
+    // BuildBranch registry value, "rs5_release"
+    std::string_view BuildBranch;
+};
+
+// Cumulative update, identified by CurrentBuildNumber and UBR.
+struct WindowsUpdate
+{
+    uint32_t Build;
+    uint32_t UBR;
+    // Knowledge base article number, 5026361 for KB5026361.
+    uint32_t KB;
+    uint16_t Year;
+    uint8_t Month;
+    uint8_t Day;
+};
+
+// Lookups into the catalog compiled from WindowsBuildCatalog.inc, nullptr when unknown.
+// Build and (build, UBR) lookups are binary searches over integer keys. The branch lookup hashes
+// the name once and binary searches the hashes, then confirms the single candidate.
+//
+// The releases are complete through 24H2. The cumulative updates are a sample of the monthly rollups of the
+// supported builds, most UBRs are not in it: FindWindowsUpdate is only an exact match, use
+// FindLatestWindowsUpdate for the patch level a host has at least.
+const WindowsRelease* FindWindowsRelease(uint32_t build) noexcept;
+const WindowsUpdate* FindWindowsUpdate(uint32_t build, uint32_t ubr) noexcept;
+// Newest update of build at or below ubr, nullptr when the catalog has none for the build up to ubr.
+const WindowsUpdate* FindLatestWindowsUpdate(uint32_t build, uint32_t ubr) noexcept;
+// Enablement-package releases share their base release's branch, the base release is returned for those.
+const WindowsRelease* FindWindowsReleaseByBranch(std::string_view buildBranch) noexcept;
@@ -1,17 +1,19 @@
 #pragma once
 
+#include "IRegistryBackend.h"
+
 #include <windows.h>
 #include <string>
 #include <stdint.h>
 #include <vector>
 
-class WindowsReg final
+class WindowsReg final : public IRegistryBackend
 {
 public:
     WindowsReg() : m_Key(nullptr)
     {
     }
-    ~WindowsReg()
+    ~WindowsReg() override
     {
         Close();
     }
@@ -24,15 +26,24 @@ public:
     bool Open(HKEY rootKey, const wchar_t* path, uint32_t mode = KEY_READ);
     void Close();
 
+    // Reads a value for the decoders of RegistryValueDecoder.h, the data is read into buffer.
+    bool ReadValue(const wchar_t* name, RegistryValue& result, std::vector<std::byte>& buffer) const;
+
+    // REG_SZ and REG_EXPAND_SZ, the latter as stored. The std::string overload returns UTF-8.
     bool ReadStringValue(const wchar_t* name, std::wstring& result) const;
     bool ReadStringValue(const char* name, std::string& result) const;
 
+    bool ReadMultiStringValue(const wchar_t* name, std::vector<std::wstring>& result) const;
+    bool ReadMultiStringValue(const char* name, std::vector<std::string>& result) const;
+
     bool ReadIntValue(const wchar_t* name, uint32_t& result) const;
 
     bool ReadInt64Value(const wchar_t* name, uint64_t& result) const;
 
     bool ReadBinaryValue(const wchar_t* name, std::vector<std::byte>& result) const;
 
+    bool ForEachValue(IRegistryValueVisitor& visitor) const override;
+
 private:
     HKEY m_Key;
 };
\ No newline at end of file
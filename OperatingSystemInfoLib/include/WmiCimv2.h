@@ -0,0 +1,43 @@
+#pragma once
+
+#include "IWmiProvider.h"
+#include "OperatingSystemInfoField.h"
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
+struct OSInfo
+{
+    std::wstring Caption;
+    std::wstring OSArchitecture;
+    std::wstring MUILanguage;
+    std::wstring Locale;
+    std::wstring Version;
+    int32_t OSLanguage = 0;
+    int32_t ServicePackMajorVersion = 0;
+    int32_t ServicePackMinorVersion = 0;
+};
+
+// Reads Win32_OperatingSystem of root\cimv2 through any provider, the live one or InMemoryWmi.
+class WmiCimv2 final
+{
+public:
+    // The provider must outlive this object.
+    explicit WmiCimv2(IWmiProvider& provider) noexcept : m_Provider(provider)
+    {
+    }
+    ~WmiCimv2() noexcept = default;
+    WmiCimv2(const WmiCimv2&) = delete;
+    WmiCimv2(WmiCimv2&&) = delete;
+    WmiCimv2& operator=(const WmiCimv2&) = delete;
+    WmiCimv2& operator=(WmiCimv2&&) = delete;
+
+    // Only the properties backing the requested fields are selected and read.
+    OSInfo GetOSInfo(OperatingSystemInfoFieldMask fields = OperatingSystemInfoFieldMask::All());
+    // Same, giving up at deadline. Returns false when the query failed or gave up, info is then empty.
+    bool GetOSInfo(OperatingSystemInfoFieldMask fields, std::chrono::steady_clock::time_point deadline, OSInfo& info);
+
+private:
+    IWmiProvider& m_Provider;
+};
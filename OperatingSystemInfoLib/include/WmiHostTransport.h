@@ -0,0 +1,24 @@
+#pragma once
+
+#include "IHostTransport.h"
+
+// Reads Win32_OperatingSystem over remote WMI (\\host\root\cimv2) and the CurrentVersion key over the
+// remote registry service, with the credentials of the calling process, the same steps as
+// OperatingSystemInfoFetcher. Each attempt opens its own connections.
+//
+// Neither API takes a timeout: the connection uses WMI's two minute maximum wait, and an attempt still
+// running at its deadline is abandoned by the scheduler.
+class WmiHostTransport final : public IHostTransport
+{
+public:
+    WmiHostTransport() noexcept = default;
+    ~WmiHostTransport() override = default;
+    WmiHostTransport(WmiHostTransport&&) = delete;
+    WmiHostTransport(const WmiHostTransport&) = delete;
+    WmiHostTransport& operator=(const WmiHostTransport&) = delete;
+    WmiHostTransport& operator=(WmiHostTransport&&) = delete;
+
+    bool Collect(const std::string& host, OperatingSystemInfoFieldMask fields,
+                 std::chrono::steady_clock::time_point deadline, OperatingSystemInfo& result,
+                 std::string& error) override;
+};
@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "CompactOperatingSystemInfo.h"
+
+#include <charconv>
+
+namespace detail
+{
+// Parses values which to_chars gives back unchanged: "0", "1903", but not "", "0409", "+1" or "4294967296".
+bool ParseCanonicalNumber(std::string_view text, uint32_t& result)
+{
+    if (text.empty() || (text.size() > 1 && text.front() == '0'))
+    {
+        return false;
+    }
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), result);
+    return parsed.ec == std::errc() && parsed.ptr == text.data() + text.size();
+}
+} // namespace detail
+
+uint32_t OperatingSystemInfoStringPool::Intern(std::string_view value)
+{
+    auto found = m_Ids.find(value);
+    if (found != m_Ids.end())
+    {
+        return found->second;
+    }
+    auto id = static_cast<uint32_t>(m_Strings.size());
+    m_Ids.emplace(m_Strings.emplace_back(value), id);
+    return id;
+}
+
+bool OperatingSystemInfoStringPool::Find(std::string_view value, uint32_t& id) const
+{
+    auto found = m_Ids.find(value);
+    if (found == m_Ids.end())
+    {
+        return false;
+    }
+    id = found->second;
+    return true;
+}
+
+CompactOperatingSystemInfo CompactOperatingSystemInfo::Pack(const OperatingSystemInfo& info, OperatingSystemInfoStringPool& strings)
+{
+    return Pack(OperatingSystemInfoView::Of(info), strings);
+}
+
+CompactOperatingSystemInfo CompactOperatingSystemInfo::Pack(const OperatingSystemInfoView& info, OperatingSystemInfoStringPool& strings)
+{
+    CompactOperatingSystemInfo result;
+    result.Present = info.Present;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        const auto i = static_cast<size_t>(field.Field);
+        if (!info.Present.Has(field.Field))
+        {
+            return;
+        }
+        if (NumericFields.Has(field.Field) && detail::ParseCanonicalNumber(info.Values[i], result.Slots[i]))
+        {
+            result.Inlined.Set(field.Field);
+        }
+        else
+        {
+            result.Slots[i] = strings.Intern(info.Values[i]);
+        }
+    });
+    return result;
+}
+
+OperatingSystemInfo CompactOperatingSystemInfo::Unpack(const OperatingSystemInfoStringPool& strings) const
+{
+    OperatingSystemInfo result;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        const auto i = static_cast<size_t>(field.Field);
+        if (!Present.Has(field.Field))
+        {
+            return;
+        }
+        if (Inlined.Has(field.Field))
+        {
+            char digits[10];
+            auto converted = std::to_chars(digits, digits + sizeof(digits), Slots[i]);
+            field.Get(result).emplace(digits, converted.ptr);
+        }
+        else
+        {
+            field.Get(result).emplace(strings.Get(Slots[i]));
+        }
+    });
+    return result;
+}
+
+bool CompactOperatingSystemInfo::FindSlot(OperatingSystemInfoField field, std::string_view value,
+                                          const OperatingSystemInfoStringPool& strings, uint32_t& slot, bool& inlined)
+{
+    inlined = NumericFields.Has(field) && detail::ParseCanonicalNumber(value, slot);
+    return inlined || strings.Find(value, slot);
+}
+
+uint64_t CompactOperatingSystemInfo::Hash() const noexcept
+{
+    // FNV-1a over 32-bit words, followed by a final avalanche so that the low bits are usable as bucket index.
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint32_t word) {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    };
+    mix(Present.Bits());
+    mix(Inlined.Bits());
+    for (auto slot : Slots)
+    {
+        mix(slot);
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint32_t OperatingSystemInfoInventory::Add(const OperatingSystemInfo& info)
+{
+    return AddPacked(CompactOperatingSystemInfo::Pack(info, m_Strings));
+}
+
+uint32_t OperatingSystemInfoInventory::Add(const OperatingSystemInfoView& info)
+{
+    return AddPacked(CompactOperatingSystemInfo::Pack(info, m_Strings));
+}
+
+uint32_t OperatingSystemInfoInventory::Add(const CompactOperatingSystemInfo& record, const OperatingSystemInfoStringPool& strings)
+{
+    auto remapped = record;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        const auto i = static_cast<size_t>(field.Field);
+        if (record.Present.Has(field.Field) && !record.Inlined.Has(field.Field))
+        {
+            remapped.Slots[i] = m_Strings.Intern(strings.Get(record.Slots[i]));
+        }
+    });
+    return AddPacked(remapped);
+}
+
+uint32_t OperatingSystemInfoInventory::AddPacked(const CompactOperatingSystemInfo& record)
+{
+    auto hash = record.Hash();
+    auto candidates = m_Index.equal_range(hash);
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+    {
+        if (m_Records[candidate->second] == record)
+        {
+            return candidate->second;
+        }
+    }
+
+    auto id = static_cast<uint32_t>(m_Records.size());
+    m_Records.push_back(record);
+    m_Index.emplace(hash, id);
+    return id;
+}
@@ -0,0 +1,434 @@
+#include "pch.h"
+#include "CompositeOperatingSystemInfoFetcher.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace detail
+{
+constexpr size_t NoSource = static_cast<size_t>(-1);
+}
+
+struct CompositeOperatingSystemInfoFetcher::Call
+{
+    std::mutex Mutex;
+    std::condition_variable Resolved;
+    OperatingSystemInfoFieldMask Requested;
+    // Requested fields which a running source could still fill or replace.
+    OperatingSystemInfoFieldMask Unresolved;
+    // Sources started for this call which have not completed, by source index.
+    std::vector<bool> Pending;
+    // Pending sources the call does not wait for anymore.
+    std::vector<bool> GivenUp;
+    // Pending sources the call still waits for.
+    size_t Remaining = 0;
+    std::chrono::steady_clock::time_point Start;
+    std::chrono::steady_clock::time_point Deadline;
+    // Set once the result is final, the sources not started yet are skipped from then on.
+    bool Finished = false;
+    OperatingSystemInfo Result;
+    // Source of the value of each field of Result.
+    std::array<size_t, OperatingSystemInfoFieldCount> Owners;
+    // Requested fields which a completed source reported timed out on.
+    OperatingSystemInfoFieldMask SourceTimedOut;
+    // Requested fields without a value because of the sources given up on or timed out, set when the call finishes.
+    OperatingSystemInfoFieldMask TimedOut;
+    LateFieldsCallback OnLate;
+
+    // When the call stops waiting for a source.
+    std::chrono::steady_clock::time_point GetSourceDeadline(const Source& source) const noexcept
+    {
+        return source.Budget < Deadline - Start ? Start + source.Budget : Deadline;
+    }
+};
+
+CompositeOperatingSystemInfoFetcher::CompositeOperatingSystemInfoFetcher(ThreadPool& pool) noexcept : m_Pool(pool)
+{
+}
+
+CompositeOperatingSystemInfoFetcher::~CompositeOperatingSystemInfoFetcher()
+{
+    std::unique_lock<std::mutex> lock(m_RunningMutex);
+    m_Idle.wait(lock, [this] { return m_Running == 0; });
+}
+
+size_t CompositeOperatingSystemInfoFetcher::AddSource(std::shared_ptr<IOperatingSystemInfoFetcher> fetcher, int priority,
+                                                      OperatingSystemInfoFieldMask fields)
+{
+    assert(fetcher != nullptr);
+    auto source = std::make_unique<Source>();
+    source->Fetcher = std::move(fetcher);
+    source->Fields = fields;
+    source->Priorities.fill(priority);
+    m_Sources.push_back(std::move(source));
+    return m_Sources.size() - 1;
+}
+
+void CompositeOperatingSystemInfoFetcher::SetPriority(size_t source, OperatingSystemInfoField field, int priority)
+{
+    m_Sources[source]->Priorities[static_cast<size_t>(field)] = priority;
+}
+
+void CompositeOperatingSystemInfoFetcher::SetBudget(size_t source, std::chrono::steady_clock::duration budget)
+{
+    m_Sources[source]->Budget = budget;
+}
+
+OperatingSystemInfo CompositeOperatingSystemInfoFetcher::GetInformation()
+{
+    return GetInformation(OperatingSystemInfoFieldMask::All());
+}
+
+OperatingSystemInfo CompositeOperatingSystemInfoFetcher::GetInformation(OperatingSystemInfoFieldMask fields)
+{
+    OperatingSystemInfoFieldMask timedOut;
+    return GetInformation(fields, std::chrono::steady_clock::time_point::max(), timedOut, nullptr);
+}
+
+OperatingSystemInfo CompositeOperatingSystemInfoFetcher::GetInformation(OperatingSystemInfoFieldMask fields,
+                                                                        std::chrono::steady_clock::time_point deadline,
+                                                                        OperatingSystemInfoFieldMask& timedOut,
+                                                                        LateFieldsCallback onLate)
+{
+    m_Calls.fetch_add(1, std::memory_order_relaxed);
+    timedOut = {};
+
+    auto call = std::make_shared<Call>();
+    call->Requested = fields;
+    call->Unresolved = fields;
+    call->Pending.resize(m_Sources.size());
+    call->GivenUp.resize(m_Sources.size());
+    call->Owners.fill(detail::NoSource);
+    call->Start = std::chrono::steady_clock::now();
+    call->Deadline = deadline;
+    call->OnLate = std::move(onLate);
+
+    // Best priority of each source over the requested fields, sources without any of them are not run.
+    std::vector<std::pair<int, size_t>> order;
+    for (size_t index = 0; index < m_Sources.size(); ++index)
+    {
+        const auto& source = *m_Sources[index];
+        if (!source.Fields.Intersects(fields))
+        {
+            continue;
+        }
+        int best = (std::numeric_limits<int>::min)();
+        for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+        {
+            if (fields.Has(static_cast<OperatingSystemInfoField>(i)) && source.Fields.Has(static_cast<OperatingSystemInfoField>(i)))
+            {
+                best = (std::max)(best, source.Priorities[i]);
+            }
+        }
+        order.emplace_back(best, index);
+        call->Pending[index] = true;
+        ++call->Remaining;
+    }
+    if (order.empty())
+    {
+        return {};
+    }
+
+    // Workers run their own deque newest first, submitting the preferred sources last starts them
+    // first when there are fewer workers than sources.
+    std::sort(order.begin(), order.end(), [](const auto& left, const auto& right) {
+        return left.first != right.first ? left.first < right.first : left.second > right.second;
+    });
+    {
+        std::lock_guard<std::mutex> lock(m_RunningMutex);
+        m_Running += order.size();
+    }
+    for (const auto& entry : order)
+    {
+        auto index = entry.second;
+        auto sourceFields = fields & m_Sources[index]->Fields;
+        m_Pool.Submit([this, call, index, sourceFields] { Run(call, index, sourceFields); });
+    }
+
+    std::unique_lock<std::mutex> lock(call->Mutex);
+    while (!call->Finished)
+    {
+        auto wakeUp = std::chrono::steady_clock::time_point::max();
+        for (size_t index = 0; index < m_Sources.size(); ++index)
+        {
+            if (call->Pending[index] && !call->GivenUp[index])
+            {
+                wakeUp = (std::min)(wakeUp, call->GetSourceDeadline(*m_Sources[index]));
+            }
+        }
+        if (wakeUp == std::chrono::steady_clock::time_point::max())
+        {
+            call->Resolved.wait(lock);
+            continue;
+        }
+        call->Resolved.wait_until(lock, wakeUp);
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t index = 0; index < m_Sources.size() && !call->Finished; ++index)
+        {
+            if (call->Pending[index] && !call->GivenUp[index] && now >= call->GetSourceDeadline(*m_Sources[index]))
+            {
+                GiveUp(*call, index);
+            }
+        }
+    }
+    timedOut = call->TimedOut;
+    return std::move(call->Result);
+}
+
+CompositeOperatingSystemInfoStatistics CompositeOperatingSystemInfoFetcher::GetStatistics() const noexcept
+{
+    CompositeOperatingSystemInfoStatistics statistics;
+    statistics.Calls = m_Calls.load(std::memory_order_relaxed);
+    statistics.Started = m_Started.load(std::memory_order_relaxed);
+    statistics.Queued = m_Queued.load(std::memory_order_relaxed);
+    statistics.Skipped = m_Skipped.load(std::memory_order_relaxed);
+    statistics.TimedOut = m_TimedOut.load(std::memory_order_relaxed);
+    statistics.Late = m_Late.load(std::memory_order_relaxed);
+    statistics.Failed = m_Failed.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void CompositeOperatingSystemInfoFetcher::Run(const std::shared_ptr<Call>& call, size_t index, OperatingSystemInfoFieldMask fields)
+{
+    auto& source = *m_Sources[index];
+    std::vector<std::pair<std::shared_ptr<Call>, OperatingSystemInfoFieldMask>> calls;
+    {
+        std::lock_guard<std::mutex> sourceLock(source.Mutex);
+        if (source.Busy)
+        {
+            // Left to the worker fetching the source, this one stays free for the other sources.
+            m_Queued.fetch_add(1, std::memory_order_relaxed);
+            source.Queued.emplace_back(call, fields);
+        }
+        else
+        {
+            source.Busy = true;
+            calls.emplace_back(call, fields);
+        }
+    }
+    while (!calls.empty())
+    {
+        Fetch(index, calls);
+        calls.clear();
+        std::lock_guard<std::mutex> sourceLock(source.Mutex);
+        calls.swap(source.Queued);
+        source.Busy = !calls.empty();
+    }
+
+    // Last access to this object, the destructor may return right after.
+    std::lock_guard<std::mutex> lock(m_RunningMutex);
+    if (--m_Running == 0)
+    {
+        m_Idle.notify_all();
+    }
+}
+
+// One fetch of the source for the calls not finished yet, with the union of their fields and the latest of
+// their deadlines for it.
+void CompositeOperatingSystemInfoFetcher::Fetch(size_t index,
+                                                std::vector<std::pair<std::shared_ptr<Call>, OperatingSystemInfoFieldMask>>& calls)
+{
+    auto& source = *m_Sources[index];
+    OperatingSystemInfoFieldMask fields;
+    auto deadline = std::chrono::steady_clock::time_point::min();
+    for (auto& entry : calls)
+    {
+        bool finished = false;
+        {
+            std::lock_guard<std::mutex> lock(entry.first->Mutex);
+            finished = entry.first->Finished;
+        }
+        if (finished)
+        {
+            m_Skipped.fetch_add(1, std::memory_order_relaxed);
+            entry.first = nullptr;
+            continue;
+        }
+        fields |= entry.second;
+        deadline = (std::max)(deadline, entry.first->GetSourceDeadline(source));
+    }
+    if (deadline == std::chrono::steady_clock::time_point::min())
+    {
+        return;
+    }
+
+    m_Started.fetch_add(1, std::memory_order_relaxed);
+    OperatingSystemInfo info;
+    // The fields the source times out on come back without a value, the calls report them when they
+    // have no other source.
+    OperatingSystemInfoFieldMask timedOut;
+    bool failed = false;
+    try
+    {
+        info = source.Fetcher->GetInformation(fields, deadline, timedOut, nullptr);
+    }
+    catch (...)
+    {
+        m_Failed.fetch_add(1, std::memory_order_relaxed);
+        failed = true;
+    }
+    for (const auto& entry : calls)
+    {
+        if (entry.first)
+        {
+            Complete(*entry.first, index, failed ? nullptr : &info, timedOut);
+        }
+    }
+}
+
+bool CompositeOperatingSystemInfoFetcher::IsBetter(size_t source, size_t other, size_t field) const noexcept
+{
+    int left = m_Sources[source]->Priorities[field], right = m_Sources[other]->Priorities[field];
+    return left != right ? left > right : source < other;
+}
+
+void CompositeOperatingSystemInfoFetcher::Complete(Call& call, size_t index, const OperatingSystemInfo* info,
+                                                   OperatingSystemInfoFieldMask timedOut)
+{
+    std::unique_lock<std::mutex> lock(call.Mutex);
+    if (call.Finished)
+    {
+        CompleteLate(call, index, info);
+        return;
+    }
+
+    const auto& source = *m_Sources[index];
+    call.Pending[index] = false;
+    // A source given up on which is done before the end of the call still counts.
+    if (!call.GivenUp[index])
+    {
+        --call.Remaining;
+    }
+    if (info)
+    {
+        call.SourceTimedOut |= timedOut & source.Fields & call.Requested;
+    }
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        auto field = static_cast<OperatingSystemInfoField>(i);
+        if (!call.Unresolved.Has(field) || !info || !source.Fields.Has(field))
+        {
+            continue;
+        }
+        const auto& value = GetField(*info, field);
+        auto& owner = call.Owners[i];
+        if (value && !value->empty() && (owner == detail::NoSource || IsBetter(index, owner, i)))
+        {
+            GetField(call.Result, field) = value;
+            owner = index;
+        }
+    }
+    Resolve(call);
+}
+
+// Called with the lock of the call held.
+void CompositeOperatingSystemInfoFetcher::GiveUp(Call& call, size_t index)
+{
+    m_TimedOut.fetch_add(1, std::memory_order_relaxed);
+    call.GivenUp[index] = true;
+    --call.Remaining;
+    Resolve(call);
+}
+
+// Drops the fields no source the call waits for could still fill or replace, and finishes the call when none is left.
+// Called with the lock of the call held.
+void CompositeOperatingSystemInfoFetcher::Resolve(Call& call)
+{
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        auto field = static_cast<OperatingSystemInfoField>(i);
+        if (!call.Unresolved.Has(field))
+        {
+            continue;
+        }
+        auto owner = call.Owners[i];
+        bool replaceable = false;
+        for (size_t other = 0; other < m_Sources.size() && !replaceable; ++other)
+        {
+            replaceable = call.Pending[other] && !call.GivenUp[other] && m_Sources[other]->Fields.Has(field) &&
+                          (owner == detail::NoSource || IsBetter(other, owner, i));
+        }
+        if (!replaceable)
+        {
+            call.Unresolved.Reset(field);
+        }
+    }
+
+    if (!call.Unresolved.Empty() && call.Remaining > 0)
+    {
+        return;
+    }
+    // Requested fields without a value which a source timed out on, or which a source given up on was still fetching.
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        auto field = static_cast<OperatingSystemInfoField>(i);
+        if (call.Owners[i] == detail::NoSource && call.SourceTimedOut.Has(field))
+        {
+            call.TimedOut.Set(field);
+        }
+    }
+    for (size_t index = 0; index < m_Sources.size(); ++index)
+    {
+        if (call.Pending[index] && call.GivenUp[index])
+        {
+            for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+            {
+                auto field = static_cast<OperatingSystemInfoField>(i);
+                if (call.Owners[i] == detail::NoSource && call.Requested.Has(field) && m_Sources[index]->Fields.Has(field))
+                {
+                    call.TimedOut.Set(field);
+                }
+            }
+        }
+    }
+    call.Finished = true;
+    call.Resolved.notify_all();
+}
+
+// Gives the values of the fields the call timed out on to its late callback, with the same priorities
+// as in time so that a late source does not replace the value of a better one which was later still.
+// Called with the lock of the call held, which keeps the callbacks of one call in order.
+void CompositeOperatingSystemInfoFetcher::CompleteLate(Call& call, size_t index, const OperatingSystemInfo* info)
+{
+    m_Late.fetch_add(1, std::memory_order_relaxed);
+    call.Pending[index] = false;
+    if (!info || !call.OnLate)
+    {
+        return;
+    }
+
+    const auto& source = *m_Sources[index];
+    OperatingSystemInfo late;
+    OperatingSystemInfoFieldMask lateFields;
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        auto field = static_cast<OperatingSystemInfoField>(i);
+        if (!call.TimedOut.Has(field) || !source.Fields.Has(field))
+        {
+            continue;
+        }
+        const auto& value = GetField(*info, field);
+        auto& owner = call.Owners[i];
+        if (value && !value->empty() && (owner == detail::NoSource || IsBetter(index, owner, i)))
+        {
+            GetField(late, field) = value;
+            lateFields.Set(field);
+            owner = index;
+        }
+    }
+    if (lateFields.Empty())
+    {
+        return;
+    }
+    try
+    {
+        call.OnLate(late, lateFields);
+    }
+    catch (...)
+    {
+        // TODO: Should put error information when logger is published.
+    }
+}
@@ -0,0 +1,32 @@
+#include "pch.h"
+#include "FetchTiming.h"
+
+#if OPERATINGSYSTEMINFO_TIMING
+namespace detail
+{
+std::array<LatencyHistogram, FetchStageCount> s_FetchStageHistograms;
+} // namespace detail
+#endif
+
+FetchTimingStatistics GetFetchTimingStatistics() noexcept
+{
+    FetchTimingStatistics statistics;
+#if OPERATINGSYSTEMINFO_TIMING
+    statistics.Enabled = true;
+    for (size_t i = 0; i < FetchStageCount; ++i)
+    {
+        statistics.Stages[i] = detail::s_FetchStageHistograms[i].Snapshot();
+    }
+#endif
+    return statistics;
+}
+
+void ResetFetchTiming() noexcept
+{
+#if OPERATINGSYSTEMINFO_TIMING
+    for (auto& histogram : detail::s_FetchStageHistograms)
+    {
+        histogram.Reset();
+    }
+#endif
+}
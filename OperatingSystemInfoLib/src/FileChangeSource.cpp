@@ -0,0 +1,318 @@
+#include "pch.h"
+#include "FileChangeSource.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct FileChangeSource::Watch
+{
+    std::string Directory;
+    // Names of the watched files within Directory.
+    std::vector<std::string> Names;
+#ifdef _WIN32
+    struct FileState
+    {
+        bool Exists = false;
+        uint64_t LastWriteTime = 0;
+        uint64_t Size = 0;
+
+        bool operator!=(const FileState& other) const
+        {
+            return Exists != other.Exists || LastWriteTime != other.LastWriteTime || Size != other.Size;
+        }
+    };
+    // Last state seen of each of Names.
+    std::vector<FileState> States;
+
+    FileState GetState(const std::string& name) const
+    {
+        FileState state;
+        WIN32_FILE_ATTRIBUTE_DATA data{};
+        if (GetFileAttributesExA((Directory + "\\" + name).c_str(), GetFileExInfoStandard, &data))
+        {
+            state.Exists = true;
+            state.LastWriteTime =
+                (uint64_t{data.ftLastWriteTime.dwHighDateTime} << 32) | data.ftLastWriteTime.dwLowDateTime;
+            state.Size = (uint64_t{data.nFileSizeHigh} << 32) | data.nFileSizeLow;
+        }
+        return state;
+    }
+    void* Notification = nullptr;
+#else
+    int Descriptor = -1;
+#endif
+};
+
+// Adds path to the watch of its directory, "os-release" is in ".".
+void FileChangeSource::AddWatchedFile(const std::string& path)
+{
+    auto separator = path.find_last_of(
+#ifdef _WIN32
+        "\\/"
+#else
+        "/"
+#endif
+    );
+    auto directory = separator == std::string::npos ? std::string(".")
+                     : separator == 0                ? path.substr(0, 1)
+                                                     : path.substr(0, separator);
+    auto name = separator == std::string::npos ? path : path.substr(separator + 1);
+    if (name.empty())
+    {
+        return;
+    }
+
+    auto watch = std::find_if(m_Watches.begin(), m_Watches.end(),
+                              [&directory](const Watch& w) { return w.Directory == directory; });
+    if (watch == m_Watches.end())
+    {
+        m_Watches.emplace_back();
+        watch = m_Watches.end() - 1;
+        watch->Directory = std::move(directory);
+    }
+    if (std::find(watch->Names.begin(), watch->Names.end(), name) == watch->Names.end())
+    {
+        watch->Names.push_back(std::move(name));
+    }
+}
+
+FileChangeSource::FileChangeSource(std::vector<std::string> paths) noexcept : m_Paths(std::move(paths))
+{
+}
+
+FileChangeSource::~FileChangeSource()
+{
+    Stop();
+}
+
+#ifdef _WIN32
+bool FileChangeSource::Start(std::function<void()> onChange)
+{
+    Stop();
+    for (const auto& path : m_Paths)
+    {
+        AddWatchedFile(path);
+    }
+
+    bool watching = false;
+    for (auto& watch : m_Watches)
+    {
+        for (const auto& name : watch.Names)
+        {
+            watch.States.push_back(watch.GetState(name));
+        }
+        constexpr DWORD Filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+        auto notification = FindFirstChangeNotificationA(watch.Directory.c_str(), FALSE, Filter);
+        if (notification != INVALID_HANDLE_VALUE)
+        {
+            watch.Notification = notification;
+            watching = true;
+        }
+    }
+    // One wait handle is taken by the stop event.
+    m_StopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!watching || !m_StopEvent || m_Watches.size() >= MAXIMUM_WAIT_OBJECTS)
+    {
+        Stop();
+        return false;
+    }
+
+    m_OnChange = std::move(onChange);
+    m_Thread = std::thread(&FileChangeSource::Run, this);
+    return true;
+}
+
+void FileChangeSource::Stop()
+{
+    if (m_Thread.joinable())
+    {
+        SetEvent(m_StopEvent);
+        m_Thread.join();
+    }
+    for (auto& watch : m_Watches)
+    {
+        if (watch.Notification)
+        {
+            FindCloseChangeNotification(watch.Notification);
+        }
+    }
+    m_Watches.clear();
+    if (m_StopEvent)
+    {
+        CloseHandle(m_StopEvent);
+        m_StopEvent = nullptr;
+    }
+    m_OnChange = nullptr;
+}
+
+void FileChangeSource::Run()
+{
+    std::vector<HANDLE> handles{m_StopEvent};
+    std::vector<Watch*> watches{nullptr};
+    for (auto& watch : m_Watches)
+    {
+        if (watch.Notification)
+        {
+            handles.push_back(watch.Notification);
+            watches.push_back(&watch);
+        }
+    }
+
+    for (;;)
+    {
+        auto rv = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+        if (rv <= WAIT_OBJECT_0 || rv >= WAIT_OBJECT_0 + handles.size())
+        {
+            return;
+        }
+
+        // The notification covers the whole directory, only the watched files are compared.
+        auto& watch = *watches[rv - WAIT_OBJECT_0];
+        FindNextChangeNotification(watch.Notification);
+        bool changed = false;
+        for (size_t i = 0; i < watch.Names.size(); ++i)
+        {
+            auto state = watch.GetState(watch.Names[i]);
+            if (state != watch.States[i])
+            {
+                watch.States[i] = state;
+                changed = true;
+            }
+        }
+        if (changed)
+        {
+            m_OnChange();
+        }
+    }
+}
+#else
+bool FileChangeSource::Start(std::function<void()> onChange)
+{
+    Stop();
+    for (const auto& path : m_Paths)
+    {
+        AddWatchedFile(path);
+        struct stat status{};
+        char target[PATH_MAX];
+        if (lstat(path.c_str(), &status) == 0 && S_ISLNK(status.st_mode) && realpath(path.c_str(), target))
+        {
+            AddWatchedFile(target);
+        }
+    }
+
+    m_Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_Notify < 0 || pipe2(m_StopPipe, O_CLOEXEC) != 0)
+    {
+        Stop();
+        return false;
+    }
+
+    // Writes in place end with IN_CLOSE_WRITE, replacements with IN_MOVED_TO or IN_CREATE.
+    constexpr uint32_t Mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+    bool watching = false;
+    for (auto& watch : m_Watches)
+    {
+        watch.Descriptor = inotify_add_watch(m_Notify, watch.Directory.c_str(), Mask | IN_ONLYDIR);
+        watching |= watch.Descriptor >= 0;
+    }
+    if (!watching)
+    {
+        Stop();
+        return false;
+    }
+
+    m_OnChange = std::move(onChange);
+    m_Thread = std::thread(&FileChangeSource::Run, this);
+    return true;
+}
+
+void FileChangeSource::Stop()
+{
+    if (m_Thread.joinable())
+    {
+        char stop = 0;
+        while (write(m_StopPipe[1], &stop, 1) < 0 && errno == EINTR)
+        {
+        }
+        m_Thread.join();
+    }
+    for (auto& descriptor : {&m_Notify, &m_StopPipe[0], &m_StopPipe[1]})
+    {
+        if (*descriptor >= 0)
+        {
+            close(*descriptor);
+            *descriptor = -1;
+        }
+    }
+    // Closing the inotify descriptor removed every watch.
+    m_Watches.clear();
+    m_OnChange = nullptr;
+}
+
+void FileChangeSource::Run()
+{
+    alignas(inotify_event) char buffer[4096];
+    pollfd descriptors[] = {{m_Notify, POLLIN, 0}, {m_StopPipe[0], POLLIN, 0}};
+    for (;;)
+    {
+        if (poll(descriptors, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        if (descriptors[1].revents != 0)
+        {
+            return;
+        }
+
+        // Every pending event is read before reporting, so a burst of writes makes one notification.
+        bool changed = false;
+        for (;;)
+        {
+            auto size = read(m_Notify, buffer, sizeof(buffer));
+            if (size <= 0)
+            {
+                break;
+            }
+            for (auto position = buffer; position < buffer + size;)
+            {
+                auto event = reinterpret_cast<const inotify_event*>(position);
+                position += sizeof(inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    // Events were lost.
+                    changed = true;
+                    continue;
+                }
+                auto watch = std::find_if(m_Watches.begin(), m_Watches.end(),
+                                          [event](const Watch& w) { return w.Descriptor == event->wd; });
+                if (watch != m_Watches.end() && event->len > 0 &&
+                    std::find(watch->Names.begin(), watch->Names.end(), event->name) != watch->Names.end())
+                {
+                    changed = true;
+                }
+            }
+        }
+        if (changed)
+        {
+            m_OnChange();
+        }
+    }
+}
+#endif
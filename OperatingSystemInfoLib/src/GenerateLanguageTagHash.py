@@ -0,0 +1,72 @@
+"""Generates LanguageTagHash.inc, the seeds of the perfect hash of the tags in LanguageTags.inc.
+
+A tag goes to bucket HashLanguageTag(tag, 0) % BucketCount, then to slot HashLanguageTag(tag, seed) % SlotCount
+with the seed of its bucket. Seeds are picked bucket by bucket, largest first, so that no two tags share a slot.
+HashLanguageTag must stay the same as in LanguageTags.cpp.
+
+    python3 GenerateLanguageTagHash.py
+"""
+
+import os
+import re
+
+BUCKET_COUNT = 128
+SLOT_COUNT = 512
+MASK = 0xFFFFFFFF
+
+
+def hash_language_tag(tag, seed):
+    value = 2166136261 ^ ((seed * 0x9E3779B9) & MASK)
+    for c in tag.lower().encode('ascii'):
+        value ^= c
+        value = (value * 16777619) & MASK
+    value ^= value >> 16
+    value = (value * 0x7FEB352D) & MASK
+    value ^= value >> 15
+    value = (value * 0x846CA68B) & MASK
+    value ^= value >> 16
+    return value
+
+
+def main():
+    directory = os.path.dirname(os.path.abspath(__file__))
+    with open(os.path.join(directory, 'LanguageTags.inc'), encoding='utf-8') as rows:
+        tags = re.findall(r'^LANGUAGE_TAG\(0x[0-9A-Fa-f]+, "([^"]+)"\)', rows.read(), re.MULTILINE)
+    if len(set(tag.lower() for tag in tags)) != len(tags):
+        raise SystemExit('LanguageTags.inc has duplicate tags')
+
+    buckets = [[] for _ in range(BUCKET_COUNT)]
+    for tag in tags:
+        buckets[hash_language_tag(tag, 0) % BUCKET_COUNT].append(tag)
+
+    seeds = [0] * BUCKET_COUNT
+    used = set()
+    for bucket in sorted(range(BUCKET_COUNT), key=lambda b: -len(buckets[b])):
+        if not buckets[bucket]:
+            break
+        for seed in range(1, 1 << 16):
+            slots = {hash_language_tag(tag, seed) % SLOT_COUNT for tag in buckets[bucket]}
+            if len(slots) == len(buckets[bucket]) and not slots & used:
+                seeds[bucket] = seed
+                used |= slots
+                break
+        else:
+            raise SystemExit('No seed found, raise SLOT_COUNT')
+
+    lines = [
+        '// Generated by GenerateLanguageTagHash.py from LanguageTags.inc, do not edit.',
+        '',
+        f'constexpr size_t s_LanguageTagBucketCount = {BUCKET_COUNT};',
+        f'constexpr size_t s_LanguageTagSlotCount = {SLOT_COUNT};',
+        '',
+        'constexpr uint16_t s_LanguageTagSeeds[s_LanguageTagBucketCount] = {',
+    ]
+    for start in range(0, BUCKET_COUNT, 16):
+        lines.append('    ' + ', '.join(str(seed) for seed in seeds[start:start + 16]) + ',')
+    lines.append('};')
+    with open(os.path.join(directory, 'LanguageTagHash.inc'), 'w', encoding='utf-8', newline='\n') as output:
+        output.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "HostCollectionScheduler.h"
+#include "IHostTransport.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <queue>
+#include <random>
+#include <utility>
+
+using Clock = std::chrono::steady_clock;
+
+struct HostCollectionScheduler::Batch
+{
+    struct Host
+    {
+        std::string Name;
+        Clock::time_point Start;
+        Clock::time_point Deadline;
+        unsigned Attempts = 0;
+        // An attempt holds one of the InFlight slots.
+        bool Running = false;
+        bool Done = false;
+        std::string Error;
+    };
+    // Host index by time, the earliest first.
+    using Timer = std::pair<Clock::time_point, size_t>;
+    using TimerQueue = std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>>;
+
+    // Guards everything below, Name and Deadline are not written anymore once an attempt is submitted.
+    std::mutex Mutex;
+    std::condition_variable Changed;
+    std::vector<Host> Hosts;
+    std::deque<size_t> Ready;
+    TimerQueue Retries;
+    TimerQueue Deadlines;
+    size_t InFlight = 0;
+    uint64_t RetryCount = 0;
+    // Results waiting to be given to the caller's thread.
+    std::vector<HostCollectionResult> Completed;
+    std::minstd_rand Random{std::random_device{}()};
+
+    void Finish(size_t index, HostCollectionStatus status, OperatingSystemInfo info)
+    {
+        auto& host = Hosts[index];
+        host.Done = true;
+        // The slot of an abandoned attempt goes to the next host, the attempt only keeps its worker.
+        if (host.Running)
+        {
+            host.Running = false;
+            --InFlight;
+        }
+        HostCollectionResult result;
+        result.Host = host.Name;
+        result.Status = status;
+        result.Info = std::move(info);
+        result.Error = std::move(host.Error);
+        result.Attempts = host.Attempts;
+        result.Elapsed = Clock::now() - host.Start;
+        Completed.push_back(std::move(result));
+    }
+};
+
+namespace detail
+{
+// InitialBackoff * 2^(attempts - 1) up to MaxBackoff, then a random part of the upper half of it.
+Clock::duration GetBackoff(const HostCollectionOptions& options, unsigned attempts, std::minstd_rand& random)
+{
+    auto backoff = options.InitialBackoff;
+    for (unsigned i = 1; i < attempts && backoff < options.MaxBackoff; ++i)
+    {
+        backoff *= 2;
+    }
+    backoff = (std::min)(backoff, options.MaxBackoff);
+    std::uniform_int_distribution<Clock::rep> jitter(backoff.count() / 2, (std::max)(backoff.count(), Clock::rep{0}));
+    return Clock::duration(jitter(random));
+}
+} // namespace detail
+
+HostCollectionScheduler::HostCollectionScheduler(ThreadPool& pool, IHostTransport& transport,
+                                                 HostCollectionOptions options) noexcept
+    : m_Pool(pool), m_Transport(transport), m_Options(std::move(options))
+{
+    m_Options.MaxConcurrency = (std::max)(m_Options.MaxConcurrency, size_t{1});
+    m_Options.MaxAttempts = (std::max)(m_Options.MaxAttempts, 1u);
+}
+
+HostCollectionScheduler::~HostCollectionScheduler()
+{
+    std::unique_lock<std::mutex> lock(m_RunningMutex);
+    m_Idle.wait(lock, [this] { return m_Running == 0; });
+}
+
+HostCollectionStatistics HostCollectionScheduler::Collect(const std::vector<std::string>& hosts,
+                                                          const ResultCallback& onResult)
+{
+    HostCollectionStatistics statistics;
+    statistics.Hosts = hosts.size();
+    auto start = Clock::now();
+
+    auto batch = std::make_shared<Batch>();
+    batch->Hosts.resize(hosts.size());
+    for (size_t i = 0; i < hosts.size(); ++i)
+    {
+        batch->Hosts[i].Name = hosts[i];
+        batch->Ready.push_back(i);
+    }
+
+    size_t remaining = hosts.size();
+    std::vector<HostCollectionResult> completed;
+    std::unique_lock<std::mutex> lock(batch->Mutex);
+    while (remaining > 0)
+    {
+        auto now = Clock::now();
+        // A host past its deadline ends now, whether an attempt is running or it waits for a retry.
+        while (!batch->Deadlines.empty() && batch->Deadlines.top().first <= now)
+        {
+            auto index = batch->Deadlines.top().second;
+            batch->Deadlines.pop();
+            if (!batch->Hosts[index].Done)
+            {
+                if (batch->Hosts[index].Error.empty())
+                {
+                    batch->Hosts[index].Error = "Deadline exceeded";
+                }
+                batch->Finish(index, HostCollectionStatus::TimedOut, {});
+            }
+        }
+        while (!batch->Retries.empty() && batch->Retries.top().first <= now)
+        {
+            auto index = batch->Retries.top().second;
+            batch->Retries.pop();
+            if (!batch->Hosts[index].Done)
+            {
+                batch->Ready.push_back(index);
+            }
+        }
+        while (batch->InFlight < m_Options.MaxConcurrency && !batch->Ready.empty())
+        {
+            auto index = batch->Ready.front();
+            batch->Ready.pop_front();
+            auto& host = batch->Hosts[index];
+            if (host.Attempts++ == 0)
+            {
+                host.Start = now;
+                host.Deadline = now + m_Options.HostTimeout;
+                batch->Deadlines.emplace(host.Deadline, index);
+            }
+            host.Running = true;
+            ++batch->InFlight;
+            ++statistics.Attempts;
+            {
+                std::lock_guard<std::mutex> runningLock(m_RunningMutex);
+                ++m_Running;
+            }
+            m_Pool.Submit([this, batch, index] { Attempt(batch, index); });
+        }
+
+        if (!batch->Completed.empty())
+        {
+            completed.swap(batch->Completed);
+            lock.unlock();
+            for (const auto& result : completed)
+            {
+                --remaining;
+                switch (result.Status)
+                {
+                case HostCollectionStatus::Succeeded:
+                    ++statistics.Succeeded;
+                    break;
+                case HostCollectionStatus::Failed:
+                    ++statistics.Failed;
+                    break;
+                case HostCollectionStatus::TimedOut:
+                    ++statistics.TimedOut;
+                    break;
+                }
+                onResult(result);
+            }
+            completed.clear();
+            lock.lock();
+            continue;
+        }
+
+        // Woken up by a finished attempt, or by the next retry or deadline.
+        auto wakeUp = Clock::time_point::max();
+        if (!batch->Retries.empty())
+        {
+            wakeUp = batch->Retries.top().first;
+        }
+        if (!batch->Deadlines.empty())
+        {
+            wakeUp = (std::min)(wakeUp, batch->Deadlines.top().first);
+        }
+        if (wakeUp == Clock::time_point::max())
+        {
+            batch->Changed.wait(lock);
+        }
+        else
+        {
+            batch->Changed.wait_until(lock, wakeUp);
+        }
+    }
+    statistics.Retries = batch->RetryCount;
+    lock.unlock();
+
+    statistics.Elapsed = Clock::now() - start;
+    auto seconds = std::chrono::duration<double>(statistics.Elapsed).count();
+    statistics.HostsPerSecond = seconds > 0 ? statistics.Hosts / seconds : 0;
+    return statistics;
+}
+
+void HostCollectionScheduler::Attempt(const std::shared_ptr<Batch>& batch, size_t index)
+{
+    const auto& name = batch->Hosts[index].Name;
+    auto deadline = batch->Hosts[index].Deadline;
+
+    OperatingSystemInfo info;
+    std::string error;
+    bool succeeded = false;
+    try
+    {
+        succeeded = m_Transport.Collect(name, m_Options.Fields, deadline, info, error);
+    }
+    catch (const std::exception& e)
+    {
+        error = e.what();
+    }
+    catch (...)
+    {
+        error = "Unknown exception";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(batch->Mutex);
+        auto& host = batch->Hosts[index];
+        auto now = Clock::now();
+        // A host which timed out already keeps its result, and gave up its slot then.
+        if (!host.Done)
+        {
+            host.Running = false;
+            --batch->InFlight;
+            if (now > host.Deadline)
+            {
+                host.Error = succeeded ? "Deadline exceeded" : std::move(error);
+                batch->Finish(index, HostCollectionStatus::TimedOut, {});
+            }
+            else if (succeeded)
+            {
+                host.Error.clear();
+                batch->Finish(index, HostCollectionStatus::Succeeded, std::move(info));
+            }
+            else
+            {
+                host.Error = error.empty() ? "Collection failed" : std::move(error);
+                auto retry = now + detail::GetBackoff(m_Options, host.Attempts, batch->Random);
+                if (host.Attempts < m_Options.MaxAttempts && retry < host.Deadline)
+                {
+                    batch->Retries.emplace(retry, index);
+                    ++batch->RetryCount;
+                }
+                else
+                {
+                    batch->Finish(index, HostCollectionStatus::Failed, {});
+                }
+            }
+        }
+        batch->Changed.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lock(m_RunningMutex);
+    if (--m_Running == 0)
+    {
+        m_Idle.notify_all();
+    }
+}
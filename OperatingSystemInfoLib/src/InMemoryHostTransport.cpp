@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "InMemoryHostTransport.h"
+#include "InMemoryReg.h"
+#include "InMemoryWmi.h"
+#include "OperatingSystemInfoSources.h"
+
+#include <algorithm>
+#include <thread>
+
+InMemoryHostTransport::InMemoryHostTransport(const InMemoryWmiRepository& wmi, const InMemoryRegistry& registry,
+                                             InMemoryHostTransportOptions options) noexcept
+    : m_Wmi(wmi), m_Registry(registry), m_Options(options), m_Random(options.Seed)
+{
+}
+
+void InMemoryHostTransport::SetFailures(const std::string& host, uint32_t attempts)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Hosts[host].Failures = attempts;
+}
+
+void InMemoryHostTransport::SetLatency(const std::string& host, std::chrono::steady_clock::duration latency)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto& entry = m_Hosts[host];
+    entry.HasLatency = true;
+    entry.Latency = latency;
+}
+
+bool InMemoryHostTransport::Collect(const std::string& host, OperatingSystemInfoFieldMask fields,
+                                    std::chrono::steady_clock::time_point deadline, OperatingSystemInfo& result,
+                                    std::string& error)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration latency;
+    bool fail = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_Statistics.Attempts;
+        std::uniform_int_distribution<std::chrono::steady_clock::rep> latencies(
+            m_Options.MinLatency.count(), (std::max)(m_Options.MinLatency, m_Options.MaxLatency).count());
+        latency = std::chrono::steady_clock::duration(latencies(m_Random));
+        fail = std::uniform_real_distribution<double>(0, 1)(m_Random) < m_Options.FailureRate;
+
+        auto found = m_Hosts.find(host);
+        if (found != m_Hosts.end())
+        {
+            auto& entry = found->second;
+            if (entry.HasLatency)
+            {
+                latency = entry.Latency;
+            }
+            fail |= entry.Attempts++ < entry.Failures;
+        }
+    }
+
+    // A real transport gives up at the deadline rather than sleeping past it.
+    if (start + latency > deadline)
+    {
+        std::this_thread::sleep_until(deadline);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_Statistics.TimedOut;
+        error = "Timed out connecting to " + host;
+        return false;
+    }
+    std::this_thread::sleep_until(start + latency);
+    if (fail)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_Statistics.InjectedFailures;
+        error = "Injected failure on " + host;
+        return false;
+    }
+
+    auto needed = detail::GetNeededFields(fields);
+    if (needed.Intersects(detail::s_WmiFields))
+    {
+        InMemoryWmi provider(m_Wmi);
+        detail::ReadOperatingSystemObject(provider, needed, fields, result);
+    }
+    if (needed.Intersects(detail::s_RegistryFields))
+    {
+        InMemoryReg reg;
+        reg.Open(m_Registry, "SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion");
+        detail::ReadCurrentVersionValues(reg, result);
+    }
+    detail::CompleteInformation(fields, result);
+    return true;
+}
+
+InMemoryHostTransportStatistics InMemoryHostTransport::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "InMemoryReg.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace detail
+{
+    std::string NormalizeKeyPath(const char* path)
+    {
+        std::string normalized;
+        for (; path && *path; ++path)
+        {
+            const char c = *path;
+            if (c == '\\' && (normalized.empty() || normalized.back() == '\\'))
+            {
+                continue;
+            }
+            normalized.push_back(c >= 'a' && c <= 'z' ? static_cast<char>(c - ('a' - 'A')) : c);
+        }
+        if (!normalized.empty() && normalized.back() == '\\')
+        {
+            normalized.pop_back();
+        }
+        return normalized;
+    }
+
+    template <class T> std::vector<std::byte> ToBytes(T value)
+    {
+        std::vector<std::byte> bytes(sizeof(value));
+        std::memcpy(bytes.data(), &value, sizeof(value));
+        return bytes;
+    }
+
+    // REG_SZ data is UTF-16LE including the terminating NUL.
+    std::vector<std::byte> ToRegistryString(const wchar_t* value)
+    {
+        std::vector<std::byte> bytes;
+        auto append = [&bytes](uint32_t unit) {
+            bytes.push_back(static_cast<std::byte>(unit & 0xFF));
+            bytes.push_back(static_cast<std::byte>(unit >> 8));
+        };
+        for (; value && *value; ++value)
+        {
+            auto c = static_cast<uint32_t>(*value);
+            if (c >= 0x10000)
+            {
+                c -= 0x10000;
+                append(0xD800 + (c >> 10));
+                append(0xDC00 + (c & 0x3FF));
+            }
+            else
+            {
+                append(c);
+            }
+        }
+        append(0);
+        return bytes;
+    }
+}
+
+void InMemoryRegistry::SetStringValue(const char* path, const char* name, const wchar_t* value)
+{
+    SetValue(path, name, RegistryValueType::String, detail::ToRegistryString(value));
+}
+
+void InMemoryRegistry::SetIntValue(const char* path, const char* name, uint32_t value)
+{
+    SetValue(path, name, RegistryValueType::Dword, detail::ToBytes(value));
+}
+
+void InMemoryRegistry::SetInt64Value(const char* path, const char* name, uint64_t value)
+{
+    SetValue(path, name, RegistryValueType::Qword, detail::ToBytes(value));
+}
+
+void InMemoryRegistry::SetBinaryValue(const char* path, const char* name, std::vector<std::byte> value)
+{
+    SetValue(path, name, RegistryValueType::Binary, std::move(value));
+}
+
+void InMemoryRegistry::SetValue(const char* path, const char* name, RegistryValueType type, std::vector<std::byte> data)
+{
+    auto& values = m_Keys[detail::NormalizeKeyPath(path)];
+    auto itr = std::find_if(values.begin(), values.end(), [name](const Value& value) {
+        RegistryValueName valueName{value.Name.data(), value.Name.size(), false};
+        return valueName.EqualsAscii(name, std::strlen(name));
+    });
+    if (itr == values.end())
+    {
+        values.push_back({name, type, std::move(data)});
+        return;
+    }
+    itr->Type = type;
+    itr->Data = std::move(data);
+}
+
+const std::vector<InMemoryRegistry::Value>* InMemoryRegistry::FindKey(const char* path) const
+{
+    auto itr = m_Keys.find(detail::NormalizeKeyPath(path));
+    return itr != m_Keys.end() ? &itr->second : nullptr;
+}
+
+bool InMemoryReg::Open(const InMemoryRegistry& registry, const char* path)
+{
+    m_Values = registry.FindKey(path);
+    return m_Values != nullptr;
+}
+
+void InMemoryReg::Close()
+{
+    m_Values = nullptr;
+}
+
+bool InMemoryReg::ForEachValue(IRegistryValueVisitor& visitor) const
+{
+    if (!m_Values)
+    {
+        return false;
+    }
+
+    for (const auto& value : *m_Values)
+    {
+        RegistryValue entry{{value.Name.data(), value.Name.size(), false}, value.Type, value.Data.data(), value.Data.size()};
+        if (!visitor.Visit(entry))
+        {
+            break;
+        }
+    }
+    return true;
+}
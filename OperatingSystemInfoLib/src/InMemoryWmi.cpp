@@ -0,0 +1,989 @@
+#include "pch.h"
+#include "InMemoryWmi.h"
+#include "Utf16.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace detail
+{
+inline wchar_t FoldAscii(wchar_t c)
+{
+    return c >= L'a' && c <= L'z' ? static_cast<wchar_t>(c - (L'a' - L'A')) : c;
+}
+
+int CompareNoCase(std::wstring_view left, std::wstring_view right)
+{
+    auto length = (std::min)(left.size(), right.size());
+    for (size_t i = 0; i < length; ++i)
+    {
+        auto l = FoldAscii(left[i]), r = FoldAscii(right[i]);
+        if (l != r)
+        {
+            return l < r ? -1 : 1;
+        }
+    }
+    return left.size() == right.size() ? 0 : left.size() < right.size() ? -1 : 1;
+}
+
+bool EqualsNoCase(std::wstring_view left, std::wstring_view right)
+{
+    return left.size() == right.size() && CompareNoCase(left, right) == 0;
+}
+
+constexpr size_t NoProperty = static_cast<size_t>(-1);
+
+size_t FindProperty(const InMemoryWmiRepository::Class& wmiClass, std::wstring_view name)
+{
+    for (size_t i = 0; i < wmiClass.Properties.size(); ++i)
+    {
+        if (EqualsNoCase(wmiClass.Properties[i], name))
+        {
+            return i;
+        }
+    }
+    return NoProperty;
+}
+
+// Integers are 32-bit like VT_I4, unsigned values above INT32_MAX wrap the way WMI reports uint32 properties.
+bool ParseInt32(std::wstring_view text, int32_t& value)
+{
+    bool negative = !text.empty() && text.front() == L'-';
+    if (negative)
+    {
+        text.remove_prefix(1);
+    }
+    if (text.empty() || text.size() > 10)
+    {
+        return false;
+    }
+    int64_t number = 0;
+    for (auto c : text)
+    {
+        if (c < L'0' || c > L'9')
+        {
+            return false;
+        }
+        number = number * 10 + (c - L'0');
+    }
+    if (negative ? number > -int64_t{(std::numeric_limits<int32_t>::min)()} : number > (std::numeric_limits<uint32_t>::max)())
+    {
+        return false;
+    }
+    value = static_cast<int32_t>(static_cast<uint32_t>(negative ? -number : number));
+    return true;
+}
+
+// Cursor over MOF text. Blanks include comments and preprocessor lines such as #pragma namespace(...).
+class MofReader final
+{
+public:
+    explicit MofReader(std::string_view text) : m_Text(text), m_Offset(0)
+    {
+    }
+
+    bool AtEnd()
+    {
+        SkipBlanks();
+        return m_Offset == m_Text.size();
+    }
+
+    bool Consume(char c)
+    {
+        SkipBlanks();
+        if (m_Offset < m_Text.size() && m_Text[m_Offset] == c)
+        {
+            ++m_Offset;
+            return true;
+        }
+        return false;
+    }
+
+    bool ReadIdentifier(std::wstring& identifier)
+    {
+        SkipBlanks();
+        auto begin = m_Offset;
+        while (m_Offset < m_Text.size() && IsIdentifierChar(m_Text[m_Offset], m_Offset == begin))
+        {
+            ++m_Offset;
+        }
+        identifier.assign(m_Text.begin() + begin, m_Text.begin() + m_Offset);
+        return m_Offset != begin;
+    }
+
+    bool ConsumeKeyword(const wchar_t* keyword)
+    {
+        auto offset = m_Offset;
+        std::wstring identifier;
+        if (ReadIdentifier(identifier) && EqualsNoCase(identifier, keyword))
+        {
+            return true;
+        }
+        m_Offset = offset;
+        return false;
+    }
+
+    bool ReadValue(WmiValue& value)
+    {
+        SkipBlanks();
+        if (m_Offset == m_Text.size())
+        {
+            return false;
+        }
+        if (m_Text[m_Offset] == '"')
+        {
+            std::wstring text;
+            if (!ReadString(text))
+            {
+                return false;
+            }
+            value = std::move(text);
+            return true;
+        }
+        if (Consume('{'))
+        {
+            std::vector<std::wstring> strings;
+            if (!Consume('}'))
+            {
+                do
+                {
+                    strings.emplace_back();
+                    SkipBlanks();
+                    if (m_Offset == m_Text.size() || m_Text[m_Offset] != '"' || !ReadString(strings.back()))
+                    {
+                        return false;
+                    }
+                } while (Consume(','));
+                if (!Consume('}'))
+                {
+                    return false;
+                }
+            }
+            value = std::move(strings);
+            return true;
+        }
+
+        std::wstring token;
+        auto begin = m_Offset;
+        while (m_Offset < m_Text.size() && (IsIdentifierChar(m_Text[m_Offset], false) || m_Text[m_Offset] == '-'))
+        {
+            ++m_Offset;
+        }
+        token.assign(m_Text.begin() + begin, m_Text.begin() + m_Offset);
+        int32_t number = 0;
+        if (EqualsNoCase(token, L"TRUE") || EqualsNoCase(token, L"FALSE"))
+        {
+            value = EqualsNoCase(token, L"TRUE");
+        }
+        else if (EqualsNoCase(token, L"NULL"))
+        {
+            value = std::monostate{};
+        }
+        else if (ParseInt32(token, number))
+        {
+            value = number;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static bool IsIdentifierChar(char c, bool first)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (!first && c >= '0' && c <= '9');
+    }
+
+    void SkipBlanks()
+    {
+        while (m_Offset < m_Text.size())
+        {
+            auto rest = m_Text.substr(m_Offset);
+            if (rest[0] == ' ' || rest[0] == '\t' || rest[0] == '\r' || rest[0] == '\n')
+            {
+                ++m_Offset;
+            }
+            else if (rest[0] == '#' || rest.substr(0, 2) == "//")
+            {
+                auto end = rest.find('\n');
+                m_Offset = end == std::string_view::npos ? m_Text.size() : m_Offset + end + 1;
+            }
+            else if (rest.substr(0, 2) == "/*")
+            {
+                auto end = rest.find("*/", 2);
+                m_Offset = end == std::string_view::npos ? m_Text.size() : m_Offset + end + 2;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    // Adjacent literals are concatenated, "a" "b" is "ab".
+    bool ReadString(std::wstring& text)
+    {
+        do
+        {
+            ++m_Offset;
+            while (true)
+            {
+                if (m_Offset == m_Text.size() || m_Text[m_Offset] == '\n')
+                {
+                    return false;
+                }
+                char c = m_Text[m_Offset];
+                if (c == '"')
+                {
+                    ++m_Offset;
+                    break;
+                }
+                if (c == '\\')
+                {
+                    if (++m_Offset == m_Text.size())
+                    {
+                        return false;
+                    }
+                    switch (m_Text[m_Offset++])
+                    {
+                    case 'n':
+                        text.push_back(L'\n');
+                        break;
+                    case 't':
+                        text.push_back(L'\t');
+                        break;
+                    case 'r':
+                        text.push_back(L'\r');
+                        break;
+                    case 'x':
+                    case 'X':
+                    {
+                        uint32_t code = 0;
+                        size_t digits = 0;
+                        for (; digits < 4 && m_Offset < m_Text.size() && std::isxdigit(static_cast<unsigned char>(m_Text[m_Offset])); ++digits)
+                        {
+                            char h = m_Text[m_Offset++];
+                            code = code * 16 + (h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+                        }
+                        if (digits == 0)
+                        {
+                            return false;
+                        }
+                        text.push_back(static_cast<wchar_t>(code));
+                        break;
+                    }
+                    default:
+                        // \" \' \\ and any other character stand for themselves.
+                        text.push_back(static_cast<wchar_t>(m_Text[m_Offset - 1]));
+                        break;
+                    }
+                    continue;
+                }
+                AppendWide(NextUtf8CodePoint(m_Text.data(), m_Text.size(), m_Offset), text);
+            }
+            SkipBlanks();
+        } while (m_Offset < m_Text.size() && m_Text[m_Offset] == '"');
+        return true;
+    }
+
+    std::string_view m_Text;
+    size_t m_Offset;
+};
+
+struct MofInstance
+{
+    std::wstring ClassName;
+    std::vector<std::pair<std::wstring, WmiValue>> Properties;
+};
+
+bool ParseMof(std::string_view mof, std::vector<MofInstance>& instances)
+{
+    MofReader reader(mof);
+    while (!reader.AtEnd())
+    {
+        MofInstance instance;
+        if (!reader.ConsumeKeyword(L"instance") || !reader.ConsumeKeyword(L"of") ||
+            !reader.ReadIdentifier(instance.ClassName) || !reader.Consume('{'))
+        {
+            return false;
+        }
+        while (!reader.Consume('}'))
+        {
+            std::wstring name;
+            WmiValue value;
+            if (!reader.ReadIdentifier(name) || !reader.Consume('=') || !reader.ReadValue(value) || !reader.Consume(';'))
+            {
+                return false;
+            }
+            instance.Properties.emplace_back(std::move(name), std::move(value));
+        }
+        if (!reader.Consume(';'))
+        {
+            return false;
+        }
+        instances.push_back(std::move(instance));
+    }
+    return true;
+}
+
+enum class WqlTokenType
+{
+    End,
+    Identifier,
+    String,
+    Number,
+    Symbol,
+    Invalid,
+};
+
+struct WqlToken
+{
+    WqlTokenType Type = WqlTokenType::End;
+    // Identifier and symbol text, string content with escapes resolved, or the digits of a number.
+    std::wstring Text;
+};
+
+class WqlLexer final
+{
+public:
+    explicit WqlLexer(std::wstring_view text) : m_Text(text), m_Offset(0)
+    {
+        Advance();
+    }
+
+    const WqlToken& Peek() const
+    {
+        return m_Token;
+    }
+
+    WqlToken Take()
+    {
+        auto token = std::move(m_Token);
+        Advance();
+        return token;
+    }
+
+    bool IsKeyword(const wchar_t* keyword) const
+    {
+        return m_Token.Type == WqlTokenType::Identifier && EqualsNoCase(m_Token.Text, keyword);
+    }
+
+    bool IsSymbol(const wchar_t* symbol) const
+    {
+        return m_Token.Type == WqlTokenType::Symbol && m_Token.Text == symbol;
+    }
+
+    bool ConsumeKeyword(const wchar_t* keyword)
+    {
+        if (!IsKeyword(keyword))
+        {
+            return false;
+        }
+        Advance();
+        return true;
+    }
+
+    bool ConsumeSymbol(const wchar_t* symbol)
+    {
+        if (!IsSymbol(symbol))
+        {
+            return false;
+        }
+        Advance();
+        return true;
+    }
+
+private:
+    static bool IsIdentifierChar(wchar_t c, bool first)
+    {
+        return (c >= L'a' && c <= L'z') || (c >= L'A' && c <= L'Z') || c == L'_' || (!first && c >= L'0' && c <= L'9');
+    }
+
+    void Advance()
+    {
+        while (m_Offset < m_Text.size() && (m_Text[m_Offset] == L' ' || m_Text[m_Offset] == L'\t' || m_Text[m_Offset] == L'\r' || m_Text[m_Offset] == L'\n'))
+        {
+            ++m_Offset;
+        }
+        m_Token.Text.clear();
+        if (m_Offset == m_Text.size())
+        {
+            m_Token.Type = WqlTokenType::End;
+            return;
+        }
+
+        auto begin = m_Offset;
+        wchar_t c = m_Text[m_Offset];
+        if (IsIdentifierChar(c, true))
+        {
+            while (m_Offset < m_Text.size() && IsIdentifierChar(m_Text[m_Offset], false))
+            {
+                ++m_Offset;
+            }
+            m_Token.Type = WqlTokenType::Identifier;
+            m_Token.Text.assign(m_Text.substr(begin, m_Offset - begin));
+        }
+        else if ((c >= L'0' && c <= L'9') || (c == L'-' && m_Offset + 1 < m_Text.size() && m_Text[m_Offset + 1] >= L'0' && m_Text[m_Offset + 1] <= L'9'))
+        {
+            ++m_Offset;
+            while (m_Offset < m_Text.size() && m_Text[m_Offset] >= L'0' && m_Text[m_Offset] <= L'9')
+            {
+                ++m_Offset;
+            }
+            m_Token.Type = WqlTokenType::Number;
+            m_Token.Text.assign(m_Text.substr(begin, m_Offset - begin));
+        }
+        else if (c == L'\'' || c == L'"')
+        {
+            // A backslash escapes the next character, ex. 'C:\\Windows'.
+            m_Token.Type = WqlTokenType::Invalid;
+            for (++m_Offset; m_Offset < m_Text.size(); ++m_Offset)
+            {
+                if (m_Text[m_Offset] == c)
+                {
+                    ++m_Offset;
+                    m_Token.Type = WqlTokenType::String;
+                    break;
+                }
+                if (m_Text[m_Offset] == L'\\' && m_Offset + 1 < m_Text.size())
+                {
+                    ++m_Offset;
+                }
+                m_Token.Text.push_back(m_Text[m_Offset]);
+            }
+        }
+        else
+        {
+            constexpr std::wstring_view Symbols[] = {L"<>", L"!=", L"<=", L">=", L"=", L"<", L">", L"(", L")", L",", L"*"};
+            m_Token.Type = WqlTokenType::Invalid;
+            for (auto symbol : Symbols)
+            {
+                if (m_Text.substr(m_Offset, symbol.size()) == symbol)
+                {
+                    m_Offset += symbol.size();
+                    m_Token.Type = WqlTokenType::Symbol;
+                    m_Token.Text.assign(symbol);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::wstring_view m_Text;
+    size_t m_Offset;
+    WqlToken m_Token;
+};
+
+enum class WqlOperator
+{
+    Equal,
+    NotEqual,
+    Less,
+    LessOrEqual,
+    Greater,
+    GreaterOrEqual,
+    Like,
+    IsNull,
+    IsNotNull,
+    And,
+    Or,
+    Not,
+};
+
+// Condition tree stored in a vector, children are referenced by index.
+struct WqlCondition
+{
+    WqlOperator Operator;
+    size_t Property = NoProperty; // NoProperty for a property no instance sets, which reads as NULL
+    WmiValue Literal;
+    size_t Left = 0;
+    size_t Right = 0;
+};
+
+struct WqlQuery
+{
+    const InMemoryWmiRepository::Class* Class = nullptr;
+    // Selected properties in class order, the ones no instance sets are left out.
+    std::vector<size_t> Columns;
+    std::vector<WqlCondition> Conditions;
+    size_t Where = NoProperty; // root condition, NoProperty without WHERE
+};
+
+class WqlParser final
+{
+public:
+    WqlParser(std::wstring_view text, const InMemoryWmiRepository& repository) : m_Lexer(text), m_Repository(repository)
+    {
+    }
+
+    bool Parse(WqlQuery& query)
+    {
+        if (!m_Lexer.ConsumeKeyword(L"SELECT"))
+        {
+            return false;
+        }
+        bool all = m_Lexer.ConsumeSymbol(L"*");
+        std::vector<std::wstring> names;
+        if (!all)
+        {
+            do
+            {
+                if (m_Lexer.Peek().Type != WqlTokenType::Identifier)
+                {
+                    return false;
+                }
+                names.push_back(m_Lexer.Take().Text);
+            } while (m_Lexer.ConsumeSymbol(L","));
+        }
+
+        if (!m_Lexer.ConsumeKeyword(L"FROM") || m_Lexer.Peek().Type != WqlTokenType::Identifier)
+        {
+            return false;
+        }
+        query.Class = m_Repository.FindClass(m_Lexer.Take().Text.c_str());
+        if (!query.Class)
+        {
+            return false;
+        }
+        m_Query = &query;
+
+        for (size_t i = 0; i < query.Class->Properties.size(); ++i)
+        {
+            if (all || std::any_of(names.begin(), names.end(), [&](const std::wstring& name) {
+                    return EqualsNoCase(name, query.Class->Properties[i]);
+                }))
+            {
+                query.Columns.push_back(i);
+            }
+        }
+
+        if (m_Lexer.ConsumeKeyword(L"WHERE") && !ParseOr(query.Where))
+        {
+            return false;
+        }
+        return m_Lexer.Peek().Type == WqlTokenType::End;
+    }
+
+private:
+    size_t Add(WqlCondition condition)
+    {
+        m_Query->Conditions.push_back(std::move(condition));
+        return m_Query->Conditions.size() - 1;
+    }
+
+    bool ParseOr(size_t& node)
+    {
+        if (!ParseAnd(node))
+        {
+            return false;
+        }
+        while (m_Lexer.ConsumeKeyword(L"OR"))
+        {
+            size_t right = 0;
+            if (!ParseAnd(right))
+            {
+                return false;
+            }
+            node = Add({WqlOperator::Or, NoProperty, {}, node, right});
+        }
+        return true;
+    }
+
+    bool ParseAnd(size_t& node)
+    {
+        if (!ParseNot(node))
+        {
+            return false;
+        }
+        while (m_Lexer.ConsumeKeyword(L"AND"))
+        {
+            size_t right = 0;
+            if (!ParseNot(right))
+            {
+                return false;
+            }
+            node = Add({WqlOperator::And, NoProperty, {}, node, right});
+        }
+        return true;
+    }
+
+    bool ParseNot(size_t& node)
+    {
+        if (m_Lexer.ConsumeKeyword(L"NOT"))
+        {
+            size_t operand = 0;
+            if (!ParseNot(operand))
+            {
+                return false;
+            }
+            node = Add({WqlOperator::Not, NoProperty, {}, operand, 0});
+            return true;
+        }
+        if (m_Lexer.ConsumeSymbol(L"("))
+        {
+            return ParseOr(node) && m_Lexer.ConsumeSymbol(L")");
+        }
+        return ParseComparison(node);
+    }
+
+    bool ParseComparison(size_t& node)
+    {
+        if (m_Lexer.Peek().Type != WqlTokenType::Identifier)
+        {
+            return false;
+        }
+        WqlCondition condition{};
+        condition.Property = FindProperty(*m_Query->Class, m_Lexer.Take().Text);
+
+        if (m_Lexer.ConsumeKeyword(L"IS"))
+        {
+            condition.Operator = m_Lexer.ConsumeKeyword(L"NOT") ? WqlOperator::IsNotNull : WqlOperator::IsNull;
+            if (!m_Lexer.ConsumeKeyword(L"NULL"))
+            {
+                return false;
+            }
+            node = Add(std::move(condition));
+            return true;
+        }
+
+        struct Symbol
+        {
+            const wchar_t* Text;
+            WqlOperator Operator;
+        };
+        constexpr Symbol Symbols[] = {{L"=", WqlOperator::Equal},       {L"<>", WqlOperator::NotEqual},
+                                      {L"!=", WqlOperator::NotEqual},   {L"<", WqlOperator::Less},
+                                      {L"<=", WqlOperator::LessOrEqual}, {L">", WqlOperator::Greater},
+                                      {L">=", WqlOperator::GreaterOrEqual}};
+        auto symbol = std::find_if(std::begin(Symbols), std::end(Symbols), [this](const Symbol& s) { return m_Lexer.IsSymbol(s.Text); });
+        if (symbol != std::end(Symbols))
+        {
+            condition.Operator = symbol->Operator;
+        }
+        else if (m_Lexer.IsKeyword(L"LIKE"))
+        {
+            condition.Operator = WqlOperator::Like;
+        }
+        else
+        {
+            return false;
+        }
+        m_Lexer.Take();
+
+        auto literal = m_Lexer.Take();
+        switch (literal.Type)
+        {
+        case WqlTokenType::String:
+            condition.Literal = std::move(literal.Text);
+            break;
+        case WqlTokenType::Number:
+        {
+            int32_t number = 0;
+            if (!ParseInt32(literal.Text, number))
+            {
+                return false;
+            }
+            condition.Literal = number;
+            break;
+        }
+        case WqlTokenType::Identifier:
+            if (EqualsNoCase(literal.Text, L"TRUE") || EqualsNoCase(literal.Text, L"FALSE"))
+            {
+                condition.Literal = EqualsNoCase(literal.Text, L"TRUE");
+            }
+            // "= NULL" and "<> NULL" are accepted for IS NULL and IS NOT NULL, like WMI does.
+            else if (EqualsNoCase(literal.Text, L"NULL") && condition.Operator == WqlOperator::Equal)
+            {
+                condition.Operator = WqlOperator::IsNull;
+            }
+            else if (EqualsNoCase(literal.Text, L"NULL") && condition.Operator == WqlOperator::NotEqual)
+            {
+                condition.Operator = WqlOperator::IsNotNull;
+            }
+            else
+            {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+        if (condition.Operator == WqlOperator::Like && !std::holds_alternative<std::wstring>(condition.Literal))
+        {
+            return false;
+        }
+        node = Add(std::move(condition));
+        return true;
+    }
+
+    WqlLexer m_Lexer;
+    const InMemoryWmiRepository& m_Repository;
+    WqlQuery* m_Query = nullptr;
+};
+
+// % matches any sequence and _ any single character.
+bool MatchLike(std::wstring_view text, std::wstring_view pattern)
+{
+    size_t t = 0, p = 0;
+    size_t starPattern = std::wstring_view::npos, starText = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && pattern[p] == L'%')
+        {
+            starPattern = ++p;
+            starText = t;
+        }
+        else if (p < pattern.size() && (pattern[p] == L'_' || FoldAscii(pattern[p]) == FoldAscii(text[t])))
+        {
+            ++p;
+            ++t;
+        }
+        else if (starPattern != std::wstring_view::npos)
+        {
+            p = starPattern;
+            t = ++starText;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == L'%')
+    {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+// Three-way comparison, returns false when the values can't be compared (NULL, arrays, unrelated types).
+bool CompareValues(const WmiValue& value, const WmiValue& literal, int& order)
+{
+    auto compare = [&order](auto left, auto right) {
+        order = left < right ? -1 : right < left ? 1 : 0;
+        return true;
+    };
+    int32_t number = 0;
+    if (auto text = std::get_if<std::wstring>(&value))
+    {
+        if (auto other = std::get_if<std::wstring>(&literal))
+        {
+            order = CompareNoCase(*text, *other);
+            return true;
+        }
+        // uint64 properties are strings in WMI, they compare with numbers.
+        if (auto other = std::get_if<int32_t>(&literal); other && ParseInt32(*text, number))
+        {
+            return compare(number, *other);
+        }
+        return false;
+    }
+    if (auto integer = std::get_if<int32_t>(&value))
+    {
+        if (auto other = std::get_if<int32_t>(&literal))
+        {
+            return compare(*integer, *other);
+        }
+        if (auto other = std::get_if<std::wstring>(&literal); other && ParseInt32(*other, number))
+        {
+            return compare(*integer, number);
+        }
+        return false;
+    }
+    if (auto boolean = std::get_if<bool>(&value))
+    {
+        if (auto other = std::get_if<bool>(&literal))
+        {
+            return compare(*boolean, *other);
+        }
+    }
+    return false;
+}
+
+bool Evaluate(const WqlQuery& query, size_t node, const std::vector<WmiValue>& instance)
+{
+    static const WmiValue Null;
+    const auto& condition = query.Conditions[node];
+    const auto& value = condition.Property == NoProperty ? Null : instance[condition.Property];
+    int order = 0;
+    switch (condition.Operator)
+    {
+    case WqlOperator::And:
+        return Evaluate(query, condition.Left, instance) && Evaluate(query, condition.Right, instance);
+    case WqlOperator::Or:
+        return Evaluate(query, condition.Left, instance) || Evaluate(query, condition.Right, instance);
+    case WqlOperator::Not:
+        return !Evaluate(query, condition.Left, instance);
+    case WqlOperator::IsNull:
+        return std::holds_alternative<std::monostate>(value);
+    case WqlOperator::IsNotNull:
+        return !std::holds_alternative<std::monostate>(value);
+    case WqlOperator::Like:
+    {
+        auto text = std::get_if<std::wstring>(&value);
+        return text && MatchLike(*text, std::get<std::wstring>(condition.Literal));
+    }
+    default:
+        break;
+    }
+    if (!CompareValues(value, condition.Literal, order))
+    {
+        return false;
+    }
+    switch (condition.Operator)
+    {
+    case WqlOperator::Equal:
+        return order == 0;
+    case WqlOperator::NotEqual:
+        return order != 0;
+    case WqlOperator::Less:
+        return order < 0;
+    case WqlOperator::LessOrEqual:
+        return order <= 0;
+    case WqlOperator::Greater:
+        return order > 0;
+    case WqlOperator::GreaterOrEqual:
+        return order >= 0;
+    default:
+        return false;
+    }
+}
+
+// A result object, holds copies of the selected values only.
+class WqlObject final : public IWmiObject
+{
+public:
+    WqlObject(const WqlQuery& query, const std::vector<WmiValue>& values) : m_Query(query), m_Values(values)
+    {
+    }
+
+    bool Get(const wchar_t* name, WmiValue& value) const override
+    {
+        auto property = FindProperty(*m_Query.Class, name);
+        if (property == NoProperty)
+        {
+            return false;
+        }
+        auto column = std::lower_bound(m_Query.Columns.begin(), m_Query.Columns.end(), property);
+        if (column != m_Query.Columns.end() && *column == property)
+        {
+            value = m_Values[column - m_Query.Columns.begin()];
+        }
+        else
+        {
+            value = std::monostate{};
+        }
+        return true;
+    }
+
+private:
+    const WqlQuery& m_Query;
+    const std::vector<WmiValue>& m_Values;
+};
+} // namespace detail
+
+bool InMemoryWmiRepository::Load(const char* path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    return Parse(content.str());
+}
+
+bool InMemoryWmiRepository::Parse(std::string_view mof)
+{
+    std::vector<detail::MofInstance> instances;
+    if (!detail::ParseMof(mof, instances))
+    {
+        return false;
+    }
+    for (auto& instance : instances)
+    {
+        AddInstance(instance.ClassName.c_str(), std::move(instance.Properties));
+    }
+    return true;
+}
+
+void InMemoryWmiRepository::AddInstance(const wchar_t* className, std::vector<std::pair<std::wstring, WmiValue>> properties)
+{
+    auto& wmiClass = GetClass(className);
+    std::vector<WmiValue> instance(wmiClass.Properties.size());
+    for (auto& property : properties)
+    {
+        auto index = detail::FindProperty(wmiClass, property.first);
+        if (index == detail::NoProperty)
+        {
+            // A new property, the other instances don't set it.
+            index = wmiClass.Properties.size();
+            wmiClass.Properties.push_back(std::move(property.first));
+            for (auto& other : wmiClass.Instances)
+            {
+                other.emplace_back();
+            }
+            instance.emplace_back();
+        }
+        instance[index] = std::move(property.second);
+    }
+    wmiClass.Instances.push_back(std::move(instance));
+}
+
+const InMemoryWmiRepository::Class* InMemoryWmiRepository::FindClass(const wchar_t* name) const
+{
+    auto itr = std::find_if(m_Classes.begin(), m_Classes.end(), [name](const Class& wmiClass) {
+        return detail::EqualsNoCase(wmiClass.Name, name);
+    });
+    return itr != m_Classes.end() ? &*itr : nullptr;
+}
+
+InMemoryWmiRepository::Class& InMemoryWmiRepository::GetClass(const std::wstring& name)
+{
+    auto itr = std::find_if(m_Classes.begin(), m_Classes.end(), [&name](const Class& wmiClass) {
+        return detail::EqualsNoCase(wmiClass.Name, name);
+    });
+    if (itr != m_Classes.end())
+    {
+        return *itr;
+    }
+    m_Classes.push_back({name, {}, {}});
+    return m_Classes.back();
+}
+
+bool InMemoryWmi::ExecQuery(const wchar_t* query, IWmiObjectVisitor& visitor)
+{
+    detail::WqlQuery parsed;
+    if (!query || !detail::WqlParser(query, m_Repository).Parse(parsed))
+    {
+        return false;
+    }
+    ++m_Statistics.Queries;
+
+    // Projection pushdown, a result object only gets copies of the selected properties.
+    std::vector<WmiValue> values(parsed.Columns.size());
+    for (const auto& instance : parsed.Class->Instances)
+    {
+        ++m_Statistics.ObjectsScanned;
+        if (parsed.Where != detail::NoProperty && !detail::Evaluate(parsed, parsed.Where, instance))
+        {
+            continue;
+        }
+        for (size_t i = 0; i < parsed.Columns.size(); ++i)
+        {
+            values[i] = instance[parsed.Columns[i]];
+        }
+        m_Statistics.PropertiesMaterialized += parsed.Columns.size();
+        ++m_Statistics.ObjectsReturned;
+        if (!visitor.Visit(detail::WqlObject(parsed, values)))
+        {
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,252 @@
+#include "pch.h"
+#include "LanguageTags.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <iterator>
+
+namespace detail
+{
+struct LanguageTagRow
+{
+    uint32_t Lcid;
+    std::string_view Tag;
+    // Only used to map the LCID, FindLcid gives the LCID of the row which is not an alias.
+    bool Alias;
+};
+
+constexpr LanguageTagRow s_LanguageTagRows[] = {
+#define LANGUAGE_TAG(lcid, tag) {lcid, tag, false},
+#define LANGUAGE_TAG_ALIAS(lcid, tag) {lcid, tag, true},
+#include "LanguageTags.inc"
+#undef LANGUAGE_TAG_ALIAS
+#undef LANGUAGE_TAG
+};
+
+constexpr size_t s_LanguageTagRowCount = std::size(s_LanguageTagRows);
+
+#include "LanguageTagHash.inc"
+
+// Longest tag which std::string keeps inline with every standard library.
+constexpr size_t MaxLanguageTagLength = 15;
+
+constexpr char ToLowerAscii(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs)
+{
+    if (lhs.size() != rhs.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i)
+    {
+        if (ToLowerAscii(lhs[i]) != ToLowerAscii(rhs[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a of the lowercase tag with a seeded basis, then a 32-bit finalizer. Must stay the same as in
+// GenerateLanguageTagHash.py.
+constexpr uint32_t HashLanguageTag(std::string_view tag, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char c : tag)
+    {
+        hash ^= static_cast<unsigned char>(ToLowerAscii(c));
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    hash *= 0x846CA68Bu;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+constexpr size_t GetLanguageTagSlot(std::string_view tag)
+{
+    auto bucket = HashLanguageTag(tag, 0) % s_LanguageTagBucketCount;
+    return HashLanguageTag(tag, s_LanguageTagSeeds[bucket]) % s_LanguageTagSlotCount;
+}
+
+// Row of the tag in each slot of the perfect hash, plus one, 0 for empty slots.
+struct LanguageTagSlots
+{
+    std::array<uint16_t, s_LanguageTagSlotCount> Rows{};
+    bool Valid = true;
+};
+
+constexpr LanguageTagSlots BuildLanguageTagSlots()
+{
+    LanguageTagSlots slots;
+    for (size_t i = 0; i < s_LanguageTagRowCount; ++i)
+    {
+        if (s_LanguageTagRows[i].Alias)
+        {
+            continue;
+        }
+        auto& row = slots.Rows[GetLanguageTagSlot(s_LanguageTagRows[i].Tag)];
+        slots.Valid = slots.Valid && row == 0;
+        row = static_cast<uint16_t>(i + 1);
+    }
+    return slots;
+}
+
+constexpr LanguageTagSlots s_LanguageTagSlots = BuildLanguageTagSlots();
+static_assert(s_LanguageTagSlots.Valid, "Tags share a slot, run GenerateLanguageTagHash.py after editing LanguageTags.inc");
+
+// An LCID is a primary language in its low 10 bits and a sublanguage in the next 6. Each primary language has a
+// range of the dense table indexed by sublanguage, as long as its highest sublanguage.
+constexpr size_t PrimaryLanguageCount = 1 << 10;
+constexpr size_t SubLanguageCount = 1 << 6;
+
+constexpr size_t GetPrimaryLanguage(uint32_t lcid)
+{
+    return lcid & (PrimaryLanguageCount - 1);
+}
+
+constexpr size_t GetSubLanguage(uint32_t lcid)
+{
+    return (lcid >> 10) & (SubLanguageCount - 1);
+}
+
+constexpr std::array<uint8_t, PrimaryLanguageCount> CountSubLanguages()
+{
+    std::array<uint8_t, PrimaryLanguageCount> counts{};
+    for (const auto& row : s_LanguageTagRows)
+    {
+        auto& count = counts[GetPrimaryLanguage(row.Lcid)];
+        count = static_cast<uint8_t>((std::max)(size_t{count}, GetSubLanguage(row.Lcid) + 1));
+    }
+    return counts;
+}
+
+constexpr std::array<uint8_t, PrimaryLanguageCount> s_SubLanguageCounts = CountSubLanguages();
+
+constexpr size_t CountLcidEntries()
+{
+    size_t entries = 0;
+    for (auto count : s_SubLanguageCounts)
+    {
+        entries += count;
+    }
+    return entries;
+}
+
+struct LcidTable
+{
+    std::array<uint16_t, PrimaryLanguageCount> First{};
+    // Row of each LCID plus one, 0 for unknown LCIDs.
+    std::array<uint16_t, CountLcidEntries()> Rows{};
+    bool Valid = true;
+};
+
+constexpr LcidTable BuildLcidTable()
+{
+    LcidTable table;
+    size_t first = 0;
+    for (size_t i = 0; i < PrimaryLanguageCount; ++i)
+    {
+        table.First[i] = static_cast<uint16_t>(first);
+        first += s_SubLanguageCounts[i];
+    }
+    for (size_t i = 0; i < s_LanguageTagRowCount; ++i)
+    {
+        const auto lcid = s_LanguageTagRows[i].Lcid;
+        auto& row = table.Rows[table.First[GetPrimaryLanguage(lcid)] + GetSubLanguage(lcid)];
+        // Rows are sorted by LCID, which also rules out duplicates.
+        table.Valid = table.Valid && lcid <= 0xFFFF && (i == 0 || s_LanguageTagRows[i - 1].Lcid < lcid) &&
+                      s_LanguageTagRows[i].Tag.size() <= MaxLanguageTagLength;
+        row = static_cast<uint16_t>(i + 1);
+    }
+    return table;
+}
+
+constexpr LcidTable s_LcidTable = BuildLcidTable();
+static_assert(s_LcidTable.Valid, "LanguageTags.inc rows must be sorted by 16-bit LCID, with tags of at most 15 characters");
+
+bool ParseLcid(std::string_view text, int base, uint32_t& lcid)
+{
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), lcid, base);
+    return !text.empty() && parsed.ec == std::errc() && parsed.ptr == text.data() + text.size();
+}
+} // namespace detail
+
+std::string_view GetLanguageTag(uint32_t lcid) noexcept
+{
+    // The language id is the low 16 bits, the sort order is above.
+    lcid &= 0xFFFF;
+    const auto primary = detail::GetPrimaryLanguage(lcid);
+    const auto sub = detail::GetSubLanguage(lcid);
+    if (sub >= detail::s_SubLanguageCounts[primary])
+    {
+        return {};
+    }
+    const auto row = detail::s_LcidTable.Rows[detail::s_LcidTable.First[primary] + sub];
+    return row ? detail::s_LanguageTagRows[row - 1].Tag : std::string_view();
+}
+
+bool FindLcid(std::string_view tag, uint32_t& lcid) noexcept
+{
+    if (tag.size() > detail::MaxLanguageTagLength)
+    {
+        return false;
+    }
+    const auto row = detail::s_LanguageTagSlots.Rows[detail::GetLanguageTagSlot(tag)];
+    if (row == 0 || !detail::EqualsIgnoreCase(detail::s_LanguageTagRows[row - 1].Tag, tag))
+    {
+        return false;
+    }
+    lcid = detail::s_LanguageTagRows[row - 1].Lcid;
+    return true;
+}
+
+std::string_view NormalizeLanguageField(OperatingSystemInfoField field, std::string_view value) noexcept
+{
+    uint32_t lcid = 0;
+    if ((field == OperatingSystemInfoField::OSLanguage && detail::ParseLcid(value, 10, lcid)) ||
+        (field == OperatingSystemInfoField::Locale && detail::ParseLcid(value, 16, lcid)))
+    {
+        auto tag = GetLanguageTag(lcid);
+        if (!tag.empty())
+        {
+            return tag;
+        }
+    }
+    return value;
+}
+
+void NormalizeLanguageFields(OperatingSystemInfoView& info) noexcept
+{
+    for (auto field : {OperatingSystemInfoField::OSLanguage, OperatingSystemInfoField::Locale})
+    {
+        if (info.Present.Has(field))
+        {
+            auto& value = info.Values[static_cast<size_t>(field)];
+            value = NormalizeLanguageField(field, value);
+        }
+    }
+}
+
+void NormalizeLanguageFields(OperatingSystemInfo& info)
+{
+    for (auto field : {OperatingSystemInfoField::OSLanguage, OperatingSystemInfoField::Locale})
+    {
+        auto& value = GetField(info, field);
+        if (value)
+        {
+            auto tag = NormalizeLanguageField(field, *value);
+            if (tag.data() != value->data())
+            {
+                value->assign(tag.data(), tag.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "LatencyHistogram.h"
+
+#include <cmath>
+#include <limits>
+
+std::chrono::nanoseconds LatencyHistogramSnapshot::BucketLowerBound(size_t index) noexcept
+{
+    if (index < 8)
+    {
+        return std::chrono::nanoseconds(index);
+    }
+    auto exponent = index / 4 + 1;
+    auto quarter = index % 4;
+    return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(uint64_t{4 + quarter} << (exponent - 2)));
+}
+
+std::chrono::nanoseconds LatencyHistogramSnapshot::BucketUpperBound(size_t index) noexcept
+{
+    if (index < 8)
+    {
+        return std::chrono::nanoseconds(index);
+    }
+    auto exponent = index / 4 + 1;
+    auto quarter = index % 4;
+    auto upper = (uint64_t{4 + quarter} << (exponent - 2)) + (uint64_t{1} << (exponent - 2)) - 1;
+    // The last buckets go past what a duration holds.
+    constexpr auto Limit = static_cast<uint64_t>((std::numeric_limits<std::chrono::nanoseconds::rep>::max)());
+    return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>((std::min)(upper, Limit)));
+}
+
+std::chrono::nanoseconds LatencyHistogramSnapshot::Percentile(double fraction) const noexcept
+{
+    if (Count == 0)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    fraction = (std::min)((std::max)(fraction, 0.0), 1.0);
+    // Rank of the sample, from 1 to Count.
+    auto rank = (std::max)(static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(Count))), uint64_t{1});
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; ++i)
+    {
+        seen += Buckets[i];
+        if (seen >= rank)
+        {
+            return (std::min)(BucketUpperBound(i), Max);
+        }
+    }
+    return Max;
+}
+
+LatencyHistogramSnapshot LatencyHistogram::Snapshot() const noexcept
+{
+    LatencyHistogramSnapshot snapshot;
+    for (size_t i = 0; i < BucketCount; ++i)
+    {
+        snapshot.Buckets[i] = m_Buckets[i].load(std::memory_order_relaxed);
+        snapshot.Count += snapshot.Buckets[i];
+    }
+    snapshot.Total = std::chrono::nanoseconds(m_Total.load(std::memory_order_relaxed));
+    snapshot.Max = std::chrono::nanoseconds(m_Max.load(std::memory_order_relaxed));
+    return snapshot;
+}
+
+void LatencyHistogram::Reset() noexcept
+{
+    for (auto& bucket : m_Buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_Total.store(0, std::memory_order_relaxed);
+    m_Max.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,212 @@
+#include "pch.h"
+#include "LinuxOperatingSystemInfoFetcher.h"
+#include "FetchTiming.h"
+#include "OsRelease.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <initializer_list>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace detail
+{
+// os-release files are a few hundred bytes, anything past this is ignored.
+constexpr size_t OsReleaseBufferSize = 8192;
+
+// Reads the whole file with a single read() in the common case. Returns the number of bytes read.
+size_t ReadSmallFile(const char* path, char* buffer, size_t capacity)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    while (total < capacity)
+    {
+        auto rv = read(fd, buffer + total, capacity - total);
+        if (rv < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (rv <= 0)
+        {
+            break;
+        }
+        total += static_cast<size_t>(rv);
+    }
+    close(fd);
+    return total;
+}
+
+std::optional<std::string> ToOptional(std::string_view value)
+{
+    return value.empty() ? std::nullopt : std::optional<std::string>{std::string(value)};
+}
+
+// Machines whose user space is 64-bit. uname reports the kernel's machine, which is what
+// Win32_OperatingSystem::OSArchitecture reports as well.
+const char* ToOSArchitecture(std::string_view machine)
+{
+    constexpr std::array<std::string_view, 9> Machines64{
+        "x86_64", "aarch64", "arm64", "ppc64", "ppc64le", "s390x", "riscv64", "mips64", "loongarch64"};
+    for (auto candidate : Machines64)
+    {
+        if (machine == candidate)
+        {
+            return "64-bit";
+        }
+    }
+    return "32-bit";
+}
+
+// "en_US.UTF-8@euro" -> "en-US", "C" / "POSIX" / unset -> empty.
+std::optional<std::string> ToLanguageTag(std::initializer_list<const char*> variables)
+{
+    for (auto variable : variables)
+    {
+        const char* value = std::getenv(variable);
+        if (!value || !*value)
+        {
+            continue;
+        }
+        std::string_view locale(value);
+        locale = locale.substr(0, locale.find_first_of(".@"));
+        if (locale.empty() || locale == "C" || locale == "POSIX")
+        {
+            return std::nullopt;
+        }
+        std::string tag(locale);
+        auto separator = tag.find('_');
+        if (separator != std::string::npos)
+        {
+            tag[separator] = '-';
+        }
+        return tag;
+    }
+    return std::nullopt;
+}
+
+// "22.04" -> {"22", "4"}, "12" -> {"12", "0"}. Components are reported the way the
+// CurrentMajorVersionNumber / CurrentMinorVersionNumber dwords are, as plain decimal numbers.
+void FillVersionNumbers(std::string_view versionId, OperatingSystemInfo& result)
+{
+    auto toNumber = [](std::string_view digits) -> std::optional<std::string> {
+        if (digits.empty() || digits.find_first_not_of("0123456789") != std::string_view::npos)
+        {
+            return std::nullopt;
+        }
+        auto significant = digits.find_first_not_of('0');
+        return std::string(significant == std::string_view::npos ? "0" : digits.substr(significant));
+    };
+
+    auto dot = versionId.find('.');
+    result.CurrentMajorVersionNumber = toNumber(versionId.substr(0, dot));
+    if (!result.CurrentMajorVersionNumber)
+    {
+        return;
+    }
+    if (dot == std::string_view::npos)
+    {
+        result.CurrentMinorVersionNumber = "0";
+        return;
+    }
+    auto minor = versionId.substr(dot + 1);
+    result.CurrentMinorVersionNumber = toNumber(minor.substr(0, minor.find('.')));
+}
+} // namespace detail
+
+LinuxOperatingSystemInfoFetcher::LinuxOperatingSystemInfoFetcher(std::string osReleasePath) noexcept
+    : m_OsReleasePath(std::move(osReleasePath))
+{
+}
+
+// When we meet error, we continue to fill the information as possible as we can to the return object.
+OperatingSystemInfo LinuxOperatingSystemInfoFetcher::GetInformation()
+{
+    FetchTimingSpan span(FetchStage::GetInformation);
+    OperatingSystemInfo result;
+
+    // uname returns the same strings as /proc/sys/kernel/{ostype,osrelease,version} in one syscall.
+    struct utsname name{};
+    if (uname(&name) == 0)
+    {
+        result.Version = detail::ToOptional(name.release);
+        result.OSArchitecture = detail::ToOSArchitecture(name.machine);
+    }
+
+    std::array<char, detail::OsReleaseBufferSize> buffer;
+    size_t size = 0;
+    if (!m_OsReleasePath.empty())
+    {
+        size = detail::ReadSmallFile(m_OsReleasePath.c_str(), buffer.data(), buffer.size());
+    }
+    else
+    {
+        size = detail::ReadSmallFile("/etc/os-release", buffer.data(), buffer.size());
+        if (size == 0)
+        {
+            size = detail::ReadSmallFile("/usr/lib/os-release", buffer.data(), buffer.size());
+        }
+    }
+
+    OsReleaseValue id{};
+    OsReleaseValue variantId{};
+    OsReleaseValue versionId{};
+    ForEachOsReleaseEntry(std::string_view(buffer.data(), size),
+                          [&](std::string_view key, const OsReleaseValue& value) {
+                              if (key == "PRETTY_NAME")
+                              {
+                                  result.Caption = value.ToString();
+                              }
+                              else if (key == "ID")
+                              {
+                                  id = value;
+                              }
+                              else if (key == "VARIANT_ID")
+                              {
+                                  variantId = value;
+                              }
+                              else if (key == "VERSION")
+                              {
+                                  result.MarketName = value.ToString();
+                              }
+                              else if (key == "VERSION_ID")
+                              {
+                                  versionId = value;
+                              }
+                              else if (key == "VERSION_CODENAME")
+                              {
+                                  result.BuildBranch = value.ToString();
+                              }
+                              else if (key == "BUILD_ID")
+                              {
+                                  result.CurrentBuildNumber = value.ToString();
+                              }
+                          });
+
+    result.EditionID = detail::ToOptional((!variantId.Raw.empty() ? variantId : id).ToString());
+    result.Codename = result.BuildBranch;
+    if (!versionId.Raw.empty())
+    {
+        auto version = versionId.ToString();
+        detail::FillVersionNumbers(version, result);
+        result.ReleaseId = version;
+        result.CurrentVersion = std::move(version);
+    }
+
+    result.MUILanguage = detail::ToLanguageTag({"LC_ALL", "LC_MESSAGES", "LANG"});
+    result.Locale = detail::ToLanguageTag({"LC_ALL", "LC_CTYPE", "LANG"});
+
+    if (result.Caption && result.OSArchitecture)
+    {
+        result.OSVersion = *result.Caption + "[" + *result.OSArchitecture + "OS][System Locale " +
+                           result.MUILanguage.value_or("N/A") + "]";
+    }
+    return result;
+}
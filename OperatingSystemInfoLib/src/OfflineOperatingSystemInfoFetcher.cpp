@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "OfflineOperatingSystemInfoFetcher.h"
+#include "FetchTiming.h"
+#include "OfflineReg.h"
+#include "OperatingSystemInfoSources.h"
+
+#include <charconv>
+#include <string_view>
+
+namespace detail
+{
+// First build of Windows 11, which kept "Windows 10" in ProductName.
+constexpr uint32_t FirstWindows11Build = 22000;
+
+// Caption of Win32_OperatingSystem from ProductName and the build.
+std::string ToCaption(std::string productName, const std::optional<std::string>& buildNumber)
+{
+    constexpr std::string_view Windows10 = "Windows 10";
+    uint32_t build = 0;
+    if (buildNumber)
+    {
+        std::from_chars(buildNumber->data(), buildNumber->data() + buildNumber->size(), build);
+    }
+    if (build >= FirstWindows11Build && productName.compare(0, Windows10.size(), Windows10) == 0)
+    {
+        productName.replace(Windows10.size() - 2, 2, "11");
+    }
+    return "Microsoft " + productName;
+}
+
+// Number of "Service Pack 1", "0" without a service pack like WMI.
+std::string ToServicePackMajorVersion(const std::optional<std::string>& csdVersion)
+{
+    if (!csdVersion)
+    {
+        return "0";
+    }
+    auto digits = csdVersion->find_last_not_of("0123456789");
+    digits = digits == std::string::npos ? 0 : digits + 1;
+    return digits < csdVersion->size() ? csdVersion->substr(digits) : "0";
+}
+} // namespace detail
+
+OfflineOperatingSystemInfoFetcher::OfflineOperatingSystemInfoFetcher(std::string softwareHivePath) noexcept
+    : m_SoftwareHivePath(std::move(softwareHivePath))
+{
+}
+
+OperatingSystemInfo OfflineOperatingSystemInfoFetcher::GetInformation()
+{
+    FetchTimingSpan span(FetchStage::GetInformation);
+    OperatingSystemInfo result;
+
+    // The SOFTWARE hive root is HKLM\SOFTWARE itself.
+    RegistryHive hive;
+    OfflineReg reg;
+    if (!hive.Load(m_SoftwareHivePath.c_str()) || !reg.Open(hive, L"Microsoft\\Windows NT\\CurrentVersion"))
+    {
+        return result;
+    }
+    detail::ReadCurrentVersionValues(reg, result);
+
+    std::string productName;
+    if (reg.ReadStringValue("ProductName", productName))
+    {
+        result.Caption = detail::ToCaption(std::move(productName), result.CurrentBuildNumber);
+    }
+    if (result.CurrentBuildNumber)
+    {
+        if (result.CurrentMajorVersionNumber && result.CurrentMinorVersionNumber)
+        {
+            result.Version = *result.CurrentMajorVersionNumber + "." + *result.CurrentMinorVersionNumber + "." +
+                             *result.CurrentBuildNumber;
+        }
+        else if (result.CurrentVersion)
+        {
+            result.Version = *result.CurrentVersion + "." + *result.CurrentBuildNumber;
+        }
+    }
+    // Only 64-bit Windows keeps the registry view of 32-bit programs.
+    OfflineReg wow64;
+    result.OSArchitecture = wow64.Open(hive, L"WOW6432Node") ? "64-bit" : "32-bit";
+    result.ServicePackMajorVersion = detail::ToServicePackMajorVersion(result.CSDVersion);
+    result.ServicePackMinorVersion = "0";
+
+    detail::CompleteInformation(OperatingSystemInfoFieldMask::All(), result);
+    return result;
+}
@@ -0,0 +1,539 @@
+#include "pch.h"
+#include "OfflineReg.h"
+#include "RegistryBatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+// regf layout reference: https://github.com/msuhanov/regf/blob/master/Windows%20registry%20file%20format%20specification.md
+// All integers in a hive are little-endian, we assume a little-endian host (x86/x64/ARM64).
+namespace detail
+{
+    constexpr size_t BaseBlockSize = 4096;
+    constexpr size_t RootCellOffsetField = 0x24;
+    constexpr size_t HiveBinsDataSizeField = 0x28;
+
+    // Key node (nk)
+    constexpr uint16_t KeyCompressedName = 0x0020;
+    constexpr size_t KeyFlagsField = 0x02;
+    constexpr size_t KeySubkeyCountField = 0x14;
+    constexpr size_t KeySubkeyListField = 0x1C;
+    constexpr size_t KeyValueCountField = 0x24;
+    constexpr size_t KeyValueListField = 0x28;
+    constexpr size_t KeyNameLengthField = 0x48;
+    constexpr size_t KeyNameField = 0x4C;
+
+    // Value key (vk)
+    constexpr uint16_t ValueCompressedName = 0x0001;
+    constexpr size_t ValueNameLengthField = 0x02;
+    constexpr size_t ValueDataSizeField = 0x04;
+    constexpr size_t ValueDataOffsetField = 0x08;
+    constexpr size_t ValueTypeField = 0x0C;
+    constexpr size_t ValueFlagsField = 0x10;
+    constexpr size_t ValueNameField = 0x14;
+    constexpr uint32_t ValueDataInline = 0x80000000;
+
+    // Data larger than this is stored in a big data (db) record, split into segments of this size.
+    constexpr uint32_t BigDataSegmentSize = 16344;
+
+    template <class T> T Load(const std::byte* p)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    bool HasSignature(const std::byte* cell, uint32_t size, const char (&signature)[3])
+    {
+        return size >= 2 && static_cast<char>(cell[0]) == signature[0] && static_cast<char>(cell[1]) == signature[1];
+    }
+
+    constexpr uint32_t FoldAscii(uint32_t c)
+    {
+        return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+    }
+
+    // A name stored inside a cell, either "compressed" (one byte per character) or UTF-16LE.
+    struct CellName
+    {
+        const std::byte* Data;
+        uint16_t Length; // in bytes
+        bool Compressed;
+
+        size_t Count() const
+        {
+            return Compressed ? Length : Length / 2;
+        }
+
+        uint32_t At(size_t i) const
+        {
+            return Compressed ? static_cast<uint32_t>(Data[i]) : Load<uint16_t>(Data + i * 2);
+        }
+    };
+
+    // Registry names compare case-insensitively, we fold ASCII only which covers every name we look up.
+    template <class TChar> bool NameEquals(const CellName& name, const TChar* query, size_t queryLength)
+    {
+        if (name.Count() != queryLength)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < queryLength; ++i)
+        {
+            auto q = static_cast<uint32_t>(static_cast<std::make_unsigned_t<TChar>>(query[i]));
+            if (FoldAscii(name.At(i)) != FoldAscii(q))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Hash stored in "lh" subkey lists.
+    template <class TChar> uint32_t NameHash(const TChar* name, size_t length)
+    {
+        uint32_t hash = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash = hash * 37 + FoldAscii(static_cast<uint32_t>(static_cast<std::make_unsigned_t<TChar>>(name[i])));
+        }
+        return hash;
+    }
+
+    template <class TChar> size_t StringLength(const TChar* s)
+    {
+        return std::char_traits<TChar>::length(s);
+    }
+
+    template <class TChar>
+    uint32_t FindSubkeyInList(const RegistryHive& hive, uint32_t listOffset, const TChar* name, size_t nameLength,
+                              uint32_t hash, int depth)
+    {
+        uint32_t size = 0;
+        auto list = hive.Cell(listOffset, size);
+        if (!list || size < 4 || depth > 1)
+        {
+            return 0;
+        }
+
+        const auto count = Load<uint16_t>(list + 2);
+        const bool isIndexRoot = HasSignature(list, size, "ri");
+        const bool isIndexLeaf = HasSignature(list, size, "li");
+        const bool isHashLeaf = HasSignature(list, size, "lh");
+        if (!isIndexRoot && !isIndexLeaf && !isHashLeaf && !HasSignature(list, size, "lf"))
+        {
+            return 0;
+        }
+        const size_t entrySize = isIndexRoot || isIndexLeaf ? 4 : 8;
+        if (4 + count * entrySize > size)
+        {
+            return 0;
+        }
+
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            const auto entry = list + 4 + i * entrySize;
+            const auto offset = Load<uint32_t>(entry);
+            if (isIndexRoot)
+            {
+                if (auto found = FindSubkeyInList(hive, offset, name, nameLength, hash, depth + 1))
+                {
+                    return found;
+                }
+                continue;
+            }
+            if (isHashLeaf && Load<uint32_t>(entry + 4) != hash)
+            {
+                continue;
+            }
+
+            uint32_t keySize = 0;
+            auto key = hive.Cell(offset, keySize);
+            if (!key || keySize < KeyNameField || !HasSignature(key, keySize, "nk"))
+            {
+                continue;
+            }
+            CellName keyName{key + KeyNameField, Load<uint16_t>(key + KeyNameLengthField),
+                             (Load<uint16_t>(key + KeyFlagsField) & KeyCompressedName) != 0};
+            if (KeyNameField + keyName.Length > keySize)
+            {
+                continue;
+            }
+            if (NameEquals(keyName, name, nameLength))
+            {
+                return offset;
+            }
+        }
+        return 0;
+    }
+
+    template <class TChar> uint32_t OpenPath(const RegistryHive& hive, const TChar* path)
+    {
+        if (!hive.IsLoaded() || !path)
+        {
+            return 0;
+        }
+
+        uint32_t current = hive.RootCell();
+        const TChar* segment = path;
+        while (current != 0 && *segment)
+        {
+            const TChar* end = segment;
+            while (*end && *end != TChar('\\'))
+            {
+                ++end;
+            }
+            const auto segmentLength = static_cast<size_t>(end - segment);
+            if (segmentLength > 0)
+            {
+                uint32_t size = 0;
+                auto key = hive.Cell(current, size);
+                if (!key || size < KeyNameField || !HasSignature(key, size, "nk"))
+                {
+                    return 0;
+                }
+                if (Load<uint32_t>(key + KeySubkeyCountField) == 0)
+                {
+                    return 0;
+                }
+                current = FindSubkeyInList(hive, Load<uint32_t>(key + KeySubkeyListField), segment, segmentLength,
+                                           NameHash(segment, segmentLength), 0);
+            }
+            segment = *end ? end + 1 : end;
+        }
+        return current;
+    }
+
+    // Location of a value's data inside the hive. Data up to BigDataSegmentSize is contiguous and
+    // referenced in place, larger data is split into segments which have to be gathered.
+    struct ValueData
+    {
+        uint32_t Type = 0;
+        const std::byte* Data = nullptr;
+        uint32_t Size = 0;
+        const std::byte* Segments = nullptr; // big data segment offset list, nullptr when contiguous
+        uint16_t SegmentCount = 0;
+    };
+
+    // Resolves where the data of the value key (vk) cell lives.
+    bool ResolveValueData(const RegistryHive& hive, const std::byte* value, ValueData& result)
+    {
+        result = {};
+        result.Type = Load<uint32_t>(value + ValueTypeField);
+        const auto dataSize = Load<uint32_t>(value + ValueDataSizeField);
+        if (dataSize & ValueDataInline)
+        {
+            result.Size = dataSize & ~ValueDataInline;
+            result.Data = value + ValueDataOffsetField;
+            return result.Size <= 4;
+        }
+
+        uint32_t cellSize = 0;
+        auto data = hive.Cell(Load<uint32_t>(value + ValueDataOffsetField), cellSize);
+        if (!data)
+        {
+            return dataSize == 0;
+        }
+        if (dataSize > BigDataSegmentSize && HasSignature(data, cellSize, "db") && cellSize >= 8)
+        {
+            uint32_t segmentListSize = 0;
+            result.SegmentCount = Load<uint16_t>(data + 2);
+            result.Segments = hive.Cell(Load<uint32_t>(data + 4), segmentListSize);
+            result.Size = dataSize;
+            // The size is gathered into one buffer, a forged one must not make the reader allocate gigabytes.
+            return result.Segments && result.SegmentCount <= segmentListSize / 4 &&
+                   dataSize <= uint64_t{result.SegmentCount} * BigDataSegmentSize && dataSize <= hive.Size();
+        }
+        if (dataSize > cellSize)
+        {
+            return false;
+        }
+        result.Data = data;
+        result.Size = dataSize;
+        return true;
+    }
+
+    // Calls visitor(const std::byte* vk, const CellName& name) for every well-formed value key of the key node
+    // until it returns false. Returns false when the key or its value list is damaged.
+    template <class TVisitor> bool VisitValueKeys(const RegistryHive& hive, uint32_t keyCell, TVisitor&& visitor)
+    {
+        uint32_t size = 0;
+        auto key = hive.Cell(keyCell, size);
+        if (!key || size < KeyNameField)
+        {
+            return false;
+        }
+        const auto valueCount = Load<uint32_t>(key + KeyValueCountField);
+        if (valueCount == 0)
+        {
+            return true;
+        }
+        uint32_t listSize = 0;
+        auto list = hive.Cell(Load<uint32_t>(key + KeyValueListField), listSize);
+        if (!list || valueCount > listSize / 4)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < valueCount; ++i)
+        {
+            uint32_t valueSize = 0;
+            auto value = hive.Cell(Load<uint32_t>(list + i * 4), valueSize);
+            if (!value || valueSize < ValueNameField || !HasSignature(value, valueSize, "vk"))
+            {
+                continue;
+            }
+            CellName valueName{value + ValueNameField, Load<uint16_t>(value + ValueNameLengthField),
+                               (Load<uint16_t>(value + ValueFlagsField) & ValueCompressedName) != 0};
+            if (ValueNameField + valueName.Length > valueSize)
+            {
+                continue;
+            }
+            if (!visitor(value, valueName))
+            {
+                break;
+            }
+        }
+        return true;
+    }
+
+    // Copies the value data into out, which must hold at least data.Size bytes.
+    bool GatherValueData(const RegistryHive& hive, const ValueData& data, std::byte* out)
+    {
+        if (!data.Segments)
+        {
+            if (data.Size > 0)
+            {
+                std::memcpy(out, data.Data, data.Size);
+            }
+            return true;
+        }
+
+        uint32_t remaining = data.Size;
+        for (uint16_t i = 0; i < data.SegmentCount && remaining > 0; ++i)
+        {
+            uint32_t segmentSize = 0;
+            auto segment = hive.Cell(Load<uint32_t>(data.Segments + i * 4), segmentSize);
+            if (!segment)
+            {
+                return false;
+            }
+            const auto chunk = (std::min)({remaining, segmentSize, BigDataSegmentSize});
+            std::memcpy(out, segment, chunk);
+            out += chunk;
+            remaining -= chunk;
+        }
+        return remaining == 0;
+    }
+
+    // Makes a RegistryValue of the value key (vk) cell. Data is referenced in place, except big data
+    // which is gathered into scratch.
+    bool ToRegistryValue(const RegistryHive& hive, const std::byte* value, const CellName& name, RegistryValue& result,
+                         std::vector<std::byte>& scratch)
+    {
+        ValueData data;
+        if (!ResolveValueData(hive, value, data))
+        {
+            return false;
+        }
+        if (data.Segments)
+        {
+            scratch.resize(data.Size);
+            if (!GatherValueData(hive, data, scratch.data()))
+            {
+                return false;
+            }
+            data.Data = scratch.data();
+        }
+        result = {{name.Data, name.Count(), !name.Compressed},
+                  static_cast<RegistryValueType>(data.Type),
+                  data.Data,
+                  data.Size};
+        return true;
+    }
+
+    template <class TChar>
+    bool ReadValue(const RegistryHive* hive, uint32_t keyCell, const TChar* name, RegistryValue& result,
+                   std::vector<std::byte>& scratch)
+    {
+        if (!hive || keyCell == 0 || !name)
+        {
+            return false;
+        }
+
+        const auto nameLength = StringLength(name);
+        bool found = false;
+        VisitValueKeys(*hive, keyCell, [&](const std::byte* value, const CellName& valueName) {
+            if (!NameEquals(valueName, name, nameLength))
+            {
+                return true;
+            }
+            found = ToRegistryValue(*hive, value, valueName, result, scratch);
+            return false;
+        });
+        return found;
+    }
+
+    // Decodes with the DecodeRegistryValue overload of the result type, which checks the value type.
+    template <class TChar, class TResult>
+    bool ReadDecodedValue(const RegistryHive* hive, uint32_t keyCell, const TChar* name, TResult& result)
+    {
+        std::vector<std::byte> scratch;
+        RegistryValue value{};
+        return ReadValue(hive, keyCell, name, value, scratch) && DecodeRegistryValue(value, result);
+    }
+}
+
+bool RegistryHive::Load(const char* path)
+{
+    Close();
+    if (!m_File.Open(path))
+    {
+        return false;
+    }
+    m_Data = m_File.Data();
+    m_Size = m_File.Size();
+
+    // We read the primary file as is, transaction logs (.LOG1/.LOG2) of a dirty hive are not replayed.
+    if (m_Size < detail::BaseBlockSize || std::memcmp(m_Data, "regf", 4) != 0)
+    {
+        Close();
+        return false;
+    }
+    const auto binsSize = detail::Load<uint32_t>(m_Data + detail::HiveBinsDataSizeField);
+    if (binsSize < m_Size - detail::BaseBlockSize)
+    {
+        m_Size = detail::BaseBlockSize + binsSize;
+    }
+    m_RootCell = detail::Load<uint32_t>(m_Data + detail::RootCellOffsetField);
+
+    uint32_t size = 0;
+    auto root = Cell(m_RootCell, size);
+    if (!root || !detail::HasSignature(root, size, "nk"))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+const std::byte* RegistryHive::Cell(uint32_t offset, uint32_t& size) const
+{
+    const size_t position = detail::BaseBlockSize + static_cast<size_t>(offset);
+    if (!m_Data || offset == 0xFFFFFFFF || position + sizeof(int32_t) > m_Size)
+    {
+        return nullptr;
+    }
+
+    // Allocated cells have a negative size, which includes the size field itself.
+    const auto cellSize = detail::Load<int32_t>(m_Data + position);
+    if (cellSize >= -static_cast<int32_t>(sizeof(int32_t)))
+    {
+        return nullptr;
+    }
+    const auto length = static_cast<size_t>(-static_cast<int64_t>(cellSize));
+    if (position + length > m_Size)
+    {
+        return nullptr;
+    }
+    size = static_cast<uint32_t>(length - sizeof(int32_t));
+    return m_Data + position + sizeof(int32_t);
+}
+
+void RegistryHive::Close()
+{
+    m_File.Close();
+    m_Data = nullptr;
+    m_Size = 0;
+    m_RootCell = 0;
+}
+
+bool OfflineReg::Open(const RegistryHive& hive, const wchar_t* path)
+{
+    Close();
+    m_KeyCell = detail::OpenPath(hive, path);
+    m_Hive = m_KeyCell ? &hive : nullptr;
+    return m_KeyCell != 0;
+}
+
+bool OfflineReg::Open(const RegistryHive& hive, const char* path)
+{
+    Close();
+    m_KeyCell = detail::OpenPath(hive, path);
+    m_Hive = m_KeyCell ? &hive : nullptr;
+    return m_KeyCell != 0;
+}
+
+void OfflineReg::Close()
+{
+    m_Hive = nullptr;
+    m_KeyCell = 0;
+}
+
+bool OfflineReg::ReadValue(const wchar_t* name, RegistryValue& result, std::vector<std::byte>& scratch) const
+{
+    return detail::ReadValue(m_Hive, m_KeyCell, name, result, scratch);
+}
+
+bool OfflineReg::ReadValue(const char* name, RegistryValue& result, std::vector<std::byte>& scratch) const
+{
+    return detail::ReadValue(m_Hive, m_KeyCell, name, result, scratch);
+}
+
+bool OfflineReg::ReadStringValue(const wchar_t* name, std::wstring& result) const
+{
+    return detail::ReadDecodedValue(m_Hive, m_KeyCell, name, result);
+}
+
+bool OfflineReg::ReadStringValue(const char* name, std::string& result) const
+{
+    return detail::ReadDecodedValue(m_Hive, m_KeyCell, name, result);
+}
+
+bool OfflineReg::ReadMultiStringValue(const wchar_t* name, std::vector<std::wstring>& result) const
+{
+    return detail::ReadDecodedValue(m_Hive, m_KeyCell, name, result);
+}
+
+bool OfflineReg::ReadMultiStringValue(const char* name, std::vector<std::string>& result) const
+{
+    return detail::ReadDecodedValue(m_Hive, m_KeyCell, name, result);
+}
+
+bool OfflineReg::ReadIntValue(const wchar_t* name, uint32_t& result) const
+{
+    return detail::ReadDecodedValue(m_Hive, m_KeyCell, name, result);
+}
+
+bool OfflineReg::ReadInt64Value(const wchar_t* name, uint64_t& result) const
+{
+    return detail::ReadDecodedValue(m_Hive, m_KeyCell, name, result);
+}
+
+bool OfflineReg::ReadBinaryValue(const wchar_t* name, std::vector<std::byte>& result) const
+{
+    std::vector<std::byte> scratch;
+    RegistryValue value{};
+    if (!ReadValue(name, value, scratch) || value.Type != RegistryValueType::Binary)
+    {
+        return false;
+    }
+    return detail::DecodeRegistryValue(value, result);
+}
+
+bool OfflineReg::ForEachValue(IRegistryValueVisitor& visitor) const
+{
+    if (!m_Hive || m_KeyCell == 0)
+    {
+        return false;
+    }
+
+    std::vector<std::byte> scratch;
+    return detail::VisitValueKeys(*m_Hive, m_KeyCell, [&](const std::byte* value, const detail::CellName& name) {
+        RegistryValue entry{};
+        // Values with damaged data are skipped.
+        return !detail::ToRegistryValue(*m_Hive, value, name, entry, scratch) || visitor.Visit(entry);
+    });
+}
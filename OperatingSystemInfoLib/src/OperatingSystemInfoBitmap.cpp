@@ -0,0 +1,629 @@
+#include "pch.h"
+#include "OperatingSystemInfoBitmap.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define OPERATINGSYSTEM_BITMAP_X64
+#include <immintrin.h>
+#endif
+
+// MSVC accepts AVX2 intrinsics anywhere, GCC and clang only in functions compiled for it.
+#if defined(__GNUC__) || defined(__clang__)
+#define OPERATINGSYSTEM_BITMAP_AVX2 __attribute__((target("avx2")))
+#else
+#define OPERATINGSYSTEM_BITMAP_AVX2
+#endif
+
+namespace detail
+{
+using Container = OperatingSystemInfoBitmapContainer;
+using Operation = BitmapOperation;
+
+constexpr size_t BitsetWords = Container::BitsetWords;
+
+// Without a POPCNT target, compilers call a table-based helper for std::bitset::count, this is a few instructions.
+inline uint32_t CountBits(uint64_t word)
+{
+    word -= (word >> 1) & 0x5555555555555555ull;
+    word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<uint32_t>((word * 0x0101010101010101ull) >> 56);
+}
+
+inline bool TestBit(const uint64_t* bits, uint16_t value)
+{
+    return (bits[value >> 6] >> (value & 63)) & 1;
+}
+
+template <Operation TOperation> uint32_t CombineBitsetsScalar(const uint64_t* lhs, const uint64_t* rhs, uint64_t* out)
+{
+    uint32_t count = 0;
+    for (size_t i = 0; i < BitsetWords; ++i)
+    {
+        uint64_t word;
+        if constexpr (TOperation == Operation::And)
+        {
+            word = lhs[i] & rhs[i];
+        }
+        else if constexpr (TOperation == Operation::Or)
+        {
+            word = lhs[i] | rhs[i];
+        }
+        else
+        {
+            word = lhs[i] & ~rhs[i];
+        }
+        out[i] = word;
+        count += CountBits(word);
+    }
+    return count;
+}
+
+#ifdef OPERATINGSYSTEM_BITMAP_X64
+// Counts the bits of 256-bit words with a nibble lookup table, summed per 64-bit lane by _mm256_sad_epu8.
+template <Operation TOperation>
+OPERATINGSYSTEM_BITMAP_AVX2 uint32_t CombineBitsetsAvx2(const uint64_t* lhs, const uint64_t* rhs, uint64_t* out)
+{
+    const auto lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                         2, 3, 2, 3, 3, 4);
+    const auto nibbles = _mm256_set1_epi8(0x0F);
+    auto total = _mm256_setzero_si256();
+    for (size_t i = 0; i < BitsetWords; i += 4)
+    {
+        const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+        __m256i word;
+        if constexpr (TOperation == Operation::And)
+        {
+            word = _mm256_and_si256(a, b);
+        }
+        else if constexpr (TOperation == Operation::Or)
+        {
+            word = _mm256_or_si256(a, b);
+        }
+        else
+        {
+            word = _mm256_andnot_si256(b, a);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), word);
+        const auto low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(word, nibbles));
+        const auto high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(word, 4), nibbles));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+    return static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+#endif
+
+template <Operation TOperation>
+uint32_t CombineBitsets(const uint64_t* lhs, const uint64_t* rhs, uint64_t* out, SimdLevel level)
+{
+#ifdef OPERATINGSYSTEM_BITMAP_X64
+    if (level == SimdLevel::Avx2)
+    {
+        return CombineBitsetsAvx2<TOperation>(lhs, rhs, out);
+    }
+#else
+    (void)level;
+#endif
+    return CombineBitsetsScalar<TOperation>(lhs, rhs, out);
+}
+
+uint32_t CombineBitsets(const uint64_t* lhs, const uint64_t* rhs, uint64_t* out, Operation operation, SimdLevel level)
+{
+    switch (operation)
+    {
+    case Operation::And:
+        return CombineBitsets<Operation::And>(lhs, rhs, out, level);
+    case Operation::Or:
+        return CombineBitsets<Operation::Or>(lhs, rhs, out, level);
+    default:
+        return CombineBitsets<Operation::AndNot>(lhs, rhs, out, level);
+    }
+}
+
+// First position of [begin, end) not below value, probing 1, 2, 4... elements ahead before the binary search,
+// so that walking a long array for a few values costs O(log distance) each.
+inline const uint16_t* Gallop(const uint16_t* begin, const uint16_t* end, uint16_t value)
+{
+    size_t step = 1;
+    while (step < static_cast<size_t>(end - begin) && begin[step] < value)
+    {
+        begin += step;
+        step *= 2;
+    }
+    return std::lower_bound(begin, begin + (std::min)(step + 1, static_cast<size_t>(end - begin)), value);
+}
+
+uint32_t IntersectArrays(const uint16_t* lhs, uint32_t lhsCount, const uint16_t* rhs, uint32_t rhsCount,
+                         std::vector<uint16_t>& out)
+{
+    if (lhsCount > rhsCount)
+    {
+        std::swap(lhs, rhs);
+        std::swap(lhsCount, rhsCount);
+    }
+    out.reserve(lhsCount);
+    const auto lhsEnd = lhs + lhsCount;
+    const auto rhsEnd = rhs + rhsCount;
+    if (size_t{lhsCount} * 32 < rhsCount)
+    {
+        for (; lhs != lhsEnd && rhs != rhsEnd; ++lhs)
+        {
+            rhs = Gallop(rhs, rhsEnd, *lhs);
+            if (rhs != rhsEnd && *rhs == *lhs)
+            {
+                out.push_back(*lhs);
+            }
+        }
+    }
+    else
+    {
+        std::set_intersection(lhs, lhsEnd, rhs, rhsEnd, std::back_inserter(out));
+    }
+    return static_cast<uint32_t>(out.size());
+}
+
+// Keeps the values whose bit is set, or clear when keep is false. Branch-free, since the bits are as good as random.
+uint32_t FilterArray(const uint16_t* values, uint32_t count, const uint64_t* bits, bool keep, std::vector<uint16_t>& out)
+{
+    out.resize(count);
+    const auto data = out.data();
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        data[kept] = values[i];
+        kept += TestBit(bits, values[i]) == keep;
+    }
+    out.resize(kept);
+    return kept;
+}
+
+// Returns the number of bits which changed.
+uint32_t SetBits(const uint16_t* values, uint32_t count, uint64_t* bits)
+{
+    uint32_t changed = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint64_t mask = uint64_t{1} << (values[i] & 63);
+        changed += (bits[values[i] >> 6] & mask) == 0;
+        bits[values[i] >> 6] |= mask;
+    }
+    return changed;
+}
+
+uint32_t ClearBits(const uint16_t* values, uint32_t count, uint64_t* bits)
+{
+    uint32_t changed = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint64_t mask = uint64_t{1} << (values[i] & 63);
+        changed += (bits[values[i] >> 6] & mask) != 0;
+        bits[values[i] >> 6] &= ~mask;
+    }
+    return changed;
+}
+
+// Writes one value per set bit, clearing the lowest bit of the word each step, so the loop runs once per set bit
+// instead of once per position.
+void BitsToArray(const uint64_t* bits, uint32_t cardinality, std::vector<uint16_t>& out)
+{
+    out.resize(cardinality);
+    auto data = out.data();
+    for (uint32_t word = 0; word < BitsetWords; ++word)
+    {
+        for (auto w = bits[word]; w != 0; w &= w - 1)
+        {
+            *data++ = static_cast<uint16_t>(word * 64 + LowestBit(w));
+        }
+    }
+}
+
+// Position of the container with key, or of the first one above it.
+size_t FindContainer(const Container* containers, size_t count, uint16_t key)
+{
+    return static_cast<size_t>(
+        std::lower_bound(containers, containers + count, key,
+                         [](const Container& container, uint16_t value) { return container.Key < value; }) -
+        containers);
+}
+} // namespace detail
+
+uint64_t OperatingSystemInfoBitmapView::Cardinality() const noexcept
+{
+    uint64_t cardinality = 0;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        cardinality += Containers[i].Cardinality;
+    }
+    return cardinality;
+}
+
+bool OperatingSystemInfoBitmapView::Contains(uint32_t host) const noexcept
+{
+    const auto key = static_cast<uint16_t>(host >> 16);
+    const auto low = static_cast<uint16_t>(host);
+    const auto i = detail::FindContainer(Containers, Count, key);
+    if (i == Count || Containers[i].Key != key)
+    {
+        return false;
+    }
+    if (Containers[i].IsBitset())
+    {
+        return detail::TestBit(Bits(i), low);
+    }
+    return std::binary_search(Array(i), Array(i) + Containers[i].Cardinality, low);
+}
+
+void AndBitmaps(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+                OperatingSystemInfoBitmap& result, SimdLevel level)
+{
+    result.Combine(lhs, rhs, detail::BitmapOperation::And, level);
+}
+
+void OrBitmaps(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+               OperatingSystemInfoBitmap& result, SimdLevel level)
+{
+    result.Combine(lhs, rhs, detail::BitmapOperation::Or, level);
+}
+
+void AndNotBitmaps(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+                   OperatingSystemInfoBitmap& result, SimdLevel level)
+{
+    result.Combine(lhs, rhs, detail::BitmapOperation::AndNot, level);
+}
+
+void AndBitmaps(const OperatingSystemInfoBitmapView* bitmaps, size_t count, OperatingSystemInfoBitmap& result,
+                SimdLevel level)
+{
+    if (count == 0)
+    {
+        result.Clear();
+        return;
+    }
+    std::vector<std::pair<uint64_t, const OperatingSystemInfoBitmapView*>> order;
+    order.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        order.emplace_back(bitmaps[i].Cardinality(), bitmaps + i);
+    }
+    std::sort(order.begin(), order.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    if (count == 1)
+    {
+        result.Assign(*order[0].second);
+        return;
+    }
+    AndBitmaps(*order[0].second, *order[1].second, result, level);
+    OperatingSystemInfoBitmap next;
+    for (size_t i = 2; i < count && !result.Empty(); ++i)
+    {
+        AndBitmaps(result.View(), *order[i].second, next, level);
+        std::swap(result, next);
+    }
+}
+
+bool OperatingSystemInfoBitmap::Add(uint32_t host)
+{
+    const auto key = static_cast<uint16_t>(host >> 16);
+    const auto low = static_cast<uint16_t>(host);
+    const auto i = detail::FindContainer(m_Containers.data(), m_Containers.size(), key);
+    if (i == m_Containers.size() || m_Containers[i].Key != key)
+    {
+        auto storage = TakeStorage();
+        storage.Array.push_back(low);
+        m_Containers.insert(m_Containers.begin() + static_cast<ptrdiff_t>(i), {key, 0, 1, 0});
+        m_Storage.insert(m_Storage.begin() + static_cast<ptrdiff_t>(i), std::move(storage));
+        Refresh(i);
+        return true;
+    }
+
+    auto& container = m_Containers[i];
+    auto& storage = m_Storage[i];
+    if (!container.IsBitset())
+    {
+        auto position = std::lower_bound(storage.Array.begin(), storage.Array.end(), low);
+        if (position != storage.Array.end() && *position == low)
+        {
+            return false;
+        }
+        if (container.Cardinality < OperatingSystemInfoBitmapContainer::ArrayLimit)
+        {
+            storage.Array.insert(position, low);
+            ++container.Cardinality;
+            Refresh(i);
+            return true;
+        }
+        ToBitset(i);
+    }
+    const uint64_t mask = uint64_t{1} << (low & 63);
+    if ((storage.Bits[low >> 6] & mask) != 0)
+    {
+        return false;
+    }
+    storage.Bits[low >> 6] |= mask;
+    ++container.Cardinality;
+    Refresh(i);
+    return true;
+}
+
+bool OperatingSystemInfoBitmap::Remove(uint32_t host)
+{
+    const auto key = static_cast<uint16_t>(host >> 16);
+    const auto low = static_cast<uint16_t>(host);
+    const auto i = detail::FindContainer(m_Containers.data(), m_Containers.size(), key);
+    if (i == m_Containers.size() || m_Containers[i].Key != key)
+    {
+        return false;
+    }
+
+    auto& container = m_Containers[i];
+    auto& storage = m_Storage[i];
+    if (container.IsBitset())
+    {
+        const uint64_t mask = uint64_t{1} << (low & 63);
+        if ((storage.Bits[low >> 6] & mask) == 0)
+        {
+            return false;
+        }
+        storage.Bits[low >> 6] &= ~mask;
+        if (--container.Cardinality == OperatingSystemInfoBitmapContainer::ArrayLimit)
+        {
+            ToArray(i);
+        }
+        Refresh(i);
+        return true;
+    }
+
+    auto position = std::lower_bound(storage.Array.begin(), storage.Array.end(), low);
+    if (position == storage.Array.end() || *position != low)
+    {
+        return false;
+    }
+    storage.Array.erase(position);
+    if (--container.Cardinality == 0)
+    {
+        m_Spare.push_back(std::move(storage));
+        m_Storage.erase(m_Storage.begin() + static_cast<ptrdiff_t>(i));
+        m_Containers.erase(m_Containers.begin() + static_cast<ptrdiff_t>(i));
+    }
+    return true;
+}
+
+void OperatingSystemInfoBitmap::Assign(const OperatingSystemInfoBitmapView& bitmap)
+{
+    Clear();
+    for (size_t i = 0; i < bitmap.Count; ++i)
+    {
+        Append(bitmap, i);
+    }
+}
+
+void OperatingSystemInfoBitmap::Clear()
+{
+    // Keeps the storage of the containers for the next ones, without allocating.
+    if (m_Spare.empty())
+    {
+        m_Spare.swap(m_Storage);
+    }
+    else
+    {
+        for (auto& storage : m_Storage)
+        {
+            m_Spare.push_back(std::move(storage));
+        }
+        m_Storage.clear();
+    }
+    m_Containers.clear();
+}
+
+std::vector<uint32_t> OperatingSystemInfoBitmap::ToVector() const
+{
+    std::vector<uint32_t> hosts;
+    hosts.reserve(static_cast<size_t>(Cardinality()));
+    View().ForEach([&](uint32_t host) { hosts.push_back(host); });
+    return hosts;
+}
+
+void OperatingSystemInfoBitmap::Append(uint16_t key, Storage&& storage, uint32_t cardinality)
+{
+    if (cardinality == 0)
+    {
+        m_Spare.push_back(std::move(storage));
+        return;
+    }
+    const bool bitset = cardinality > OperatingSystemInfoBitmapContainer::ArrayLimit;
+    if (!bitset && !storage.Bits.empty())
+    {
+        detail::BitsToArray(storage.Bits.data(), cardinality, storage.Array);
+        storage.Bits.clear();
+    }
+    else if (bitset && storage.Bits.empty())
+    {
+        storage.Bits.assign(OperatingSystemInfoBitmapContainer::BitsetWords, 0);
+        detail::SetBits(storage.Array.data(), static_cast<uint32_t>(storage.Array.size()), storage.Bits.data());
+        storage.Array.clear();
+    }
+    m_Containers.push_back({key, 0, cardinality, 0});
+    m_Storage.push_back(std::move(storage));
+    Refresh(m_Containers.size() - 1);
+}
+
+void OperatingSystemInfoBitmap::Append(const OperatingSystemInfoBitmapView& bitmap, size_t i)
+{
+    auto storage = TakeStorage();
+    const auto& container = bitmap.Containers[i];
+    if (container.IsBitset())
+    {
+        storage.Bits.assign(bitmap.Bits(i), bitmap.Bits(i) + OperatingSystemInfoBitmapContainer::BitsetWords);
+    }
+    else
+    {
+        storage.Array.assign(bitmap.Array(i), bitmap.Array(i) + container.Cardinality);
+    }
+    Append(container.Key, std::move(storage), container.Cardinality);
+}
+
+void OperatingSystemInfoBitmap::Combine(const OperatingSystemInfoBitmapView& lhs, const OperatingSystemInfoBitmapView& rhs,
+                                        detail::BitmapOperation operation, SimdLevel level)
+{
+    using detail::BitmapOperation;
+    if (level > GetSupportedSimdLevel())
+    {
+        level = GetSupportedSimdLevel();
+    }
+    Clear();
+    size_t i = 0;
+    size_t j = 0;
+    while (i < lhs.Count || j < rhs.Count)
+    {
+        if ((operation == BitmapOperation::And && (i == lhs.Count || j == rhs.Count)) ||
+            (operation == BitmapOperation::AndNot && i == lhs.Count))
+        {
+            break;
+        }
+        if (j == rhs.Count || (i < lhs.Count && lhs.Containers[i].Key < rhs.Containers[j].Key))
+        {
+            if (operation != BitmapOperation::And)
+            {
+                Append(lhs, i);
+            }
+            ++i;
+        }
+        else if (i == lhs.Count || rhs.Containers[j].Key < lhs.Containers[i].Key)
+        {
+            if (operation == BitmapOperation::Or)
+            {
+                Append(rhs, j);
+            }
+            ++j;
+        }
+        else
+        {
+            Combine(lhs, i++, rhs, j++, operation, level);
+        }
+    }
+}
+
+void OperatingSystemInfoBitmap::Combine(const OperatingSystemInfoBitmapView& lhs, size_t i,
+                                        const OperatingSystemInfoBitmapView& rhs, size_t j,
+                                        detail::BitmapOperation operation, SimdLevel level)
+{
+    using detail::BitmapOperation;
+    constexpr auto words = OperatingSystemInfoBitmapContainer::BitsetWords;
+    const auto& left = lhs.Containers[i];
+    const auto& right = rhs.Containers[j];
+    auto storage = TakeStorage();
+    uint32_t cardinality = 0;
+    if (left.IsBitset() && right.IsBitset())
+    {
+        storage.Bits.resize(words);
+        cardinality = detail::CombineBitsets(lhs.Bits(i), rhs.Bits(j), storage.Bits.data(), operation, level);
+    }
+    else if (left.IsBitset())
+    {
+        switch (operation)
+        {
+        case BitmapOperation::And:
+            cardinality = detail::FilterArray(rhs.Array(j), right.Cardinality, lhs.Bits(i), true, storage.Array);
+            break;
+        case BitmapOperation::Or:
+            storage.Bits.assign(lhs.Bits(i), lhs.Bits(i) + words);
+            cardinality = left.Cardinality + detail::SetBits(rhs.Array(j), right.Cardinality, storage.Bits.data());
+            break;
+        case BitmapOperation::AndNot:
+            storage.Bits.assign(lhs.Bits(i), lhs.Bits(i) + words);
+            cardinality = left.Cardinality - detail::ClearBits(rhs.Array(j), right.Cardinality, storage.Bits.data());
+            break;
+        }
+    }
+    else if (right.IsBitset())
+    {
+        switch (operation)
+        {
+        case BitmapOperation::And:
+            cardinality = detail::FilterArray(lhs.Array(i), left.Cardinality, rhs.Bits(j), true, storage.Array);
+            break;
+        case BitmapOperation::Or:
+            storage.Bits.assign(rhs.Bits(j), rhs.Bits(j) + words);
+            cardinality = right.Cardinality + detail::SetBits(lhs.Array(i), left.Cardinality, storage.Bits.data());
+            break;
+        case BitmapOperation::AndNot:
+            cardinality = detail::FilterArray(lhs.Array(i), left.Cardinality, rhs.Bits(j), false, storage.Array);
+            break;
+        }
+    }
+    else
+    {
+        const auto leftBegin = lhs.Array(i);
+        const auto leftEnd = leftBegin + left.Cardinality;
+        const auto rightBegin = rhs.Array(j);
+        const auto rightEnd = rightBegin + right.Cardinality;
+        switch (operation)
+        {
+        case BitmapOperation::And:
+            cardinality =
+                detail::IntersectArrays(leftBegin, left.Cardinality, rightBegin, right.Cardinality, storage.Array);
+            break;
+        case BitmapOperation::Or:
+            if (left.Cardinality + right.Cardinality <= OperatingSystemInfoBitmapContainer::ArrayLimit)
+            {
+                storage.Array.reserve(left.Cardinality + right.Cardinality);
+                std::set_union(leftBegin, leftEnd, rightBegin, rightEnd, std::back_inserter(storage.Array));
+                cardinality = static_cast<uint32_t>(storage.Array.size());
+            }
+            else
+            {
+                storage.Bits.assign(words, 0);
+                cardinality = detail::SetBits(leftBegin, left.Cardinality, storage.Bits.data()) +
+                              detail::SetBits(rightBegin, right.Cardinality, storage.Bits.data());
+            }
+            break;
+        case BitmapOperation::AndNot:
+            storage.Array.reserve(left.Cardinality);
+            std::set_difference(leftBegin, leftEnd, rightBegin, rightEnd, std::back_inserter(storage.Array));
+            cardinality = static_cast<uint32_t>(storage.Array.size());
+            break;
+        }
+    }
+    Append(left.Key, std::move(storage), cardinality);
+}
+
+OperatingSystemInfoBitmap::Storage OperatingSystemInfoBitmap::TakeStorage()
+{
+    if (m_Spare.empty())
+    {
+        return {};
+    }
+    auto storage = std::move(m_Spare.back());
+    m_Spare.pop_back();
+    storage.Array.clear();
+    storage.Bits.clear();
+    return storage;
+}
+
+void OperatingSystemInfoBitmap::Refresh(size_t i) noexcept
+{
+    auto& container = m_Containers[i];
+    container.Offset = container.IsBitset() ? reinterpret_cast<uintptr_t>(m_Storage[i].Bits.data())
+                                            : reinterpret_cast<uintptr_t>(m_Storage[i].Array.data());
+}
+
+void OperatingSystemInfoBitmap::ToArray(size_t i)
+{
+    auto& storage = m_Storage[i];
+    detail::BitsToArray(storage.Bits.data(), m_Containers[i].Cardinality, storage.Array);
+    storage.Bits.clear();
+}
+
+void OperatingSystemInfoBitmap::ToBitset(size_t i)
+{
+    auto& storage = m_Storage[i];
+    storage.Bits.assign(OperatingSystemInfoBitmapContainer::BitsetWords, 0);
+    detail::SetBits(storage.Array.data(), static_cast<uint32_t>(storage.Array.size()), storage.Bits.data());
+    storage.Array.clear();
+}
@@ -0,0 +1,380 @@
+#include "pch.h"
+#include "OperatingSystemInfoBitmapIndex.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+
+namespace detail
+{
+using BitmapIndexFormat = OperatingSystemInfoBitmapIndexFormat;
+
+inline uint64_t GetBitmapKey(const CompactOperatingSystemInfo& record, size_t field)
+{
+    const bool inlined = record.Inlined.Has(static_cast<OperatingSystemInfoField>(field));
+    return (uint64_t{inlined} << 32) | record.Slots[field];
+}
+
+inline uint64_t AlignBitmapOffset(uint64_t offset)
+{
+    return (offset + BitmapIndexFormat::Alignment - 1) & ~uint64_t{BitmapIndexFormat::Alignment - 1};
+}
+
+inline uint64_t GetContainerDataSize(const OperatingSystemInfoBitmapContainer& container)
+{
+    return container.IsBitset() ? OperatingSystemInfoBitmapContainer::BitsetWords * sizeof(uint64_t)
+                                : container.Cardinality * sizeof(uint16_t);
+}
+
+// Lays the sections out in a buffer, then copies the containers, their data and the strings in place.
+class BitmapIndexWriter
+{
+public:
+    BitmapIndexWriter(std::vector<std::byte>& buffer) : m_Buffer(buffer)
+    {
+    }
+
+    void Reserve(const OperatingSystemInfoBitmapView& bitmap, size_t strings)
+    {
+        m_ContainerCount += bitmap.Count;
+        for (size_t i = 0; i < bitmap.Count; ++i)
+        {
+            m_DataSize += AlignBitmapOffset(GetContainerDataSize(bitmap.Containers[i]));
+        }
+        m_StringSize += strings;
+    }
+
+    // Sizes the buffer once everything was reserved, for entries bytes of header, fields and values.
+    void Allocate(uint64_t entries)
+    {
+        m_ContainerOffset = entries;
+        m_DataOffset = m_ContainerOffset + m_ContainerCount * sizeof(OperatingSystemInfoBitmapContainer);
+        m_StringOffset = m_DataOffset + m_DataSize;
+        m_Buffer.assign(static_cast<size_t>(m_StringOffset + m_StringSize), std::byte{0});
+    }
+
+    template <class T> void Store(uint64_t offset, const T& value)
+    {
+        std::memcpy(m_Buffer.data() + offset, &value, sizeof(value));
+    }
+
+    // Copies bitmap, returns the offset of its containers.
+    uint64_t WriteBitmap(const OperatingSystemInfoBitmapView& bitmap)
+    {
+        const auto offset = m_ContainerOffset;
+        for (size_t i = 0; i < bitmap.Count; ++i)
+        {
+            auto container = bitmap.Containers[i];
+            const auto size = GetContainerDataSize(container);
+            std::memcpy(m_Buffer.data() + m_DataOffset, bitmap.Array(i), static_cast<size_t>(size));
+            container.Offset = m_DataOffset;
+            Store(m_ContainerOffset, container);
+            m_ContainerOffset += sizeof(container);
+            m_DataOffset += AlignBitmapOffset(size);
+        }
+        return offset;
+    }
+
+    uint64_t WriteString(std::string_view value)
+    {
+        const auto offset = m_StringOffset;
+        std::memcpy(m_Buffer.data() + offset, value.data(), value.size());
+        m_StringOffset += value.size();
+        return offset;
+    }
+
+private:
+    std::vector<std::byte>& m_Buffer;
+    uint64_t m_ContainerCount = 0;
+    uint64_t m_DataSize = 0;
+    uint64_t m_StringSize = 0;
+    uint64_t m_ContainerOffset = 0;
+    uint64_t m_DataOffset = 0;
+    uint64_t m_StringOffset = 0;
+};
+} // namespace detail
+
+void OperatingSystemInfoBitmapIndex::Update(uint32_t host, const OperatingSystemInfo& info)
+{
+    UpdateRecord(host, m_Inventory.Add(info));
+}
+
+void OperatingSystemInfoBitmapIndex::Update(uint32_t host, const OperatingSystemInfoView& info)
+{
+    UpdateRecord(host, m_Inventory.Add(info));
+}
+
+void OperatingSystemInfoBitmapIndex::UpdateRecord(uint32_t host, uint32_t record)
+{
+    if (host >= m_HostRecords.size())
+    {
+        m_HostRecords.resize(static_cast<size_t>(host) + 1, NoRecord);
+    }
+    const auto previous = m_HostRecords[host];
+    if (previous == record)
+    {
+        return;
+    }
+    const auto& after = m_Inventory.GetCompact(record);
+    const auto* before = previous == NoRecord ? nullptr : &m_Inventory.GetCompact(previous);
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        const auto field = static_cast<OperatingSystemInfoField>(i);
+        const bool had = before != nullptr && before->Present.Has(field);
+        const bool has = after.Present.Has(field);
+        const auto key = detail::GetBitmapKey(after, i);
+        if (had)
+        {
+            const auto previousKey = detail::GetBitmapKey(*before, i);
+            if (has && previousKey == key)
+            {
+                continue;
+            }
+            auto bitmap = m_Values[i].find(previousKey);
+            bitmap->second.Remove(host);
+            if (bitmap->second.Empty())
+            {
+                m_Values[i].erase(bitmap);
+            }
+        }
+        if (has)
+        {
+            m_Values[i][key].Add(host);
+        }
+    }
+    m_Hosts.Add(host);
+    m_HostRecords[host] = record;
+}
+
+bool OperatingSystemInfoBitmapIndex::Remove(uint32_t host)
+{
+    if (host >= m_HostRecords.size() || m_HostRecords[host] == NoRecord)
+    {
+        return false;
+    }
+    const auto& record = m_Inventory.GetCompact(m_HostRecords[host]);
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        if (record.Present.Has(static_cast<OperatingSystemInfoField>(i)))
+        {
+            auto bitmap = m_Values[i].find(detail::GetBitmapKey(record, i));
+            bitmap->second.Remove(host);
+            if (bitmap->second.Empty())
+            {
+                m_Values[i].erase(bitmap);
+            }
+        }
+    }
+    m_Hosts.Remove(host);
+    m_HostRecords[host] = NoRecord;
+    return true;
+}
+
+OperatingSystemInfoBitmapView OperatingSystemInfoBitmapIndex::Find(OperatingSystemInfoField field, std::string_view value) const
+{
+    uint32_t slot = 0;
+    bool inlined = false;
+    if (!CompactOperatingSystemInfo::FindSlot(field, value, m_Inventory.Strings(), slot, inlined))
+    {
+        return {};
+    }
+    const auto& values = m_Values[static_cast<size_t>(field)];
+    auto found = values.find((uint64_t{inlined} << 32) | slot);
+    return found == values.end() ? OperatingSystemInfoBitmapView{} : found->second.View();
+}
+
+bool OperatingSystemInfoBitmapIndex::Write(std::ostream& output) const
+{
+    using Format = OperatingSystemInfoBitmapIndexFormat;
+    struct Entry
+    {
+        std::string Value;
+        OperatingSystemInfoBitmapView Bitmap;
+    };
+
+    std::vector<std::byte> buffer;
+    detail::BitmapIndexWriter writer(buffer);
+    std::array<std::vector<Entry>, OperatingSystemInfoFieldCount> fields;
+    size_t valueCount = 0;
+    writer.Reserve(m_Hosts.View(), 0);
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        for (const auto& [key, bitmap] : m_Values[i])
+        {
+            Entry entry{{}, bitmap.View()};
+            if (key >> 32)
+            {
+                char digits[10];
+                auto converted = std::to_chars(digits, digits + sizeof(digits), static_cast<uint32_t>(key));
+                entry.Value.assign(digits, converted.ptr);
+            }
+            else
+            {
+                entry.Value = m_Inventory.Strings().Get(static_cast<uint32_t>(key));
+            }
+            writer.Reserve(entry.Bitmap, entry.Value.size());
+            fields[i].push_back(std::move(entry));
+        }
+        std::sort(fields[i].begin(), fields[i].end(), [](const Entry& lhs, const Entry& rhs) { return lhs.Value < rhs.Value; });
+        valueCount += fields[i].size();
+    }
+
+    const uint64_t fieldsOffset = sizeof(Format::Header);
+    uint64_t valuesOffset = fieldsOffset + OperatingSystemInfoFieldCount * sizeof(Format::Field);
+    writer.Allocate(valuesOffset + valueCount * sizeof(Format::Value));
+
+    Format::Header header{};
+    header.Magic = Format::Magic;
+    header.Version = Format::Version;
+    header.FieldCount = static_cast<uint32_t>(OperatingSystemInfoFieldCount);
+    header.HostsOffset = writer.WriteBitmap(m_Hosts.View());
+    header.HostsCount = m_Hosts.View().Count;
+    writer.Store(0, header);
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        writer.Store(fieldsOffset + i * sizeof(Format::Field), Format::Field{valuesOffset, fields[i].size()});
+        for (const auto& entry : fields[i])
+        {
+            Format::Value value{};
+            value.StringOffset = writer.WriteString(entry.Value);
+            value.StringSize = static_cast<uint32_t>(entry.Value.size());
+            value.ContainersOffset = writer.WriteBitmap(entry.Bitmap);
+            value.ContainerCount = entry.Bitmap.Count;
+            writer.Store(valuesOffset, value);
+            valuesOffset += sizeof(value);
+        }
+    }
+
+    output.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<bool>(output);
+}
+
+bool OperatingSystemInfoBitmapIndex::WriteFile(const char* path) const
+{
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    return output && Write(output) && output.flush();
+}
+
+bool MappedOperatingSystemInfoBitmapIndex::Open(const char* path)
+{
+    Close();
+    if (!m_File.Open(path))
+    {
+        return false;
+    }
+    if (!Validate())
+    {
+        Close();
+        return false;
+    }
+    m_Header = reinterpret_cast<const OperatingSystemInfoBitmapIndexFormat::Header*>(m_File.Data());
+    m_Fields = reinterpret_cast<const OperatingSystemInfoBitmapIndexFormat::Field*>(m_File.Data() + sizeof(*m_Header));
+    return true;
+}
+
+void MappedOperatingSystemInfoBitmapIndex::Close()
+{
+    m_File.Close();
+    m_Header = nullptr;
+    m_Fields = nullptr;
+}
+
+OperatingSystemInfoBitmapView MappedOperatingSystemInfoBitmapIndex::Find(OperatingSystemInfoField field,
+                                                                       std::string_view value) const noexcept
+{
+    using Format = OperatingSystemInfoBitmapIndexFormat;
+    const auto index = static_cast<size_t>(field);
+    if (m_Header == nullptr || index >= m_Header->FieldCount)
+    {
+        return {};
+    }
+    const auto values = reinterpret_cast<const Format::Value*>(m_File.Data() + m_Fields[index].ValuesOffset);
+    const auto end = values + m_Fields[index].ValueCount;
+    auto found = std::lower_bound(values, end, value,
+                                  [this](const Format::Value& entry, std::string_view text) { return GetString(entry) < text; });
+    if (found == end || GetString(*found) != value)
+    {
+        return {};
+    }
+    return {reinterpret_cast<const OperatingSystemInfoBitmapContainer*>(m_File.Data() + found->ContainersOffset),
+            static_cast<size_t>(found->ContainerCount), m_File.Data()};
+}
+
+OperatingSystemInfoBitmapView MappedOperatingSystemInfoBitmapIndex::Hosts() const noexcept
+{
+    if (m_Header == nullptr)
+    {
+        return {};
+    }
+    return {reinterpret_cast<const OperatingSystemInfoBitmapContainer*>(m_File.Data() + m_Header->HostsOffset),
+            static_cast<size_t>(m_Header->HostsCount), m_File.Data()};
+}
+
+bool MappedOperatingSystemInfoBitmapIndex::Validate() const noexcept
+{
+    using Format = OperatingSystemInfoBitmapIndexFormat;
+    const auto size = m_File.Size();
+    if (size < sizeof(Format::Header))
+    {
+        return false;
+    }
+    const auto& header = *reinterpret_cast<const Format::Header*>(m_File.Data());
+    if (header.Magic != Format::Magic || header.Version != Format::Version ||
+        header.FieldCount > (size - sizeof(header)) / sizeof(Format::Field) ||
+        !ValidateBitmap(header.HostsOffset, header.HostsCount))
+    {
+        return false;
+    }
+    const auto fields = reinterpret_cast<const Format::Field*>(m_File.Data() + sizeof(header));
+    for (uint32_t i = 0; i < header.FieldCount; ++i)
+    {
+        const auto& field = fields[i];
+        if (field.ValuesOffset % alignof(Format::Value) != 0 || field.ValuesOffset > size ||
+            field.ValueCount > (size - field.ValuesOffset) / sizeof(Format::Value))
+        {
+            return false;
+        }
+        const auto values = reinterpret_cast<const Format::Value*>(m_File.Data() + field.ValuesOffset);
+        for (uint64_t j = 0; j < field.ValueCount; ++j)
+        {
+            const auto& value = values[j];
+            if (value.StringOffset > size || value.StringSize > size - value.StringOffset ||
+                !ValidateBitmap(value.ContainersOffset, value.ContainerCount) ||
+                (j > 0 && !(GetString(values[j - 1]) < GetString(value))))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool MappedOperatingSystemInfoBitmapIndex::ValidateBitmap(uint64_t offset, uint64_t count) const noexcept
+{
+    using Container = OperatingSystemInfoBitmapContainer;
+    const auto size = m_File.Size();
+    if (offset % alignof(Container) != 0 || offset > size || count > (size - offset) / sizeof(Container))
+    {
+        return false;
+    }
+    const auto containers = reinterpret_cast<const Container*>(m_File.Data() + offset);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const auto& container = containers[i];
+        if (container.Cardinality == 0 || container.Cardinality > 0x10000 || (i > 0 && containers[i - 1].Key >= container.Key) ||
+            container.Offset % (container.IsBitset() ? sizeof(uint64_t) : sizeof(uint16_t)) != 0 || container.Offset > size ||
+            detail::GetContainerDataSize(container) > size - container.Offset)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view MappedOperatingSystemInfoBitmapIndex::GetString(const OperatingSystemInfoBitmapIndexFormat::Value& value) const noexcept
+{
+    return {reinterpret_cast<const char*>(m_File.Data() + value.StringOffset), value.StringSize};
+}
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "OperatingSystemInfoDiff.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+namespace detail
+{
+constexpr size_t DefaultDiffChunkSize = 16384;
+
+size_t CountFields(OperatingSystemInfoFieldMask mask) noexcept
+{
+    size_t count = 0;
+    for (auto bits = mask.Bits(); bits != 0; bits &= bits - 1)
+    {
+        ++count;
+    }
+    return count;
+}
+
+// Diffs the pairs of a chunk and counts the changes.
+template <class TRecord>
+void DiffChunk(const TRecord* previous, const TRecord* current, OperatingSystemInfoFieldMask* changed, size_t count,
+               OperatingSystemInfoFieldMask fields, uint64_t& changedPairs, uint64_t& changedFields)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        changed[i] = ::GetChangedFields(previous[i], current[i], fields);
+        if (!changed[i].Empty())
+        {
+            ++changedPairs;
+            changedFields += CountFields(changed[i]);
+        }
+    }
+}
+} // namespace detail
+
+size_t DiffOperatingSystemInfo(const OperatingSystemInfo& previous, const OperatingSystemInfo& current,
+                               OperatingSystemInfoChangeSet& changes, OperatingSystemInfoFieldMask fields)
+{
+    changes.Clear();
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        const auto& oldValue = field.Get(previous);
+        const auto& newValue = field.Get(current);
+        if (fields.Has(field.Field) && oldValue != newValue)
+        {
+            changes.Add(field.Field, oldValue, newValue);
+        }
+    });
+    return changes.Size();
+}
+
+OperatingSystemInfoFieldMask GetChangedFields(const OperatingSystemInfo& previous, const OperatingSystemInfo& current,
+                                              OperatingSystemInfoFieldMask fields)
+{
+    OperatingSystemInfoFieldMask changed;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        if (fields.Has(field.Field) && field.Get(previous) != field.Get(current))
+        {
+            changed.Set(field.Field);
+        }
+    });
+    return changed;
+}
+
+OperatingSystemInfoFieldMask GetChangedFields(const CompactOperatingSystemInfo& previous,
+                                              const CompactOperatingSystemInfo& current,
+                                              OperatingSystemInfoFieldMask fields) noexcept
+{
+    // A branch-free loop over the slots, the flags tell whether equal slots hold the same kind of value.
+    uint32_t bits = (previous.Present.Bits() ^ current.Present.Bits()) | (previous.Inlined.Bits() ^ current.Inlined.Bits());
+    for (size_t i = 0; i < OperatingSystemInfoFieldCount; ++i)
+    {
+        bits |= uint32_t{previous.Slots[i] != current.Slots[i]} << i;
+    }
+    return OperatingSystemInfoFieldMask::FromBits(bits) & fields;
+}
+
+void ApplyOperatingSystemInfoChanges(OperatingSystemInfo& target, const OperatingSystemInfoChangeSet& changes)
+{
+    for (const auto& change : changes)
+    {
+        GetField(target, change.Field) = *change.New;
+    }
+}
+
+void ApplyOperatingSystemInfoChanges(OperatingSystemInfo& target, const OperatingSystemInfo& source,
+                                     OperatingSystemInfoFieldMask fields)
+{
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        if (fields.Has(field.Field))
+        {
+            field.Get(target) = field.Get(source);
+        }
+    });
+}
+
+OperatingSystemInfoBatchDiff::OperatingSystemInfoBatchDiff(ThreadPool& pool, size_t chunkSize) noexcept
+    : m_Pool(pool), m_ChunkSize(chunkSize == 0 ? detail::DefaultDiffChunkSize : chunkSize)
+{
+}
+
+bool OperatingSystemInfoBatchDiff::Diff(const std::vector<OperatingSystemInfo>& previous,
+                                        const std::vector<OperatingSystemInfo>& current,
+                                        std::vector<OperatingSystemInfoFieldMask>& changed,
+                                        OperatingSystemInfoFieldMask fields)
+{
+    return DiffAll(previous, current, changed, fields);
+}
+
+bool OperatingSystemInfoBatchDiff::Diff(const std::vector<CompactOperatingSystemInfo>& previous,
+                                        const std::vector<CompactOperatingSystemInfo>& current,
+                                        std::vector<OperatingSystemInfoFieldMask>& changed,
+                                        OperatingSystemInfoFieldMask fields)
+{
+    return DiffAll(previous, current, changed, fields);
+}
+
+template <class TRecord>
+bool OperatingSystemInfoBatchDiff::DiffAll(const std::vector<TRecord>& previous, const std::vector<TRecord>& current,
+                                           std::vector<OperatingSystemInfoFieldMask>& changed,
+                                           OperatingSystemInfoFieldMask fields)
+{
+    m_Statistics = {};
+    if (previous.size() != current.size())
+    {
+        changed.clear();
+        return false;
+    }
+    auto started = std::chrono::steady_clock::now();
+    auto count = previous.size();
+    changed.resize(count);
+
+    // The last chunk runs on the calling thread, which then runs queued tasks until the others are done.
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = count == 0 ? 0 : (count + m_ChunkSize - 1) / m_ChunkSize;
+    uint64_t changedPairs = 0;
+    uint64_t changedFields = 0;
+    auto diffChunk = [&](size_t begin) {
+        auto size = (std::min)(m_ChunkSize, count - begin);
+        uint64_t chunkPairs = 0;
+        uint64_t chunkFields = 0;
+        detail::DiffChunk(previous.data() + begin, current.data() + begin, changed.data() + begin, size, fields,
+                          chunkPairs, chunkFields);
+        // Notified with the lock held, the waiting thread may destroy done as soon as it has the lock.
+        std::lock_guard<std::mutex> lock(mutex);
+        changedPairs += chunkPairs;
+        changedFields += chunkFields;
+        if (--remaining == 0)
+        {
+            done.notify_one();
+        }
+    };
+
+    size_t begin = 0;
+    for (; count - begin > m_ChunkSize; begin += m_ChunkSize)
+    {
+        m_Pool.Submit([&diffChunk, begin] { diffChunk(begin); });
+    }
+    if (begin < count)
+    {
+        diffChunk(begin);
+    }
+    // Once nothing is queued every chunk left is running on some thread, so blocking cannot deadlock
+    // even when called from a worker of the pool.
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (remaining == 0)
+            {
+                break;
+            }
+        }
+        if (!m_Pool.RunPending())
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&remaining] { return remaining == 0; });
+            break;
+        }
+    }
+
+    m_Statistics.Pairs = count;
+    m_Statistics.ChangedPairs = changedPairs;
+    m_Statistics.ChangedFields = changedFields;
+    m_Statistics.Elapsed = std::chrono::steady_clock::now() - started;
+    return true;
+}
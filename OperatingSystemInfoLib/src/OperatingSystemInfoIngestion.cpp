@@ -0,0 +1,558 @@
+#include "pch.h"
+#include "OperatingSystemInfoIngestion.h"
+#include "LanguageTags.h"
+#include "ThreadPool.h"
+#include "Utf16.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace detail
+{
+bool IsJsonSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void SkipJsonSpace(const char*& p, const char* end)
+{
+    while (p < end && IsJsonSpace(*p))
+    {
+        ++p;
+    }
+}
+
+int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool ParseHex4(const char*& p, const char* end, uint32_t& result)
+{
+    if (end - p < 4)
+    {
+        return false;
+    }
+    result = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        auto digit = HexDigit(*p++);
+        if (digit < 0)
+        {
+            return false;
+        }
+        result = (result << 4) | static_cast<uint32_t>(digit);
+    }
+    return true;
+}
+
+// p points after the opening quote. Strings without escapes are returned in place, others are
+// unescaped at the end of scratch, which the caller reserved so that it never reallocates.
+bool ParseJsonString(const char*& p, const char* end, std::string_view& result, std::string& scratch)
+{
+    auto begin = p;
+    while (p < end && *p != '"' && *p != '\\')
+    {
+        ++p;
+    }
+    if (p == end)
+    {
+        return false;
+    }
+    if (*p == '"')
+    {
+        result = std::string_view(begin, static_cast<size_t>(p - begin));
+        ++p;
+        return true;
+    }
+
+    auto offset = scratch.size();
+    scratch.append(begin, p);
+    while (p < end && *p != '"')
+    {
+        if (*p != '\\')
+        {
+            scratch.push_back(*p++);
+            continue;
+        }
+        if (++p == end)
+        {
+            return false;
+        }
+        char escape = *p++;
+        switch (escape)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            scratch.push_back(escape);
+            break;
+        case 'b':
+            scratch.push_back('\b');
+            break;
+        case 'f':
+            scratch.push_back('\f');
+            break;
+        case 'n':
+            scratch.push_back('\n');
+            break;
+        case 'r':
+            scratch.push_back('\r');
+            break;
+        case 't':
+            scratch.push_back('\t');
+            break;
+        case 'u': {
+            uint32_t c = 0;
+            if (!ParseHex4(p, end, c))
+            {
+                return false;
+            }
+            if (c >= 0xD800 && c <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+            {
+                auto low = p + 2;
+                uint32_t second = 0;
+                if (ParseHex4(low, end, second) && second >= 0xDC00 && second <= 0xDFFF)
+                {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (second - 0xDC00);
+                    p = low;
+                }
+            }
+            if (c >= 0xD800 && c <= 0xDFFF)
+            {
+                c = 0xFFFD;
+            }
+            char utf8[4];
+            scratch.append(utf8, EncodeUtf8(c, utf8));
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    if (p == end)
+    {
+        return false;
+    }
+    ++p;
+    result = std::string_view(scratch.data() + offset, scratch.size() - offset);
+    return true;
+}
+
+// Skips a nested object or array, p points at its opening bracket.
+bool SkipJsonContainer(const char*& p, const char* end)
+{
+    size_t depth = 0;
+    while (p < end)
+    {
+        char c = *p++;
+        if (c == '"')
+        {
+            while (p < end && *p != '"')
+            {
+                p += *p == '\\' ? 2 : 1;
+            }
+            if (p >= end)
+            {
+                return false;
+            }
+            ++p;
+        }
+        else if (c == '{' || c == '[')
+        {
+            ++depth;
+        }
+        else if (c == '}' || c == ']')
+        {
+            if (--depth == 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+} // namespace detail
+
+bool ParseOperatingSystemInfoLine(std::string_view line, OperatingSystemInfoView& result, std::string& scratch)
+{
+    result.Present = {};
+    scratch.clear();
+    scratch.reserve(line.size());
+
+    auto p = line.data();
+    auto end = p + line.size();
+    detail::SkipJsonSpace(p, end);
+    if (p == end || *p++ != '{')
+    {
+        return false;
+    }
+    detail::SkipJsonSpace(p, end);
+    if (p < end && *p == '}')
+    {
+        ++p;
+        detail::SkipJsonSpace(p, end);
+        return p == end;
+    }
+
+    for (;;)
+    {
+        std::string_view key;
+        if (p == end || *p++ != '"' || !detail::ParseJsonString(p, end, key, scratch))
+        {
+            return false;
+        }
+        detail::SkipJsonSpace(p, end);
+        if (p == end || *p++ != ':')
+        {
+            return false;
+        }
+        detail::SkipJsonSpace(p, end);
+        if (p == end)
+        {
+            return false;
+        }
+
+        std::string_view value;
+        bool isNull = false;
+        if (*p == '"')
+        {
+            ++p;
+            if (!detail::ParseJsonString(p, end, value, scratch))
+            {
+                return false;
+            }
+        }
+        else if (*p == '{' || *p == '[')
+        {
+            if (!detail::SkipJsonContainer(p, end))
+            {
+                return false;
+            }
+            isNull = true;
+        }
+        else
+        {
+            auto begin = p;
+            while (p < end && *p != ',' && *p != '}' && !detail::IsJsonSpace(*p))
+            {
+                ++p;
+            }
+            value = std::string_view(begin, static_cast<size_t>(p - begin));
+            isNull = value == "null";
+            if (value.empty())
+            {
+                return false;
+            }
+        }
+
+        OperatingSystemInfoField field;
+        if (FindField(key, field))
+        {
+            if (isNull)
+            {
+                result.Present.Reset(field);
+            }
+            else
+            {
+                result.Present.Set(field);
+                result.Values[static_cast<size_t>(field)] = value;
+            }
+        }
+
+        detail::SkipJsonSpace(p, end);
+        if (p == end)
+        {
+            return false;
+        }
+        char separator = *p++;
+        if (separator == '}')
+        {
+            break;
+        }
+        if (separator != ',')
+        {
+            return false;
+        }
+        detail::SkipJsonSpace(p, end);
+    }
+    detail::SkipJsonSpace(p, end);
+    return p == end;
+}
+
+namespace detail
+{
+using IngestionClock = std::chrono::steady_clock;
+
+struct IngestionChunk
+{
+    uint64_t Sequence = 0;
+    std::string Data;
+    size_t Size = 0;
+
+    OperatingSystemInfoInventory Records;
+    std::vector<uint32_t> LineRecords;
+    uint64_t Lines = 0;
+    uint64_t Malformed = 0;
+};
+
+// State shared by the reading thread and the pool tasks of one ingestion.
+class IngestionRun final
+{
+public:
+    IngestionRun(OperatingSystemInfoInventory& inventory, std::vector<uint32_t>* recordIds,
+                 OperatingSystemInfoIngestionStatistics& statistics, size_t chunksInFlight, bool languageTags)
+        : m_Inventory(inventory), m_RecordIds(recordIds), m_Statistics(statistics), m_ChunksInFlight(chunksInFlight),
+          m_LanguageTags(languageTags)
+    {
+    }
+
+    // Blocks while ChunksInFlight chunks are pending, then hands out a buffer of the previous chunks if any.
+    std::shared_ptr<IngestionChunk> AcquireChunk()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_ChunkDone.wait(lock, [this] { return m_InFlight < m_ChunksInFlight; });
+        ++m_InFlight;
+        auto chunk = std::make_shared<IngestionChunk>();
+        if (!m_FreeBuffers.empty())
+        {
+            chunk->Data = std::move(m_FreeBuffers.back());
+            m_FreeBuffers.pop_back();
+        }
+        return chunk;
+    }
+
+    // For a chunk which turned out to be empty.
+    void ReleaseChunk(std::shared_ptr<IngestionChunk> chunk)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FreeBuffers.push_back(std::move(chunk->Data));
+        --m_InFlight;
+        m_ChunkDone.notify_all();
+    }
+
+    void WaitForAll()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_ChunkDone.wait(lock, [this] { return m_InFlight == 0; });
+        m_Statistics.Parse.Busy = std::chrono::nanoseconds(m_ParseBusy.load());
+    }
+
+    void Parse(IngestionChunk& chunk)
+    {
+        auto started = IngestionClock::now();
+        OperatingSystemInfoView view{};
+        std::string scratch;
+        std::string_view content(chunk.Data.data(), chunk.Size);
+        while (!content.empty())
+        {
+            auto lineEnd = content.find('\n');
+            auto line = content.substr(0, lineEnd);
+            content.remove_prefix(lineEnd == std::string_view::npos ? content.size() : lineEnd + 1);
+            if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+            {
+                continue;
+            }
+
+            ++chunk.Lines;
+            if (ParseOperatingSystemInfoLine(line, view, scratch))
+            {
+                if (m_LanguageTags)
+                {
+                    NormalizeLanguageFields(view);
+                }
+                chunk.LineRecords.push_back(chunk.Records.Add(view));
+            }
+            else
+            {
+                ++chunk.Malformed;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_FreeBuffers.push_back(std::move(chunk.Data));
+        }
+        m_ParseBusy += (IngestionClock::now() - started).count();
+    }
+
+    // Queues a parsed chunk. Whichever thread finds no merge running merges every chunk that is
+    // next in input order, so merging is serialized without a dedicated thread.
+    // The last access to the run is releasing m_Mutex, WaitForAll may destroy it right after.
+    void Complete(std::shared_ptr<IngestionChunk> chunk)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Ready.emplace(chunk->Sequence, std::move(chunk));
+        if (m_Merging)
+        {
+            return;
+        }
+        m_Merging = true;
+
+        while (!m_Ready.empty() && m_Ready.begin()->first == m_NextMerge)
+        {
+            auto next = std::move(m_Ready.begin()->second);
+            m_Ready.erase(m_Ready.begin());
+            lock.unlock();
+
+            Merge(*next);
+            next.reset();
+
+            lock.lock();
+            ++m_NextMerge;
+            --m_InFlight;
+            m_ChunkDone.notify_all();
+        }
+        m_Merging = false;
+    }
+
+private:
+    void Merge(const IngestionChunk& chunk)
+    {
+        auto started = IngestionClock::now();
+        std::vector<uint32_t> ids(chunk.Records.Size());
+        for (uint32_t i = 0; i < ids.size(); ++i)
+        {
+            ids[i] = m_Inventory.Add(chunk.Records.GetCompact(i), chunk.Records.Strings());
+        }
+        if (m_RecordIds)
+        {
+            for (auto local : chunk.LineRecords)
+            {
+                m_RecordIds->push_back(ids[local]);
+            }
+        }
+
+        m_Statistics.Lines += chunk.Lines;
+        m_Statistics.Records += chunk.LineRecords.size();
+        m_Statistics.Malformed += chunk.Malformed;
+        m_Statistics.Parse.Bytes += chunk.Size;
+        m_Statistics.Merge.Bytes += chunk.Size;
+        m_Statistics.Merge.Busy += IngestionClock::now() - started;
+    }
+
+    OperatingSystemInfoInventory& m_Inventory;
+    std::vector<uint32_t>* m_RecordIds;
+    OperatingSystemInfoIngestionStatistics& m_Statistics;
+    const size_t m_ChunksInFlight;
+    const bool m_LanguageTags;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_ChunkDone;
+    size_t m_InFlight = 0;
+    std::vector<std::string> m_FreeBuffers;
+    std::map<uint64_t, std::shared_ptr<IngestionChunk>> m_Ready;
+    uint64_t m_NextMerge = 0;
+    bool m_Merging = false;
+    std::atomic<int64_t> m_ParseBusy{0};
+};
+} // namespace detail
+
+OperatingSystemInfoIngestion::OperatingSystemInfoIngestion(ThreadPool& pool, OperatingSystemInfoIngestionOptions options) noexcept
+    : m_Pool(pool), m_Options(options)
+{
+    if (m_Options.ChunkSize == 0)
+    {
+        m_Options.ChunkSize = OperatingSystemInfoIngestionOptions{}.ChunkSize;
+    }
+    if (m_Options.ChunksInFlight == 0)
+    {
+        m_Options.ChunksInFlight = 2 * m_Pool.Size();
+    }
+}
+
+bool OperatingSystemInfoIngestion::IngestFile(const char* path, OperatingSystemInfoInventory& inventory, std::vector<uint32_t>* recordIds)
+{
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+    {
+        m_Statistics = {};
+        return false;
+    }
+    return Ingest(input, inventory, recordIds);
+}
+
+bool OperatingSystemInfoIngestion::Ingest(std::istream& input, OperatingSystemInfoInventory& inventory, std::vector<uint32_t>* recordIds)
+{
+    m_Statistics = {};
+    auto started = detail::IngestionClock::now();
+    detail::IngestionRun run(inventory, recordIds, m_Statistics, m_Options.ChunksInFlight, m_Options.LanguageTags);
+
+    // Bytes after the last newline of a chunk, they start the next one.
+    std::string carry;
+    uint64_t sequence = 0;
+    bool atEnd = false;
+    while (!atEnd)
+    {
+        auto chunk = run.AcquireChunk();
+        auto& data = chunk->Data;
+        if (data.size() < carry.size() + m_Options.ChunkSize)
+        {
+            data.resize(carry.size() + m_Options.ChunkSize);
+        }
+        std::memcpy(&data[0], carry.data(), carry.size());
+        size_t filled = carry.size();
+        size_t searched = filled;
+
+        size_t lineEnd = std::string::npos;
+        for (;;)
+        {
+            auto readStarted = detail::IngestionClock::now();
+            input.read(&data[filled], static_cast<std::streamsize>(data.size() - filled));
+            auto count = static_cast<size_t>(input.gcount());
+            m_Statistics.Read.Busy += detail::IngestionClock::now() - readStarted;
+            m_Statistics.Read.Bytes += count;
+            filled += count;
+            atEnd = !input;
+
+            auto last = std::string_view(data.data() + searched, filled - searched).rfind('\n');
+            if (last != std::string_view::npos)
+            {
+                lineEnd = searched + last;
+            }
+            if (atEnd || lineEnd != std::string::npos)
+            {
+                break;
+            }
+            // A single line longer than the chunk, grow the chunk until it ends.
+            searched = filled;
+            data.resize(data.size() * 2);
+        }
+
+        chunk->Size = atEnd ? filled : lineEnd + 1;
+        carry.assign(data.data() + chunk->Size, filled - chunk->Size);
+        if (chunk->Size == 0)
+        {
+            run.ReleaseChunk(std::move(chunk));
+            continue;
+        }
+
+        chunk->Sequence = sequence++;
+        m_Pool.Submit([&run, chunk] {
+            run.Parse(*chunk);
+            run.Complete(chunk);
+        });
+    }
+
+    run.WaitForAll();
+    m_Statistics.Elapsed = detail::IngestionClock::now() - started;
+    return !input.bad();
+}
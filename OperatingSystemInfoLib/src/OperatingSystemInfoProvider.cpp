@@ -1,69 +1,354 @@
 #include "pch.h"
 #include "OperatingSystemInfoProvider.h"
 #include "IOperatingSystemInfoFetcher.h"
+#include "OperatingSystemInfoDiff.h"
 
-#include <array>
 #include <cassert>
+#include <thread>
+
+struct OperatingSystemInfoProvider::Snapshot
+{
+    OperatingSystemInfo Info;
+    OperatingSystemInfoFieldMask Fields;
+    std::chrono::steady_clock::time_point Expiry;
+    // Id of the fetch which made the snapshot.
+    uint64_t Refresh;
+};
+
+namespace detail
+{
+// Fill the requested fields with NotApplicableDefaultValue when it is not provided by fetcher or the value is empty.
+void FillDefaultValues(OperatingSystemInfo& info, OperatingSystemInfoFieldMask fields)
+{
+    constexpr char NotApplicableDefaultValue[] = "N/A";
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        auto& value = field.Get(info);
+        if (fields.Has(field.Field) && (!value || value->empty()))
+        {
+            value = NotApplicableDefaultValue;
+        }
+    });
+}
+
+void FillTimedOutValues(OperatingSystemInfo& info, OperatingSystemInfoFieldMask fields)
+{
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        if (fields.Has(field.Field))
+        {
+            field.Get(info) = OperatingSystemInfoProvider::TimedOutValue;
+        }
+    });
+}
+
+// Copies only the requested fields out of a cached snapshot.
+OperatingSystemInfo Project(const OperatingSystemInfo& info, OperatingSystemInfoFieldMask fields)
+{
+    OperatingSystemInfo result;
+    ApplyOperatingSystemInfoChanges(result, info, fields);
+    return result;
+}
+
+// Counts a reader of the published snapshot for as long as it is in scope.
+class SnapshotReader final
+{
+public:
+    SnapshotReader(const std::atomic<uint64_t>& epoch, std::atomic<uint32_t> (&readers)[2]) noexcept
+        : m_Readers(readers[epoch.load() & 1])
+    {
+        m_Readers.fetch_add(1);
+    }
+    ~SnapshotReader()
+    {
+        m_Readers.fetch_sub(1, std::memory_order_release);
+    }
+    SnapshotReader(SnapshotReader&&) = delete;
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(SnapshotReader&&) = delete;
+
+private:
+    std::atomic<uint32_t>& m_Readers;
+};
+} // namespace detail
 
 OperatingSystemInfoProvider::OperatingSystemInfoProvider(std::unique_ptr<IOperatingSystemInfoFetcher> fetcher) noexcept
-    : m_Fetcher(std::move(fetcher))
+    : OperatingSystemInfoProvider(std::move(fetcher), std::chrono::steady_clock::duration::zero())
+{
+}
+
+OperatingSystemInfoProvider::OperatingSystemInfoProvider(std::unique_ptr<IOperatingSystemInfoFetcher> fetcher,
+                                                         std::chrono::steady_clock::duration timeToLive) noexcept
+    : m_Fetcher(std::move(fetcher)), m_TimeToLive(timeToLive)
 {
     assert(m_Fetcher != nullptr);
 }
 
-OperatingSystemInfoProvider::~OperatingSystemInfoProvider() = default;
+OperatingSystemInfoProvider::~OperatingSystemInfoProvider()
+{
+    // Late values call back into this object, the fetcher waits for them when it is destroyed.
+    m_Fetcher.reset();
+}
 
 OperatingSystemInfo OperatingSystemInfoProvider::GetInformation()
 {
-    // Fill all the field with NotApplicableDefaultValue when it is not provided by fetcher or the value is empty.
-    auto defaultValueFiller = [](OperatingSystemInfo& info) {
-        constexpr char NotApplicableDefaultValue[] = "N/A";
-        constexpr auto NumberOfFields = 21;
-        std::array<std::optional<std::string> OperatingSystemInfo::*, NumberOfFields> fields =
-        { &OperatingSystemInfo::BuildBranch,
-          &OperatingSystemInfo::Caption,
-          &OperatingSystemInfo::Codename,
-          &OperatingSystemInfo::CSDBuildNumber,
-          &OperatingSystemInfo::CSDVersion,
-          &OperatingSystemInfo::CurrentBuildNumber,
-          &OperatingSystemInfo::CurrentMajorVersionNumber,
-          &OperatingSystemInfo::CurrentMinorVersionNumber,
-          &OperatingSystemInfo::CurrentVersion,
-          &OperatingSystemInfo::EditionID,
-          &OperatingSystemInfo::Locale,
-          &OperatingSystemInfo::MarketName,
-          &OperatingSystemInfo::MUILanguage,
-          &OperatingSystemInfo::OSArchitecture,
-          &OperatingSystemInfo::OSLanguage,
-          &OperatingSystemInfo::OSVersion,
-          &OperatingSystemInfo::ReleaseId,
-          &OperatingSystemInfo::ServicePackMajorVersion,
-          &OperatingSystemInfo::ServicePackMinorVersion,
-          &OperatingSystemInfo::UBR,
-          &OperatingSystemInfo::Version };
-
-        for (auto f : fields)
+    return GetInformation(OperatingSystemInfoFieldMask::All());
+}
+
+OperatingSystemInfo OperatingSystemInfoProvider::GetInformation(OperatingSystemInfoFieldMask fields)
+{
+    return GetInformation(fields, std::chrono::steady_clock::time_point::max());
+}
+
+OperatingSystemInfo OperatingSystemInfoProvider::GetInformation(OperatingSystemInfoFieldMask fields,
+                                                                std::chrono::steady_clock::time_point deadline,
+                                                                OperatingSystemInfoFieldMask* timedOut)
+{
+    OperatingSystemInfoFieldMask missed;
+    OperatingSystemInfo info;
+    if (m_TimeToLive > std::chrono::steady_clock::duration::zero())
+    {
+        info = GetCachedInformation(fields, deadline, missed);
+    }
+    else
+    {
+        try
+        {
+            m_Refreshes.fetch_add(1, std::memory_order_relaxed);
+            info = m_Fetcher->GetInformation(fields, deadline, missed, nullptr);
+            detail::FillDefaultValues(info, fields & ~missed);
+        }
+        catch (...)
+        {
+            // TODO: Should put error information when logger is published.
+            info = {};
+            missed = {};
+        }
+    }
+
+    missed &= fields;
+    if (!missed.Empty())
+    {
+        m_TimedOut.fetch_add(1, std::memory_order_relaxed);
+        detail::FillTimedOutValues(info, missed);
+    }
+    if (timedOut)
+    {
+        *timedOut = missed;
+    }
+    return info;
+}
+
+void OperatingSystemInfoProvider::Invalidate()
+{
+    std::lock_guard<std::mutex> lock(m_RefreshMutex);
+    ++m_Generation;
+    Publish(nullptr);
+}
+
+OperatingSystemInfoCacheStatistics OperatingSystemInfoProvider::GetCacheStatistics() const noexcept
+{
+    OperatingSystemInfoCacheStatistics statistics;
+    statistics.Hits = m_Hits.load(std::memory_order_relaxed);
+    statistics.Misses = m_Misses.load(std::memory_order_relaxed);
+    statistics.Refreshes = m_Refreshes.load(std::memory_order_relaxed);
+    statistics.TimedOut = m_TimedOut.load(std::memory_order_relaxed);
+    statistics.LateUpdates = m_LateUpdates.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+// timedOut receives the requested fields which the result is missing because of the deadline.
+OperatingSystemInfo OperatingSystemInfoProvider::GetCachedInformation(OperatingSystemInfoFieldMask fields,
+                                                                      std::chrono::steady_clock::time_point deadline,
+                                                                      OperatingSystemInfoFieldMask& timedOut)
+{
+    auto isFresh = [fields](const Snapshot* snapshot) {
+        return snapshot && snapshot->Fields.Contains(fields) && std::chrono::steady_clock::now() < snapshot->Expiry;
+    };
+    // What a fetch which did not get every field in time gives to a caller out of time.
+    auto partial = [fields, &timedOut](const SnapshotPtr& fetched) {
+        timedOut = fields & ~fetched->Fields;
+        return detail::Project(fetched->Info, fields & fetched->Fields);
+    };
+
+    {
+        detail::SnapshotReader reader(m_ReaderEpoch, m_Readers);
+        auto snapshot = m_Snapshot.load();
+        if (isFresh(snapshot))
+        {
+            m_Hits.fetch_add(1, std::memory_order_relaxed);
+            return detail::Project(snapshot->Info, fields);
+        }
+    }
+    m_Misses.fetch_add(1, std::memory_order_relaxed);
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(m_RefreshMutex);
+        auto snapshot = m_Published;
+        if (isFresh(snapshot.get()))
+        {
+            return detail::Project(snapshot->Info, fields);
+        }
+
+        // Someone is already fetching. Share its result when it covers our fields, otherwise wait for it and retry.
+        if (m_Refresh.valid())
+        {
+            auto refresh = m_Refresh;
+            bool covered = m_RefreshFields.Contains(fields);
+            lock.unlock();
+            if (deadline == std::chrono::steady_clock::time_point::max())
+            {
+                refresh.wait();
+            }
+            else if (refresh.wait_until(deadline) == std::future_status::timeout)
+            {
+                // The fetch goes on and caches its result for the next call.
+                timedOut = fields;
+                return {};
+            }
+            auto fetched = refresh.get();
+            if (covered && !fetched)
+            {
+                return {};
+            }
+            if (fetched && fetched->Fields.Contains(fields))
+            {
+                return detail::Project(fetched->Info, fields);
+            }
+            // The fetch timed out on some of our fields, fetch again while there is time left.
+            if (fetched && std::chrono::steady_clock::now() >= deadline)
+            {
+                return partial(fetched);
+            }
+            continue;
+        }
+
+        // Keep the fields other callers asked for so they stay cached across the refresh.
+        auto fetchFields = fields;
+        if (snapshot)
         {
-            if (!(info.*f) || (*(info.*f)).empty())
+            fetchFields |= snapshot->Fields;
+        }
+        std::promise<SnapshotPtr> promise;
+        m_Refresh = promise.get_future().share();
+        m_RefreshFields = fetchFields;
+        auto generation = m_Generation;
+        auto refresh = ++m_LastRefresh;
+        lock.unlock();
+
+        auto fetched = FetchSnapshot(fetchFields, deadline, generation, refresh);
+
+        lock.lock();
+        if (fetched && generation == m_Generation)
+        {
+            // Values of fields the fetch timed out on which arrived before it returned.
+            if (m_LateRefresh == refresh)
             {
-                info.*f = NotApplicableDefaultValue;
+                auto updated = std::make_shared<Snapshot>(*fetched);
+                ApplyOperatingSystemInfoChanges(updated->Info, m_LateInfo, m_LateFields);
+                updated->Fields |= m_LateFields;
+                fetched = std::move(updated);
             }
+            Publish(fetched);
         }
-    };
+        if (m_LateRefresh == refresh)
+        {
+            m_LateInfo = {};
+            m_LateFields = {};
+            m_LateRefresh = 0;
+        }
+        m_Refresh = {};
+        lock.unlock();
+        promise.set_value(fetched);
 
+        return fetched ? partial(fetched) : OperatingSystemInfo{};
+    }
+}
+
+// Returns nullptr when the fetcher failed, failures are not cached. The snapshot only has the fields fetched in time.
+OperatingSystemInfoProvider::SnapshotPtr OperatingSystemInfoProvider::FetchSnapshot(OperatingSystemInfoFieldMask fields,
+                                                                                    std::chrono::steady_clock::time_point deadline,
+                                                                                    uint64_t generation, uint64_t refresh) noexcept
+{
     try
     {
-        auto info = m_Fetcher->GetInformation();
-        defaultValueFiller(info);
-        return info;
+        m_Refreshes.fetch_add(1, std::memory_order_relaxed);
+        OperatingSystemInfoFieldMask missed;
+        auto info = m_Fetcher->GetInformation(
+            fields, deadline, missed,
+            [this, generation, refresh](const OperatingSystemInfo& late, OperatingSystemInfoFieldMask lateFields) {
+                AddLateFields(generation, refresh, late, lateFields);
+            });
+        fields &= ~missed;
+        detail::FillDefaultValues(info, fields);
+        return std::make_shared<const Snapshot>(
+            Snapshot{std::move(info), fields, std::chrono::steady_clock::now() + m_TimeToLive, refresh});
     }
-    catch (const std::exception&)
+    catch (...)
     {
         // TODO: Should put error information when logger is published.
-        return {};
+        return nullptr;
     }
-    catch (...)
+}
+
+// Adds values which arrived after the deadline of a fetch to the snapshot it made. A snapshot made
+// by a later fetch or dropped by Invalidate keeps its values.
+void OperatingSystemInfoProvider::AddLateFields(uint64_t generation, uint64_t refresh, const OperatingSystemInfo& info,
+                                                OperatingSystemInfoFieldMask fields)
+{
+    std::lock_guard<std::mutex> lock(m_RefreshMutex);
+    if (generation != m_Generation)
     {
-        return {};
+        return;
     }
-}
\ No newline at end of file
+    if (m_Published && m_Published->Refresh == refresh)
+    {
+        auto updated = std::make_shared<Snapshot>(*m_Published);
+        ApplyOperatingSystemInfoChanges(updated->Info, info, fields);
+        updated->Fields |= fields;
+        Publish(std::move(updated));
+    }
+    else if (refresh == m_LastRefresh && m_Refresh.valid())
+    {
+        // The fetch has not published its snapshot yet, it adds them when it does.
+        if (m_LateRefresh != refresh)
+        {
+            m_LateInfo = {};
+            m_LateFields = {};
+            m_LateRefresh = refresh;
+        }
+        ApplyOperatingSystemInfoChanges(m_LateInfo, info, fields);
+        m_LateFields |= fields;
+    }
+    else
+    {
+        return;
+    }
+    m_LateUpdates.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Called with m_RefreshMutex held. The replaced snapshot is released after the readers which may still use it.
+void OperatingSystemInfoProvider::Publish(SnapshotPtr snapshot)
+{
+    m_Snapshot.store(snapshot.get());
+    std::swap(m_Published, snapshot);
+    if (snapshot)
+    {
+        WaitForReaders();
+    }
+}
+
+// Waits until every reader which may have loaded the previous m_Snapshot is done. New readers count themselves in
+// the other slot after a flip, so the old one drains. Flipping twice also covers a reader which read the epoch
+// before a flip and counted itself after it, in the slot the next flip waits for.
+void OperatingSystemInfoProvider::WaitForReaders()
+{
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        auto& readers = m_Readers[m_ReaderEpoch.fetch_add(1) & 1];
+        while (readers.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "OperatingSystemInfoRecord.h"
+
+#include <cstring>
+
+namespace detail
+{
+// Byte-wise so that neither alignment nor host endianness matter, compilers turn these into plain loads and stores.
+inline uint32_t LoadLe16(const std::byte* data)
+{
+    return std::to_integer<uint32_t>(data[0]) | std::to_integer<uint32_t>(data[1]) << 8;
+}
+
+inline uint32_t LoadLe32(const std::byte* data)
+{
+    return LoadLe16(data) | LoadLe16(data + 2) << 16;
+}
+
+inline void StoreLe16(std::byte* data, uint32_t value)
+{
+    data[0] = static_cast<std::byte>(value);
+    data[1] = static_cast<std::byte>(value >> 8);
+}
+
+inline void StoreLe32(std::byte* data, uint32_t value)
+{
+    StoreLe16(data, value);
+    StoreLe16(data + 2, value >> 16);
+}
+
+constexpr size_t EndTableOffset = OperatingSystemInfoRecordFormat::HeaderSize;
+} // namespace detail
+
+bool OperatingSystemInfoRecordView::Parse(const std::byte* data, size_t size) noexcept
+{
+    m_Data = nullptr;
+    m_Size = 0;
+    m_FieldCount = 0;
+    m_Present = {};
+    if (size < OperatingSystemInfoRecordFormat::HeaderSize || detail::LoadLe32(data) != OperatingSystemInfoRecordFormat::Magic ||
+        detail::LoadLe16(data + 4) != OperatingSystemInfoRecordFormat::Version)
+    {
+        return false;
+    }
+
+    const size_t fieldCount = detail::LoadLe16(data + 6);
+    const size_t recordSize = detail::LoadLe32(data + 8);
+    const size_t stringsOffset = detail::EndTableOffset + fieldCount * sizeof(uint32_t);
+    if (recordSize % OperatingSystemInfoRecordFormat::Alignment != 0 || recordSize < stringsOffset || recordSize > size)
+    {
+        return false;
+    }
+
+    // Validate the end table once, so the accessors need no checks.
+    uint32_t previous = 0;
+    for (size_t i = 0; i < fieldCount; ++i)
+    {
+        auto end = detail::LoadLe32(data + detail::EndTableOffset + i * sizeof(uint32_t));
+        if (end < previous || end > recordSize - stringsOffset)
+        {
+            return false;
+        }
+        previous = end;
+    }
+
+    auto present = detail::LoadLe32(data + 12);
+    if (fieldCount < 32)
+    {
+        present &= (uint32_t{1} << fieldCount) - 1;
+    }
+    m_Data = data;
+    m_Size = recordSize;
+    m_FieldCount = fieldCount;
+    m_Present = OperatingSystemInfoFieldMask::FromBits(present);
+    return true;
+}
+
+uint32_t OperatingSystemInfoRecordView::End(size_t index) const noexcept
+{
+    return detail::LoadLe32(m_Data + detail::EndTableOffset + index * sizeof(uint32_t));
+}
+
+std::string_view OperatingSystemInfoRecordView::Get(OperatingSystemInfoField field) const noexcept
+{
+    if (!m_Present.Has(field))
+    {
+        return {};
+    }
+    auto index = static_cast<size_t>(field);
+    auto begin = index == 0 ? 0 : End(index - 1);
+    auto strings = m_Data + detail::EndTableOffset + m_FieldCount * sizeof(uint32_t);
+    return std::string_view(reinterpret_cast<const char*>(strings + begin), End(index) - begin);
+}
+
+OperatingSystemInfo OperatingSystemInfoRecordView::ToOperatingSystemInfo() const
+{
+    OperatingSystemInfo result;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        if (m_Present.Has(field.Field))
+        {
+            field.Get(result).emplace(Get(field.Field));
+        }
+    });
+    return result;
+}
+
+OperatingSystemInfoView OperatingSystemInfoRecordView::ToView() const noexcept
+{
+    OperatingSystemInfoView result{};
+    result.Present = m_Present;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        result.Values[static_cast<size_t>(field.Field)] = Get(field.Field);
+    });
+    return result;
+}
+
+size_t OperatingSystemInfoRecordWriter::Append(const OperatingSystemInfo& info)
+{
+    return Append(OperatingSystemInfoView::Of(info));
+}
+
+size_t OperatingSystemInfoRecordWriter::Append(const OperatingSystemInfoView& info)
+{
+    constexpr size_t StringsOffset = detail::EndTableOffset + OperatingSystemInfoFieldCount * sizeof(uint32_t);
+    size_t stringsSize = 0;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        if (info.Present.Has(field.Field))
+        {
+            stringsSize += info.Values[static_cast<size_t>(field.Field)].size();
+        }
+    });
+    constexpr size_t Mask = OperatingSystemInfoRecordFormat::Alignment - 1;
+    const size_t size = (StringsOffset + stringsSize + Mask) & ~Mask;
+
+    // New bytes are zeroed by resize, which takes care of the padding.
+    const auto offset = m_Buffer.size();
+    m_Buffer.resize(offset + size);
+    auto record = m_Buffer.data() + offset;
+    detail::StoreLe32(record, OperatingSystemInfoRecordFormat::Magic);
+    detail::StoreLe16(record + 4, OperatingSystemInfoRecordFormat::Version);
+    detail::StoreLe16(record + 6, static_cast<uint32_t>(OperatingSystemInfoFieldCount));
+    detail::StoreLe32(record + 8, static_cast<uint32_t>(size));
+    detail::StoreLe32(record + 12, info.Present.Bits());
+
+    auto strings = record + StringsOffset;
+    uint32_t end = 0;
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        const auto i = static_cast<size_t>(field.Field);
+        if (info.Present.Has(field.Field))
+        {
+            std::memcpy(strings + end, info.Values[i].data(), info.Values[i].size());
+            end += static_cast<uint32_t>(info.Values[i].size());
+        }
+        detail::StoreLe32(record + detail::EndTableOffset + i * sizeof(uint32_t), end);
+    });
+    return size;
+}
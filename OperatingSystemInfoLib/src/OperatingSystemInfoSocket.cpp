@@ -0,0 +1,663 @@
+#include "pch.h"
+#include "OperatingSystemInfoSocket.h"
+#include "OperatingSystemInfoProvider.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace detail
+{
+using SocketFormat = OperatingSystemInfoSocketFormat;
+
+// epoll keys of the two descriptors which are not connections.
+constexpr uint64_t ListenerKey = UINT64_MAX;
+constexpr uint64_t WakeupKey = UINT64_MAX - 1;
+constexpr int MaxEvents = 256;
+constexpr size_t ServerReadSize = 64 * 1024;
+constexpr size_t ClientReadSize = 16 * 1024;
+// A client which stops reading its responses is not read from either once this much is waiting for it.
+constexpr size_t MaxPendingOutput = 1 << 20;
+
+inline uint32_t LoadHost32(const std::byte* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline void StoreHost32(std::byte* data, uint32_t value)
+{
+    std::memcpy(data, &value, sizeof(value));
+}
+
+bool MakeSocketAddress(const std::string& path, sockaddr_un& address)
+{
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Response with a zero Id, the server patches it for each request.
+std::vector<std::byte> MakeResponse(SocketFormat::Status status, const OperatingSystemInfo* info)
+{
+    OperatingSystemInfoRecordWriter writer;
+    const auto size = info != nullptr ? writer.Append(*info) : 0;
+    std::vector<std::byte> response(SocketFormat::ResponseHeaderSize + size);
+    StoreHost32(response.data() + 4, status);
+    StoreHost32(response.data() + 8, static_cast<uint32_t>(size));
+    if (size > 0)
+    {
+        std::memcpy(response.data() + SocketFormat::ResponseHeaderSize, writer.Data(), size);
+    }
+    return response;
+}
+
+bool IsRetryable(int error)
+{
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+} // namespace detail
+
+struct OperatingSystemInfoServer::Connection
+{
+    uint64_t Id = 0;
+    int Socket = -1;
+    // epoll events currently registered.
+    uint32_t Events = 0;
+    std::vector<std::byte> Input;
+    std::vector<std::byte> Output;
+    // Bytes of Output already sent.
+    size_t Written = 0;
+    // In m_Dirty, waiting for the end of the iteration to be flushed.
+    bool Dirty = false;
+    // Got a bad request, closed once its responses are sent.
+    bool Closing = false;
+};
+
+struct OperatingSystemInfoServer::Fetch
+{
+    // Connection and request id of every request waiting for the provider call.
+    std::vector<std::pair<uint64_t, uint32_t>> Waiters;
+};
+
+OperatingSystemInfoServer::OperatingSystemInfoServer(OperatingSystemInfoProvider& provider, OperatingSystemInfoServerOptions options)
+    : m_Provider(provider), m_Options(options)
+{
+}
+
+OperatingSystemInfoServer::~OperatingSystemInfoServer()
+{
+    Stop();
+}
+
+bool OperatingSystemInfoServer::Start(const std::string& path)
+{
+    sockaddr_un address;
+    if (IsRunning() || !detail::MakeSocketAddress(path, address))
+    {
+        return false;
+    }
+
+    // A socket file nobody accepts on is left over from a server which did not stop, it can be replaced.
+    const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe == -1)
+    {
+        return false;
+    }
+    const bool live = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    close(probe);
+    if (live)
+    {
+        return false;
+    }
+    unlink(path.c_str());
+
+    m_Path = path;
+    m_Listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    m_Epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_Wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_Reserve = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    epoll_event listener{};
+    listener.events = EPOLLIN;
+    listener.data.u64 = detail::ListenerKey;
+    epoll_event wakeup{};
+    wakeup.events = EPOLLIN;
+    wakeup.data.u64 = detail::WakeupKey;
+    if (m_Listener == -1 || m_Epoll == -1 || m_Wakeup == -1 || m_Reserve == -1 ||
+        bind(m_Listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(m_Listener, SOMAXCONN) != 0 || epoll_ctl(m_Epoll, EPOLL_CTL_ADD, m_Listener, &listener) != 0 ||
+        epoll_ctl(m_Epoll, EPOLL_CTL_ADD, m_Wakeup, &wakeup) != 0)
+    {
+        CloseAll();
+        return false;
+    }
+
+    m_Pool = std::make_unique<ThreadPool>((std::max)(m_Options.FetchThreads, size_t{1}));
+    m_Stopping.store(false);
+    m_Thread = std::thread([this] { Run(); });
+    return true;
+}
+
+void OperatingSystemInfoServer::Stop()
+{
+    if (!IsRunning())
+    {
+        return;
+    }
+    m_Stopping.store(true);
+    const uint64_t one = 1;
+    (void)write(m_Wakeup, &one, sizeof(one));
+    m_Thread.join();
+    // Waits for the provider calls in flight, they signal m_Wakeup.
+    m_Pool.reset();
+    CloseAll();
+}
+
+OperatingSystemInfoServerStatistics OperatingSystemInfoServer::GetStatistics() const noexcept
+{
+    OperatingSystemInfoServerStatistics statistics;
+    statistics.Connections = m_ConnectionCount.load(std::memory_order_relaxed);
+    statistics.Requests = m_Requests.load(std::memory_order_relaxed);
+    statistics.CacheHits = m_CacheHits.load(std::memory_order_relaxed);
+    statistics.Coalesced = m_Coalesced.load(std::memory_order_relaxed);
+    statistics.Fetches = m_FetchCount.load(std::memory_order_relaxed);
+    statistics.Batches = m_Batches.load(std::memory_order_relaxed);
+    statistics.BadRequests = m_BadRequests.load(std::memory_order_relaxed);
+    statistics.Refused = m_Refused.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void OperatingSystemInfoServer::Run()
+{
+    epoll_event events[detail::MaxEvents];
+    while (!m_Stopping.load())
+    {
+        const int count = epoll_wait(m_Epoll, events, detail::MaxEvents, -1);
+        if (count == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            const auto key = events[i].data.u64;
+            if (key == detail::ListenerKey)
+            {
+                Accept();
+                continue;
+            }
+            if (key == detail::WakeupKey)
+            {
+                uint64_t signaled;
+                (void)read(m_Wakeup, &signaled, sizeof(signaled));
+                Complete();
+                continue;
+            }
+            auto connection = m_Connections.find(key);
+            if (connection != m_Connections.end() && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+            {
+                Receive(*connection->second);
+                connection = m_Connections.find(key);
+            }
+            if (connection != m_Connections.end() && (events[i].events & EPOLLOUT) != 0)
+            {
+                Flush(*connection->second);
+            }
+        }
+
+        if (!m_Pending.empty())
+        {
+            m_Batches.fetch_add(1, std::memory_order_relaxed);
+            Dispatch();
+        }
+        for (auto id : m_Dirty)
+        {
+            auto connection = m_Connections.find(id);
+            if (connection != m_Connections.end())
+            {
+                connection->second->Dirty = false;
+                Flush(*connection->second);
+            }
+        }
+        m_Dirty.clear();
+    }
+}
+
+void OperatingSystemInfoServer::Accept()
+{
+    for (;;)
+    {
+        const int socket = accept4(m_Listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket == -1)
+        {
+            if (errno == ECONNABORTED || errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+                Refuse();
+            }
+            return;
+        }
+        auto connection = std::make_unique<Connection>();
+        connection->Id = m_NextConnection++;
+        connection->Socket = socket;
+        connection->Events = EPOLLIN;
+        epoll_event event{};
+        event.events = connection->Events;
+        event.data.u64 = connection->Id;
+        if (epoll_ctl(m_Epoll, EPOLL_CTL_ADD, socket, &event) != 0)
+        {
+            close(socket);
+            continue;
+        }
+        m_ConnectionCount.fetch_add(1, std::memory_order_relaxed);
+        m_Connections.emplace(connection->Id, std::move(connection));
+    }
+}
+
+// Out of descriptors, the connections waiting in the backlog keep the listener readable and the loop would spin
+// on it. The reserve descriptor makes room to accept and close them, so that their clients fail at once.
+void OperatingSystemInfoServer::Refuse()
+{
+    if (m_Reserve != -1)
+    {
+        close(m_Reserve);
+        for (;;)
+        {
+            const int socket = accept4(m_Listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (socket == -1)
+            {
+                break;
+            }
+            close(socket);
+            m_Refused.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_Reserve = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    // Another thread took the descriptor, wait for a connection to close one instead.
+    if (m_Reserve == -1 && !m_ListenerPaused)
+    {
+        epoll_event listener{};
+        listener.data.u64 = detail::ListenerKey;
+        epoll_ctl(m_Epoll, EPOLL_CTL_MOD, m_Listener, &listener);
+        m_ListenerPaused = true;
+    }
+}
+
+void OperatingSystemInfoServer::Receive(Connection& connection)
+{
+    // A closing connection is not polled for input any more, this is a hang up or an error.
+    if (connection.Closing)
+    {
+        Close(connection.Id);
+        return;
+    }
+    auto& input = connection.Input;
+    const auto used = input.size();
+    input.resize(used + detail::ServerReadSize);
+    const auto received = recv(connection.Socket, input.data() + used, detail::ServerReadSize, 0);
+    input.resize(used + static_cast<size_t>((std::max)(received, ssize_t{0})));
+    if (received == 0 || (received == -1 && !detail::IsRetryable(errno)))
+    {
+        Close(connection.Id);
+        return;
+    }
+
+    size_t offset = 0;
+    for (; input.size() - offset >= detail::SocketFormat::RequestSize; offset += detail::SocketFormat::RequestSize)
+    {
+        const auto request = input.data() + offset;
+        if (detail::LoadHost32(request) != detail::SocketFormat::RequestMagic)
+        {
+            // The stream cannot be trusted past this point, answer and hang up.
+            m_BadRequests.fetch_add(1, std::memory_order_relaxed);
+            static const auto badRequest = detail::MakeResponse(detail::SocketFormat::BadRequest, nullptr);
+            Respond(connection.Id, detail::LoadHost32(request + 4), badRequest);
+            connection.Closing = true;
+            input.clear();
+            return;
+        }
+        m_Requests.fetch_add(1, std::memory_order_relaxed);
+        m_Pending.push_back({connection.Id, detail::LoadHost32(request + 4),
+                             OperatingSystemInfoFieldMask::FromBits(detail::LoadHost32(request + 8)).Bits()});
+    }
+    input.erase(input.begin(), input.begin() + static_cast<ptrdiff_t>(offset));
+}
+
+void OperatingSystemInfoServer::Dispatch()
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& pending : m_Pending)
+    {
+        if (m_Options.TimeToLive > std::chrono::steady_clock::duration::zero())
+        {
+            auto cached = m_Cache.find(pending.Fields);
+            if (cached != m_Cache.end() && now < cached->second.Expires)
+            {
+                m_CacheHits.fetch_add(1, std::memory_order_relaxed);
+                Respond(pending.Connection, pending.Id, cached->second.Bytes);
+                continue;
+            }
+        }
+
+        auto& fetch = m_Fetches[pending.Fields];
+        if (fetch)
+        {
+            m_Coalesced.fetch_add(1, std::memory_order_relaxed);
+            fetch->Waiters.emplace_back(pending.Connection, pending.Id);
+            continue;
+        }
+        fetch = std::make_unique<Fetch>();
+        fetch->Waiters.emplace_back(pending.Connection, pending.Id);
+        m_FetchCount.fetch_add(1, std::memory_order_relaxed);
+        m_Pool->Submit([this, fields = pending.Fields] {
+            std::vector<std::byte> response;
+            try
+            {
+                const auto info = m_Provider.GetInformation(OperatingSystemInfoFieldMask::FromBits(fields));
+                response = detail::MakeResponse(detail::SocketFormat::Ok, &info);
+            }
+            catch (...)
+            {
+                response = detail::MakeResponse(detail::SocketFormat::Failed, nullptr);
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_CompletedMutex);
+                m_Completed.emplace_back(fields, std::move(response));
+            }
+            const uint64_t one = 1;
+            (void)write(m_Wakeup, &one, sizeof(one));
+        });
+    }
+    m_Pending.clear();
+}
+
+void OperatingSystemInfoServer::Complete()
+{
+    std::vector<std::pair<uint32_t, std::vector<std::byte>>> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_CompletedMutex);
+        completed.swap(m_Completed);
+    }
+    const auto now = std::chrono::steady_clock::now();
+    for (auto& [fields, response] : completed)
+    {
+        auto fetch = m_Fetches.find(fields);
+        if (fetch == m_Fetches.end())
+        {
+            continue;
+        }
+        for (const auto& [connection, id] : fetch->second->Waiters)
+        {
+            Respond(connection, id, response);
+        }
+        m_Fetches.erase(fetch);
+        if (m_Options.TimeToLive > std::chrono::steady_clock::duration::zero() &&
+            detail::LoadHost32(response.data() + 4) == detail::SocketFormat::Ok)
+        {
+            m_Cache[fields] = {std::move(response), now + m_Options.TimeToLive};
+        }
+    }
+}
+
+void OperatingSystemInfoServer::Respond(uint64_t connectionId, uint32_t id, const std::vector<std::byte>& response)
+{
+    auto found = m_Connections.find(connectionId);
+    if (found == m_Connections.end() || found->second->Closing)
+    {
+        return;
+    }
+    auto& connection = *found->second;
+    const auto offset = connection.Output.size();
+    connection.Output.insert(connection.Output.end(), response.begin(), response.end());
+    detail::StoreHost32(connection.Output.data() + offset, id);
+    if (!connection.Dirty)
+    {
+        connection.Dirty = true;
+        m_Dirty.push_back(connectionId);
+    }
+}
+
+void OperatingSystemInfoServer::Flush(Connection& connection)
+{
+    auto& output = connection.Output;
+    while (connection.Written < output.size())
+    {
+        const auto sent = send(connection.Socket, output.data() + connection.Written, output.size() - connection.Written, MSG_NOSIGNAL);
+        if (sent == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            Close(connection.Id);
+            return;
+        }
+        connection.Written += static_cast<size_t>(sent);
+    }
+    if (connection.Written == output.size())
+    {
+        output.clear();
+        connection.Written = 0;
+        if (connection.Closing)
+        {
+            Close(connection.Id);
+            return;
+        }
+    }
+
+    const bool reading = !connection.Closing && output.size() - connection.Written < detail::MaxPendingOutput;
+    const uint32_t events = (reading ? EPOLLIN : 0u) | (output.empty() ? 0u : EPOLLOUT);
+    if (events != connection.Events)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = connection.Id;
+        epoll_ctl(m_Epoll, EPOLL_CTL_MOD, connection.Socket, &event);
+        connection.Events = events;
+    }
+}
+
+void OperatingSystemInfoServer::Close(uint64_t connectionId)
+{
+    auto found = m_Connections.find(connectionId);
+    if (found != m_Connections.end())
+    {
+        // Closing the descriptor removes it from the epoll set.
+        close(found->second->Socket);
+        m_Connections.erase(found);
+    }
+    if (m_ListenerPaused)
+    {
+        m_Reserve = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        epoll_event listener{};
+        listener.events = EPOLLIN;
+        listener.data.u64 = detail::ListenerKey;
+        epoll_ctl(m_Epoll, EPOLL_CTL_MOD, m_Listener, &listener);
+        m_ListenerPaused = false;
+    }
+}
+
+void OperatingSystemInfoServer::CloseAll()
+{
+    for (auto& connection : m_Connections)
+    {
+        close(connection.second->Socket);
+    }
+    m_Connections.clear();
+    m_ListenerPaused = false;
+    for (auto descriptor : {&m_Listener, &m_Epoll, &m_Wakeup, &m_Reserve})
+    {
+        if (*descriptor != -1)
+        {
+            close(*descriptor);
+            *descriptor = -1;
+        }
+    }
+    if (!m_Path.empty())
+    {
+        unlink(m_Path.c_str());
+        m_Path.clear();
+    }
+    m_Pending.clear();
+    m_Dirty.clear();
+    m_Cache.clear();
+    m_Fetches.clear();
+    m_Completed.clear();
+}
+
+bool OperatingSystemInfoClient::Connect(const std::string& path)
+{
+    Close();
+    sockaddr_un address;
+    if (!detail::MakeSocketAddress(path, address))
+    {
+        return false;
+    }
+    m_Socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_Socket == -1 || connect(m_Socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void OperatingSystemInfoClient::Close() noexcept
+{
+    if (m_Socket != -1)
+    {
+        close(m_Socket);
+        m_Socket = -1;
+    }
+    m_Input.clear();
+    m_Consumed = 0;
+}
+
+bool OperatingSystemInfoClient::Query(OperatingSystemInfoFieldMask fields, OperatingSystemInfo& info)
+{
+    OperatingSystemInfoRecordView record;
+    uint32_t id = 0;
+    if (!Send(0, fields) || !Receive(id, record))
+    {
+        return false;
+    }
+    info = record.ToOperatingSystemInfo();
+    return true;
+}
+
+bool OperatingSystemInfoClient::Send(uint32_t id, OperatingSystemInfoFieldMask fields)
+{
+    std::byte request[detail::SocketFormat::RequestSize];
+    detail::StoreHost32(request, detail::SocketFormat::RequestMagic);
+    detail::StoreHost32(request + 4, id);
+    detail::StoreHost32(request + 8, fields.Bits());
+    size_t written = 0;
+    while (IsConnected() && written < sizeof(request))
+    {
+        const auto sent = send(m_Socket, request + written, sizeof(request) - written, MSG_NOSIGNAL);
+        if (sent == -1 && errno != EINTR)
+        {
+            Close();
+            return false;
+        }
+        written += static_cast<size_t>((std::max)(sent, ssize_t{0}));
+    }
+    return IsConnected();
+}
+
+bool OperatingSystemInfoClient::Receive(uint32_t& id, OperatingSystemInfoRecordView& record)
+{
+    while (IsConnected())
+    {
+        if (Parse(id, record))
+        {
+            return true;
+        }
+        if (!IsConnected() || !Fill(true))
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool OperatingSystemInfoClient::TryReceive(uint32_t& id, OperatingSystemInfoRecordView& record)
+{
+    if (Parse(id, record))
+    {
+        return true;
+    }
+    return IsConnected() && Fill(false) && Parse(id, record);
+}
+
+bool OperatingSystemInfoClient::Parse(uint32_t& id, OperatingSystemInfoRecordView& record)
+{
+    const auto available = m_Input.size() - m_Consumed;
+    if (available < detail::SocketFormat::ResponseHeaderSize)
+    {
+        return false;
+    }
+    const auto response = m_Input.data() + m_Consumed;
+    const auto status = detail::LoadHost32(response + 4);
+    const auto size = detail::LoadHost32(response + 8);
+    if (status != detail::SocketFormat::Ok || size > detail::SocketFormat::MaxRecordSize)
+    {
+        Close();
+        return false;
+    }
+    if (available - detail::SocketFormat::ResponseHeaderSize < size)
+    {
+        return false;
+    }
+    const auto data = response + detail::SocketFormat::ResponseHeaderSize;
+    if (!record.Parse(data, size) || record.Size() != size)
+    {
+        Close();
+        return false;
+    }
+    id = detail::LoadHost32(response);
+    m_Consumed += detail::SocketFormat::ResponseHeaderSize + size;
+    return true;
+}
+
+bool OperatingSystemInfoClient::Fill(bool wait)
+{
+    // The record of the last response may still be viewed, so consumed bytes are only dropped here.
+    m_Input.erase(m_Input.begin(), m_Input.begin() + static_cast<ptrdiff_t>(m_Consumed));
+    m_Consumed = 0;
+    const auto used = m_Input.size();
+    m_Input.resize(used + detail::ClientReadSize);
+    const auto received = recv(m_Socket, m_Input.data() + used, detail::ClientReadSize, wait ? 0 : MSG_DONTWAIT);
+    m_Input.resize(used + static_cast<size_t>((std::max)(received, ssize_t{0})));
+    if (received == 0 || (received == -1 && !detail::IsRetryable(errno)))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
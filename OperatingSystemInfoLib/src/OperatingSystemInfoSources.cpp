@@ -0,0 +1,152 @@
+#include "pch.h"
+#include "OperatingSystemInfoSources.h"
+#include "RegistryBatch.h"
+#include "Utf16.h"
+#include "WmiCimv2.h"
+
+#include <charconv>
+
+namespace detail
+{
+OperatingSystemInfoFieldMask GetNeededFields(OperatingSystemInfoFieldMask fields)
+{
+    using Field = OperatingSystemInfoField;
+
+    // Fields we make ourselves need their inputs even when those are not requested.
+    auto needed = fields;
+    if (fields.Has(Field::OSVersion))
+    {
+        needed |= {Field::Caption, Field::OSArchitecture, Field::MUILanguage};
+    }
+    if (fields.Has(Field::Codename) || fields.Has(Field::MarketName))
+    {
+        needed |= {Field::CurrentMajorVersionNumber, Field::CurrentBuildNumber, Field::BuildBranch};
+    }
+    return needed;
+}
+
+bool ReadOperatingSystemObject(IWmiProvider& provider, OperatingSystemInfoFieldMask needed,
+                               OperatingSystemInfoFieldMask fields, OperatingSystemInfo& result,
+                               std::chrono::steady_clock::time_point deadline)
+{
+    using Field = OperatingSystemInfoField;
+
+    // A failed query still fills the fields, with empty values.
+    WmiCimv2 wmi(provider);
+    OSInfo osInfo;
+    if (!wmi.GetOSInfo(needed, deadline, osInfo) && std::chrono::steady_clock::now() >= deadline)
+    {
+        return false;
+    }
+
+    if (needed.Has(Field::Caption))
+    {
+        result.Caption = detail::ToUtf8String(osInfo.Caption);
+    }
+    if (needed.Has(Field::OSArchitecture))
+    {
+        result.OSArchitecture = detail::ToUtf8String(osInfo.OSArchitecture);
+    }
+    if (needed.Has(Field::MUILanguage))
+    {
+        result.MUILanguage = detail::ToUtf8String(osInfo.MUILanguage);
+    }
+    if (needed.Has(Field::OSLanguage))
+    {
+        result.OSLanguage = std::to_string(osInfo.OSLanguage);
+    }
+    if (needed.Has(Field::Locale))
+    {
+        result.Locale = detail::ToUtf8String(osInfo.Locale);
+    }
+    if (needed.Has(Field::Version))
+    {
+        result.Version = detail::ToUtf8String(osInfo.Version);
+    }
+    if (needed.Has(Field::ServicePackMajorVersion))
+    {
+        result.ServicePackMajorVersion = std::to_string(osInfo.ServicePackMajorVersion);
+    }
+    if (needed.Has(Field::ServicePackMinorVersion))
+    {
+        result.ServicePackMinorVersion = std::to_string(osInfo.ServicePackMinorVersion);
+    }
+    if (fields.Has(Field::OSVersion))
+    {
+        result.OSVersion = *result.Caption + "[" + *result.OSArchitecture + "OS][System Locale " + *result.MUILanguage + "]";
+    }
+    return true;
+}
+
+const WindowsRelease* FindRelease(const OperatingSystemInfo& info)
+{
+    if (info.CurrentBuildNumber)
+    {
+        const auto& text = *info.CurrentBuildNumber;
+        uint32_t build = 0;
+        auto parsed = std::from_chars(text.data(), text.data() + text.size(), build);
+        if (parsed.ec == std::errc() && parsed.ptr == text.data() + text.size())
+        {
+            if (auto release = FindWindowsRelease(build))
+            {
+                return release;
+            }
+        }
+    }
+    return info.BuildBranch ? FindWindowsReleaseByBranch(*info.BuildBranch) : nullptr;
+}
+
+void ReadCurrentVersionValues(const IRegistryBackend& reg, OperatingSystemInfo& result)
+{
+    ReadValues(reg,
+               // EditionID="Professional"
+               Bind<RegistryValueType::String>("EditionID", result.EditionID),
+               // BuildBranch = "rs2_release"
+               // (Windows 10 only, Codename information)
+               Bind<RegistryValueType::String>("BuildBranch", result.BuildBranch),
+               // ReleaseId="1703"
+               // (Windows 10 only)
+               Bind<RegistryValueType::String>("ReleaseId", result.ReleaseId),
+               // CurrentMajorVersionNumber=dword:0xa(10)
+               // (Windows 10 only)
+               Bind<RegistryValueType::Dword>("CurrentMajorVersionNumber", result.CurrentMajorVersionNumber),
+               // CurrentMinorVersionNumber=dword:0x0(0)
+               // (Windows 10 only)
+               Bind<RegistryValueType::Dword>("CurrentMinorVersionNumber", result.CurrentMinorVersionNumber),
+               // CurrentVersion="6.3"
+               Bind<RegistryValueType::String>("CurrentVersion", result.CurrentVersion),
+               // CurrentBuildNumber="15063"
+               Bind<RegistryValueType::String>("CurrentBuildNumber", result.CurrentBuildNumber),
+               // UBR = dword:0x2a2(674)
+               // Update Build Revision
+               Bind<RegistryValueType::Dword>("UBR", result.UBR),
+               // CSDVersion="Service Pack 1"
+               // Service Pack name
+               // (Windows 7 only, Service Pack information)
+               Bind<RegistryValueType::String>("CSDVersion", result.CSDVersion),
+               // CSDBuildNumber="1130"
+               // Service Pack build number
+               // (Windows 7 only, Service Pack information)
+               Bind<RegistryValueType::String>("CSDBuildNumber", result.CSDBuildNumber));
+}
+
+void CompleteInformation(OperatingSystemInfoFieldMask fields, OperatingSystemInfo& result)
+{
+    if (result.CurrentMajorVersionNumber == "10") // Windows 10 and 11
+    {
+        if (auto release = detail::FindRelease(result))
+        {
+            result.Codename = std::string(release->Codename);
+            result.MarketName = std::string(release->MarketName);
+        }
+    }
+
+    // Drop what we only fetched as an input of another field.
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        if (!fields.Has(field.Field))
+        {
+            field.Get(result).reset();
+        }
+    });
+}
+} // namespace detail
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "IRegistryBackend.h"
+#include "IWmiProvider.h"
+#include "OperatingSystemInfo.h"
+#include "OperatingSystemInfoField.h"
+#include "WindowsBuildCatalog.h"
+
+#include <chrono>
+
+// Steps of OperatingSystemInfoFetcher which only depend on the backend interfaces,
+// so that the benchmarks can run them against InMemoryWmi and InMemoryReg.
+namespace detail
+{
+// Fields collected from WMI Win32_OperatingSystem and from [HKLM\SOFTWARE\Microsoft\Windows NT\CurrentVersion].
+constexpr OperatingSystemInfoFieldMask s_WmiFields = GetSourceFields(OperatingSystemInfoFieldSource::Wmi);
+constexpr OperatingSystemInfoFieldMask s_RegistryFields = GetSourceFields(OperatingSystemInfoFieldSource::Registry);
+
+// Requested fields plus the inputs of the fields we make ourselves (OSVersion, Codename, MarketName).
+OperatingSystemInfoFieldMask GetNeededFields(OperatingSystemInfoFieldMask fields);
+
+// Fills the needed s_WmiFields from Win32_OperatingSystem, and OSVersion when requested.
+// Returns false, leaving them unset, when WMI did not answer by deadline.
+bool ReadOperatingSystemObject(IWmiProvider& provider, OperatingSystemInfoFieldMask needed,
+                               OperatingSystemInfoFieldMask fields, OperatingSystemInfo& result,
+                               std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+// Reads the values of [HKLM\SOFTWARE\Microsoft\Windows NT\CurrentVersion] from an opened key
+// in a single pass over its values. reg is WindowsReg for the live registry or OfflineReg for a hive file.
+void ReadCurrentVersionValues(const IRegistryBackend& reg, OperatingSystemInfo& result);
+
+// Release of the build, or of the branch for builds missing from the catalog.
+const WindowsRelease* FindRelease(const OperatingSystemInfo& info);
+
+// Sets Codename and MarketName, then drops what we only fetched as an input of another field.
+void CompleteInformation(OperatingSystemInfoFieldMask fields, OperatingSystemInfo& result);
+} // namespace detail
@@ -0,0 +1,14 @@
+#include "pch.h"
+#include "OperatingSystemInfoStream.h"
+#include "OperatingSystemInfoField.h"
+
+std::ostream& operator<<(std::ostream& out, const OperatingSystemInfo& info)
+{
+    ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+        if (const auto& value = field.Get(info))
+        {
+            out << field.Name << " = " << *value << '\n';
+        }
+    });
+    return out;
+}
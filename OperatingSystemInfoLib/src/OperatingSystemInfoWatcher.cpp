@@ -0,0 +1,180 @@
+#include "pch.h"
+#include "OperatingSystemInfoWatcher.h"
+#include "OperatingSystemInfoProvider.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include "RegistryChangeSource.h"
+#else
+#include "FileChangeSource.h"
+#endif
+
+namespace detail
+{
+// The provider returns an empty result when the fetcher failed, requested fields are "N/A" otherwise.
+bool IsEmpty(const OperatingSystemInfo& info)
+{
+    return AllOfFields([&](const OperatingSystemInfoFieldDescriptor& field) { return !field.Get(info); });
+}
+} // namespace detail
+
+OperatingSystemInfoWatcher::OperatingSystemInfoWatcher(OperatingSystemInfoProvider& provider,
+                                                       OperatingSystemInfoFieldMask fields,
+                                                       std::chrono::steady_clock::duration settleDelay) noexcept
+    : m_Provider(provider), m_Fields(fields), m_SettleDelay(settleDelay)
+{
+}
+
+OperatingSystemInfoWatcher::~OperatingSystemInfoWatcher()
+{
+    Stop();
+}
+
+void OperatingSystemInfoWatcher::AddSource(std::unique_ptr<IChangeSource> source)
+{
+    m_Sources.push_back(std::move(source));
+}
+
+bool OperatingSystemInfoWatcher::Start()
+{
+    Stop();
+    {
+        auto info = m_Provider.GetInformation(m_Fields);
+        std::lock_guard<std::mutex> lock(m_InfoMutex);
+        m_Info = std::move(info);
+    }
+
+    m_Thread = std::thread(&OperatingSystemInfoWatcher::Run, this);
+    for (auto& source : m_Sources)
+    {
+        if (!source->Start([this] { OnChange(); }))
+        {
+            Stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void OperatingSystemInfoWatcher::Stop()
+{
+    // No notification comes in once the sources are stopped.
+    for (auto& source : m_Sources)
+    {
+        source->Stop();
+    }
+    if (m_Thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_WakeUp.notify_one();
+        m_Thread.join();
+    }
+    m_Changed = false;
+    m_Stopping = false;
+}
+
+size_t OperatingSystemInfoWatcher::Subscribe(Callback callback)
+{
+    std::lock_guard<std::mutex> lock(m_SubscribersMutex);
+    m_Subscribers.emplace_back(m_NextSubscription, std::move(callback));
+    return m_NextSubscription++;
+}
+
+void OperatingSystemInfoWatcher::Unsubscribe(size_t subscription)
+{
+    std::lock_guard<std::mutex> lock(m_SubscribersMutex);
+    m_Subscribers.erase(std::remove_if(m_Subscribers.begin(), m_Subscribers.end(),
+                                       [subscription](const std::pair<size_t, Callback>& subscriber) {
+                                           return subscriber.first == subscription;
+                                       }),
+                        m_Subscribers.end());
+}
+
+OperatingSystemInfo OperatingSystemInfoWatcher::GetInformation() const
+{
+    std::lock_guard<std::mutex> lock(m_InfoMutex);
+    return m_Info;
+}
+
+OperatingSystemInfoWatcherStatistics OperatingSystemInfoWatcher::GetStatistics() const noexcept
+{
+    OperatingSystemInfoWatcherStatistics statistics;
+    statistics.Notifications = m_Notifications.load(std::memory_order_relaxed);
+    statistics.Refreshes = m_Refreshes.load(std::memory_order_relaxed);
+    statistics.Published = m_Published.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+// Called from the threads of the sources.
+void OperatingSystemInfoWatcher::OnChange()
+{
+    m_Notifications.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Changed = true;
+    }
+    m_WakeUp.notify_one();
+}
+
+void OperatingSystemInfoWatcher::Run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for (;;)
+    {
+        m_WakeUp.wait(lock, [this] { return m_Changed || m_Stopping; });
+        // Notifications during the delay are covered by the refresh which follows it.
+        m_WakeUp.wait_for(lock, m_SettleDelay, [this] { return m_Stopping; });
+        if (m_Stopping)
+        {
+            return;
+        }
+        // Changes made during the refresh set the flag again and make another refresh.
+        m_Changed = false;
+        lock.unlock();
+        Refresh();
+        lock.lock();
+    }
+}
+
+void OperatingSystemInfoWatcher::Refresh()
+{
+    m_Refreshes.fetch_add(1, std::memory_order_relaxed);
+    m_Provider.Invalidate();
+    auto info = m_Provider.GetInformation(m_Fields);
+    {
+        // A failed fetch keeps the previous snapshot, the next notification tries again.
+        std::lock_guard<std::mutex> lock(m_InfoMutex);
+        if (detail::IsEmpty(info) || info == m_Info)
+        {
+            return;
+        }
+        m_Info = info;
+    }
+    m_Published.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_SubscribersMutex);
+    for (const auto& subscriber : m_Subscribers)
+    {
+        try
+        {
+            subscriber.second(info);
+        }
+        catch (...)
+        {
+            // TODO: Should put error information when logger is published.
+        }
+    }
+}
+
+std::unique_ptr<IChangeSource> CreateSystemChangeSource()
+{
+#ifdef _WIN32
+    return std::make_unique<RegistryChangeSource>();
+#else
+    return std::make_unique<FileChangeSource>(std::vector<std::string>{"/etc/os-release", "/usr/lib/os-release"});
+#endif
+}
@@ -0,0 +1,457 @@
+#include "pch.h"
+#include "OperatingSystemVersion.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+// The AVX2 parser moves 64-bit words between general purpose and vector registers, which needs x64.
+#if defined(_M_X64) || defined(__x86_64__)
+#define OPERATINGSYSTEM_VERSION_X64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX2 intrinsics anywhere, GCC and clang only in functions compiled for it.
+#if defined(__GNUC__) || defined(__clang__)
+#define OPERATINGSYSTEM_VERSION_AVX2 __attribute__((target("avx2")))
+#else
+#define OPERATINGSYSTEM_VERSION_AVX2
+#endif
+
+namespace detail
+{
+using Field = OperatingSystemInfoField;
+
+constexpr size_t MaxComponentDigits = 5;
+constexpr uint32_t MaxComponent = 0xFFFF;
+
+bool ParseVersionScalar(std::string_view text, uint64_t& packed)
+{
+    uint64_t result = 0;
+    size_t components = 0;
+    size_t i = 0;
+    for (;;)
+    {
+        uint32_t value = 0;
+        size_t digits = 0;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9' && digits <= MaxComponentDigits)
+        {
+            value = value * 10 + static_cast<uint32_t>(text[i++] - '0');
+            ++digits;
+        }
+        if (digits == 0 || digits > MaxComponentDigits || value > MaxComponent)
+        {
+            return false;
+        }
+        result |= uint64_t{value} << (48 - 16 * components++);
+        if (i == text.size())
+        {
+            break;
+        }
+        if (text[i++] != '.' || components == 4)
+        {
+            return false;
+        }
+    }
+    packed = result;
+    return components >= 2;
+}
+
+#ifdef OPERATINGSYSTEM_VERSION_X64
+inline uint32_t CountTrailingZeros(uint32_t bits)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return index;
+#else
+    return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+}
+
+inline uint64_t Load64(const char* text)
+{
+    uint64_t word;
+    std::memcpy(&word, text, sizeof(word));
+    return word;
+}
+
+inline uint32_t Load32(const char* text)
+{
+    uint32_t word;
+    std::memcpy(&word, text, sizeof(word));
+    return word;
+}
+
+// Loads the 1 to 16 characters of text into two little-endian words, zero past the end, with overlapping loads
+// so that nothing past the string is read and nothing goes through memory.
+inline void LoadShort(std::string_view text, uint64_t& low, uint64_t& high)
+{
+    const auto data = text.data();
+    const auto size = text.size();
+    high = 0;
+    if (size >= 8)
+    {
+        low = Load64(data);
+        if (size > 8)
+        {
+            high = Load64(data + size - 8) >> ((16 - size) * 8);
+        }
+    }
+    else if (size >= 4)
+    {
+        low = Load32(data) | (uint64_t{Load32(data + size - 4)} << ((size - 4) * 8));
+    }
+    else
+    {
+        low = uint64_t{static_cast<uint8_t>(data[0])} | (uint64_t{static_cast<uint8_t>(data[size / 2])} << (size / 2 * 8)) |
+              (uint64_t{static_cast<uint8_t>(data[size - 1])} << ((size - 1) * 8));
+    }
+}
+
+// Where the components of a string of 1 to 16 characters end, the dot after them or the end of the string.
+// Missing components end at the end of the string, as does the previous one, so they are empty.
+struct VersionShape
+{
+    uint32_t Ends[4];
+};
+
+// Checks the string 16 bytes at a time, then leaves the digit values in low and high.
+inline bool ClassifyVersion(std::string_view text, uint64_t& low, uint64_t& high, VersionShape& shape)
+{
+    LoadShort(text, low, high);
+    const auto chars = _mm_set_epi64x(static_cast<long long>(high), static_cast<long long>(low));
+    const auto values = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const auto digits = _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+    const auto dots = _mm_cmpeq_epi8(chars, _mm_set1_epi8('.'));
+
+    const auto size = static_cast<uint32_t>(text.size());
+    const uint32_t used = (1u << size) - 1;
+    const uint32_t dotBits = static_cast<uint32_t>(_mm_movemask_epi8(dots)) & used;
+    const uint32_t digitBits = static_cast<uint32_t>(_mm_movemask_epi8(digits)) & used;
+    // Only digits and dots, no dot at either end or next to another one, one to three dots.
+    const uint32_t secondDots = dotBits & (dotBits - 1);
+    const uint32_t thirdDot = secondDots & (secondDots - 1);
+    if ((dotBits | digitBits) != used || (dotBits & (1u | (1u << (size - 1)) | (dotBits >> 1))) != 0 || dotBits == 0 ||
+        (thirdDot & (thirdDot - 1)) != 0)
+    {
+        return false;
+    }
+    shape.Ends[0] = CountTrailingZeros(dotBits);
+    shape.Ends[1] = secondDots != 0 ? CountTrailingZeros(secondDots) : size;
+    shape.Ends[2] = thirdDot != 0 ? CountTrailingZeros(thirdDot) : size;
+    shape.Ends[3] = size;
+    // The bytes of the dots and past the string are shifted away with the other components.
+    constexpr uint64_t Zeros = 0x3030303030303030ull;
+    low ^= Zeros;
+    high ^= Zeros;
+    return true;
+}
+
+// The four components at once, one per 64-bit lane. Variable shifts right-align the digits of each lane, with
+// the most significant one in the lowest byte and leading zeros below (counts of 64 and more give zero), then
+// digits are summed by pairs, pairs by quads and quads into the lane.
+OPERATINGSYSTEM_VERSION_AVX2 inline bool ParseVersionAvx2(std::string_view text, uint64_t& packed)
+{
+    if (text.empty() || text.size() > 16)
+    {
+        return ParseVersionScalar(text, packed);
+    }
+    uint64_t low;
+    uint64_t high;
+    VersionShape shape;
+    if (!ClassifyVersion(text, low, high, shape))
+    {
+        return false;
+    }
+    const auto& ends = shape.Ends;
+    // Bit offsets of the components.
+    const auto starts = _mm256_set_epi64x((std::min)(ends[2] + 1, ends[3]) * 8, (std::min)(ends[1] + 1, ends[3]) * 8,
+                                          (ends[0] + 1) * 8, 0);
+    const auto lengths = _mm256_sub_epi64(_mm256_set_epi64x(ends[3] * 8, ends[2] * 8, ends[1] * 8, ends[0] * 8), starts);
+    const auto bits = _mm256_set1_epi64x(64);
+    const auto lows = _mm256_set1_epi64x(static_cast<long long>(low));
+    const auto highs = _mm256_set1_epi64x(static_cast<long long>(high));
+    auto words = _mm256_or_si256(_mm256_srlv_epi64(lows, starts), _mm256_sllv_epi64(highs, _mm256_sub_epi64(bits, starts)));
+    words = _mm256_or_si256(words, _mm256_srlv_epi64(highs, _mm256_sub_epi64(starts, bits)));
+    words = _mm256_sllv_epi64(words, _mm256_sub_epi64(bits, lengths));
+
+    const auto pairs = _mm256_maddubs_epi16(words, _mm256_set1_epi16(0x010A));
+    const auto quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00010064));
+    const auto values = _mm256_add_epi64(_mm256_mul_epu32(quads, _mm256_set1_epi64x(10000)), _mm256_srli_epi64(quads, 32));
+    const auto invalid = _mm256_or_si256(_mm256_cmpgt_epi64(values, _mm256_set1_epi64x(MaxComponent)),
+                                         _mm256_cmpgt_epi64(lengths, _mm256_set1_epi64x(MaxComponentDigits * 8)));
+    if (!_mm256_testz_si256(invalid, invalid))
+    {
+        return false;
+    }
+    const auto placed = _mm256_sllv_epi64(values, _mm256_set_epi64x(0, 16, 32, 48));
+    auto folded = _mm_or_si128(_mm256_castsi256_si128(placed), _mm256_extracti128_si256(placed, 1));
+    folded = _mm_or_si128(folded, _mm_unpackhi_epi64(folded, folded));
+    packed = static_cast<uint64_t>(_mm_cvtsi128_si64(folded));
+    return true;
+}
+#endif
+
+template <typename Parse>
+inline size_t ParseColumn(const std::string_view* texts, size_t count, OperatingSystemVersion* versions, Parse&& parse)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t packed = 0;
+        versions[i].Packed = parse(texts[i], packed) ? packed : 0;
+        valid += versions[i].IsValid();
+    }
+    return valid;
+}
+
+#ifdef OPERATINGSYSTEM_VERSION_X64
+// Same as ParseColumn, GCC and clang only inline ParseVersionAvx2 into functions compiled for AVX2.
+OPERATINGSYSTEM_VERSION_AVX2 size_t ParseColumnAvx2(const std::string_view* texts, size_t count, OperatingSystemVersion* versions)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t packed = 0;
+        versions[i].Packed = ParseVersionAvx2(texts[i], packed) ? packed : 0;
+        valid += versions[i].IsValid();
+    }
+    return valid;
+}
+#endif
+
+bool ParseNumber(std::string_view text, uint32_t& value)
+{
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && parsed.ec == std::errc() && parsed.ptr == text.data() + text.size() && value <= MaxComponent;
+}
+
+// number(field, value) reads a numeric field, text(field) a string field, empty when missing.
+template <typename GetNumber, typename GetText>
+bool MakeVersion(GetNumber&& number, GetText&& text, OperatingSystemVersion& version)
+{
+    OperatingSystemVersion legacy;
+    const bool hasLegacy = ParseOperatingSystemVersion(text(Field::Version), legacy) ||
+                           ParseOperatingSystemVersion(text(Field::CurrentVersion), legacy);
+    uint32_t major = 0;
+    uint32_t minor = 0;
+    if (!number(Field::CurrentMajorVersionNumber, major) || !number(Field::CurrentMinorVersionNumber, minor))
+    {
+        if (!hasLegacy)
+        {
+            return false;
+        }
+        major = legacy.Major();
+        minor = legacy.Minor();
+    }
+    uint32_t build = 0;
+    if (!number(Field::CurrentBuildNumber, build))
+    {
+        build = hasLegacy ? legacy.Build() : 0;
+    }
+    uint32_t ubr = 0;
+    if (!number(Field::UBR, ubr))
+    {
+        ubr = 0;
+    }
+    if (build == 0 || major > MaxComponent || minor > MaxComponent || build > MaxComponent || ubr > MaxComponent)
+    {
+        return false;
+    }
+    version = OperatingSystemVersion::Make(static_cast<uint16_t>(major), static_cast<uint16_t>(minor),
+                                           static_cast<uint16_t>(build), static_cast<uint16_t>(ubr));
+    return true;
+}
+} // namespace detail
+
+std::string OperatingSystemVersion::ToString() const
+{
+    return std::to_string(Major()) + "." + std::to_string(Minor()) + "." + std::to_string(Build()) + "." +
+           std::to_string(UBR());
+}
+
+bool ParseOperatingSystemVersion(std::string_view text, OperatingSystemVersion& version) noexcept
+{
+    uint64_t packed = 0;
+    if (!detail::ParseVersionScalar(text, packed) || packed == 0)
+    {
+        return false;
+    }
+    version.Packed = packed;
+    return true;
+}
+
+size_t ParseOperatingSystemVersions(const std::string_view* texts, size_t count, OperatingSystemVersion* versions) noexcept
+{
+    return ParseOperatingSystemVersions(texts, count, versions, GetSupportedSimdLevel());
+}
+
+size_t ParseOperatingSystemVersions(const std::string_view* texts, size_t count, OperatingSystemVersion* versions,
+                                    SimdLevel level) noexcept
+{
+    if (level > GetSupportedSimdLevel())
+    {
+        level = GetSupportedSimdLevel();
+    }
+    switch (level)
+    {
+#ifdef OPERATINGSYSTEM_VERSION_X64
+    case SimdLevel::Avx2:
+        return detail::ParseColumnAvx2(texts, count, versions);
+#endif
+    default:
+        return detail::ParseColumn(texts, count, versions, detail::ParseVersionScalar);
+    }
+}
+
+bool GetOperatingSystemVersion(const OperatingSystemInfoView& info, OperatingSystemVersion& version) noexcept
+{
+    return detail::MakeVersion(
+        [&](OperatingSystemInfoField field, uint32_t& value) {
+            return info.Present.Has(field) && detail::ParseNumber(info.Values[static_cast<size_t>(field)], value);
+        },
+        [&](OperatingSystemInfoField field) {
+            return info.Present.Has(field) ? info.Values[static_cast<size_t>(field)] : std::string_view();
+        },
+        version);
+}
+
+bool GetOperatingSystemVersion(const OperatingSystemInfo& info, OperatingSystemVersion& version) noexcept
+{
+    return GetOperatingSystemVersion(OperatingSystemInfoView::Of(info), version);
+}
+
+bool GetOperatingSystemVersion(const CompactOperatingSystemInfo& info, const OperatingSystemInfoStringPool& strings,
+                               OperatingSystemVersion& version) noexcept
+{
+    return detail::MakeVersion(
+        [&](OperatingSystemInfoField field, uint32_t& value) {
+            value = info.Slots[static_cast<size_t>(field)];
+            return info.Inlined.Has(field);
+        },
+        [&](OperatingSystemInfoField field) {
+            return info.Present.Has(field) && !info.Inlined.Has(field) ? strings.Get(info.Slots[static_cast<size_t>(field)])
+                                                                        : std::string_view();
+        },
+        version);
+}
+
+void OperatingSystemVersionIndex::Build(const OperatingSystemVersion* versions, size_t count)
+{
+    m_Versions.clear();
+    m_Snapshots.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (versions[i].IsValid())
+        {
+            m_Versions.push_back(versions[i].Packed);
+            m_Snapshots.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    Sort();
+}
+
+void OperatingSystemVersionIndex::Build(const OperatingSystemInfoInventory& inventory, const std::vector<uint32_t>& recordIds)
+{
+    std::vector<OperatingSystemVersion> recordVersions(inventory.Size());
+    for (size_t id = 0; id < recordVersions.size(); ++id)
+    {
+        GetOperatingSystemVersion(inventory.GetCompact(static_cast<uint32_t>(id)), inventory.Strings(), recordVersions[id]);
+    }
+    m_Versions.clear();
+    m_Snapshots.clear();
+    for (size_t i = 0; i < recordIds.size(); ++i)
+    {
+        const auto version = recordVersions[recordIds[i]];
+        if (version.IsValid())
+        {
+            m_Versions.push_back(version.Packed);
+            m_Snapshots.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    Sort();
+}
+
+// Least significant digit radix sort, one byte per pass. It is stable, so equal versions stay in snapshot order.
+void OperatingSystemVersionIndex::Sort()
+{
+    if (m_Versions.empty())
+    {
+        return;
+    }
+    // Bytes which are the same in every version are skipped.
+    uint64_t varying = 0;
+    for (auto version : m_Versions)
+    {
+        varying |= version ^ m_Versions.front();
+    }
+    std::array<uint32_t, 8> passes;
+    size_t passCount = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        if (((varying >> shift) & 0xFF) != 0)
+        {
+            passes[passCount++] = shift;
+        }
+    }
+    if (passCount == 0)
+    {
+        return;
+    }
+
+    std::array<std::array<size_t, 256>, 8> offsets{};
+    for (auto version : m_Versions)
+    {
+        for (size_t pass = 0; pass < passCount; ++pass)
+        {
+            ++offsets[pass][(version >> passes[pass]) & 0xFF];
+        }
+    }
+    std::vector<uint64_t> versions(m_Versions.size());
+    std::vector<uint32_t> snapshots(m_Snapshots.size());
+    for (size_t pass = 0; pass < passCount; ++pass)
+    {
+        auto& offset = offsets[pass];
+        size_t total = 0;
+        for (auto& bucket : offset)
+        {
+            total += std::exchange(bucket, total);
+        }
+        const auto shift = passes[pass];
+        for (size_t i = 0; i < m_Versions.size(); ++i)
+        {
+            const auto target = offset[(m_Versions[i] >> shift) & 0xFF]++;
+            versions[target] = m_Versions[i];
+            snapshots[target] = m_Snapshots[i];
+        }
+        m_Versions.swap(versions);
+        m_Snapshots.swap(snapshots);
+    }
+}
+
+size_t OperatingSystemVersionIndex::LowerBound(OperatingSystemVersion version) const noexcept
+{
+    return static_cast<size_t>(std::lower_bound(m_Versions.begin(), m_Versions.end(), version.Packed) - m_Versions.begin());
+}
+
+OperatingSystemVersionMatches OperatingSystemVersionIndex::Below(OperatingSystemVersion version) const noexcept
+{
+    return {m_Snapshots.data(), m_Snapshots.data() + LowerBound(version)};
+}
+
+OperatingSystemVersionMatches OperatingSystemVersionIndex::AtLeast(OperatingSystemVersion version) const noexcept
+{
+    return {m_Snapshots.data() + LowerBound(version), m_Snapshots.data() + m_Snapshots.size()};
+}
+
+OperatingSystemVersionMatches OperatingSystemVersionIndex::Between(OperatingSystemVersion low, OperatingSystemVersion high) const noexcept
+{
+    const auto begin = LowerBound(low);
+    return {m_Snapshots.data() + begin, m_Snapshots.data() + (std::max)(begin, LowerBound(high))};
+}
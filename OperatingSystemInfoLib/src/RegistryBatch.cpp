@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "RegistryBatch.h"
+#include "RegistryValueDecoder.h"
+
+bool detail::DecodeRegistryValue(const RegistryValue& value, std::string& result)
+{
+    RegistryStringView text;
+    if (!DecodeRegistryString(value, text))
+    {
+        return false;
+    }
+    text.ToUtf8(result);
+    return true;
+}
+
+bool detail::DecodeRegistryValue(const RegistryValue& value, std::wstring& result)
+{
+    RegistryStringView text;
+    if (!DecodeRegistryString(value, text))
+    {
+        return false;
+    }
+    text.ToWide(result);
+    return true;
+}
+
+bool detail::DecodeRegistryValue(const RegistryValue& value, std::vector<std::string>& result)
+{
+    RegistryMultiStringView entries;
+    if (!DecodeRegistryMultiString(value, entries))
+    {
+        return false;
+    }
+    result = entries.ToUtf8();
+    return true;
+}
+
+bool detail::DecodeRegistryValue(const RegistryValue& value, std::vector<std::wstring>& result)
+{
+    RegistryMultiStringView entries;
+    if (!DecodeRegistryMultiString(value, entries))
+    {
+        return false;
+    }
+    result = entries.ToWide();
+    return true;
+}
+
+bool detail::DecodeRegistryValue(const RegistryValue& value, uint32_t& result)
+{
+    return DecodeRegistryDword(value, result);
+}
+
+bool detail::DecodeRegistryValue(const RegistryValue& value, uint64_t& result)
+{
+    return DecodeRegistryQword(value, result);
+}
+
+bool detail::DecodeRegistryValue(const RegistryValue& value, std::vector<std::byte>& result)
+{
+    const std::byte* data = nullptr;
+    size_t size = 0;
+    DecodeRegistryBinary(value, data, size);
+    result.assign(data, data + size);
+    return true;
+}
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "RegistryChangeSource.h"
+
+RegistryChangeSource::RegistryChangeSource() noexcept
+    : RegistryChangeSource(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion")
+{
+}
+
+RegistryChangeSource::RegistryChangeSource(HKEY rootKey, std::wstring path) noexcept
+    : m_RootKey(rootKey), m_Path(std::move(path))
+{
+}
+
+RegistryChangeSource::~RegistryChangeSource()
+{
+    Stop();
+}
+
+bool RegistryChangeSource::Start(std::function<void()> onChange)
+{
+    Stop();
+    if (RegOpenKeyExW(m_RootKey, m_Path.c_str(), 0, KEY_NOTIFY, &m_Key) != ERROR_SUCCESS)
+    {
+        m_Key = nullptr;
+        return false;
+    }
+    m_ChangeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    m_StopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    // Armed before returning so that no change after Start is missed.
+    if (!m_ChangeEvent || !m_StopEvent || !Arm())
+    {
+        Stop();
+        return false;
+    }
+
+    m_OnChange = std::move(onChange);
+    m_Thread = std::thread(&RegistryChangeSource::Run, this);
+    return true;
+}
+
+void RegistryChangeSource::Stop()
+{
+    if (m_Thread.joinable())
+    {
+        SetEvent(m_StopEvent);
+        m_Thread.join();
+    }
+    // Closing the key cancels the pending notification.
+    if (m_Key)
+    {
+        RegCloseKey(m_Key);
+        m_Key = nullptr;
+    }
+    for (auto event : {&m_ChangeEvent, &m_StopEvent})
+    {
+        if (*event)
+        {
+            CloseHandle(*event);
+            *event = nullptr;
+        }
+    }
+    m_OnChange = nullptr;
+}
+
+// A notification fires once, it is armed again after each change. Without REG_NOTIFY_THREAD_AGNOSTIC
+// it would end with the thread which armed it, and Start is called from the caller's thread.
+bool RegistryChangeSource::Arm()
+{
+    constexpr DWORD Filter = REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC;
+    return RegNotifyChangeKeyValue(m_Key, FALSE, Filter, m_ChangeEvent, TRUE) == ERROR_SUCCESS;
+}
+
+void RegistryChangeSource::Run()
+{
+    const HANDLE handles[] = {m_StopEvent, m_ChangeEvent};
+    while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+    {
+        // Armed again first, a change made while onChange runs is reported by the next wait.
+        bool armed = Arm();
+        m_OnChange();
+        if (!armed)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,260 @@
+#include "pch.h"
+#include "RegistryValueDecoder.h"
+#include "Utf16.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace detail
+{
+// Number of code units before the first NUL, or count when there is none.
+size_t FindNul(const std::byte* utf16, size_t position, size_t count)
+{
+    for (size_t i = position; i < count; ++i)
+    {
+        if (LoadUtf16(utf16, i) == 0)
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+bool LookUpProcessEnvironment(std::string_view name, std::string& value)
+{
+#ifdef _WIN32
+    std::wstring wideName;
+    for (size_t i = 0; i < name.size();)
+    {
+        AppendWide(NextUtf8CodePoint(name.data(), name.size(), i), wideName);
+    }
+    // The size includes the NUL when the buffer is too small, and excludes it once the value fits.
+    std::wstring wideValue(64, L'\0');
+    for (;;)
+    {
+        SetLastError(ERROR_SUCCESS);
+        auto size = GetEnvironmentVariableW(wideName.c_str(), &wideValue[0], static_cast<DWORD>(wideValue.size()));
+        if (size == 0 && GetLastError() == ERROR_ENVVAR_NOT_FOUND)
+        {
+            return false;
+        }
+        if (size < wideValue.size())
+        {
+            wideValue.resize(size);
+            break;
+        }
+        wideValue.resize(size);
+    }
+    value = ToUtf8String(wideValue);
+    return true;
+#else
+    auto found = std::getenv(std::string(name).c_str());
+    if (!found)
+    {
+        return false;
+    }
+    value = found;
+    return true;
+#endif
+}
+} // namespace detail
+
+char16_t RegistryStringView::operator[](size_t index) const noexcept
+{
+    return static_cast<char16_t>(detail::LoadUtf16(m_Data, index));
+}
+
+void RegistryStringView::ToUtf8(std::string& result) const
+{
+    detail::Utf16LeToUtf8(m_Data, m_Length, result);
+}
+
+std::string RegistryStringView::ToUtf8() const
+{
+    std::string result;
+    ToUtf8(result);
+    return result;
+}
+
+void RegistryStringView::ToWide(std::wstring& result) const
+{
+    detail::Utf16LeToWide(m_Data, m_Length, result);
+}
+
+std::wstring RegistryStringView::ToWide() const
+{
+    std::wstring result;
+    ToWide(result);
+    return result;
+}
+
+bool RegistryStringView::operator==(std::string_view utf8) const noexcept
+{
+    size_t i = 0, j = 0;
+    while (i < m_Length && j < utf8.size())
+    {
+        if (detail::NextCodePoint(m_Data, m_Length, i) != detail::NextUtf8CodePoint(utf8.data(), utf8.size(), j))
+        {
+            return false;
+        }
+    }
+    return i == m_Length && j == utf8.size();
+}
+
+RegistryMultiStringView::Iterator::Iterator(const std::byte* data, size_t count, size_t position) noexcept
+    : m_Data(data), m_Count(count), m_Position(position)
+{
+    Find();
+}
+
+RegistryMultiStringView::Iterator& RegistryMultiStringView::Iterator::operator++() noexcept
+{
+    // Skip the entry and its NUL, a last entry without one ends at the end of the data.
+    m_Position = (std::min)(m_Position + m_Current.Length() + 1, m_Count);
+    Find();
+    return *this;
+}
+
+void RegistryMultiStringView::Iterator::Find() noexcept
+{
+    auto nul = detail::FindNul(m_Data, m_Position, m_Count);
+    if (nul == m_Position)
+    {
+        // Empty entry, the list ends here.
+        m_Position = m_Count;
+        m_Current = {};
+        return;
+    }
+    m_Current = RegistryStringView(m_Data + m_Position * 2, nul - m_Position);
+}
+
+RegistryMultiStringView::Iterator RegistryMultiStringView::begin() const noexcept
+{
+    return Iterator(m_Data, m_Count, 0);
+}
+
+RegistryMultiStringView::Iterator RegistryMultiStringView::end() const noexcept
+{
+    return Iterator(m_Data, m_Count, m_Count);
+}
+
+std::vector<std::string> RegistryMultiStringView::ToUtf8() const
+{
+    std::vector<std::string> result;
+    for (auto entry : *this)
+    {
+        result.push_back(entry.ToUtf8());
+    }
+    return result;
+}
+
+std::vector<std::wstring> RegistryMultiStringView::ToWide() const
+{
+    std::vector<std::wstring> result;
+    for (auto entry : *this)
+    {
+        result.push_back(entry.ToWide());
+    }
+    return result;
+}
+
+bool DecodeRegistryString(const RegistryValue& value, RegistryStringView& result) noexcept
+{
+    if (value.Type != RegistryValueType::String && value.Type != RegistryValueType::ExpandString)
+    {
+        return false;
+    }
+    result = RegistryStringView(value.Data, detail::FindNul(value.Data, 0, value.Size / 2));
+    return true;
+}
+
+bool DecodeRegistryMultiString(const RegistryValue& value, RegistryMultiStringView& result) noexcept
+{
+    if (value.Type != RegistryValueType::MultiString)
+    {
+        return false;
+    }
+    result = RegistryMultiStringView(value.Data, value.Size / 2);
+    return true;
+}
+
+bool DecodeRegistryDword(const RegistryValue& value, uint32_t& result) noexcept
+{
+    if (value.Size != sizeof(result))
+    {
+        return false;
+    }
+    if (value.Type == RegistryValueType::Dword)
+    {
+        std::memcpy(&result, value.Data, sizeof(result));
+        return true;
+    }
+    if (value.Type == RegistryValueType::DwordBigEndian)
+    {
+        auto bytes = reinterpret_cast<const unsigned char*>(value.Data);
+        result = (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) | (uint32_t{bytes[2]} << 8) | bytes[3];
+        return true;
+    }
+    return false;
+}
+
+bool DecodeRegistryQword(const RegistryValue& value, uint64_t& result) noexcept
+{
+    if (value.Type != RegistryValueType::Qword || value.Size != sizeof(result))
+    {
+        return false;
+    }
+    std::memcpy(&result, value.Data, sizeof(result));
+    return true;
+}
+
+bool DecodeRegistryBinary(const RegistryValue& value, const std::byte*& data, size_t& size) noexcept
+{
+    data = value.Data;
+    size = value.Size;
+    return true;
+}
+
+void ExpandRegistryString(RegistryStringView text, std::string& result)
+{
+    ExpandRegistryString(text, detail::LookUpProcessEnvironment, result);
+}
+
+void ExpandRegistryString(RegistryStringView text, const RegistryEnvironmentLookup& lookup, std::string& result)
+{
+    std::string utf8;
+    text.ToUtf8(utf8);
+
+    result.clear();
+    result.reserve(utf8.size());
+    std::string value;
+    size_t position = 0;
+    for (;;)
+    {
+        auto open = utf8.find('%', position);
+        auto close = open == std::string::npos ? std::string::npos : utf8.find('%', open + 1);
+        if (close == std::string::npos)
+        {
+            result.append(utf8, position, std::string::npos);
+            return;
+        }
+        result.append(utf8, position, open - position);
+        auto name = std::string_view(utf8).substr(open + 1, close - open - 1);
+        if (!name.empty() && lookup(name, value))
+        {
+            result += value;
+            position = close + 1;
+        }
+        else
+        {
+            // Not a variable, the closing % may open the next one.
+            result.append(utf8, open, close - open);
+            position = close;
+        }
+    }
+}
@@ -0,0 +1,363 @@
+#include "pch.h"
+#include "SharedOperatingSystemInfo.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace detail
+{
+struct SharedSegment
+{
+    std::atomic<uint32_t> Magic;
+    std::atomic<uint32_t> Version;
+    std::atomic<uint32_t> Capacity;
+    std::atomic<uint32_t> Sequence;
+    std::atomic<int64_t> Published;
+    std::atomic<uint32_t> Size;
+    alignas(SharedOperatingSystemInfoFormat::HeaderSize)
+        std::atomic<uint64_t> Record[SharedOperatingSystemInfoFormat::Capacity / sizeof(uint64_t)];
+};
+
+// Other processes map the same bytes, the atomics must not hide a lock.
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<int64_t>::is_always_lock_free);
+static_assert(sizeof(SharedSegment) == SharedOperatingSystemInfoFormat::HeaderSize + SharedOperatingSystemInfoFormat::Capacity);
+
+// A publisher rewrites the record in well under a microsecond, readers give up when it keeps doing so.
+constexpr int MaxReadAttempts = 64;
+
+std::string GetSegmentName(const std::string& name)
+{
+#ifdef _WIN32
+    return "Local\\OperatingSystemInfo." + name;
+#else
+    return "/OperatingSystemInfo." + name;
+#endif
+}
+
+int64_t GetSteadyNow() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Write>
+void WriteLocked(SharedSegment& segment, Write write) noexcept
+{
+    auto sequence = segment.Sequence.load(std::memory_order_relaxed);
+    segment.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    // Readers which see any of the writes below also see the odd sequence.
+    std::atomic_thread_fence(std::memory_order_release);
+    write();
+    segment.Sequence.store(sequence + 2, std::memory_order_release);
+}
+} // namespace detail
+
+SharedOperatingSystemInfoPublisher::SharedOperatingSystemInfoPublisher(std::string name) noexcept : m_Name(std::move(name))
+{
+}
+
+SharedOperatingSystemInfoPublisher::~SharedOperatingSystemInfoPublisher()
+{
+    if (!m_Segment)
+    {
+        return;
+    }
+    Withdraw();
+#ifdef _WIN32
+    UnmapViewOfFile(m_Segment);
+    CloseHandle(m_Mapping);
+#else
+    munmap(m_Segment, sizeof(detail::SharedSegment));
+    shm_unlink(detail::GetSegmentName(m_Name).c_str());
+#endif
+}
+
+bool SharedOperatingSystemInfoPublisher::Open()
+{
+    if (m_Segment)
+    {
+        return true;
+    }
+    const auto name = detail::GetSegmentName(m_Name);
+#ifdef _WIN32
+    m_Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(detail::SharedSegment),
+                                   name.c_str());
+    if (!m_Mapping)
+    {
+        return false;
+    }
+    void* data = MapViewOfFile(m_Mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(detail::SharedSegment));
+    if (!data)
+    {
+        CloseHandle(m_Mapping);
+        m_Mapping = nullptr;
+        return false;
+    }
+#else
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    void* data = MAP_FAILED;
+    if (ftruncate(fd, sizeof(detail::SharedSegment)) == 0)
+    {
+        data = mmap(nullptr, sizeof(detail::SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+#endif
+    // New segments are zeroed. A previous publisher may have died while writing and left the sequence odd,
+    // the sequence goes on from there so that readers which mapped the old segment notice the change.
+    m_Segment = static_cast<detail::SharedSegment*>(data);
+    auto sequence = m_Segment->Sequence.load(std::memory_order_relaxed);
+    if (sequence & 1)
+    {
+        m_Segment->Sequence.store(sequence + 1, std::memory_order_relaxed);
+    }
+    Withdraw();
+    m_Segment->Version.store(SharedOperatingSystemInfoFormat::Version, std::memory_order_relaxed);
+    m_Segment->Capacity.store(SharedOperatingSystemInfoFormat::Capacity, std::memory_order_relaxed);
+    m_Segment->Magic.store(SharedOperatingSystemInfoFormat::Magic, std::memory_order_release);
+    return true;
+}
+
+bool SharedOperatingSystemInfoPublisher::Publish(const OperatingSystemInfo& info)
+{
+    if (!m_Segment)
+    {
+        return false;
+    }
+    m_Writer.Clear();
+    const auto size = m_Writer.Append(info);
+    if (size > SharedOperatingSystemInfoFormat::Capacity)
+    {
+        return false;
+    }
+    const auto published = detail::GetSteadyNow();
+    detail::WriteLocked(*m_Segment, [&] {
+        const auto data = m_Writer.Data();
+        for (size_t offset = 0; offset < size; offset += sizeof(uint64_t))
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, data + offset, (std::min)(sizeof(word), size - offset));
+            m_Segment->Record[offset / sizeof(uint64_t)].store(word, std::memory_order_relaxed);
+        }
+        m_Segment->Size.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+        m_Segment->Published.store(published, std::memory_order_relaxed);
+    });
+    return true;
+}
+
+void SharedOperatingSystemInfoPublisher::Withdraw() noexcept
+{
+    if (m_Segment)
+    {
+        detail::WriteLocked(*m_Segment, [this] { m_Segment->Published.store(0, std::memory_order_relaxed); });
+    }
+}
+
+SharedOperatingSystemInfoReader::SharedOperatingSystemInfoReader(std::string name) noexcept : m_Name(std::move(name))
+{
+}
+
+SharedOperatingSystemInfoReader::~SharedOperatingSystemInfoReader()
+{
+    auto segment = m_Segment.load(std::memory_order_relaxed);
+    if (!segment)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(segment);
+    CloseHandle(m_Mapping);
+#else
+    munmap(const_cast<detail::SharedSegment*>(segment), sizeof(detail::SharedSegment));
+    for (auto retired : m_Retired)
+    {
+        munmap(const_cast<detail::SharedSegment*>(retired), sizeof(detail::SharedSegment));
+    }
+#endif
+}
+
+bool SharedOperatingSystemInfoReader::Open()
+{
+    std::lock_guard<std::mutex> lock(m_OpenMutex);
+    const auto current = m_Segment.load(std::memory_order_relaxed);
+    const auto name = detail::GetSegmentName(m_Name);
+#ifdef _WIN32
+    // The mapping lives as long as a handle to it, a restarted publisher opens the one readers hold.
+    if (current)
+    {
+        return true;
+    }
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!mapping)
+    {
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(detail::SharedSegment));
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+#else
+    // The publisher unlinks the name when it exits, the segment mapped before stays the best there is until
+    // the next one creates a new segment.
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return current != nullptr;
+    }
+    struct stat status{};
+    void* data = MAP_FAILED;
+    if (fstat(fd, &status) == 0)
+    {
+        if (current && static_cast<uint64_t>(status.st_dev) == m_Device && static_cast<uint64_t>(status.st_ino) == m_Inode)
+        {
+            close(fd);
+            return true;
+        }
+        if (static_cast<size_t>(status.st_size) >= sizeof(detail::SharedSegment))
+        {
+            data = mmap(nullptr, sizeof(detail::SharedSegment), PROT_READ, MAP_SHARED, fd, 0);
+        }
+    }
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return current != nullptr;
+    }
+#endif
+    // The publisher may still be setting the segment up, or be of another version.
+    auto segment = static_cast<const detail::SharedSegment*>(data);
+    if (segment->Magic.load(std::memory_order_acquire) != SharedOperatingSystemInfoFormat::Magic ||
+        segment->Version.load(std::memory_order_relaxed) != SharedOperatingSystemInfoFormat::Version ||
+        segment->Capacity.load(std::memory_order_relaxed) != SharedOperatingSystemInfoFormat::Capacity)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+#else
+        munmap(data, sizeof(detail::SharedSegment));
+#endif
+        return current != nullptr;
+    }
+#ifdef _WIN32
+    m_Mapping = mapping;
+#else
+    // Reads may still be copying out of the old segment, it is unmapped with the reader.
+    if (current)
+    {
+        m_Retired.push_back(current);
+    }
+    m_Device = static_cast<uint64_t>(status.st_dev);
+    m_Inode = static_cast<uint64_t>(status.st_ino);
+#endif
+    m_Segment.store(segment, std::memory_order_release);
+    return true;
+}
+
+bool SharedOperatingSystemInfoReader::Read(std::byte* buffer, OperatingSystemInfoRecordView& record,
+                                           std::chrono::steady_clock::duration maxAge) const noexcept
+{
+    auto segment = m_Segment.load(std::memory_order_acquire);
+    if (!segment)
+    {
+        return false;
+    }
+    for (int attempt = 0; attempt < detail::MaxReadAttempts; ++attempt)
+    {
+        const auto before = segment->Sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        const auto published = segment->Published.load(std::memory_order_relaxed);
+        // A torn size is caught by the sequence check, it only has to stay within the buffer until then.
+        const size_t size = (std::min)(size_t{segment->Size.load(std::memory_order_relaxed)}, SharedOperatingSystemInfoFormat::Capacity);
+        for (size_t offset = 0; offset < size; offset += sizeof(uint64_t))
+        {
+            auto word = segment->Record[offset / sizeof(uint64_t)].load(std::memory_order_relaxed);
+            std::memcpy(buffer + offset, &word, sizeof(word));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (segment->Sequence.load(std::memory_order_relaxed) != before)
+        {
+            continue;
+        }
+        if (published == 0 || detail::GetSteadyNow() - published > std::chrono::duration_cast<std::chrono::nanoseconds>(maxAge).count())
+        {
+            return false;
+        }
+        return record.Parse(buffer, size);
+    }
+    return false;
+}
+
+bool SharedOperatingSystemInfoReader::Read(OperatingSystemInfoRecordView& record, std::chrono::steady_clock::duration maxAge) noexcept
+{
+    return Read(m_Buffer.data(), record, maxAge);
+}
+
+bool SharedOperatingSystemInfoReader::Read(OperatingSystemInfo& info, std::chrono::steady_clock::duration maxAge) const
+{
+    alignas(8) std::array<std::byte, SharedOperatingSystemInfoFormat::Capacity> buffer;
+    OperatingSystemInfoRecordView record;
+    if (!Read(buffer.data(), record, maxAge))
+    {
+        return false;
+    }
+    info = record.ToOperatingSystemInfo();
+    return true;
+}
+
+SharedOperatingSystemInfoFetcher::SharedOperatingSystemInfoFetcher(std::string name, std::chrono::steady_clock::duration maxAge,
+                                                                   std::unique_ptr<IOperatingSystemInfoFetcher> fallback) noexcept
+    : m_Reader(std::move(name)), m_MaxAge(maxAge), m_Fallback(std::move(fallback))
+{
+}
+
+OperatingSystemInfo SharedOperatingSystemInfoFetcher::GetInformation()
+{
+    return GetInformation(OperatingSystemInfoFieldMask::All());
+}
+
+OperatingSystemInfo SharedOperatingSystemInfoFetcher::GetInformation(OperatingSystemInfoFieldMask fields)
+{
+    // Open is tried again on every miss, a publisher may have started or restarted since the last one.
+    OperatingSystemInfo info;
+    if ((m_Reader.IsOpen() && m_Reader.Read(info, m_MaxAge)) || (m_Reader.Open() && m_Reader.Read(info, m_MaxAge)))
+    {
+        m_Hits.fetch_add(1, std::memory_order_relaxed);
+        ForEachField([&](const OperatingSystemInfoFieldDescriptor& field) {
+            if (!fields.Has(field.Field))
+            {
+                field.Get(info).reset();
+            }
+        });
+        return info;
+    }
+    m_Misses.fetch_add(1, std::memory_order_relaxed);
+    return m_Fallback ? m_Fallback->GetInformation(fields) : OperatingSystemInfo();
+}
+
+SharedOperatingSystemInfoStatistics SharedOperatingSystemInfoFetcher::GetStatistics() const noexcept
+{
+    SharedOperatingSystemInfoStatistics statistics;
+    statistics.Hits = m_Hits.load(std::memory_order_relaxed);
+    statistics.Misses = m_Misses.load(std::memory_order_relaxed);
+    return statistics;
+}
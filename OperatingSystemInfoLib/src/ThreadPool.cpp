@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace detail
+{
+// Identifies the pool and queue of the current worker thread, so nested submissions stay local.
+thread_local const ThreadPool* t_CurrentPool = nullptr;
+thread_local size_t t_CurrentQueue = 0;
+} // namespace detail
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+    m_Queues.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        m_Queues.push_back(std::make_unique<Queue>());
+    }
+    m_Workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        m_Workers.emplace_back([this, i] { Work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_WakeUp.notify_all();
+    for (auto& worker : m_Workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    auto index = detail::t_CurrentPool == this ? detail::t_CurrentQueue
+                                               : m_NextQueue.fetch_add(1, std::memory_order_relaxed) % m_Queues.size();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Queues[index]->Mutex);
+        m_Queues[index]->Tasks.push_back(std::move(task));
+    }
+    m_WakeUp.notify_one();
+}
+
+bool ThreadPool::RunPending()
+{
+    // A worker starts with its own deque, where its latest submissions are.
+    std::function<void()> task;
+    if (!TryPop(detail::t_CurrentPool == this ? detail::t_CurrentQueue : 0, task))
+    {
+        return false;
+    }
+    m_Pending.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+}
+
+bool ThreadPool::TryPop(size_t index, std::function<void()>& task)
+{
+    {
+        auto& own = *m_Queues[index];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        if (!own.Tasks.empty())
+        {
+            task = std::move(own.Tasks.back());
+            own.Tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < m_Queues.size(); ++offset)
+    {
+        auto& victim = *m_Queues[(index + offset) % m_Queues.size()];
+        std::lock_guard<std::mutex> lock(victim.Mutex);
+        if (!victim.Tasks.empty())
+        {
+            task = std::move(victim.Tasks.front());
+            victim.Tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::Work(size_t index)
+{
+    detail::t_CurrentPool = this;
+    detail::t_CurrentQueue = index;
+
+    std::function<void()> task;
+    for (;;)
+    {
+        if (TryPop(index, task))
+        {
+            m_Pending.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_WakeUp.wait(lock, [this] { return m_Stopping || m_Pending.load(std::memory_order_relaxed) > 0; });
+        if (m_Stopping && m_Pending.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+
+#include "Utf16Transcoder.h"
+
+// UTF-16LE conversions for raw registry data, which has no alignment guarantee, and UTF-8 helpers.
+namespace detail
+{
+inline uint32_t LoadUtf16(const std::byte* utf16, size_t index)
+{
+    uint16_t unit = 0;
+    std::memcpy(&unit, utf16 + index * 2, sizeof(unit));
+    return unit;
+}
+
+// Decodes one code point from UTF-16LE, unpaired surrogates become U+FFFD.
+inline uint32_t NextCodePoint(const std::byte* utf16, size_t count, size_t& i)
+{
+    uint32_t c = LoadUtf16(utf16, i++);
+    if (c >= 0xD800 && c <= 0xDBFF && i < count)
+    {
+        uint32_t low = LoadUtf16(utf16, i);
+        if (low >= 0xDC00 && low <= 0xDFFF)
+        {
+            ++i;
+            return 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        }
+    }
+    return c >= 0xD800 && c <= 0xDFFF ? 0xFFFD : c;
+}
+
+// Writes the UTF-8 form of a code point, returns the number of bytes written (1 to 4).
+inline size_t EncodeUtf8(uint32_t c, char* out)
+{
+    if (c < 0x80)
+    {
+        out[0] = static_cast<char>(c);
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        out[0] = static_cast<char>(0xC0 | (c >> 6));
+        out[1] = static_cast<char>(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000)
+    {
+        out[0] = static_cast<char>(0xE0 | (c >> 12));
+        out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (c >> 18));
+    out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (c & 0x3F));
+    return 4;
+}
+
+// Decodes one code point from UTF-8, invalid or truncated sequences become U+FFFD.
+inline uint32_t NextUtf8CodePoint(const char* utf8, size_t count, size_t& i)
+{
+    auto lead = static_cast<unsigned char>(utf8[i++]);
+    if (lead < 0x80)
+    {
+        return lead;
+    }
+    size_t length = lead >= 0xF0 && lead < 0xF5 ? 3 : lead >= 0xE0 ? (lead < 0xF0 ? 2 : 0) : lead >= 0xC2 ? 1 : 0;
+    if (length == 0 || count - i < length)
+    {
+        return 0xFFFD;
+    }
+    uint32_t c = lead & (0x3F >> length);
+    for (size_t k = 0; k < length; ++k)
+    {
+        auto next = static_cast<unsigned char>(utf8[i + k]);
+        if ((next & 0xC0) != 0x80)
+        {
+            return 0xFFFD;
+        }
+        c = (c << 6) | (next & 0x3F);
+    }
+    i += length;
+    constexpr uint32_t Minimum[] = {0, 0x80, 0x800, 0x10000};
+    return c < Minimum[length] || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF) ? 0xFFFD : c;
+}
+
+// Appends a code point to a wide string, as a surrogate pair where wchar_t is 16-bit.
+inline void AppendWide(uint32_t c, std::wstring& result)
+{
+    if (sizeof(wchar_t) == 2 && c >= 0x10000)
+    {
+        c -= 0x10000;
+        result.push_back(static_cast<wchar_t>(0xD800 + (c >> 10)));
+        result.push_back(static_cast<wchar_t>(0xDC00 + (c & 0x3FF)));
+        return;
+    }
+    result.push_back(static_cast<wchar_t>(c));
+}
+
+inline void Utf16LeToUtf8(const std::byte* utf16, size_t count, std::string& result)
+{
+    result.resize(GetUtf8BufferSize(count));
+    result.resize(ConvertUtf16ToUtf8(utf16, count, &result[0]));
+}
+
+inline void Utf16LeToWide(const std::byte* utf16, size_t count, std::wstring& result)
+{
+    if constexpr (sizeof(wchar_t) == 2)
+    {
+        result.resize(count);
+        std::memcpy(result.data(), utf16, count * 2);
+    }
+    else
+    {
+        result.clear();
+        result.reserve(count);
+        for (size_t i = 0; i < count;)
+        {
+            result.push_back(static_cast<wchar_t>(NextCodePoint(utf16, count, i)));
+        }
+    }
+}
+
+// Converts a wide string to UTF-8, wchar_t holds UTF-16 on Windows and UTF-32 elsewhere.
+inline std::string ToUtf8String(const std::wstring& wideCharStr)
+{
+    std::string result;
+    if constexpr (sizeof(wchar_t) == 2)
+    {
+        result.resize(GetUtf8BufferSize(wideCharStr.size()));
+        result.resize(ConvertUtf16ToUtf8(wideCharStr.data(), wideCharStr.size(), &result[0]));
+    }
+    else
+    {
+        result.reserve(wideCharStr.size());
+        char buffer[4];
+        for (auto c : wideCharStr)
+        {
+            auto codePoint = static_cast<uint32_t>(c);
+            if (codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+            {
+                codePoint = 0xFFFD;
+            }
+            result.append(buffer, EncodeUtf8(codePoint, buffer));
+        }
+    }
+    return result;
+}
+} // namespace detail
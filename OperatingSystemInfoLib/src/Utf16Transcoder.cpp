@@ -0,0 +1,257 @@
+#include "pch.h"
+#include "Utf16Transcoder.h"
+#include "Utf16.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define UTF16_TRANSCODER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX2 intrinsics anywhere, GCC and clang only in functions compiled for it.
+#if defined(__GNUC__) || defined(__clang__)
+#define UTF16_TRANSCODER_AVX2 __attribute__((target("avx2")))
+#else
+#define UTF16_TRANSCODER_AVX2
+#endif
+
+namespace detail
+{
+// Encodes the code units [i, end), which hold no surrogate.
+inline char* EncodeBasicPlane(const std::byte* utf16, size_t i, size_t end, char* out)
+{
+    for (; i < end; ++i)
+    {
+        out += EncodeUtf8(LoadUtf16(utf16, i), out);
+    }
+    return out;
+}
+
+// Encodes from i up to end, a pair starting at end - 1 is completed with the unit at end. Returns the next unit.
+inline size_t EncodeAny(const std::byte* utf16, size_t count, size_t i, size_t end, char*& out)
+{
+    while (i < end)
+    {
+        out += EncodeUtf8(NextCodePoint(utf16, count, i), out);
+    }
+    return i;
+}
+
+size_t ConvertScalar(const std::byte* utf16, size_t count, char* output)
+{
+    char* out = output;
+    size_t i = 0;
+    while (i < count)
+    {
+        // Four ASCII units at a time.
+        if (count - i >= 4)
+        {
+            uint64_t units = 0;
+            std::memcpy(&units, utf16 + i * 2, sizeof(units));
+            if ((units & 0xFF80FF80FF80FF80ull) == 0)
+            {
+                out[0] = static_cast<char>(units);
+                out[1] = static_cast<char>(units >> 16);
+                out[2] = static_cast<char>(units >> 32);
+                out[3] = static_cast<char>(units >> 48);
+                out += 4;
+                i += 4;
+                continue;
+            }
+        }
+        out += EncodeUtf8(NextCodePoint(utf16, count, i), out);
+    }
+    return static_cast<size_t>(out - output);
+}
+
+// Validates from i up to end, a pair starting at end - 1 is completed with the unit at end.
+inline bool ValidateScalar(const std::byte* utf16, size_t count, size_t& i, size_t end)
+{
+    while (i < end)
+    {
+        auto c = LoadUtf16(utf16, i++);
+        if (c >= 0xD800 && c <= 0xDBFF)
+        {
+            if (i == count || LoadUtf16(utf16, i) < 0xDC00 || LoadUtf16(utf16, i) > 0xDFFF)
+            {
+                return false;
+            }
+            ++i;
+        }
+        else if (c >= 0xDC00 && c <= 0xDFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef UTF16_TRANSCODER_X86
+inline bool HasSurrogate(__m128i units)
+{
+    auto surrogates = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))),
+                                      _mm_set1_epi16(static_cast<short>(0xD800)));
+    return _mm_movemask_epi8(surrogates) != 0;
+}
+
+size_t ConvertSse2(const std::byte* utf16, size_t count, char* output)
+{
+    const auto nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    char* out = output;
+    size_t i = 0;
+    while (count - i >= 16)
+    {
+        auto block = reinterpret_cast<const __m128i*>(utf16 + i * 2);
+        auto low = _mm_loadu_si128(block);
+        auto high = _mm_loadu_si128(block + 1);
+        auto ascii = _mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(low, high), nonAscii), _mm_setzero_si128());
+        if (_mm_movemask_epi8(ascii) == 0xFFFF)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, high));
+            out += 16;
+            i += 16;
+        }
+        else if (!HasSurrogate(low) && !HasSurrogate(high))
+        {
+            out = EncodeBasicPlane(utf16, i, i + 16, out);
+            i += 16;
+        }
+        else
+        {
+            i = EncodeAny(utf16, count, i, i + 16, out);
+        }
+    }
+    return static_cast<size_t>(out - output) + ConvertScalar(utf16 + i * 2, count - i, out);
+}
+
+UTF16_TRANSCODER_AVX2 size_t ConvertAvx2(const std::byte* utf16, size_t count, char* output)
+{
+    const auto nonAscii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+    const auto surrogateMask = _mm256_set1_epi16(static_cast<short>(0xF800));
+    const auto surrogate = _mm256_set1_epi16(static_cast<short>(0xD800));
+    char* out = output;
+    size_t i = 0;
+    while (count - i >= 32)
+    {
+        auto block = reinterpret_cast<const __m256i*>(utf16 + i * 2);
+        auto low = _mm256_loadu_si256(block);
+        auto high = _mm256_loadu_si256(block + 1);
+        if (_mm256_testz_si256(_mm256_or_si256(low, high), nonAscii))
+        {
+            // packus interleaves the 128-bit lanes of both inputs, the permutation restores the order.
+            auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+            out += 32;
+            i += 32;
+            continue;
+        }
+        auto surrogates = _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_and_si256(low, surrogateMask), surrogate),
+                                          _mm256_cmpeq_epi16(_mm256_and_si256(high, surrogateMask), surrogate));
+        if (_mm256_testz_si256(surrogates, surrogates))
+        {
+            out = EncodeBasicPlane(utf16, i, i + 32, out);
+            i += 32;
+        }
+        else
+        {
+            i = EncodeAny(utf16, count, i, i + 32, out);
+        }
+    }
+    return static_cast<size_t>(out - output) + ConvertSse2(utf16 + i * 2, count - i, out);
+}
+#endif
+
+SimdLevel DetectSimdLevel()
+{
+#if !defined(UTF16_TRANSCODER_X86)
+    return SimdLevel::Scalar;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return SimdLevel::Sse2;
+    }
+    // The OS must save the YMM registers.
+    __cpuid(info, 1);
+    constexpr int OsXSave = 1 << 27, Avx = 1 << 28;
+    if ((info[2] & (OsXSave | Avx)) != (OsXSave | Avx) || (_xgetbv(0) & 6) != 6)
+    {
+        return SimdLevel::Sse2;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0 ? SimdLevel::Avx2 : SimdLevel::Sse2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::Avx2 : SimdLevel::Sse2;
+#endif
+}
+} // namespace detail
+
+SimdLevel GetSupportedSimdLevel() noexcept
+{
+    static const SimdLevel level = detail::DetectSimdLevel();
+    return level;
+}
+
+size_t ConvertUtf16ToUtf8(const void* utf16, size_t count, char* output) noexcept
+{
+    return ConvertUtf16ToUtf8(utf16, count, output, GetSupportedSimdLevel());
+}
+
+size_t ConvertUtf16ToUtf8(const void* utf16, size_t count, char* output, SimdLevel level) noexcept
+{
+    auto units = static_cast<const std::byte*>(utf16);
+    if (level > GetSupportedSimdLevel())
+    {
+        level = GetSupportedSimdLevel();
+    }
+    switch (level)
+    {
+#ifdef UTF16_TRANSCODER_X86
+    case SimdLevel::Avx2:
+        return detail::ConvertAvx2(units, count, output);
+    case SimdLevel::Sse2:
+        return detail::ConvertSse2(units, count, output);
+#endif
+    default:
+        return detail::ConvertScalar(units, count, output);
+    }
+}
+
+size_t ConvertUtf16ToUtf8(const Utf16String* strings, size_t stringCount, char* output, size_t* ends) noexcept
+{
+    auto level = GetSupportedSimdLevel();
+    size_t size = 0;
+    for (size_t i = 0; i < stringCount; ++i)
+    {
+        size += ConvertUtf16ToUtf8(strings[i].Data, strings[i].Count, output + size, level);
+        ends[i] = size;
+    }
+    return size;
+}
+
+bool IsValidUtf16(const void* utf16, size_t count) noexcept
+{
+    auto units = static_cast<const std::byte*>(utf16);
+    size_t i = 0;
+#ifdef UTF16_TRANSCODER_X86
+    // Only the blocks holding a surrogate are checked unit by unit.
+    while (count - i >= 8)
+    {
+        if (!detail::HasSurrogate(_mm_loadu_si128(reinterpret_cast<const __m128i*>(units + i * 2))))
+        {
+            i += 8;
+        }
+        else if (!detail::ValidateScalar(units, count, i, i + 8))
+        {
+            return false;
+        }
+    }
+#endif
+    return detail::ValidateScalar(units, count, i, count);
+}
@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "WindowsBuildCatalog.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+namespace detail
+{
+constexpr WindowsRelease s_WindowsReleases[] = {
+#define WINDOWS_RELEASE(build, version, codename, marketName, buildBranch) {build, version, codename, marketName, buildBranch},
+#include "WindowsBuildCatalog.inc"
+#undef WINDOWS_RELEASE
+};
+
+constexpr WindowsUpdate s_WindowsUpdates[] = {
+#define WINDOWS_UPDATE(build, ubr, kb, year, month, day) {build, ubr, kb, year, month, day},
+#include "WindowsBuildCatalog.inc"
+#undef WINDOWS_UPDATE
+};
+
+constexpr size_t s_WindowsReleaseCount = std::size(s_WindowsReleases);
+
+constexpr uint64_t UpdateKey(uint32_t build, uint32_t ubr)
+{
+    return static_cast<uint64_t>(build) << 32 | ubr;
+}
+
+constexpr bool ReleasesAreSorted()
+{
+    for (size_t i = 1; i < s_WindowsReleaseCount; ++i)
+    {
+        if (s_WindowsReleases[i - 1].Build >= s_WindowsReleases[i].Build)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool UpdatesAreSorted()
+{
+    for (size_t i = 1; i < std::size(s_WindowsUpdates); ++i)
+    {
+        if (UpdateKey(s_WindowsUpdates[i - 1].Build, s_WindowsUpdates[i - 1].UBR) >=
+            UpdateKey(s_WindowsUpdates[i].Build, s_WindowsUpdates[i].UBR))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(ReleasesAreSorted(), "WINDOWS_RELEASE rows must be sorted by build without duplicates");
+static_assert(UpdatesAreSorted(), "WINDOWS_UPDATE rows must be sorted by build and UBR without duplicates");
+
+// FNV-1a
+constexpr uint64_t HashBranch(std::string_view branch)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : branch)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+struct BranchEntry
+{
+    uint64_t Hash;
+    uint32_t Release;
+};
+
+struct BranchIndex
+{
+    std::array<BranchEntry, s_WindowsReleaseCount> Entries;
+    size_t Count;
+};
+
+// One entry per distinct branch pointing at its first release, sorted by hash.
+constexpr BranchIndex MakeBranchIndex()
+{
+    BranchIndex index{};
+    for (uint32_t release = 0; release < s_WindowsReleaseCount; ++release)
+    {
+        bool seen = false;
+        for (uint32_t earlier = 0; earlier < release; ++earlier)
+        {
+            seen = seen || s_WindowsReleases[earlier].BuildBranch == s_WindowsReleases[release].BuildBranch;
+        }
+        if (!seen)
+        {
+            index.Entries[index.Count++] = {HashBranch(s_WindowsReleases[release].BuildBranch), release};
+        }
+    }
+    for (size_t i = 1; i < index.Count; ++i)
+    {
+        for (size_t j = i; j > 0 && index.Entries[j - 1].Hash > index.Entries[j].Hash; --j)
+        {
+            auto entry = index.Entries[j];
+            index.Entries[j] = index.Entries[j - 1];
+            index.Entries[j - 1] = entry;
+        }
+    }
+    return index;
+}
+
+constexpr BranchIndex s_BranchIndex = MakeBranchIndex();
+
+constexpr bool BranchHashesAreUnique()
+{
+    for (size_t i = 1; i < s_BranchIndex.Count; ++i)
+    {
+        if (s_BranchIndex.Entries[i - 1].Hash == s_BranchIndex.Entries[i].Hash)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(BranchHashesAreUnique(), "two BuildBranch names hash alike, change HashBranch");
+} // namespace detail
+
+const WindowsRelease* FindWindowsRelease(uint32_t build) noexcept
+{
+    auto begin = std::begin(detail::s_WindowsReleases);
+    auto end = std::end(detail::s_WindowsReleases);
+    auto found = std::lower_bound(begin, end, build, [](const WindowsRelease& release, uint32_t key) { return release.Build < key; });
+    return found != end && found->Build == build ? &*found : nullptr;
+}
+
+const WindowsUpdate* FindWindowsUpdate(uint32_t build, uint32_t ubr) noexcept
+{
+    auto key = detail::UpdateKey(build, ubr);
+    auto begin = std::begin(detail::s_WindowsUpdates);
+    auto end = std::end(detail::s_WindowsUpdates);
+    auto found = std::lower_bound(begin, end, key, [](const WindowsUpdate& update, uint64_t value) {
+        return detail::UpdateKey(update.Build, update.UBR) < value;
+    });
+    return found != end && detail::UpdateKey(found->Build, found->UBR) == key ? &*found : nullptr;
+}
+
+const WindowsUpdate* FindLatestWindowsUpdate(uint32_t build, uint32_t ubr) noexcept
+{
+    auto key = detail::UpdateKey(build, ubr);
+    auto begin = std::begin(detail::s_WindowsUpdates);
+    auto end = std::end(detail::s_WindowsUpdates);
+    auto found = std::upper_bound(begin, end, key, [](uint64_t value, const WindowsUpdate& update) {
+        return value < detail::UpdateKey(update.Build, update.UBR);
+    });
+    return found != begin && (found - 1)->Build == build ? &*(found - 1) : nullptr;
+}
+
+const WindowsRelease* FindWindowsReleaseByBranch(std::string_view buildBranch) noexcept
+{
+    auto hash = detail::HashBranch(buildBranch);
+    auto begin = detail::s_BranchIndex.Entries.begin();
+    auto end = begin + detail::s_BranchIndex.Count;
+    auto found = std::lower_bound(begin, end, hash, [](const detail::BranchEntry& entry, uint64_t value) { return entry.Hash < value; });
+    if (found == end || found->Hash != hash)
+    {
+        return nullptr;
+    }
+    const auto& release = detail::s_WindowsReleases[found->Release];
+    return release.BuildBranch == buildBranch ? &release : nullptr;
+}
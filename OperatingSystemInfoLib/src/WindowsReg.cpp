@@ -1,11 +1,17 @@
 #include "pch.h"
 #include "WindowsReg.h"
+#include "FetchTiming.h"
+#include "RegistryBatch.h"
+#include "RegistryValueDecoder.h"
+#include <algorithm>
 #include <cassert>
+#include <cwchar>
 
 bool WindowsReg::Open(HKEY rootKey, const wchar_t* path, uint32_t mode)
 {
     Close();
 
+    FetchTimingSpan span(FetchStage::RegistryOpen);
     constexpr DWORD DefaultOptions = 0;
     auto rv = RegOpenKeyExW(rootKey, path, DefaultOptions, static_cast<REGSAM>(mode), &m_Key);
     return rv == ERROR_SUCCESS;
@@ -22,50 +28,110 @@ void WindowsReg::Close()
 
 namespace detail
 {
-    template<class T> struct DependentFalse : std::false_type {};
-
-    template<class TString>
-    bool ReadStringValueImpl(HKEY key, const typename TString::value_type* name, TString& result)
+    // Reads the data of a value into buffer, grown to the size of the value, so there is no length limit.
+    // TBuffer is a std::vector or std::basic_string, size receives the data size in bytes.
+    template <class TBuffer> bool QueryValue(HKEY key, const wchar_t* name, TBuffer& buffer, DWORD& type, DWORD& size)
     {
         if (!key)
         {
             return false;
         }
 
-        // Only support RRF_RT_REG_SZ.
-        // We haven't support RRF_RT_REG_EXPAND_SZ & RRF_RT_REG_MULTI_SZ yet.
-        typename TString::value_type data[MAX_PATH]{};
-        DWORD dataSize = sizeof(data);
-        LSTATUS rv = E_FAIL;
-        if constexpr (std::is_same_v<TString, std::wstring>)
-        {
-            rv = RegGetValueW(key, nullptr, name, RRF_RT_REG_SZ, nullptr, &data, &dataSize);
-        }
-        else if constexpr (std::is_same_v<TString, std::string>)
+        FetchTimingSpan span(FetchStage::RegistryRead);
+        constexpr size_t ElementSize = sizeof(typename TBuffer::value_type);
+        for (;;)
         {
-            rv = RegGetValueA(key, nullptr, name, RRF_RT_REG_SZ, nullptr, &data, &dataSize);
+            const auto capacity = static_cast<DWORD>(buffer.size() * ElementSize);
+            size = capacity;
+            auto data = capacity > 0 ? reinterpret_cast<LPBYTE>(&buffer[0]) : nullptr;
+            auto rv = RegQueryValueExW(key, name, nullptr, &type, data, &size);
+            // Without a buffer only the size is returned. The value may also grow between two calls.
+            if (rv == ERROR_MORE_DATA || (rv == ERROR_SUCCESS && size > capacity))
+            {
+                buffer.resize((size + ElementSize - 1) / ElementSize);
+                continue;
+            }
+            return rv == ERROR_SUCCESS;
         }
-        else
+    }
+
+    // Value names given as char are in the ANSI code page, as for the RegXxxA functions.
+    std::wstring ToWideName(const char* name)
+    {
+        std::wstring wide;
+        if (name)
         {
-            static_assert(DependentFalse<TString>::value, "Unexpected character type.");
+            int length = MultiByteToWideChar(CP_ACP, 0, name, -1, nullptr, 0);
+            wide.resize(length > 0 ? length : 1);
+            MultiByteToWideChar(CP_ACP, 0, name, -1, &wide[0], length);
+            wide.pop_back();
         }
-        if (rv != ERROR_SUCCESS)
+        return wide;
+    }
+
+    // A null name is the default value of the key.
+    RegistryValue MakeValue(const wchar_t* name, DWORD type, const void* data, DWORD size)
+    {
+        return {{name, name ? wcslen(name) : 0, true}, static_cast<RegistryValueType>(type),
+                static_cast<const std::byte*>(data), size};
+    }
+
+    template <class TResult> bool ReadDecodedValue(HKEY key, const wchar_t* name, TResult& result)
+    {
+        std::vector<std::byte> buffer;
+        DWORD type = REG_NONE;
+        DWORD size = 0;
+        if (!QueryValue(key, name, buffer, type, size))
         {
             return false;
         }
-        result = data;
-        return true;
+        return DecodeRegistryValue(MakeValue(name, type, buffer.data(), size), result);
+    }
+}
+
+bool WindowsReg::ReadValue(const wchar_t* name, RegistryValue& result, std::vector<std::byte>& buffer) const
+{
+    DWORD type = REG_NONE;
+    DWORD size = 0;
+    if (!detail::QueryValue(m_Key, name, buffer, type, size))
+    {
+        return false;
     }
+    result = detail::MakeValue(name, type, buffer.data(), size);
+    return true;
 }
 
+// The data is read straight into the result and decoded in place.
 bool WindowsReg::ReadStringValue(const wchar_t* name, std::wstring& result) const
 {
-    return detail::ReadStringValueImpl(m_Key, name, result);
+    DWORD type = REG_NONE;
+    DWORD size = 0;
+    if (!detail::QueryValue(m_Key, name, result, type, size))
+    {
+        return false;
+    }
+    RegistryStringView text;
+    if (!DecodeRegistryString(detail::MakeValue(name, type, result.data(), size), text))
+    {
+        return false;
+    }
+    result.resize(text.Length());
+    return true;
 }
 
 bool WindowsReg::ReadStringValue(const char* name, std::string& result) const
 {
-    return detail::ReadStringValueImpl(m_Key, name, result);
+    return detail::ReadDecodedValue(m_Key, detail::ToWideName(name).c_str(), result);
+}
+
+bool WindowsReg::ReadMultiStringValue(const wchar_t* name, std::vector<std::wstring>& result) const
+{
+    return detail::ReadDecodedValue(m_Key, name, result);
+}
+
+bool WindowsReg::ReadMultiStringValue(const char* name, std::vector<std::string>& result) const
+{
+    return detail::ReadDecodedValue(m_Key, detail::ToWideName(name).c_str(), result);
 }
 
 bool WindowsReg::ReadIntValue(const  wchar_t* name, uint32_t& result) const
@@ -75,6 +141,7 @@ bool WindowsReg::ReadIntValue(const  wchar_t* name, uint32_t& result) const
         return false;
     }
 
+    FetchTimingSpan span(FetchStage::RegistryRead);
     DWORD size = sizeof(result);
     auto rv = ::RegGetValueW(m_Key, nullptr, name, RRF_RT_REG_DWORD, nullptr, &result, &size);
     return rv == ERROR_SUCCESS;
@@ -87,30 +154,77 @@ bool WindowsReg::ReadInt64Value(const  wchar_t* name, uint64_t& result) const
         return false;
     }
 
+    FetchTimingSpan span(FetchStage::RegistryRead);
     DWORD size = sizeof(result);
     auto rv = ::RegGetValueW(m_Key, nullptr, name, RRF_RT_REG_QWORD, nullptr, &result, &size);
     return rv == ERROR_SUCCESS;
 }
 
 bool WindowsReg::ReadBinaryValue(const  wchar_t* name, std::vector<std::byte>& result) const
+{
+    std::vector<std::byte> out;
+    DWORD type = REG_NONE;
+    DWORD size = 0;
+    if (!detail::QueryValue(m_Key, name, out, type, size) || type != REG_BINARY)
+    {
+        return false;
+    }
+    out.resize(size);
+    result = std::move(out);
+    return true;
+}
+
+bool WindowsReg::ForEachValue(IRegistryValueVisitor& visitor) const
 {
     if (!m_Key)
     {
         return false;
     }
 
-    DWORD size = 0;
-    // We need to know the size of the blob first, then we can resize our buffer for storing the blob.
-    auto rv = RegGetValueW(m_Key, nullptr, name, RRF_RT_REG_BINARY, nullptr, nullptr, &size);
+    FetchTimingSpan span(FetchStage::RegistryRead);
+    DWORD valueCount = 0;
+    DWORD maxNameLength = 0;
+    DWORD maxDataSize = 0;
+    auto rv = RegQueryInfoKeyW(m_Key, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &valueCount, &maxNameLength,
+                               &maxDataSize, nullptr, nullptr);
     if (rv != ERROR_SUCCESS)
     {
         return false;
     }
 
-    std::vector<std::byte> out;
-    out.resize(size);
-    rv = RegGetValueW(m_Key, nullptr, name, RRF_RT_REG_BINARY, nullptr, out.data(), &size);
-    result = std::move(out);
+    // One pair of scratch buffers for the whole enumeration, sized by the largest name and data of the key.
+    std::vector<wchar_t> name(maxNameLength + 1);
+    std::vector<std::byte> data(maxDataSize);
+    DWORD index = 0;
+    while (index < valueCount)
+    {
+        DWORD nameLength = static_cast<DWORD>(name.size());
+        DWORD dataSize = static_cast<DWORD>(data.size());
+        DWORD type = REG_NONE;
+        rv = RegEnumValueW(m_Key, index, name.data(), &nameLength, nullptr, &type,
+                           reinterpret_cast<LPBYTE>(data.data()), &dataSize);
+        if (rv == ERROR_MORE_DATA)
+        {
+            // The value has been changed since RegQueryInfoKeyW, grow the buffers and read it again.
+            name.resize(name.size() * 2);
+            data.resize(std::max<size_t>(dataSize, data.size() * 2));
+            continue;
+        }
+        if (rv == ERROR_NO_MORE_ITEMS)
+        {
+            break;
+        }
+        ++index;
+        if (rv != ERROR_SUCCESS)
+        {
+            continue;
+        }
 
-    return rv == ERROR_SUCCESS;
+        RegistryValue value{{name.data(), nameLength, true}, static_cast<RegistryValueType>(type), data.data(), dataSize};
+        if (!visitor.Visit(value))
+        {
+            break;
+        }
+    }
+    return true;
 }
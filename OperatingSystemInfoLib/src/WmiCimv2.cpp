@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "WmiCimv2.h"
+
+#include <array>
+#include <vector>
+
+OSInfo WmiCimv2::GetOSInfo(OperatingSystemInfoFieldMask fields)
+{
+    OSInfo info;
+    GetOSInfo(fields, std::chrono::steady_clock::time_point::max(), info);
+    return info;
+}
+
+bool WmiCimv2::GetOSInfo(OperatingSystemInfoFieldMask fields, std::chrono::steady_clock::time_point deadline, OSInfo& info)
+{
+    info = {};
+    struct Property
+    {
+        OperatingSystemInfoField Field;
+        const wchar_t* Name;
+    };
+    constexpr std::array<Property, 8> Properties{{
+        {OperatingSystemInfoField::Caption, L"Caption"},
+        {OperatingSystemInfoField::OSArchitecture, L"OSArchitecture"},
+        {OperatingSystemInfoField::MUILanguage, L"MUILanguages"},
+        {OperatingSystemInfoField::Locale, L"Locale"},
+        {OperatingSystemInfoField::Version, L"Version"},
+        {OperatingSystemInfoField::OSLanguage, L"OSLanguage"},
+        {OperatingSystemInfoField::ServicePackMajorVersion, L"ServicePackMajorVersion"},
+        {OperatingSystemInfoField::ServicePackMinorVersion, L"ServicePackMinorVersion"},
+    }};
+
+    std::wstring query;
+    for (const auto& property : Properties)
+    {
+        if (fields.Has(property.Field))
+        {
+            query += query.empty() ? L"SELECT " : L", ";
+            query += property.Name;
+        }
+    }
+    if (query.empty())
+    {
+        return true;
+    }
+    query += L" FROM Win32_OperatingSystem";
+
+    class Visitor final : public IWmiObjectVisitor
+    {
+    public:
+        explicit Visitor(OperatingSystemInfoFieldMask fields) : m_Fields(fields)
+        {
+        }
+
+        bool Visit(const IWmiObject& object) override
+        {
+            OSInfo info{};
+            // When meeting failure case inside StoreWmiPropertyValue,
+            // we still get the remaining fields from object and return the info back to caller.
+            if (m_Fields.Has(OperatingSystemInfoField::Caption))
+            {
+                StoreWmiPropertyValue(object, L"Caption", info.Caption);
+            }
+            if (m_Fields.Has(OperatingSystemInfoField::OSArchitecture))
+            {
+                StoreWmiPropertyValue(object, L"OSArchitecture", info.OSArchitecture);
+            }
+            if (m_Fields.Has(OperatingSystemInfoField::MUILanguage))
+            {
+                std::vector<std::wstring> muilangs;
+                StoreWmiPropertyValue(object, L"MUILanguages", muilangs);
+                // currently, we only collect first element by design.
+                if (!muilangs.empty())
+                {
+                    info.MUILanguage = muilangs.front();
+                }
+            }
+            if (m_Fields.Has(OperatingSystemInfoField::Locale))
+            {
+                StoreWmiPropertyValue(object, L"Locale", info.Locale);
+            }
+            if (m_Fields.Has(OperatingSystemInfoField::Version))
+            {
+                StoreWmiPropertyValue(object, L"Version", info.Version);
+            }
+            if (m_Fields.Has(OperatingSystemInfoField::OSLanguage))
+            {
+                StoreWmiPropertyValue(object, L"OSLanguage", info.OSLanguage);
+            }
+            if (m_Fields.Has(OperatingSystemInfoField::ServicePackMajorVersion))
+            {
+                StoreWmiPropertyValue(object, L"ServicePackMajorVersion", info.ServicePackMajorVersion);
+            }
+            if (m_Fields.Has(OperatingSystemInfoField::ServicePackMinorVersion))
+            {
+                StoreWmiPropertyValue(object, L"ServicePackMinorVersion", info.ServicePackMinorVersion);
+            }
+
+            // There is a single Win32_OperatingSystem instance, the last one wins otherwise.
+            Result = std::move(info);
+            return true;
+        }
+
+        OSInfo Result;
+
+    private:
+        OperatingSystemInfoFieldMask m_Fields;
+    };
+
+    Visitor visitor(fields);
+    if (!m_Provider.ExecQuery(query.c_str(), visitor, deadline))
+    {
+        return false;
+    }
+    info = std::move(visitor.Result);
+    return true;
+}
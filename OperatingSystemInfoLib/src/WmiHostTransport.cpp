@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "WmiHostTransport.h"
+#include "OperatingSystemInfoSources.h"
+#include "WindowsReg.h"
+#include "WmiQuery.h"
+
+#include <string>
+
+namespace detail
+{
+std::wstring ToWideHostName(const std::string& host)
+{
+    std::wstring wide;
+    int length = MultiByteToWideChar(CP_UTF8, 0, host.data(), static_cast<int>(host.size()), nullptr, 0);
+    if (length > 0)
+    {
+        wide.resize(length);
+        MultiByteToWideChar(CP_UTF8, 0, host.data(), static_cast<int>(host.size()), &wide[0], length);
+    }
+    return wide;
+}
+} // namespace detail
+
+bool WmiHostTransport::Collect(const std::string& host, OperatingSystemInfoFieldMask fields,
+                               std::chrono::steady_clock::time_point deadline, OperatingSystemInfo& result,
+                               std::string& error)
+{
+    // The attempts run on the scheduler's pool, whose threads do not initialize COM themselves.
+    thread_local ComCtx t_ComCtx;
+
+    auto machine = L"\\\\" + detail::ToWideHostName(host);
+    auto needed = detail::GetNeededFields(fields);
+    if (needed.Intersects(detail::s_WmiFields))
+    {
+        WmiQuery provider;
+        if (!provider.ConnectServer(_bstr_t((machine + L"\\root\\cimv2").c_str()), WBEM_FLAG_CONNECT_USE_MAX_WAIT))
+        {
+            error = "Cannot connect to WMI on " + host;
+            return false;
+        }
+        if (!detail::ReadOperatingSystemObject(provider, needed, fields, result, deadline))
+        {
+            error = "Timed out reading WMI on " + host;
+            return false;
+        }
+    }
+
+    if (std::chrono::steady_clock::now() > deadline)
+    {
+        error = "Deadline exceeded";
+        return false;
+    }
+
+    if (needed.Intersects(detail::s_RegistryFields))
+    {
+        HKEY localMachine = nullptr;
+        if (RegConnectRegistryW(machine.c_str(), HKEY_LOCAL_MACHINE, &localMachine) != ERROR_SUCCESS)
+        {
+            error = "Cannot connect to the registry of " + host;
+            return false;
+        }
+        {
+            WindowsReg reg;
+            reg.Open(localMachine, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion");
+            detail::ReadCurrentVersionValues(reg, result);
+        }
+        RegCloseKey(localMachine);
+    }
+
+    detail::CompleteInformation(fields, result);
+    return true;
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -10,88 +10,53 @@
 #include <comdef.h>
 #include <wrl/client.h>
 
+#include "FetchTiming.h"
+#include "IWmiProvider.h"
+
 #pragma comment(lib, "Ole32.lib")
 #pragma comment(lib, "Wbemuuid.lib")
 
 namespace detail
 {
-template <class BSTRType> struct BSTRTrait;
-
-template <> struct BSTRTrait<wchar_t>
-{
-    using StdType = std::wstring;
-};
-
-template <> struct BSTRTrait<char>
-{
-    using StdType = std::string;
-};
-
-// If we need to support more different types of accessing variant member,
-// we should extend the specialization template.
-template <VARENUM ExpectedVariantType> struct VariantTrait;
-
-template <> struct VariantTrait<VARENUM::VT_BSTR>
-{
-    using Type = BSTRTrait<std::remove_pointer<BSTR>::type>::StdType;
-    static constexpr auto Value = &VARIANT::bstrVal;
-};
-
-template <> struct VariantTrait<VARENUM::VT_I4>
-{
-    using Type = INT;
-    static constexpr auto Value = &VARIANT::intVal;
-};
-
-template <> struct VariantTrait<VARENUM::VT_BOOL>
-{
-    using Type = VARIANT_BOOL;
-    static constexpr auto Value = &VARIANT::boolVal;
-};
-
-template <> struct VariantTrait<static_cast<VARENUM>(VARENUM::VT_ARRAY | VARENUM::VT_BSTR)>
-{
-    using Type = std::vector<BSTRTrait<std::remove_pointer<BSTR>::type>::StdType>;
-    static constexpr auto Value = &VARIANT::parray;
-};
-} // namespace detail
-
-// This function will assign a zero initialized value ValueType{}
-// once the expected variant type is not matched.
-template <VARENUM ExpectedVariantType>
-bool GetValueFromVariant(typename detail::VariantTrait<ExpectedVariantType>::Type& outValue, const VARIANT& variant)
-{
-    if (variant.vt == ExpectedVariantType)
-    {
-        outValue = variant.*detail::VariantTrait<ExpectedVariantType>::Value;
-        return true;
-    }
-    return false;
-}
-
-template <>
-bool GetValueFromVariant<static_cast<VARENUM>(VARENUM::VT_ARRAY | VARENUM::VT_BSTR)>(typename detail::VariantTrait<static_cast<VARENUM>(VARENUM::VT_ARRAY | VARENUM::VT_BSTR)>::Type& outValue, const VARIANT& variant)
+// Converts the variant types listed in WmiValueType, the others become NULL.
+inline void ToWmiValue(const VARIANT& variant, WmiValue& value)
 {
-    if (variant.vt != static_cast<VARENUM>(VARENUM::VT_ARRAY | VARENUM::VT_BSTR))
+    switch (variant.vt)
     {
-        return false;
-    }
-
-    long lower = 0, upper = 0;
-    SAFEARRAY *pSafeArray = variant.parray;
-    SafeArrayGetLBound(pSafeArray, 1, &lower);
-    SafeArrayGetUBound(pSafeArray, 1, &upper);
-
-    for (auto i = lower; i <= upper; i++)
+    case VT_I4:
+        value = static_cast<int32_t>(variant.intVal);
+        break;
+    case VT_BSTR:
+        value = std::wstring(variant.bstrVal, SysStringLen(variant.bstrVal));
+        break;
+    case VT_BOOL:
+        value = variant.boolVal != VARIANT_FALSE;
+        break;
+    case VT_ARRAY | VT_BSTR:
     {
-        BSTR bstrVal = nullptr;
-        if (SUCCEEDED(SafeArrayGetElement(pSafeArray, &i, &bstrVal)))
+        std::vector<std::wstring> strings;
+        long lower = 0, upper = 0;
+        SAFEARRAY* pSafeArray = variant.parray;
+        SafeArrayGetLBound(pSafeArray, 1, &lower);
+        SafeArrayGetUBound(pSafeArray, 1, &upper);
+        for (auto i = lower; i <= upper; i++)
         {
-            outValue.emplace_back(bstrVal);
+            BSTR bstrVal = nullptr;
+            if (SUCCEEDED(SafeArrayGetElement(pSafeArray, &i, &bstrVal)))
+            {
+                strings.emplace_back(bstrVal, SysStringLen(bstrVal));
+                SysFreeString(bstrVal);
+            }
         }
+        value = std::move(strings);
+        break;
+    }
+    default:
+        value = std::monostate{};
+        break;
     }
-    return true;
 }
+} // namespace detail
 
 template <typename T> class ComPtr : public Microsoft::WRL::ComPtr<T>
 {
@@ -177,26 +142,29 @@ public:
 
     ComCtx() noexcept
     {
+        FetchTimingSpan span(FetchStage::ComInitialize);
         CoInitializeEx(NULL, COINIT_MULTITHREADED);
         CoInitializeSecurity(nullptr, -1, nullptr, nullptr, RPC_C_AUTHN_LEVEL_DEFAULT, RPC_C_IMP_LEVEL_IMPERSONATE,
                              nullptr, EOAC_NONE, nullptr);
     }
 };
 
-class WmiQuery final
+class WmiQuery final : public IWmiProvider
 {
 public:
-    bool ConnectServer(BSTR networkResource) noexcept
+    // flags takes WBEM_FLAG_CONNECT_USE_MAX_WAIT for remote namespaces, to give up after two minutes.
+    bool ConnectServer(BSTR networkResource, long flags = 0) noexcept
     {
+        FetchTimingSpan span(FetchStage::ConnectServer);
         if (SUCCEEDED(
                 CoCreateInstance(CLSID_WbemLocator, 0, CLSCTX_INPROC_SERVER, IID_IWbemLocator, (LPVOID*)&m_locator)) &&
-            SUCCEEDED(m_locator->ConnectServer(networkResource, NULL, NULL, 0, NULL, 0, 0, &m_services)) &&
+            SUCCEEDED(m_locator->ConnectServer(networkResource, NULL, NULL, 0, flags, 0, 0, &m_services)) &&
             SUCCEEDED(CoSetProxyBlanket(m_services, RPC_C_AUTHN_WINNT, RPC_C_AUTHZ_NONE, NULL, RPC_C_AUTHN_LEVEL_CALL,
                                         RPC_C_IMP_LEVEL_IMPERSONATE, NULL, EOAC_NONE)))
         {
             return true;
         }
-        return true;
+        return false;
     }
 
     bool ExecQuery(BSTR query, IEnumWbemClassObject** objects) noexcept
@@ -206,6 +174,7 @@ public:
             return false;
         }
 
+        FetchTimingSpan span(FetchStage::ExecQuery);
         long flags = WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY;
         if (SUCCEEDED(m_services->ExecQuery(_bstr_t(L"WQL"), query, flags, NULL, objects)))
         {
@@ -214,108 +183,86 @@ public:
         return false;
     }
 
-private:
-    ComCtx m_env{};
-    ComPtr<IWbemLocator> m_locator{};
-    ComPtr<IWbemServices> m_services{};
-};
-
-class WmiClassAccessor
-{
-public:
-    virtual ~WmiClassAccessor() = default;
-    WmiClassAccessor(const WmiClassAccessor&) = delete;
-    WmiClassAccessor(WmiClassAccessor&&) = delete;
-    WmiClassAccessor& operator=(const WmiClassAccessor&) = delete;
-    WmiClassAccessor& operator=(WmiClassAccessor&&) = delete;
-    WmiClassAccessor() noexcept {};
-
-protected:
-    template <VARENUM ExpectedVariantType>
-    bool StoreWmiPropertyValue(ComPtr<IWbemClassObject> object, wchar_t* propertyName,
-                               typename detail::VariantTrait<ExpectedVariantType>::Type& outValue) const
-    {
-        _variant_t data;
-        HRESULT hr = object->Get(propertyName, 0, &data, nullptr, nullptr);
-        if (FAILED(hr))
-        {
-            return false;
-        }
-
-        return GetValueFromVariant<ExpectedVariantType>(outValue, data);
-    }
-
-    WmiQuery m_wmi;
-};
-
-struct OSInfo
-{
-    std::wstring Caption;
-    std::wstring OSArchitecture;
-    std::wstring MUILanguage;
-    std::wstring Locale;
-    std::wstring Version;
-    int32_t OSLanguage;
-    int32_t ServicePackMajorVersion;
-    int32_t ServicePackMinorVersion;
-};
-
-class WmiCimv2 final : private WmiClassAccessor
-{
-public:
-    ~WmiCimv2() noexcept = default;
-    WmiCimv2(const WmiCimv2&) = delete;
-    WmiCimv2(WmiCimv2&&) = delete;
-    WmiCimv2& operator=(const WmiCimv2&) = delete;
-    WmiCimv2& operator=(WmiCimv2&&) = delete;
-
-public:
-    WmiCimv2() noexcept
+    bool ExecQuery(const wchar_t* query, IWmiObjectVisitor& visitor) override
     {
-        m_wmi.ConnectServer(_bstr_t(L"root\\cimv2"));
+        return ExecQuery(query, visitor, std::chrono::steady_clock::time_point::max());
     }
 
-    OSInfo GetOSInfo()
+    // Each Next waits for the time left until deadline, WMI keeps running the query on its side after that.
+    // The query itself is sent with WBEM_FLAG_RETURN_IMMEDIATELY, so the wait for its results falls in Next.
+    // ConnectServer is not bounded by the deadline, remote connections use WBEM_FLAG_CONNECT_USE_MAX_WAIT.
+    // Exceptions of the visitor go to the caller.
+    bool ExecQuery(const wchar_t* query, IWmiObjectVisitor& visitor,
+                   std::chrono::steady_clock::time_point deadline) override
     {
         ComPtr<IEnumWbemClassObject> objects;
-        m_wmi.ExecQuery(_bstr_t(L"SELECT * FROM Win32_OperatingSystem"), &objects);
-        if (!objects)
+        if (!ExecQuery(_bstr_t(query), &objects) || !objects)
         {
-            return {};
+            return false;
         }
-        OSInfo result;
-        auto getOSInfoFromObject = [this](ComPtr<IWbemClassObject> object) {
-            OSInfo info{};
-            // When meeting failure case inside StoreWmiPropertyValue,
-            // we still get the remaining fields from object and print error log and return the info back to caller.
-            assert(StoreWmiPropertyValue<VARENUM::VT_BSTR>(object, _bstr_t(L"Caption"), info.Caption));
-            assert(StoreWmiPropertyValue<VARENUM::VT_BSTR>(object, _bstr_t(L"OSArchitecture"), info.OSArchitecture));
-            std::vector<std::wstring> muilangs;
-            assert(StoreWmiPropertyValue<static_cast<VARENUM>(VARENUM::VT_ARRAY | VARENUM::VT_BSTR)>(object, _bstr_t(L"MUILanguages"), muilangs));
-            // currently, we only collect first element by design.
-            if (!muilangs.empty())
+
+        class Object final : public IWmiObject
+        {
+        public:
+            explicit Object(IWbemClassObject* object) noexcept : m_object(object)
+            {
+            }
+
+            bool Get(const wchar_t* name, WmiValue& value) const override
             {
-                info.MUILanguage = muilangs.front();
+                _variant_t data;
+                if (FAILED(m_object->Get(name, 0, &data, nullptr, nullptr)))
+                {
+                    return false;
+                }
+                detail::ToWmiValue(data, value);
+                return true;
             }
-            assert(StoreWmiPropertyValue<VARENUM::VT_BSTR>(object, _bstr_t(L"Locale"), info.Locale));
-            assert(StoreWmiPropertyValue<VARENUM::VT_BSTR>(object, _bstr_t(L"Version"), info.Version));
-            assert(StoreWmiPropertyValue<VARENUM::VT_I4>(object, _bstr_t(L"OSLanguage"), info.OSLanguage));
-            assert(StoreWmiPropertyValue<VARENUM::VT_I4>(object, _bstr_t(L"ServicePackMajorVersion"), info.ServicePackMajorVersion));
-            assert(StoreWmiPropertyValue<VARENUM::VT_I4>(object, _bstr_t(L"ServicePackMinorVersion"), info.ServicePackMinorVersion));
 
-            return info;
+        private:
+            IWbemClassObject* m_object;
         };
+
         while (true)
         {
             ComPtr<IWbemClassObject> object;
             ULONG returned = 0;
-            objects->Next(WBEM_INFINITE, 1, &object, &returned);
+            HRESULT result = S_OK;
+            {
+                FetchTimingSpan span(FetchStage::NextObject);
+                result = objects->Next(GetTimeout(deadline), 1, &object, &returned);
+            }
+            if (result == WBEM_S_TIMEDOUT)
+            {
+                return false;
+            }
             if (returned == 0)
             {
                 break;
             }
-            result = getOSInfoFromObject(std::move(object));
+            if (!visitor.Visit(Object(object)))
+            {
+                break;
+            }
+        }
+        return true;
+    }
+
+private:
+    // Milliseconds left until deadline for IEnumWbemClassObject::Next, rounded up.
+    static long GetTimeout(std::chrono::steady_clock::time_point deadline) noexcept
+    {
+        if (deadline == std::chrono::steady_clock::time_point::max())
+        {
+            return static_cast<long>(WBEM_INFINITE);
         }
-        return result;
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        // WBEM_INFINITE is -1, longer waits are capped below it.
+        return static_cast<long>((std::min)((std::max)(remaining, decltype(remaining){0}), decltype(remaining){0x7FFFFFFE}));
     }
+
+    ComCtx m_env{};
+    ComPtr<IWbemLocator> m_locator{};
+    ComPtr<IWbemServices> m_services{};
 };
+